@@ -2,14 +2,39 @@
 
 #include "io.h"
 #include "lock.h"
+#include "math.h"
 #include "mem.h"
 #include "sphore.h"
 #include "thread.h"
 
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <vector>
 
-#define ASYNC_BUFSIZE (8 * 1024)
+// Size of the ring buffer, must be a power of two.
+#define ASYNC_BUFSIZE (64 * 1024)
 #define ASYNC_LOCAL_BUFSIZE (64 * 1024)
+// Larger writes are copied to the heap so they don't fill up the ring buffer.
+#define ASYNC_MAX_INLINE_SIZE (ASYNC_BUFSIZE / 4)
+
+// The ring buffer consists of records, each starting with an 8 byte header
+// followed by the data padded to 8 bytes. Writers reserve space for a record
+// by advancing `reserve_pos`, copy their data and then commit the record by
+// storing its header. The writer thread consumes committed records in order
+// and zeroes them again before releasing the space through `consume_pos`.
+//
+// Header: bit 0 is set once the record is committed, bit 1 marks records
+// containing a pointer to heap data instead of the data itself, the size of
+// the data is stored in the upper 32 bits.
+static constexpr uint64_t HEADER_COMMITTED = 1;
+static constexpr uint64_t HEADER_INDIRECT = 2;
+static constexpr int HEADER_SIZE = sizeof(uint64_t);
+
+// Set in `reserve_pos` while the ring buffer is full. All writes go to the
+// overflow buffer then, until the writer thread has consumed the ring buffer
+// and the overflow buffer, which keeps the writes in order.
+static constexpr uint64_t RESERVE_OVERFLOW = (uint64_t)1 << 63;
 
 struct ASYNCIO
 {
@@ -18,10 +43,17 @@ struct ASYNCIO
 	SEMAPHORE sphore;
 	void *thread;
 
-	unsigned char *buffer;
-	unsigned int buffer_size;
-	unsigned int read_pos;
-	unsigned int write_pos;
+	uint64_t *buffer;
+	alignas(64) std::atomic<uint64_t> reserve_pos;
+	alignas(64) std::atomic<uint64_t> consume_pos;
+	alignas(64) std::atomic<bool> sleeping;
+
+	CLock overflow_lock;
+	std::vector<unsigned char> overflow GUARDED_BY(overflow_lock);
+
+	// data written between `aio_lock` and `aio_unlock`, guarded by `transaction_lock`
+	CLock transaction_lock;
+	std::vector<unsigned char> transaction;
 
 	int error;
 	unsigned char finish;
@@ -35,29 +67,117 @@ enum
 	ASYNCIO_EXIT,
 };
 
-struct BUFFERS
+static unsigned char *buffer_at(ASYNCIO *aio, uint64_t pos)
 {
-	unsigned char *buf1;
-	unsigned int len1;
-	unsigned char *buf2;
-	unsigned int len2;
-};
+	return (unsigned char *)aio->buffer + (pos & (ASYNC_BUFSIZE - 1));
+}
+
+static std::atomic_ref<uint64_t> header_at(ASYNCIO *aio, uint64_t pos)
+{
+	return std::atomic_ref<uint64_t>(*(uint64_t *)buffer_at(aio, pos));
+}
+
+static unsigned record_size(unsigned size)
+{
+	return HEADER_SIZE + ((size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1));
+}
 
-static void buffer_ptrs(ASYNCIO *aio, struct BUFFERS *buffers)
+// Copies between the ring buffer and linear memory, wrapping around at the end.
+static void buffer_copy_in(ASYNCIO *aio, uint64_t pos, const void *data, unsigned size)
 {
-	mem_zero(buffers, sizeof(*buffers));
-	if(aio->read_pos < aio->write_pos)
+	const unsigned offset = pos & (ASYNC_BUFSIZE - 1);
+	const unsigned contiguous = minimum<unsigned>(size, ASYNC_BUFSIZE - offset);
+	mem_copy(buffer_at(aio, pos), data, contiguous);
+	mem_copy(aio->buffer, (const unsigned char *)data + contiguous, size - contiguous);
+}
+
+static void buffer_copy_out(ASYNCIO *aio, uint64_t pos, void *data, unsigned size)
+{
+	const unsigned offset = pos & (ASYNC_BUFSIZE - 1);
+	const unsigned contiguous = minimum<unsigned>(size, ASYNC_BUFSIZE - offset);
+	mem_copy(data, buffer_at(aio, pos), contiguous);
+	mem_copy((unsigned char *)data + contiguous, aio->buffer, size - contiguous);
+}
+
+static void buffer_zero(ASYNCIO *aio, uint64_t pos, unsigned size)
+{
+	const unsigned offset = pos & (ASYNC_BUFSIZE - 1);
+	const unsigned contiguous = minimum<unsigned>(size, ASYNC_BUFSIZE - offset);
+	mem_zero(buffer_at(aio, pos), contiguous);
+	mem_zero(aio->buffer, size - contiguous);
+}
+
+static void aio_wake(ASYNCIO *aio)
+{
+	// Only signal the writer thread if it's waiting, so many small writes
+	// are written in one batch without a wakeup each.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(aio->sleeping.load(std::memory_order_relaxed) && aio->sleeping.exchange(false, std::memory_order_relaxed))
 	{
-		buffers->buf1 = aio->buffer + aio->read_pos;
-		buffers->len1 = aio->write_pos - aio->read_pos;
+		sphore_signal(&aio->sphore);
 	}
-	else if(aio->read_pos > aio->write_pos)
+}
+
+static void aio_push(ASYNCIO *aio, const void *buffer, unsigned size)
+{
+	if(size == 0)
 	{
-		buffers->buf1 = aio->buffer + aio->read_pos;
-		buffers->len1 = aio->buffer_size - aio->read_pos;
-		buffers->buf2 = aio->buffer;
-		buffers->len2 = aio->write_pos;
+		return;
 	}
+
+	void *indirect = nullptr;
+	unsigned record = record_size(size);
+	if(record > ASYNC_MAX_INLINE_SIZE)
+	{
+		indirect = malloc(size);
+		mem_copy(indirect, buffer, size);
+		record = record_size(sizeof(indirect));
+	}
+
+	uint64_t pos = aio->reserve_pos.load(std::memory_order_relaxed);
+	while(true)
+	{
+		if(!(pos & RESERVE_OVERFLOW))
+		{
+			if(pos + record - aio->consume_pos.load(std::memory_order_acquire) <= ASYNC_BUFSIZE)
+			{
+				if(aio->reserve_pos.compare_exchange_weak(pos, pos + record, std::memory_order_relaxed))
+				{
+					break;
+				}
+				continue;
+			}
+			if(!aio->reserve_pos.compare_exchange_weak(pos, pos | RESERVE_OVERFLOW, std::memory_order_relaxed))
+			{
+				continue;
+			}
+		}
+
+		// slow path, the ring buffer is full
+		{
+			const CLockScope ls(aio->overflow_lock);
+			if(aio->reserve_pos.load(std::memory_order_relaxed) & RESERVE_OVERFLOW)
+			{
+				const unsigned char *data = indirect ? (const unsigned char *)indirect : (const unsigned char *)buffer;
+				aio->overflow.insert(aio->overflow.end(), data, data + size);
+				free(indirect);
+				aio_wake(aio);
+				return;
+			}
+		}
+		pos = aio->reserve_pos.load(std::memory_order_relaxed);
+	}
+
+	if(indirect)
+	{
+		mem_copy(buffer_at(aio, pos + HEADER_SIZE), &indirect, sizeof(indirect));
+	}
+	else
+	{
+		buffer_copy_in(aio, pos + HEADER_SIZE, buffer, size);
+	}
+	header_at(aio, pos).store(((uint64_t)size << 32) | (indirect ? HEADER_INDIRECT : 0) | HEADER_COMMITTED, std::memory_order_release);
+	aio_wake(aio);
 }
 
 static void aio_handle_free_and_unlock(ASYNCIO *aio) RELEASE(aio->lock)
@@ -75,63 +195,159 @@ static void aio_handle_free_and_unlock(ASYNCIO *aio) RELEASE(aio->lock)
 	}
 }
 
+// Collects consumed data to write it in large chunks.
+class CAioOutput
+{
+	ASYNCIO *m_pAio;
+	unsigned char m_aBuffer[ASYNC_LOCAL_BUFSIZE];
+	unsigned m_Length = 0;
+	bool m_Written = false;
+
+public:
+	CAioOutput(ASYNCIO *pAio) :
+		m_pAio(pAio) {}
+
+	unsigned char *Reserve(unsigned Size)
+	{
+		if(m_Length + Size > sizeof(m_aBuffer))
+		{
+			Flush();
+		}
+		unsigned char *pData = m_aBuffer + m_Length;
+		m_Length += Size;
+		return pData;
+	}
+
+	void Write(const void *pData, unsigned Size)
+	{
+		if(Size > sizeof(m_aBuffer))
+		{
+			Flush();
+			io_write(m_pAio->io, pData, Size);
+			m_Written = true;
+			return;
+		}
+		mem_copy(Reserve(Size), pData, Size);
+	}
+
+	void Flush()
+	{
+		if(m_Length > 0)
+		{
+			io_write(m_pAio->io, m_aBuffer, m_Length);
+			m_Length = 0;
+			m_Written = true;
+		}
+	}
+
+	bool Written() const { return m_Written; }
+	void Reset() { m_Written = false; }
+};
+
+// Consumes all committed records and the overflow buffer, returns whether anything was written.
+static bool aio_consume(ASYNCIO *aio, CAioOutput *output)
+{
+	uint64_t pos = aio->consume_pos.load(std::memory_order_relaxed);
+	while(true)
+	{
+		const uint64_t header = header_at(aio, pos).load(std::memory_order_acquire);
+		if(!(header & HEADER_COMMITTED))
+		{
+			break;
+		}
+		const unsigned size = header >> 32;
+		if(header & HEADER_INDIRECT)
+		{
+			void *indirect;
+			mem_copy(&indirect, buffer_at(aio, pos + HEADER_SIZE), sizeof(indirect));
+			output->Write(indirect, size);
+			free(indirect);
+		}
+		else
+		{
+			buffer_copy_out(aio, pos + HEADER_SIZE, output->Reserve(size), size);
+		}
+		const unsigned record = record_size(header & HEADER_INDIRECT ? sizeof(void *) : size);
+		buffer_zero(aio, pos, record);
+		pos += record;
+		aio->consume_pos.store(pos, std::memory_order_release);
+	}
+
+	// Once every write before the ring buffer became full has been consumed,
+	// the overflow buffer can be written and the ring buffer used again.
+	if(aio->reserve_pos.load(std::memory_order_relaxed) == (pos | RESERVE_OVERFLOW))
+	{
+		std::vector<unsigned char> overflow;
+		{
+			const CLockScope ls(aio->overflow_lock);
+			std::swap(overflow, aio->overflow);
+			aio->reserve_pos.store(pos, std::memory_order_relaxed);
+		}
+		output->Write(overflow.data(), overflow.size());
+	}
+
+	output->Flush();
+	return output->Written();
+}
+
+// Returns whether `aio_consume` would make progress. A record that is reserved
+// but not committed yet is not pending, its writer wakes the thread once it
+// commits the record. The overflow buffer can only be consumed once the ring
+// buffer is empty.
+static bool aio_pending(ASYNCIO *aio)
+{
+	const uint64_t pos = aio->consume_pos.load(std::memory_order_relaxed);
+	return (header_at(aio, pos).load(std::memory_order_acquire) & HEADER_COMMITTED) ||
+	       aio->reserve_pos.load(std::memory_order_relaxed) == (pos | RESERVE_OVERFLOW);
+}
+
 static void aio_thread(void *user)
 {
 	ASYNCIO *aio = (ASYNCIO *)user;
+	CAioOutput output(aio);
 
-	aio->lock.lock();
 	while(true)
 	{
-		struct BUFFERS buffers;
-		int result_io_error;
-		unsigned char local_buffer[ASYNC_LOCAL_BUFSIZE];
-		unsigned int local_buffer_len = 0;
-
-		if(aio->read_pos == aio->write_pos)
+		if(aio_consume(aio, &output))
 		{
-			if(aio->finish != ASYNCIO_RUNNING)
-			{
-				if(aio->finish == ASYNCIO_CLOSE)
-				{
-					io_close(aio->io);
-				}
-				aio_handle_free_and_unlock(aio);
-				break;
-			}
-			aio->lock.unlock();
-			sphore_wait(&aio->sphore);
-			aio->lock.lock();
+			output.Reset();
+			io_flush(aio->io);
+			const int result_io_error = io_error(aio->io);
+			const CLockScope ls(aio->lock);
+			aio->error = result_io_error;
 			continue;
 		}
 
-		buffer_ptrs(aio, &buffers);
-		if(buffers.buf1)
+		aio->lock.lock();
+		if(aio->finish != ASYNCIO_RUNNING)
 		{
-			if(buffers.len1 > sizeof(local_buffer) - local_buffer_len)
+			// writes happening before the finish request are visible because of the lock
+			if(aio_pending(aio))
 			{
-				buffers.len1 = sizeof(local_buffer) - local_buffer_len;
+				aio->lock.unlock();
+				continue;
 			}
-			mem_copy(local_buffer + local_buffer_len, buffers.buf1, buffers.len1);
-			local_buffer_len += buffers.len1;
-			if(buffers.buf2)
+			if(aio->finish == ASYNCIO_CLOSE)
 			{
-				if(buffers.len2 > sizeof(local_buffer) - local_buffer_len)
-				{
-					buffers.len2 = sizeof(local_buffer) - local_buffer_len;
-				}
-				mem_copy(local_buffer + local_buffer_len, buffers.buf2, buffers.len2);
-				local_buffer_len += buffers.len2;
+				io_close(aio->io);
 			}
+			aio_handle_free_and_unlock(aio);
+			break;
 		}
-		aio->read_pos = (aio->read_pos + buffers.len1 + buffers.len2) % aio->buffer_size;
 		aio->lock.unlock();
 
-		io_write(aio->io, local_buffer, local_buffer_len);
-		io_flush(aio->io);
-		result_io_error = io_error(aio->io);
-
-		aio->lock.lock();
-		aio->error = result_io_error;
+		aio->sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(aio_pending(aio))
+		{
+			if(!aio->sleeping.exchange(false, std::memory_order_relaxed))
+			{
+				// a writer has already signaled the semaphore, consume the signal
+				sphore_wait(&aio->sphore);
+			}
+			continue;
+		}
+		sphore_wait(&aio->sphore);
 	}
 }
 
@@ -146,16 +362,16 @@ ASYNCIO *aio_new(IOHANDLE io)
 	sphore_init(&aio->sphore);
 	aio->thread = nullptr;
 
-	aio->buffer = (unsigned char *)malloc(ASYNC_BUFSIZE);
+	aio->buffer = (uint64_t *)calloc(ASYNC_BUFSIZE / sizeof(uint64_t), sizeof(uint64_t));
 	if(!aio->buffer)
 	{
 		sphore_destroy(&aio->sphore);
 		delete aio;
 		return nullptr;
 	}
-	aio->buffer_size = ASYNC_BUFSIZE;
-	aio->read_pos = 0;
-	aio->write_pos = 0;
+	aio->reserve_pos.store(0, std::memory_order_relaxed);
+	aio->consume_pos.store(0, std::memory_order_relaxed);
+	aio->sleeping.store(false, std::memory_order_relaxed);
 	aio->error = 0;
 	aio->finish = ASYNCIO_RUNNING;
 	aio->refcount = 2;
@@ -171,93 +387,26 @@ ASYNCIO *aio_new(IOHANDLE io)
 	return aio;
 }
 
-static unsigned int buffer_len(ASYNCIO *aio)
+void aio_lock(ASYNCIO *aio) ACQUIRE(aio->transaction_lock)
 {
-	if(aio->write_pos >= aio->read_pos)
-	{
-		return aio->write_pos - aio->read_pos;
-	}
-	else
-	{
-		return aio->buffer_size + aio->write_pos - aio->read_pos;
-	}
+	aio->transaction_lock.lock();
 }
 
-static unsigned int next_buffer_size(unsigned int cur_size, unsigned int need_size)
+void aio_unlock(ASYNCIO *aio) RELEASE(aio->transaction_lock)
 {
-	while(cur_size < need_size)
-	{
-		cur_size *= 2;
-	}
-	return cur_size;
-}
-
-void aio_lock(ASYNCIO *aio) ACQUIRE(aio->lock)
-{
-	aio->lock.lock();
-}
-
-void aio_unlock(ASYNCIO *aio) RELEASE(aio->lock)
-{
-	aio->lock.unlock();
-	sphore_signal(&aio->sphore);
+	aio_push(aio, aio->transaction.data(), aio->transaction.size());
+	aio->transaction.clear();
+	aio->transaction_lock.unlock();
 }
 
 void aio_write_unlocked(ASYNCIO *aio, const void *buffer, unsigned size)
 {
-	unsigned int remaining;
-	remaining = aio->buffer_size - buffer_len(aio);
-
-	// Don't allow full queue to distinguish between empty and full queue.
-	if(size < remaining)
-	{
-		unsigned int remaining_contiguous = aio->buffer_size - aio->write_pos;
-		if(size > remaining_contiguous)
-		{
-			mem_copy(aio->buffer + aio->write_pos, buffer, remaining_contiguous);
-			size -= remaining_contiguous;
-			buffer = ((unsigned char *)buffer) + remaining_contiguous;
-			aio->write_pos = 0;
-		}
-		mem_copy(aio->buffer + aio->write_pos, buffer, size);
-		aio->write_pos = (aio->write_pos + size) % aio->buffer_size;
-	}
-	else
-	{
-		// Add 1 so the new buffer isn't completely filled.
-		unsigned int new_written = buffer_len(aio) + size + 1;
-		unsigned int next_size = next_buffer_size(aio->buffer_size, new_written);
-		unsigned int next_len = 0;
-		unsigned char *next_buffer = (unsigned char *)malloc(next_size);
-
-		struct BUFFERS buffers;
-		buffer_ptrs(aio, &buffers);
-		if(buffers.buf1)
-		{
-			mem_copy(next_buffer + next_len, buffers.buf1, buffers.len1);
-			next_len += buffers.len1;
-			if(buffers.buf2)
-			{
-				mem_copy(next_buffer + next_len, buffers.buf2, buffers.len2);
-				next_len += buffers.len2;
-			}
-		}
-		mem_copy(next_buffer + next_len, buffer, size);
-		next_len += size;
-
-		free(aio->buffer);
-		aio->buffer = next_buffer;
-		aio->buffer_size = next_size;
-		aio->read_pos = 0;
-		aio->write_pos = next_len;
-	}
+	aio->transaction.insert(aio->transaction.end(), (const unsigned char *)buffer, (const unsigned char *)buffer + size);
 }
 
 void aio_write(ASYNCIO *aio, const void *buffer, unsigned size)
 {
-	aio_lock(aio);
-	aio_write_unlocked(aio, buffer, size);
-	aio_unlock(aio);
+	aio_push(aio, buffer, size);
 }
 
 void aio_write_newline_unlocked(ASYNCIO *aio)
@@ -271,9 +420,11 @@ void aio_write_newline_unlocked(ASYNCIO *aio)
 
 void aio_write_newline(ASYNCIO *aio)
 {
-	aio_lock(aio);
-	aio_write_newline_unlocked(aio);
-	aio_unlock(aio);
+#if defined(CONF_FAMILY_WINDOWS)
+	aio_write(aio, "\r\n", 2);
+#else
+	aio_write(aio, "\n", 1);
+#endif
 }
 
 int aio_error(ASYNCIO *aio)
@@ -205,6 +205,7 @@ void fs_listdir_fileinfo(const char *dir, FS_LISTDIR_CALLBACK_FILEINFO cb, int t
 		info.m_pName = current_entry.value().c_str();
 		info.m_TimeCreated = filetime_to_unixtime(&finddata.ftCreationTime);
 		info.m_TimeModified = filetime_to_unixtime(&finddata.ftLastWriteTime);
+		info.m_Size = ((int64_t)finddata.nFileSizeHigh << 32) | finddata.nFileSizeLow;
 
 		if(cb(&info, (finddata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0, type, user))
 			break;
@@ -231,15 +232,17 @@ void fs_listdir_fileinfo(const char *dir, FS_LISTDIR_CALLBACK_FILEINFO cb, int t
 			continue;
 		}
 		str_copy(buffer + length, entry->d_name, sizeof(buffer) - length);
-		time_t created = -1, modified = -1;
-		fs_file_time(buffer, &created, &modified);
+		// a single stat provides the times, the size and the folder flag
+		struct stat sb;
+		const bool has_stat = stat(buffer, &sb) == 0;
 
 		CFsFileInfo info;
 		info.m_pName = entry->d_name;
-		info.m_TimeCreated = created;
-		info.m_TimeModified = modified;
+		info.m_TimeCreated = has_stat ? sb.st_ctime : -1;
+		info.m_TimeModified = has_stat ? sb.st_mtime : -1;
+		info.m_Size = has_stat ? (int64_t)sb.st_size : -1;
 
-		if(cb(&info, fs_is_dir(buffer), type, user))
+		if(cb(&info, has_stat && S_ISDIR(sb.st_mode) ? 1 : 0, type, user))
 			break;
 	}
 
@@ -2,6 +2,7 @@
 #include "color.h"
 #include "dbg.h"
 #include "logger.h"
+#include "mem.h"
 #include "str.h"
 #include "time.h"
 #include "windows.h"
@@ -24,10 +25,16 @@
 #include <android/log.h>
 #endif
 
+std::atomic<int> log_max_level = LEVEL_TRACE;
 std::atomic<ILogger *> global_logger = nullptr;
 thread_local ILogger *scope_logger = nullptr;
 thread_local bool in_logger = false;
 
+void log_set_max_level(int level)
+{
+	log_max_level.store(level, std::memory_order_relaxed);
+}
+
 void log_set_global_logger(ILogger *logger)
 {
 	ILogger *null = nullptr;
@@ -79,6 +86,10 @@ void log_set_scope_logger(ILogger *logger)
 
 [[gnu::format(printf, 5, 0)]] static void log_log_impl(LEVEL level, bool have_color, LOG_COLOR color, const char *sys, const char *fmt, va_list args)
 {
+	if(!log_level_enabled(level))
+	{
+		return;
+	}
 	// Make sure we're not logging recursively.
 	if(in_logger)
 	{
@@ -237,26 +248,32 @@ public:
 		{
 			return;
 		}
-		aio_lock(m_pAio);
+		// Assemble the whole line in a buffer of the calling thread, so
+		// the aio lock is only taken for a single copy per line.
+		static thread_local char s_aBuffer[32 + sizeof(CLogMessage::m_aLine) + 8];
+		int Length = 0;
 		if(m_AnsiTruecolor && pMessage->m_HaveColor)
 		{
 			// https://en.wikipedia.org/w/index.php?title=ANSI_escape_code&oldid=1077146479#24-bit
-			char aAnsi[32];
-			str_format(aAnsi, sizeof(aAnsi),
+			Length = str_format(s_aBuffer, 32,
 				"\x1b[38;2;%d;%d;%dm",
 				pMessage->m_Color.r,
 				pMessage->m_Color.g,
 				pMessage->m_Color.b);
-			aio_write_unlocked(m_pAio, aAnsi, str_length(aAnsi));
 		}
-		aio_write_unlocked(m_pAio, pMessage->m_aLine, pMessage->m_LineLength);
+		mem_copy(s_aBuffer + Length, pMessage->m_aLine, pMessage->m_LineLength);
+		Length += pMessage->m_LineLength;
 		if(m_AnsiTruecolor && pMessage->m_HaveColor)
 		{
-			const char aResetColor[] = "\x1b[0m";
-			aio_write_unlocked(m_pAio, aResetColor, str_length(aResetColor)); // reset
+			const char aResetColor[] = "\x1b[0m"; // reset
+			mem_copy(s_aBuffer + Length, aResetColor, str_length(aResetColor));
+			Length += str_length(aResetColor);
 		}
-		aio_write_newline_unlocked(m_pAio);
-		aio_unlock(m_pAio);
+#if defined(CONF_FAMILY_WINDOWS)
+		s_aBuffer[Length++] = '\r';
+#endif
+		s_aBuffer[Length++] = '\n';
+		aio_write(m_pAio, s_aBuffer, Length);
 	}
 	~CLoggerAsync() override
 	{
@@ -1,6 +1,7 @@
 #ifndef BASE_LOG_H
 #define BASE_LOG_H
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdint>
 
@@ -20,17 +21,18 @@ struct LOG_COLOR
 	uint8_t b;
 };
 
-#define log_error(sys, ...) log_log(LEVEL_ERROR, sys, __VA_ARGS__)
-#define log_warn(sys, ...) log_log(LEVEL_WARN, sys, __VA_ARGS__)
-#define log_info(sys, ...) log_log(LEVEL_INFO, sys, __VA_ARGS__)
-#define log_debug(sys, ...) log_log(LEVEL_DEBUG, sys, __VA_ARGS__)
-#define log_trace(sys, ...) log_log(LEVEL_TRACE, sys, __VA_ARGS__)
+// The level check happens before the arguments are evaluated and the message is formatted.
+#define log_error(sys, ...) (log_level_enabled(LEVEL_ERROR) ? log_log(LEVEL_ERROR, sys, __VA_ARGS__) : (void)0)
+#define log_warn(sys, ...) (log_level_enabled(LEVEL_WARN) ? log_log(LEVEL_WARN, sys, __VA_ARGS__) : (void)0)
+#define log_info(sys, ...) (log_level_enabled(LEVEL_INFO) ? log_log(LEVEL_INFO, sys, __VA_ARGS__) : (void)0)
+#define log_debug(sys, ...) (log_level_enabled(LEVEL_DEBUG) ? log_log(LEVEL_DEBUG, sys, __VA_ARGS__) : (void)0)
+#define log_trace(sys, ...) (log_level_enabled(LEVEL_TRACE) ? log_log(LEVEL_TRACE, sys, __VA_ARGS__) : (void)0)
 
-#define log_error_color(color, sys, ...) log_log_color(LEVEL_ERROR, color, sys, __VA_ARGS__)
-#define log_warn_color(color, sys, ...) log_log_color(LEVEL_WARN, color, sys, __VA_ARGS__)
-#define log_info_color(color, sys, ...) log_log_color(LEVEL_INFO, color, sys, __VA_ARGS__)
-#define log_debug_color(color, sys, ...) log_log_color(LEVEL_DEBUG, color, sys, __VA_ARGS__)
-#define log_trace_color(color, sys, ...) log_log_color(LEVEL_TRACE, color, sys, __VA_ARGS__)
+#define log_error_color(color, sys, ...) (log_level_enabled(LEVEL_ERROR) ? log_log_color(LEVEL_ERROR, color, sys, __VA_ARGS__) : (void)0)
+#define log_warn_color(color, sys, ...) (log_level_enabled(LEVEL_WARN) ? log_log_color(LEVEL_WARN, color, sys, __VA_ARGS__) : (void)0)
+#define log_info_color(color, sys, ...) (log_level_enabled(LEVEL_INFO) ? log_log_color(LEVEL_INFO, color, sys, __VA_ARGS__) : (void)0)
+#define log_debug_color(color, sys, ...) (log_level_enabled(LEVEL_DEBUG) ? log_log_color(LEVEL_DEBUG, color, sys, __VA_ARGS__) : (void)0)
+#define log_trace_color(color, sys, ...) (log_level_enabled(LEVEL_TRACE) ? log_log_color(LEVEL_TRACE, color, sys, __VA_ARGS__) : (void)0)
 
 /**
  * @defgroup Log Logging
@@ -86,4 +88,37 @@ struct LOG_COLOR
  */
 [[gnu::format(printf, 4, 0)]] void log_log_color_v(LEVEL level, LOG_COLOR color, const char *sys, const char *fmt, va_list args);
 
+extern std::atomic<int> log_max_level;
+
+/**
+ * @ingroup Log
+ *
+ * Checks whether log messages of the given level are passed to the loggers.
+ *
+ * @param level Severity of the log message.
+ *
+ * @return `true` if messages of this level are logged, `false` if they are dropped.
+ *
+ * @see log_set_max_level
+ */
+inline bool log_level_enabled(LEVEL level)
+{
+	return level <= log_max_level.load(std::memory_order_relaxed);
+}
+
+/**
+ * @ingroup Log
+ *
+ * Sets the highest level of log messages that are passed to the loggers.
+ * Messages with a higher level are dropped before they are formatted.
+ *
+ * This must be at least the highest level that any logger accepts, otherwise
+ * messages will be missing. It defaults to `LEVEL_TRACE`, so all messages
+ * are passed to the loggers, which can filter them on their own.
+ *
+ * @param level The highest `LEVEL` that is still logged, -1 corresponds to no
+ * logging at all.
+ */
+void log_set_max_level(int level);
+
 #endif // BASE_LOG_H
@@ -78,6 +78,12 @@ public:
 	 * The modification time of the file/folder.
 	 */
 	time_t m_TimeModified;
+
+	/**
+	 * The size of the file in bytes, or `-1` if it could not be determined.
+	 * Unspecified for folders.
+	 */
+	int64_t m_Size;
 };
 
 /**
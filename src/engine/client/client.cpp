@@ -43,6 +43,7 @@
 #include <engine/shared/fifo.h>
 #include <engine/shared/filecollection.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jsonwriter.h>
 #include <engine/shared/masterserver.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
@@ -78,6 +79,7 @@
 #undef main
 #endif
 
+#include <algorithm>
 #include <chrono>
 #include <limits>
 #include <stack>
@@ -1082,6 +1084,88 @@ void CClient::RenderGraphs()
 	m_aGametimeMarginGraphs[g_Config.m_ClDummy].Render(Graphics(), TextRender(), GraphX, GraphSpacing * 7 + GraphH * 2, GraphW, GraphH, "Gametime Margin");
 }
 
+void CClient::UpdateProfilerOverlay()
+{
+	if(!g_Config.m_DbgProfiler)
+	{
+		if(m_ProfilerStartedByOverlay)
+		{
+			CProfiler::Stop();
+			m_ProfilerStartedByOverlay = false;
+		}
+		m_vProfilerOverlayStats.clear();
+		return;
+	}
+
+	const int64_t Now = time_get_nanoseconds().count();
+	if(!CProfiler::Running())
+	{
+		CProfiler::Start();
+		m_ProfilerStartedByOverlay = true;
+		m_ProfilerWindowStart = Now;
+		m_ProfilerWindowFrames = 0;
+	}
+
+	m_ProfilerWindowFrames++;
+	if(Now - m_ProfilerWindowStart < std::chrono::nanoseconds(1s).count())
+		return;
+
+	// only summarize the scopes of the last second, starting with a complete outermost scope
+	std::vector<CProfiler::CThreadEvents> vThreads = CProfiler::Events(m_ProfilerWindowStart);
+	for(CProfiler::CThreadEvents &Thread : vThreads)
+	{
+		const auto FirstEvent = std::find_if(Thread.m_vEvents.begin(), Thread.m_vEvents.end(), [&](const CProfiler::CEvent &Event) {
+			return Event.m_Start >= m_ProfilerWindowStart && Event.m_Depth == 0;
+		});
+		Thread.m_vEvents.erase(Thread.m_vEvents.begin(), FirstEvent);
+	}
+	m_vProfilerOverlayStats = CProfiler::Summarize(vThreads);
+	std::stable_sort(m_vProfilerOverlayStats.begin(), m_vProfilerOverlayStats.end(), [](const CProfiler::CPathStats &Left, const CProfiler::CPathStats &Right) {
+		return Left.m_Total > Right.m_Total;
+	});
+	m_ProfilerOverlayFrames = m_ProfilerWindowFrames;
+	m_ProfilerWindowStart = Now;
+	m_ProfilerWindowFrames = 0;
+	// the scopes of the previous windows are not needed anymore, so the
+	// next window doesn't have to copy a full ring buffer
+	if(m_ProfilerStartedByOverlay)
+		CProfiler::Start();
+}
+
+void CClient::RenderProfilerOverlay()
+{
+	if(!g_Config.m_DbgProfiler)
+		return;
+
+	static constexpr int MAX_ROWS = 24;
+	const float FontSize = 12.0f;
+	const int NumRows = minimum((int)m_vProfilerOverlayStats.size(), MAX_ROWS);
+	const float OffsetY = Graphics()->ScreenHeight() - (NumRows + 3) * FontSize - 2.0f;
+	char aBuffer[512];
+
+	Graphics()->TextureSet(m_DebugFont);
+	Graphics()->MapScreen(0, 0, Graphics()->ScreenWidth(), Graphics()->ScreenHeight());
+	Graphics()->QuadsBegin();
+
+	const IGraphics::CFrameStatistics &Statistics = Graphics()->FrameStatistics();
+	str_format(aBuffer, sizeof(aBuffer), "Commands: %d  Draw calls: %d  Vertices: %" PRId64 "  Texture switches: %d",
+		Statistics.m_NumCommands, Statistics.m_NumDrawCalls, Statistics.m_NumVertices, Statistics.m_NumTextureSwitches);
+	Graphics()->QuadsText(2, OffsetY, FontSize, aBuffer);
+
+	str_format(aBuffer, sizeof(aBuffer), "%-48s %10s %10s %10s %8s", "Scope", "ms/frame", "median us", "p99 us", "calls");
+	Graphics()->QuadsText(2, OffsetY + 2 * FontSize, FontSize, aBuffer);
+	const int Frames = maximum(m_ProfilerOverlayFrames, 1);
+	for(int i = 0; i < NumRows; i++)
+	{
+		const CProfiler::CPathStats &Stats = m_vProfilerOverlayStats[i];
+		str_format(aBuffer, sizeof(aBuffer), "%-48s %10.3f %10.1f %10.1f %8.1f",
+			Stats.m_Path.c_str(), Stats.m_Total / 1e6 / Frames, Stats.m_Median / 1e3, Stats.m_P99 / 1e3, Stats.m_Count / (float)Frames);
+		Graphics()->QuadsText(2, OffsetY + (i + 3) * FontSize, FontSize, aBuffer);
+	}
+
+	Graphics()->QuadsEnd();
+}
+
 void CClient::Restart()
 {
 	SetState(IClient::STATE_RESTARTING);
@@ -1166,6 +1250,7 @@ void CClient::Render()
 
 	RenderDebug();
 	RenderGraphs();
+	RenderProfilerOverlay();
 }
 
 const char *CClient::LoadMap(const char *pName, const char *pFilename, const std::optional<SHA256_DIGEST> &WantedSha256, unsigned WantedCrc)
@@ -3151,8 +3236,12 @@ void CClient::Run()
 	// init localization first, making sure all errors during init can be localized
 	GameClient()->InitializeLanguage();
 
-	// init sound, allowed to fail
+	// init sound, allowed to fail. The demo benchmark runs without audio device.
+	const int SndEnable = g_Config.m_SndEnable;
+	if(m_aBenchmarkDemo[0])
+		g_Config.m_SndEnable = 0;
 	const bool SoundInitFailed = Sound()->Init() != 0;
+	g_Config.m_SndEnable = SndEnable;
 
 #if defined(CONF_VIDEORECORDER)
 	// init video recorder aka ffmpeg
@@ -3247,6 +3336,10 @@ void CClient::Run()
 			m_aCmdPlayDemo[0] = 0;
 		}
 
+		// handle pending demo benchmark
+		if(m_aBenchmarkDemo[0])
+			StartBenchmarkDemo();
+
 		// handle pending map edits
 		if(m_aCmdEditMap[0])
 		{
@@ -3315,7 +3408,11 @@ void CClient::Run()
 				m_EditorActive = false;
 			}
 
-			Update();
+			const std::chrono::nanoseconds WorkStart = time_get_nanoseconds();
+			{
+				const CProfileScope ProfileScope("update");
+				Update();
+			}
 			int64_t Now = time_get();
 
 			bool IsRenderActive = (g_Config.m_GfxBackgroundRender || m_pGraphics->WindowOpen());
@@ -3333,12 +3430,20 @@ void CClient::Run()
 			}
 #endif
 
+			// render every frame of the demo benchmark
+			if(m_BenchmarkDemoFps)
+			{
+				IsRenderActive = true;
+				AsyncRenderOld = false;
+				GfxRefreshRate = 0;
+			}
+
 			if(IsRenderActive &&
 				(!AsyncRenderOld || m_pGraphics->IsIdle()) &&
 				(!GfxRefreshRate || (time_freq() / (int64_t)g_Config.m_GfxRefreshRate) <= Now - LastRenderTime))
 			{
 				// update frametime
-				m_RenderFrameTime = (Now - m_LastRenderTime) / (float)time_freq();
+				m_RenderFrameTime = m_BenchmarkDemoFps ? 1.0f / m_BenchmarkDemoFps : (Now - m_LastRenderTime) / (float)time_freq();
 				m_FpsGraph.Add(1.0f / m_RenderFrameTime);
 
 				if(m_BenchmarkFile)
@@ -3364,8 +3469,20 @@ void CClient::Run()
 				LastRenderTime = Now - AdditionalTime;
 				m_LastRenderTime = Now;
 
-				Render();
-				m_pGraphics->Swap();
+				UpdateProfilerOverlay();
+				{
+					const CProfileScope ProfileScope("render");
+					Render();
+				}
+				{
+					const CProfileScope ProfileScope("swap");
+					m_pGraphics->Swap();
+				}
+
+				if(m_ProfilerCaptureFile)
+					ProfilerCaptureFrame(time_get_nanoseconds() - WorkStart);
+				if(m_BenchmarkDemoFps)
+					m_vBenchmarkDemoWorkTimes.push_back(time_get_nanoseconds() - WorkStart);
 			}
 			else if(!IsRenderActive)
 			{
@@ -3374,6 +3491,10 @@ void CClient::Run()
 			}
 		}
 
+		// the demo player pauses at the end of the demo
+		if(m_BenchmarkDemoFps && (!m_DemoPlayer.IsPlaying() || m_DemoPlayer.BaseInfo()->m_Paused))
+			FinishBenchmarkDemo();
+
 		AutoScreenshot_Cleanup();
 		AutoStatScreenshot_Cleanup();
 		AutoCSV_Cleanup();
@@ -3387,7 +3508,11 @@ void CClient::Run()
 		auto Now = time_get_nanoseconds();
 		decltype(Now) SleepTimeInNanoSeconds{0};
 		bool Slept = false;
-		if(g_Config.m_ClRefreshRateInactive && !m_pGraphics->WindowActive())
+		if(m_BenchmarkDemoFps)
+		{
+			// run the demo benchmark as fast as possible
+		}
+		else if(g_Config.m_ClRefreshRateInactive && !m_pGraphics->WindowActive())
 		{
 			SleepTimeInNanoSeconds = (std::chrono::nanoseconds(1s) / (int64_t)g_Config.m_ClRefreshRateInactive) - (Now - LastTime);
 			std::this_thread::sleep_for(SleepTimeInNanoSeconds);
@@ -3425,9 +3550,17 @@ void CClient::Run()
 		else
 			LastTime = Now;
 
-		// update local and global time
-		m_LocalTime = (time_get() - m_LocalStartTime) / (float)time_freq();
-		m_GlobalTime = (time_get() - m_GlobalStartTime) / (float)time_freq();
+		// update local and global time, the demo benchmark advances them by a fixed time per frame
+		if(m_BenchmarkDemoFps)
+		{
+			m_LocalTime += 1.0f / m_BenchmarkDemoFps;
+			m_GlobalTime += 1.0f / m_BenchmarkDemoFps;
+		}
+		else
+		{
+			m_LocalTime = (time_get() - m_LocalStartTime) / (float)time_freq();
+			m_GlobalTime = (time_get() - m_GlobalStartTime) / (float)time_freq();
+		}
 	}
 
 	GameClient()->RenderShutdownMessage();
@@ -4204,6 +4337,174 @@ void CClient::BenchmarkQuit(int Seconds, const char *pFilename)
 	m_BenchmarkStopTime = time_get() + time_freq() * Seconds;
 }
 
+void CClient::Con_ProfilerCaptureQuit(IConsole::IResult *pResult, void *pUserData)
+{
+	CClient *pSelf = (CClient *)pUserData;
+	pSelf->ProfilerCaptureQuit(pResult->GetInteger(0), pResult->GetString(1));
+}
+
+void CClient::ProfilerCaptureQuit(int Frames, const char *pFilename)
+{
+	if(m_ProfilerCaptureFile)
+		io_close(m_ProfilerCaptureFile);
+	m_ProfilerCaptureFile = Storage()->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_ABSOLUTE);
+	if(!m_ProfilerCaptureFile)
+	{
+		log_error("profiler", "Failed to open '%s' for writing", pFilename);
+		return;
+	}
+	str_copy(m_aProfilerCaptureFilename, pFilename);
+	m_ProfilerCaptureFrames = maximum(Frames, 1);
+	m_ProfilerCaptureFramesLeft = m_ProfilerCaptureFrames;
+	// the overlay must not discard the captured scopes
+	m_ProfilerStartedByOverlay = false;
+
+	const char *pHeader = "frame,frametime_us,work_us,commands,draw_calls,vertices,texture_switches";
+	io_write(m_ProfilerCaptureFile, pHeader, str_length(pHeader));
+	io_write_newline(m_ProfilerCaptureFile);
+	CProfiler::Start();
+}
+
+void CClient::ProfilerCaptureFrame(std::chrono::nanoseconds WorkTime)
+{
+	// work time includes update, render and swap of the frame
+	const IGraphics::CFrameStatistics &Statistics = Graphics()->FrameStatistics();
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%d,%d,%d,%d,%d,%" PRId64 ",%d",
+		m_ProfilerCaptureFrames - m_ProfilerCaptureFramesLeft,
+		(int)(m_RenderFrameTime * 1000000),
+		(int)std::chrono::duration_cast<std::chrono::microseconds>(WorkTime).count(),
+		Statistics.m_NumCommands, Statistics.m_NumDrawCalls, Statistics.m_NumVertices, Statistics.m_NumTextureSwitches);
+	io_write(m_ProfilerCaptureFile, aBuf, str_length(aBuf));
+	io_write_newline(m_ProfilerCaptureFile);
+
+	if(--m_ProfilerCaptureFramesLeft > 0)
+		return;
+
+	io_close(m_ProfilerCaptureFile);
+	m_ProfilerCaptureFile = nullptr;
+	CProfiler::Stop();
+
+	// save the scopes next to the frame statistics
+	const std::vector<CProfiler::CThreadEvents> vThreads = CProfiler::Events();
+	for(const char *pExtension : {"json", "folded"})
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "%s.%s", m_aProfilerCaptureFilename, pExtension);
+		IOHANDLE File = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_ABSOLUTE);
+		if(!File)
+		{
+			log_error("profiler", "Failed to open '%s' for writing", aFilename);
+			continue;
+		}
+		if(str_comp(pExtension, "json") == 0)
+			CProfiler::WriteChromeTrace(File, vThreads);
+		else
+			CProfiler::WriteFoldedStacks(File, CProfiler::Summarize(vThreads));
+		io_close(File);
+	}
+	log_info("profiler", "Captured %d frames to '%s'", m_ProfilerCaptureFrames, m_aProfilerCaptureFilename);
+	Quit();
+}
+
+void CClient::Con_BenchmarkDemo(IConsole::IResult *pResult, void *pUserData)
+{
+	CClient *pSelf = (CClient *)pUserData;
+	str_copy(pSelf->m_aBenchmarkDemo, pResult->GetString(0));
+	pSelf->m_BenchmarkDemoWantedFps = pResult->NumArguments() > 1 ? std::clamp(pResult->GetInteger(1), 1, 1000) : 60;
+	str_copy(pSelf->m_aBenchmarkDemoResultFile, pResult->NumArguments() > 2 ? pResult->GetString(2) : "");
+}
+
+void CClient::StartBenchmarkDemo()
+{
+	const char *pError = DemoPlayer_Play(m_aBenchmarkDemo, IStorage::TYPE_ALL_OR_ABSOLUTE);
+	if(pError)
+	{
+		log_error("benchmark", "playing demo file '%s' failed: %s", m_aBenchmarkDemo, pError);
+		m_aBenchmarkDemo[0] = '\0';
+		Quit();
+		return;
+	}
+	m_aBenchmarkDemo[0] = '\0';
+
+	// every frame advances the demo by the same time, so every run renders the same frames
+	m_BenchmarkDemoFps = m_BenchmarkDemoWantedFps;
+	m_DemoPlayer.SetFixedFrameTime(time_freq() / m_BenchmarkDemoFps);
+	m_vBenchmarkDemoWorkTimes.clear();
+	m_BenchmarkDemoStart = time_get_nanoseconds();
+	log_info("benchmark", "Benchmarking demo '%s' at %d frames per demo second", m_DemoPlayer.Filename(), m_BenchmarkDemoFps);
+}
+
+void CClient::FinishBenchmarkDemo()
+{
+	const std::chrono::nanoseconds Duration = time_get_nanoseconds() - m_BenchmarkDemoStart;
+	m_BenchmarkDemoFps = 0;
+	m_DemoPlayer.SetFixedFrameTime(0);
+
+	// work time includes update, render and swap of a frame
+	std::vector<std::chrono::nanoseconds> &vWorkTimes = m_vBenchmarkDemoWorkTimes;
+	if(vWorkTimes.empty())
+	{
+		log_error("benchmark", "No frames rendered: %s", m_DemoPlayer.ErrorMessage());
+		Quit();
+		return;
+	}
+	std::sort(vWorkTimes.begin(), vWorkTimes.end());
+	const auto Percentile = [&](int Percent) {
+		const size_t Index = std::min(vWorkTimes.size() - 1, vWorkTimes.size() * Percent / 100);
+		return (int)std::chrono::duration_cast<std::chrono::microseconds>(vWorkTimes[Index]).count();
+	};
+	std::chrono::nanoseconds TotalWorkTime(0);
+	for(std::chrono::nanoseconds WorkTime : vWorkTimes)
+		TotalWorkTime += WorkTime;
+	const int Frames = vWorkTimes.size();
+	const int DurationUs = std::chrono::duration_cast<std::chrono::microseconds>(Duration).count();
+	const int MeanUs = std::chrono::duration_cast<std::chrono::microseconds>(TotalWorkTime).count() / Frames;
+	const float FramesPerSecond = Frames / std::chrono::duration<float>(Duration).count();
+
+	log_info("benchmark", "%d frames in %.3f s, %.1f frames/s", Frames, DurationUs / 1e6f, FramesPerSecond);
+	log_info("benchmark", "frame work time: mean=%dus p50=%dus p90=%dus p99=%dus max=%dus",
+		MeanUs, Percentile(50), Percentile(90), Percentile(99), Percentile(100));
+
+	if(m_aBenchmarkDemoResultFile[0])
+	{
+		IOHANDLE File = Storage()->OpenFile(m_aBenchmarkDemoResultFile, IOFLAG_WRITE, IStorage::TYPE_ABSOLUTE);
+		if(File)
+		{
+			CJsonFileWriter Writer(File);
+			Writer.BeginObject();
+			Writer.WriteAttribute("demo");
+			Writer.WriteStrValue(m_DemoPlayer.Filename());
+			Writer.WriteAttribute("frames");
+			Writer.WriteIntValue(Frames);
+			Writer.WriteAttribute("duration_us");
+			Writer.WriteIntValue(DurationUs);
+			Writer.WriteAttribute("frames_per_second");
+			Writer.WriteIntValue(round_to_int(FramesPerSecond));
+			Writer.WriteAttribute("frame_us");
+			Writer.BeginObject();
+			Writer.WriteAttribute("mean");
+			Writer.WriteIntValue(MeanUs);
+			for(int Percent : {50, 90, 99})
+			{
+				char aName[8];
+				str_format(aName, sizeof(aName), "p%d", Percent);
+				Writer.WriteAttribute(aName);
+				Writer.WriteIntValue(Percentile(Percent));
+			}
+			Writer.WriteAttribute("max");
+			Writer.WriteIntValue(Percentile(100));
+			Writer.EndObject();
+			Writer.EndObject();
+		}
+		else
+		{
+			log_error("benchmark", "Failed to open '%s' for writing", m_aBenchmarkDemoResultFile);
+		}
+	}
+	Quit();
+}
+
 void CClient::UpdateAndSwap()
 {
 	Input()->Update();
@@ -4474,6 +4775,7 @@ void CClient::ConchainLoglevel(IConsole::IResult *pResult, void *pUserData, ICon
 	if(pResult->NumArguments())
 	{
 		pSelf->m_pFileLogger->SetFilter(CLogFilter{IConsole::ToLogLevelFilter(g_Config.m_Loglevel)});
+		IConsole::UpdateLogMaxLevel();
 	}
 }
 
@@ -4485,6 +4787,10 @@ void CClient::ConchainStdoutOutputLevel(IConsole::IResult *pResult, void *pUserD
 	{
 		pSelf->m_pStdoutLogger->SetFilter(CLogFilter{IConsole::ToLogLevelFilter(g_Config.m_StdoutOutputLevel)});
 	}
+	if(pResult->NumArguments())
+	{
+		IConsole::UpdateLogMaxLevel();
+	}
 }
 
 void CClient::RegisterCommands()
@@ -4528,6 +4834,10 @@ void CClient::RegisterCommands()
 
 	m_pConsole->Register("save_replay", "?i[length] ?r[filename]", CFGFLAG_CLIENT, Con_SaveReplay, this, "Save a replay of the last defined amount of seconds");
 	m_pConsole->Register("benchmark_quit", "i[seconds] r[file]", CFGFLAG_CLIENT | CFGFLAG_STORE, Con_BenchmarkQuit, this, "Benchmark frame times for number of seconds to file, then quit");
+	m_pConsole->Register("benchmark_demo", "s[demo] ?i[fps] ?r[file]", CFGFLAG_CLIENT, Con_BenchmarkDemo, this, "Play a demo as fast as possible with a fixed demo time per frame, optionally save the results to a JSON file, then quit");
+	m_pConsole->Register("profiler_capture_quit", "i[frames] r[file]", CFGFLAG_CLIENT, Con_ProfilerCaptureQuit, this, "Save the frame times and graphics statistics of a number of frames to a CSV file and the profiler scopes next to it, then quit");
+
+	m_Profiler.Init(m_pConsole, Kernel()->RequestInterface<IStorage>());
 
 	RustVersionRegister(*m_pConsole);
 
@@ -5016,6 +5326,7 @@ int main(int argc, const char **argv)
 	pConsole->SetUnknownCommandCallback(UnknownArgumentCallback, pClient);
 	pConsole->ParseArguments(argc - 1, &argv[1]);
 	pConsole->SetUnknownCommandCallback(IConsole::EmptyUnknownCommandCallback, nullptr);
+	IConsole::UpdateLogMaxLevel();
 
 	if(pSteam->GetConnectAddress())
 	{
@@ -22,6 +22,7 @@
 #include <engine/shared/fifo.h>
 #include <engine/shared/http.h>
 #include <engine/shared/network.h>
+#include <engine/shared/profiler.h>
 #include <engine/textrender.h>
 #include <engine/warning.h>
 
@@ -193,6 +194,14 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	CGraph m_aGametimeMarginGraphs[NUM_DUMMIES];
 	CGraph m_FpsGraph;
 
+	// profiler overlay, see dbg_profiler
+	CProfiler m_Profiler;
+	bool m_ProfilerStartedByOverlay = false;
+	int64_t m_ProfilerWindowStart = 0;
+	int m_ProfilerWindowFrames = 0;
+	int m_ProfilerOverlayFrames = 0;
+	std::vector<CProfiler::CPathStats> m_vProfilerOverlayStats;
+
 	// the game snapshots are modifiable by the game
 	CSnapshotStorage m_aSnapshotStorage[NUM_DUMMIES];
 	CSnapshotStorage::CHolder *m_aapSnapshots[NUM_DUMMIES][NUM_SNAPSHOT_TYPES];
@@ -249,6 +258,19 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	IOHANDLE m_BenchmarkFile = nullptr;
 	int64_t m_BenchmarkStopTime = 0;
 
+	IOHANDLE m_ProfilerCaptureFile = nullptr;
+	char m_aProfilerCaptureFilename[IO_MAX_PATH_LENGTH];
+	int m_ProfilerCaptureFrames = 0;
+	int m_ProfilerCaptureFramesLeft = 0;
+
+	// demo benchmark, m_BenchmarkDemoFps is set while it's running
+	char m_aBenchmarkDemo[IO_MAX_PATH_LENGTH] = "";
+	char m_aBenchmarkDemoResultFile[IO_MAX_PATH_LENGTH] = "";
+	int m_BenchmarkDemoFps = 0;
+	int m_BenchmarkDemoWantedFps = 0;
+	std::chrono::nanoseconds m_BenchmarkDemoStart{0};
+	std::vector<std::chrono::nanoseconds> m_vBenchmarkDemoWorkTimes;
+
 	CChecksum m_Checksum;
 	int64_t m_OwnExecutableSize = 0;
 	IOHANDLE m_OwnExecutable = nullptr;
@@ -364,6 +386,11 @@ public:
 	void Render();
 	void RenderDebug();
 	void RenderGraphs();
+	void UpdateProfilerOverlay();
+	void RenderProfilerOverlay();
+	void ProfilerCaptureFrame(std::chrono::nanoseconds WorkTime);
+	void StartBenchmarkDemo();
+	void FinishBenchmarkDemo();
 
 	void Restart() override;
 	void Quit() override;
@@ -453,6 +480,8 @@ public:
 	static void Con_StopRecord(IConsole::IResult *pResult, void *pUserData);
 	static void Con_AddDemoMarker(IConsole::IResult *pResult, void *pUserData);
 	static void Con_BenchmarkQuit(IConsole::IResult *pResult, void *pUserData);
+	static void Con_ProfilerCaptureQuit(IConsole::IResult *pResult, void *pUserData);
+	static void Con_BenchmarkDemo(IConsole::IResult *pResult, void *pUserData);
 	static void ConchainServerBrowserUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainFullscreen(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainWindowBordered(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -503,6 +532,7 @@ public:
 	void Notify(const char *pTitle, const char *pMessage) override;
 	void OnWindowResize() override;
 	void BenchmarkQuit(int Seconds, const char *pFilename);
+	void ProfilerCaptureQuit(int Frames, const char *pFilename);
 
 	void UpdateAndSwap() override;
 
@@ -0,0 +1,217 @@
+#include "demo_info_cache.h"
+
+#include <base/bytes.h>
+#include <base/lock.h>
+#include <base/mem.h>
+#include <base/str.h>
+
+#include <engine/console.h>
+#include <engine/sqlite.h>
+
+#include <sqlite3.h>
+
+#include <string_view>
+#include <unordered_set>
+
+class CDemoInfoCache : public IDemoInfoCache
+{
+public:
+	CDemoInfoCache(IConsole *pConsole, IStorage *pStorage);
+	~CDemoInfoCache() override = default;
+
+	bool Lookup(const char *pPath, int64_t Size, time_t TimeModified, CDemoInfo *pInfo) override;
+	void Store(const char *pPath, int64_t Size, time_t TimeModified, const CDemoInfo &Info) override;
+	void Prune(const char *pFolder, const std::vector<std::string> &vPaths) override;
+
+private:
+	IConsole *m_pConsole;
+
+	CLock m_Lock;
+	CSqlite m_pDisk GUARDED_BY(m_Lock);
+	CSqliteStmt m_pLookupStmt GUARDED_BY(m_Lock);
+	CSqliteStmt m_pStoreStmt GUARDED_BY(m_Lock);
+	CSqliteStmt m_pListStmt GUARDED_BY(m_Lock);
+	CSqliteStmt m_pRemoveStmt GUARDED_BY(m_Lock);
+};
+
+CDemoInfoCache::CDemoInfoCache(IConsole *pConsole, IStorage *pStorage) :
+	m_pConsole(pConsole)
+{
+	const CLockScope LockScope(m_Lock);
+	m_pDisk = SqliteOpen(pConsole, pStorage, "ddnet-cache.sqlite3");
+	if(!m_pDisk)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_info_cache", "failed to open ddnet-cache.sqlite3");
+		return;
+	}
+	sqlite3 *pSqlite = m_pDisk.get();
+	// the database is shared with other clients and the server browser's ping cache
+	sqlite3_busy_timeout(pSqlite, 1000);
+	static const char TABLE[] = "CREATE TABLE IF NOT EXISTS demo_infos (path TEXT PRIMARY KEY NOT NULL, size INTEGER NOT NULL, time_modified INTEGER NOT NULL, valid INTEGER NOT NULL, header BLOB NOT NULL, timeline_markers BLOB NOT NULL, map_sha256 BLOB)";
+	if(SQLITE_HANDLE_ERROR(sqlite3_exec(pSqlite, TABLE, nullptr, nullptr, nullptr)))
+	{
+		m_pDisk = nullptr;
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_info_cache", "failed to create demo_infos table");
+		return;
+	}
+	m_pLookupStmt = SqlitePrepare(pConsole, pSqlite, "SELECT valid, header, timeline_markers, map_sha256 FROM demo_infos WHERE path = ? AND size = ? AND time_modified = ?");
+	m_pStoreStmt = SqlitePrepare(pConsole, pSqlite, "INSERT OR REPLACE INTO demo_infos (path, size, time_modified, valid, header, timeline_markers, map_sha256) VALUES (?, ?, ?, ?, ?, ?, ?)");
+	m_pListStmt = SqlitePrepare(pConsole, pSqlite, "SELECT path FROM demo_infos WHERE path >= ? AND path < ?");
+	m_pRemoveStmt = SqlitePrepare(pConsole, pSqlite, "DELETE FROM demo_infos WHERE path = ?");
+}
+
+bool CDemoInfoCache::Lookup(const char *pPath, int64_t Size, time_t TimeModified, CDemoInfo *pInfo)
+{
+	const CLockScope LockScope(m_Lock);
+	if(!m_pDisk || !m_pLookupStmt)
+	{
+		return false;
+	}
+
+	sqlite3 *pSqlite = m_pDisk.get();
+	IConsole *pConsole = m_pConsole;
+	sqlite3_stmt *pStmt = m_pLookupStmt.get();
+	bool Error = false;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(pStmt)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(pStmt, 1, pPath, -1, SQLITE_STATIC)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int64(pStmt, 2, Size)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int64(pStmt, 3, TimeModified)) != SQLITE_OK;
+	if(Error || SQLITE_HANDLE_ERROR(sqlite3_step(pStmt)) != SQLITE_ROW)
+	{
+		sqlite3_reset(pStmt);
+		return false;
+	}
+
+	// entries with unexpected blob sizes are treated like missing ones and get replaced
+	const int Sha256Size = sqlite3_column_bytes(pStmt, 3);
+	const bool Found = sqlite3_column_bytes(pStmt, 1) == (int)sizeof(pInfo->m_Header) &&
+			   sqlite3_column_bytes(pStmt, 2) == (int)sizeof(pInfo->m_TimelineMarkers) &&
+			   (Sha256Size == 0 || Sha256Size == (int)sizeof(SHA256_DIGEST));
+	if(Found)
+	{
+		pInfo->m_Valid = sqlite3_column_int(pStmt, 0) != 0;
+		mem_copy(&pInfo->m_Header, sqlite3_column_blob(pStmt, 1), sizeof(pInfo->m_Header));
+		mem_copy(&pInfo->m_TimelineMarkers, sqlite3_column_blob(pStmt, 2), sizeof(pInfo->m_TimelineMarkers));
+		str_copy(pInfo->m_MapInfo.m_aName, pInfo->m_Header.m_aMapName);
+		if(Sha256Size != 0)
+		{
+			SHA256_DIGEST Sha256;
+			mem_copy(&Sha256, sqlite3_column_blob(pStmt, 3), sizeof(Sha256));
+			pInfo->m_MapInfo.m_Sha256 = Sha256;
+		}
+		else
+		{
+			pInfo->m_MapInfo.m_Sha256 = std::nullopt;
+		}
+		pInfo->m_MapInfo.m_Crc = bytes_be_to_uint(pInfo->m_Header.m_aMapCrc);
+		pInfo->m_MapInfo.m_Size = bytes_be_to_uint(pInfo->m_Header.m_aMapSize);
+	}
+	// don't keep the read transaction open until the next lookup
+	sqlite3_reset(pStmt);
+	return Found;
+}
+
+void CDemoInfoCache::Store(const char *pPath, int64_t Size, time_t TimeModified, const CDemoInfo &Info)
+{
+	const CLockScope LockScope(m_Lock);
+	if(!m_pDisk)
+	{
+		return;
+	}
+
+	sqlite3 *pSqlite = m_pDisk.get();
+	IConsole *pConsole = m_pConsole;
+	sqlite3_stmt *pStmt = m_pStoreStmt.get();
+	bool Error = false;
+	Error = Error || !pStmt;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(pStmt)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(pStmt, 1, pPath, -1, SQLITE_STATIC)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int64(pStmt, 2, Size)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int64(pStmt, 3, TimeModified)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int(pStmt, 4, Info.m_Valid ? 1 : 0)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_blob(pStmt, 5, &Info.m_Header, sizeof(Info.m_Header), SQLITE_STATIC)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_blob(pStmt, 6, &Info.m_TimelineMarkers, sizeof(Info.m_TimelineMarkers), SQLITE_STATIC)) != SQLITE_OK;
+	if(Info.m_MapInfo.m_Sha256.has_value())
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_blob(pStmt, 7, &Info.m_MapInfo.m_Sha256.value(), sizeof(SHA256_DIGEST), SQLITE_STATIC)) != SQLITE_OK;
+	else
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_null(pStmt, 7)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_step(pStmt)) != SQLITE_DONE;
+	if(pStmt)
+		sqlite3_reset(pStmt);
+	if(Error)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_info_cache", "failed to store demo info");
+	}
+}
+
+void CDemoInfoCache::Prune(const char *pFolder, const std::vector<std::string> &vPaths)
+{
+	const CLockScope LockScope(m_Lock);
+	if(!m_pDisk || !m_pListStmt || !m_pRemoveStmt)
+	{
+		return;
+	}
+
+	// the paths of all entries in the folder and its subfolders sort between
+	// "<folder>/" and "<folder>0", because '0' follows '/'
+	char aFirst[IO_MAX_PATH_LENGTH];
+	str_format(aFirst, sizeof(aFirst), "%s/", pFolder);
+	char aEnd[IO_MAX_PATH_LENGTH];
+	str_format(aEnd, sizeof(aEnd), "%s0", pFolder);
+	const int FirstLength = str_length(aFirst);
+
+	sqlite3 *pSqlite = m_pDisk.get();
+	IConsole *pConsole = m_pConsole;
+	const std::unordered_set<std::string_view> Existing(vPaths.begin(), vPaths.end());
+	std::vector<std::string> vRemoved;
+	sqlite3_stmt *pStmt = m_pListStmt.get();
+	bool Error = false;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(pStmt)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(pStmt, 1, aFirst, -1, SQLITE_STATIC)) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(pStmt, 2, aEnd, -1, SQLITE_STATIC)) != SQLITE_OK;
+	while(!Error)
+	{
+		const int Result = SQLITE_HANDLE_ERROR(sqlite3_step(pStmt));
+		if(Result != SQLITE_ROW)
+		{
+			Error = Result != SQLITE_DONE;
+			break;
+		}
+		const char *pPath = (const char *)sqlite3_column_text(pStmt, 0);
+		// demos in subfolders are pruned when their folder is listed
+		if(pPath && !str_find(pPath + FirstLength, "/") && !Existing.contains(pPath))
+		{
+			vRemoved.emplace_back(pPath);
+		}
+	}
+	sqlite3_reset(pStmt);
+	if(Error || vRemoved.empty())
+	{
+		if(Error)
+		{
+			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_info_cache", "failed to list cached demos");
+		}
+		return;
+	}
+
+	pStmt = m_pRemoveStmt.get();
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_exec(pSqlite, "BEGIN", nullptr, nullptr, nullptr)) != SQLITE_OK;
+	for(const std::string &Path : vRemoved)
+	{
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(pStmt)) != SQLITE_OK;
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(pStmt, 1, Path.c_str(), -1, SQLITE_STATIC)) != SQLITE_OK;
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_step(pStmt)) != SQLITE_DONE;
+	}
+	sqlite3_reset(pStmt);
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_exec(pSqlite, "COMMIT", nullptr, nullptr, nullptr)) != SQLITE_OK;
+	if(Error)
+	{
+		sqlite3_exec(pSqlite, "ROLLBACK", nullptr, nullptr, nullptr);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_info_cache", "failed to remove cached demos");
+	}
+}
+
+IDemoInfoCache *CreateDemoInfoCache(IConsole *pConsole, IStorage *pStorage)
+{
+	return new CDemoInfoCache(pConsole, pStorage);
+}
@@ -0,0 +1,40 @@
+#ifndef ENGINE_CLIENT_DEMO_INFO_CACHE_H
+#define ENGINE_CLIENT_DEMO_INFO_CACHE_H
+#include <base/types.h>
+
+#include <engine/demo.h>
+
+#include <string>
+#include <vector>
+
+class IConsole;
+class IStorage;
+
+class CDemoInfo
+{
+public:
+	bool m_Valid;
+	CDemoHeader m_Header;
+	CTimelineMarkers m_TimelineMarkers;
+	CMapInfo m_MapInfo;
+};
+
+// Persistent cache of demo headers, so demo folders don't have to be parsed
+// again every time they are listed. Demos are identified by their complete
+// path, entries are only used while the size and modification time of the
+// file still match. All functions are thread-safe.
+class IDemoInfoCache
+{
+public:
+	virtual ~IDemoInfoCache() = default;
+
+	// Returns false if the demo isn't cached or has changed since.
+	virtual bool Lookup(const char *pPath, int64_t Size, time_t TimeModified, CDemoInfo *pInfo) = 0;
+	virtual void Store(const char *pPath, int64_t Size, time_t TimeModified, const CDemoInfo &Info) = 0;
+	// Removes the entries of demos directly in the folder with the complete
+	// path pFolder, unless their complete path is in vPaths.
+	virtual void Prune(const char *pFolder, const std::vector<std::string> &vPaths) = 0;
+};
+
+IDemoInfoCache *CreateDemoInfoCache(IConsole *pConsole, IStorage *pStorage);
+#endif // ENGINE_CLIENT_DEMO_INFO_CACHE_H
@@ -18,6 +18,8 @@ CDemoEdit::CDemoEdit(const char *pNetVersion, CSnapshotDelta *pSnapshotDelta, CS
 
 	// Init the demoeditor
 	m_DemoEditor.Init(&m_SnapshotDelta, &m_SnapshotDeltaSixup, nullptr, pStorage);
+
+	SetPriority(PRIORITY_BACKGROUND);
 }
 
 void CDemoEdit::Run()
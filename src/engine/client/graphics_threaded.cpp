@@ -698,6 +698,7 @@ public:
 		m_Image(std::move(Image))
 	{
 		str_copy(m_aName, pName);
+		SetPriority(PRIORITY_BACKGROUND);
 	}
 
 	~CScreenshotSaveJob() override
@@ -1398,6 +1399,10 @@ void CGraphics_Threaded::RenderTileLayer(int BufferContainerIndex, const ColorRG
 	mem_copy(Cmd.m_pDrawCount, pIndicedVertexDrawNum, sizeof(unsigned int) * NumIndicesOffset);
 
 	m_pCommandBuffer->AddRenderCalls(NumIndicesOffset);
+	int64_t NumVertices = 0;
+	for(size_t i = 0; i < NumIndicesOffset; i++)
+		NumVertices += pIndicedVertexDrawNum[i];
+	AddDrawStatistics(m_State.m_Texture, NumIndicesOffset, NumVertices);
 	// todo max indices group check!!
 }
 
@@ -1420,6 +1425,7 @@ void CGraphics_Threaded::RenderBorderTiles(int BufferContainerIndex, const Color
 	AddCmd(Cmd);
 
 	m_pCommandBuffer->AddRenderCalls(1);
+	AddDrawStatistics(m_State.m_Texture, 1, (int64_t)DrawNum * 6);
 }
 
 void CGraphics_Threaded::RenderQuadLayer(int BufferContainerIndex, SQuadRenderInfo *pQuadInfo, size_t QuadNum, int QuadOffset, bool Grouped)
@@ -1443,6 +1449,7 @@ void CGraphics_Threaded::RenderQuadLayer(int BufferContainerIndex, SQuadRenderIn
 
 		mem_copy(Cmd.m_pQuadInfo, pQuadInfo, sizeof(SQuadRenderInfo) * QuadNum);
 		m_pCommandBuffer->AddRenderCalls(((QuadNum - 1) / GRAPHICS_MAX_QUADS_RENDER_COUNT) + 1);
+		AddDrawStatistics(m_State.m_Texture, ((QuadNum - 1) / GRAPHICS_MAX_QUADS_RENDER_COUNT) + 1, (int64_t)QuadNum * 6);
 	}
 	else
 	{
@@ -1454,6 +1461,7 @@ void CGraphics_Threaded::RenderQuadLayer(int BufferContainerIndex, SQuadRenderIn
 
 		*Cmd.m_pQuadInfo = *pQuadInfo;
 		m_pCommandBuffer->AddRenderCalls(1);
+		AddDrawStatistics(m_State.m_Texture, 1, (int64_t)QuadNum * 6);
 	}
 }
 
@@ -1475,6 +1483,7 @@ void CGraphics_Threaded::RenderText(int BufferContainerIndex, int TextQuadNum, i
 	AddCmd(Cmd);
 
 	m_pCommandBuffer->AddRenderCalls(1);
+	AddDrawStatistics(TextureTextIndex, 1, Cmd.m_DrawNum);
 }
 
 int CGraphics_Threaded::CreateQuadContainer(bool AutomaticUpload)
@@ -1700,6 +1709,7 @@ void CGraphics_Threaded::RenderQuadContainer(int ContainerIndex, int QuadOffset,
 
 		AddCmd(Cmd);
 		m_pCommandBuffer->AddRenderCalls(1);
+		AddDrawStatistics(m_State.m_Texture, 1, Cmd.m_DrawNum);
 	}
 	else
 	{
@@ -1774,6 +1784,7 @@ void CGraphics_Threaded::RenderQuadContainerEx(int ContainerIndex, int QuadOffse
 
 		AddCmd(Cmd);
 		m_pCommandBuffer->AddRenderCalls(1);
+		AddDrawStatistics(m_State.m_Texture, 1, Cmd.m_DrawNum);
 	}
 	else
 	{
@@ -1910,6 +1921,7 @@ void CGraphics_Threaded::RenderQuadContainerAsSpriteMultiple(int ContainerIndex,
 		mem_copy(Cmd.m_pRenderInfo, pRenderInfo, sizeof(IGraphics::SRenderSpriteInfo) * DrawCount);
 
 		m_pCommandBuffer->AddRenderCalls(((DrawCount - 1) / GRAPHICS_MAX_QUADS_RENDER_COUNT) + 1);
+		AddDrawStatistics(m_State.m_Texture, ((DrawCount - 1) / GRAPHICS_MAX_QUADS_RENDER_COUNT) + 1, (int64_t)Cmd.m_DrawNum * DrawCount);
 
 		WrapNormal();
 	}
@@ -2808,6 +2820,9 @@ void CGraphics_Threaded::Swap()
 		AddCmd(Cmd);
 	}
 
+	m_LastFrameStatistics = m_FrameStatistics;
+	m_FrameStatistics = CFrameStatistics();
+
 	KickCommandBuffer();
 	// TODO: Remove when https://github.com/libsdl-org/SDL/issues/5203 is fixed
 #ifdef CONF_PLATFORM_MACOS
@@ -789,6 +789,20 @@ class CGraphics_Threaded : public IEngineGraphics
 	size_t m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	CFrameStatistics m_FrameStatistics;
+	CFrameStatistics m_LastFrameStatistics;
+	int m_LastDrawTexture = -2;
+	void AddDrawStatistics(int Texture, int NumDrawCalls, int64_t NumVertices)
+	{
+		m_FrameStatistics.m_NumDrawCalls += NumDrawCalls;
+		m_FrameStatistics.m_NumVertices += NumVertices;
+		if(Texture != m_LastDrawTexture)
+		{
+			m_FrameStatistics.m_NumTextureSwitches++;
+			m_LastDrawTexture = Texture;
+		}
+	}
+
 	std::atomic<bool> m_WarnPngliteIncompatibleImages = false;
 
 	std::mutex m_WarningsMutex;
@@ -872,6 +886,7 @@ class CGraphics_Threaded : public IEngineGraphics
 	void AddCmd(
 		TName &Cmd, const std::function<bool()> &FailFunc = [] { return true; })
 	{
+		m_FrameStatistics.m_NumCommands++;
 		if(m_pCommandBuffer->AddCommandUnsafe(Cmd))
 			return;
 
@@ -913,6 +928,7 @@ public:
 	uint64_t BufferMemoryUsage() const override;
 	uint64_t StreamedMemoryUsage() const override;
 	uint64_t StagingMemoryUsage() const override;
+	const CFrameStatistics &FrameStatistics() const override { return m_LastFrameStatistics; }
 
 	const TTwGraphicsGpuList &GetGpus() const override;
 
@@ -945,6 +961,7 @@ public:
 
 	// simple uncompressed RGBA loaders
 	IGraphics::CTextureHandle LoadTexture(const char *pFilename, int StorageType, int Flags = 0) override;
+	IGraphics::CTextureHandle NullTexture() const override { return m_NullTexture; }
 	bool LoadPng(CImageInfo &Image, const char *pFilename, int StorageType) override;
 	bool LoadPng(CImageInfo &Image, const uint8_t *pData, size_t DataSize, const char *pContextName) override;
 
@@ -1179,6 +1196,7 @@ public:
 		});
 
 		m_pCommandBuffer->AddRenderCalls(1);
+		AddDrawStatistics(m_State.m_Texture, 1, NumVerts);
 	}
 
 	void FlushVertices(bool KeepVertices = false) override;
@@ -11,6 +11,7 @@
 
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
+#include <engine/shared/sound_mix.h>
 #include <engine/storage.h>
 
 #include <SDL.h>
@@ -30,26 +31,34 @@ static constexpr int SAMPLE_INDEX_FULL = -1;
 
 void CSound::Mix(short *pFinalOut, unsigned Frames)
 {
+	class CMixVoice
+	{
+	public:
+		const short *m_pData;
+		int m_Channels;
+		unsigned m_Frames;
+		int m_VolumeL;
+		int m_VolumeR;
+	};
+	CMixVoice aMixVoices[NUM_VOICES];
+	int NumMixVoices = 0;
+
+	const CLockScope MixLockScope(m_MixLock);
 	Frames = minimum(Frames, m_MaxFrames);
 	mem_zero(m_pMixBuffer, Frames * 2 * sizeof(int));
 
-	// acquire lock while we are mixing
-	m_SoundLock.lock();
-
 	const int MasterVol = m_SoundVolume.load(std::memory_order_relaxed);
 
+	// Only hold the lock while collecting and advancing the voices. The sample
+	// data stays valid until the mix is done because unloading waits for m_MixLock.
+	m_SoundLock.lock();
+	ProcessVoiceCommands();
+
 	for(auto &Voice : m_aVoices)
 	{
 		if(!Voice.m_pSample)
 			continue;
 
-		// mix voice
-		int *pOut = m_pMixBuffer;
-
-		const int Step = Voice.m_pSample->m_Channels; // setup input sources
-		short *pInL = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
-		short *pInR = &Voice.m_pSample->m_pData[Voice.m_Tick * Step + 1];
-
 		unsigned End = Voice.m_pSample->m_NumFrames - Voice.m_Tick;
 
 		int VolumeR = round_truncate(Voice.m_pChannel->m_Vol * (Voice.m_Vol / 255.0f));
@@ -59,10 +68,6 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 		if(Frames < End)
 			End = Frames;
 
-		// check if we have a mono sound
-		if(Voice.m_pSample->m_Channels == 1)
-			pInR = pInL;
-
 		// volume calculation
 		if(Voice.m_Flags & ISound::FLAG_POS && Voice.m_pChannel->m_Pan)
 		{
@@ -135,15 +140,16 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 			}
 		}
 
-		// process all frames
-		for(unsigned s = 0; s < End; s++)
+		if(VolumeL > 0 || VolumeR > 0)
 		{
-			*pOut++ += (*pInL) * VolumeL;
-			*pOut++ += (*pInR) * VolumeR;
-			pInL += Step;
-			pInR += Step;
-			Voice.m_Tick++;
+			CMixVoice &MixVoice = aMixVoices[NumMixVoices++];
+			MixVoice.m_pData = &Voice.m_pSample->m_pData[Voice.m_Tick * Voice.m_pSample->m_Channels];
+			MixVoice.m_Channels = Voice.m_pSample->m_Channels;
+			MixVoice.m_Frames = End;
+			MixVoice.m_VolumeL = VolumeL;
+			MixVoice.m_VolumeR = VolumeR;
 		}
+		Voice.m_Tick += End;
 
 		// free voice if not used any more
 		if(Voice.m_Tick == Voice.m_pSample->m_NumFrames)
@@ -162,9 +168,18 @@ void CSound::Mix(short *pFinalOut, unsigned Frames)
 
 	m_SoundLock.unlock();
 
+	// mix voices
+	for(int i = 0; i < NumMixVoices; i++)
+	{
+		const CMixVoice &MixVoice = aMixVoices[i];
+		if(MixVoice.m_Channels == 1)
+			CSoundMix::AccumulateMono(m_pMixBuffer, MixVoice.m_pData, MixVoice.m_Frames, MixVoice.m_VolumeL, MixVoice.m_VolumeR);
+		else
+			CSoundMix::AccumulateStereo(m_pMixBuffer, MixVoice.m_pData, MixVoice.m_Frames, MixVoice.m_VolumeL, MixVoice.m_VolumeR);
+	}
+
 	// clamp accumulated values
-	for(unsigned i = 0; i < Frames * 2; i++)
-		pFinalOut[i] = std::clamp<int>(((m_pMixBuffer[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	CSoundMix::Clamp(pFinalOut, m_pMixBuffer, Frames * 2, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -197,16 +212,18 @@ int CSound::Init()
 
 	// Initialize sample indices. We always need them to load sounds in
 	// the editor even if sound is disabled or failed to be enabled.
-	const CLockScope LockScope(m_SoundLock);
-	m_FirstFreeSampleIndex = 0;
-	for(size_t i = 0; i < std::size(m_aSamples) - 1; ++i)
 	{
-		m_aSamples[i].m_Index = i;
-		m_aSamples[i].m_NextFreeSampleIndex = i + 1;
-		m_aSamples[i].m_pData = nullptr;
+		const CLockScope LockScope(m_SoundLock);
+		m_FirstFreeSampleIndex = 0;
+		for(size_t i = 0; i < std::size(m_aSamples) - 1; ++i)
+		{
+			m_aSamples[i].m_Index = i;
+			m_aSamples[i].m_NextFreeSampleIndex = i + 1;
+			m_aSamples[i].m_pData = nullptr;
+		}
+		m_aSamples[std::size(m_aSamples) - 1].m_Index = std::size(m_aSamples) - 1;
+		m_aSamples[std::size(m_aSamples) - 1].m_NextFreeSampleIndex = SAMPLE_INDEX_FULL;
 	}
-	m_aSamples[std::size(m_aSamples) - 1].m_Index = std::size(m_aSamples) - 1;
-	m_aSamples[std::size(m_aSamples) - 1].m_NextFreeSampleIndex = SAMPLE_INDEX_FULL;
 
 	if(!g_Config.m_SndEnable)
 		return 0;
@@ -242,7 +259,10 @@ int CSound::Init()
 #if defined(CONF_VIDEORECORDER)
 	m_MaxFrames = maximum<uint32_t>(m_MaxFrames, 1024 * 2); // make the buffer bigger just in case
 #endif
-	m_pMixBuffer = (int *)calloc(m_MaxFrames * 2, sizeof(int));
+	{
+		const CLockScope MixLockScope(m_MixLock);
+		m_pMixBuffer = (int *)calloc(m_MaxFrames * 2, sizeof(int));
+	}
 
 	m_SoundEnabled = true;
 	Update();
@@ -274,6 +294,7 @@ void CSound::Shutdown()
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	m_Device = 0;
 
+	const CLockScope MixLockScope(m_MixLock);
 	const CLockScope LockScope(m_SoundLock);
 	for(auto &Sample : m_aSamples)
 	{
@@ -675,7 +696,10 @@ void CSound::UnloadSample(int SampleId)
 		return;
 
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
+	// wait for a running mix that might still read the sample data
+	const CLockScope MixLockScope(m_MixLock);
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample &Sample = m_aSamples[SampleId];
 
 	if(Sample.IsLoaded())
@@ -716,6 +740,7 @@ float CSound::GetSampleCurrentTime(int SampleId)
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	CSample *pSample = &m_aSamples[SampleId];
 	for(auto &Voice : m_aVoices)
@@ -734,6 +759,7 @@ void CSound::SetSampleCurrentTime(int SampleId, float Time)
 	dbg_assert(SampleId >= 0 && SampleId < NUM_SAMPLES, "SampleId invalid");
 
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	CSample *pSample = &m_aSamples[SampleId];
 	for(auto &Voice : m_aVoices)
@@ -753,7 +779,7 @@ void CSound::SetChannel(int ChannelId, float Vol, float Pan)
 	dbg_assert(ChannelId >= 0 && ChannelId < NUM_CHANNELS, "ChannelId invalid");
 
 	const CLockScope LockScope(m_SoundLock);
-	m_aChannels[ChannelId].m_Vol = (int)(Vol * 255.0f);
+	m_aChannels[ChannelId].m_Vol = (int)(std::clamp(Vol, 0.0f, 1.0f) * 255.0f);
 	m_aChannels[ChannelId].m_Pan = (int)(Pan * 255.0f); // TODO: this is only on and off right now
 }
 
@@ -763,132 +789,137 @@ void CSound::SetListenerPosition(vec2 Position)
 	m_ListenerPositionY.store(Position.y, std::memory_order_relaxed);
 }
 
-void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
+void CSound::PushVoiceCommand(int Type, CVoiceHandle Voice, float X, float Y)
 {
 	if(!Voice.IsValid())
 		return;
 
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	Volume = std::clamp(Volume, 0.0f, 1.0f);
-	m_aVoices[VoiceId].m_Vol = (int)(Volume * 255.0f);
-}
-
-void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
-{
-	if(!Voice.IsValid())
+	CVoiceCommand Command;
+	Command.m_Type = Type;
+	Command.m_VoiceId = Voice.Id();
+	Command.m_Age = Voice.Age();
+	Command.m_X = X;
+	Command.m_Y = Y;
+	if(m_VoiceCommands.TryPush(Command))
 		return;
 
-	int VoiceId = Voice.Id();
-
+	// the mixer is lagging behind, apply the pending commands in order ourselves
 	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	Falloff = std::clamp(Falloff, 0.0f, 1.0f);
-	m_aVoices[VoiceId].m_Falloff = Falloff;
+	ProcessVoiceCommands();
+	ApplyVoiceCommand(Command);
 }
 
-void CSound::SetVoicePosition(CVoiceHandle Voice, vec2 Position)
+void CSound::ProcessVoiceCommands()
 {
-	if(!Voice.IsValid())
-		return;
-
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	m_aVoices[VoiceId].m_Position = Position;
+	CVoiceCommand Command;
+	while(m_VoiceCommands.TryPop(&Command))
+		ApplyVoiceCommand(Command);
 }
 
-void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+void CSound::ApplyVoiceCommand(const CVoiceCommand &Command)
 {
-	if(!Voice.IsValid())
-		return;
-
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
-
-	if(!m_aVoices[VoiceId].m_pSample)
+	CVoice &Voice = m_aVoices[Command.m_VoiceId];
+	if(Voice.m_Age != Command.m_Age)
 		return;
 
-	int Tick = 0;
-	bool IsLooping = m_aVoices[VoiceId].m_Flags & ISound::FLAG_LOOP;
-	uint64_t TickOffset = m_aVoices[VoiceId].m_pSample->m_Rate * TimeOffset;
-	if(m_aVoices[VoiceId].m_pSample->m_NumFrames > 0 && IsLooping)
+	switch(Command.m_Type)
+	{
+	case CVoiceCommand::VOLUME:
+		Voice.m_Vol = (int)(std::clamp(Command.m_X, 0.0f, 1.0f) * 255.0f);
+		break;
+	case CVoiceCommand::FALLOFF:
+		Voice.m_Falloff = std::clamp(Command.m_X, 0.0f, 1.0f);
+		break;
+	case CVoiceCommand::POSITION:
+		Voice.m_Position = vec2(Command.m_X, Command.m_Y);
+		break;
+	case CVoiceCommand::TIME_OFFSET:
 	{
-		const int LoopStart = m_aVoices[VoiceId].m_pSample->m_LoopStart;
-		const int NumFrames = m_aVoices[VoiceId].m_pSample->m_NumFrames;
-		if(TickOffset < static_cast<uint64_t>(NumFrames))
+		if(!Voice.m_pSample)
+			return;
+
+		const float TimeOffset = Command.m_X;
+		int Tick = 0;
+		bool IsLooping = Voice.m_Flags & ISound::FLAG_LOOP;
+		uint64_t TickOffset = Voice.m_pSample->m_Rate * TimeOffset;
+		if(Voice.m_pSample->m_NumFrames > 0 && IsLooping)
 		{
-			// Still in first playthrough
-			Tick = TickOffset;
+			const int LoopStart = Voice.m_pSample->m_LoopStart;
+			const int NumFrames = Voice.m_pSample->m_NumFrames;
+			if(TickOffset < static_cast<uint64_t>(NumFrames))
+			{
+				// Still in first playthrough
+				Tick = TickOffset;
+			}
+			else
+			{
+				// Past first playthrough, wrap within loop section only
+				const int LoopLength = NumFrames - LoopStart;
+				if(LoopLength > 0)
+					Tick = LoopStart + ((TickOffset - NumFrames) % LoopLength);
+				else
+					Tick = LoopStart;
+			}
 		}
 		else
 		{
-			// Past first playthrough, wrap within loop section only
-			const int LoopLength = NumFrames - LoopStart;
-			if(LoopLength > 0)
-				Tick = LoopStart + ((TickOffset - NumFrames) % LoopLength);
-			else
-				Tick = LoopStart;
+			Tick = std::clamp<uint64_t>(TickOffset, 0, Voice.m_pSample->m_NumFrames);
 		}
-	}
-	else
-	{
-		Tick = std::clamp<uint64_t>(TickOffset, 0, m_aVoices[VoiceId].m_pSample->m_NumFrames);
-	}
 
-	// at least 200msec off, else depend on buffer size
-	float Threshold = maximum(0.2f * m_aVoices[VoiceId].m_pSample->m_Rate, (float)m_MaxFrames);
-	if(absolute(m_aVoices[VoiceId].m_Tick - Tick) > Threshold)
-	{
-		// take care of looping (modulo!)
-		if(!(IsLooping && (minimum(m_aVoices[VoiceId].m_Tick, Tick) + m_aVoices[VoiceId].m_pSample->m_NumFrames - maximum(m_aVoices[VoiceId].m_Tick, Tick)) <= Threshold))
+		// at least 200msec off, else depend on buffer size
+		float Threshold = maximum(0.2f * Voice.m_pSample->m_Rate, (float)m_MaxFrames);
+		if(absolute(Voice.m_Tick - Tick) > Threshold)
 		{
-			m_aVoices[VoiceId].m_Tick = Tick;
+			// take care of looping (modulo!)
+			if(!(IsLooping && (minimum(Voice.m_Tick, Tick) + Voice.m_pSample->m_NumFrames - maximum(Voice.m_Tick, Tick)) <= Threshold))
+			{
+				Voice.m_Tick = Tick;
+			}
 		}
+		break;
+	}
+	case CVoiceCommand::CIRCLE:
+		Voice.m_Shape = ISound::SHAPE_CIRCLE;
+		Voice.m_Circle.m_Radius = maximum(0.0f, Command.m_X);
+		break;
+	case CVoiceCommand::RECTANGLE:
+		Voice.m_Shape = ISound::SHAPE_RECTANGLE;
+		Voice.m_Rectangle.m_Width = maximum(0.0f, Command.m_X);
+		Voice.m_Rectangle.m_Height = maximum(0.0f, Command.m_Y);
+		break;
+	default:
+		dbg_assert_failed("Invalid voice command type: %d", Command.m_Type);
 	}
 }
 
-void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
+void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
 {
-	if(!Voice.IsValid())
-		return;
-
-	int VoiceId = Voice.Id();
-
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
+	PushVoiceCommand(CVoiceCommand::VOLUME, Voice, Volume);
+}
 
-	m_aVoices[VoiceId].m_Shape = ISound::SHAPE_CIRCLE;
-	m_aVoices[VoiceId].m_Circle.m_Radius = maximum(0.0f, Radius);
+void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
+{
+	PushVoiceCommand(CVoiceCommand::FALLOFF, Voice, Falloff);
 }
 
-void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
+void CSound::SetVoicePosition(CVoiceHandle Voice, vec2 Position)
 {
-	if(!Voice.IsValid())
-		return;
+	PushVoiceCommand(CVoiceCommand::POSITION, Voice, Position.x, Position.y);
+}
 
-	int VoiceId = Voice.Id();
+void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
+{
+	PushVoiceCommand(CVoiceCommand::TIME_OFFSET, Voice, TimeOffset);
+}
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceId].m_Age != Voice.Age())
-		return;
+void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
+{
+	PushVoiceCommand(CVoiceCommand::CIRCLE, Voice, Radius);
+}
 
-	m_aVoices[VoiceId].m_Shape = ISound::SHAPE_RECTANGLE;
-	m_aVoices[VoiceId].m_Rectangle.m_Width = maximum(0.0f, Width);
-	m_aVoices[VoiceId].m_Rectangle.m_Height = maximum(0.0f, Height);
+void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
+{
+	PushVoiceCommand(CVoiceCommand::RECTANGLE, Voice, Width, Height);
 }
 
 ISound::CVoiceHandle CSound::Play(int ChannelId, int SampleId, int Flags, float Volume, vec2 Position)
@@ -953,6 +984,7 @@ void CSound::Pause(int SampleId)
 
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleId];
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	for(auto &Voice : m_aVoices)
@@ -971,6 +1003,7 @@ void CSound::Stop(int SampleId)
 
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	CSample *pSample = &m_aSamples[SampleId];
 	dbg_assert(m_aSamples[SampleId].IsLoaded(), "Sample not loaded");
 	for(auto &Voice : m_aVoices)
@@ -990,6 +1023,7 @@ void CSound::StopAll()
 {
 	// TODO: a nice fade out
 	const CLockScope LockScope(m_SoundLock);
+	ProcessVoiceCommands();
 	for(auto &Voice : m_aVoices)
 	{
 		if(Voice.m_pSample)
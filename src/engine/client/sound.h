@@ -5,6 +5,7 @@
 
 #include <base/lock.h>
 
+#include <engine/shared/mpsc_queue.h>
 #include <engine/sound.h>
 
 #include <SDL_audio.h>
@@ -59,6 +60,27 @@ struct CVoice
 	};
 };
 
+// parameter update of a playing voice, queued by the game thread and applied by the mixer
+class CVoiceCommand
+{
+public:
+	enum
+	{
+		VOLUME,
+		FALLOFF,
+		POSITION,
+		TIME_OFFSET,
+		CIRCLE,
+		RECTANGLE,
+	};
+
+	int m_Type;
+	int m_VoiceId;
+	int m_Age;
+	float m_X;
+	float m_Y;
+};
+
 class CSound : public IEngineSound
 {
 	enum
@@ -66,10 +88,14 @@ class CSound : public IEngineSound
 		NUM_SAMPLES = 512,
 		NUM_VOICES = 256,
 		NUM_CHANNELS = 16,
+		NUM_VOICE_COMMANDS = 1024,
 	};
 
 	bool m_SoundEnabled = false;
 	SDL_AudioDeviceID m_Device = 0;
+	// Held while mixing, so sample data is not freed while it is being read.
+	// m_SoundLock is only held while the voices are advanced, not for the entire mix.
+	CLock m_MixLock ACQUIRED_BEFORE(m_SoundLock);
 	CLock m_SoundLock;
 
 	CSample m_aSamples[NUM_SAMPLES] GUARDED_BY(m_SoundLock) = {{0}};
@@ -78,6 +104,8 @@ class CSound : public IEngineSound
 	CVoice m_aVoices[NUM_VOICES] GUARDED_BY(m_SoundLock) = {{nullptr}};
 	CChannel m_aChannels[NUM_CHANNELS] GUARDED_BY(m_SoundLock) = {{255, 0}};
 	int m_NextVoice GUARDED_BY(m_SoundLock) = 0;
+	// popped only while holding m_SoundLock
+	CMpscQueue<CVoiceCommand, NUM_VOICE_COMMANDS> m_VoiceCommands;
 	uint32_t m_MaxFrames = 0;
 
 	// This is not an std::atomic<vec2> as this would require linking with
@@ -90,9 +118,12 @@ class CSound : public IEngineSound
 	class IEngineGraphics *m_pGraphics = nullptr;
 	IStorage *m_pStorage = nullptr;
 
-	int *m_pMixBuffer = nullptr;
+	int *m_pMixBuffer GUARDED_BY(m_MixLock) = nullptr;
 
 	CSample *AllocSample() REQUIRES(!m_SoundLock);
+	void PushVoiceCommand(int Type, CVoiceHandle Voice, float X, float Y = 0.0f) REQUIRES(!m_SoundLock);
+	void ProcessVoiceCommands() REQUIRES(m_SoundLock);
+	void ApplyVoiceCommand(const CVoiceCommand &Command) REQUIRES(m_SoundLock);
 	void RateConvert(CSample &Sample) const;
 
 	// pContextName used for error
@@ -102,17 +133,17 @@ class CSound : public IEngineSound
 	void UpdateVolume();
 
 public:
-	int Init() override REQUIRES(!m_SoundLock);
+	int Init() override REQUIRES(!m_SoundLock, !m_MixLock);
 	int Update() override;
-	void Shutdown() override REQUIRES(!m_SoundLock);
+	void Shutdown() override REQUIRES(!m_SoundLock, !m_MixLock);
 
 	bool IsSoundEnabled() override { return m_SoundEnabled; }
 
-	int LoadOpus(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override REQUIRES(!m_SoundLock);
-	int LoadWV(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override REQUIRES(!m_SoundLock);
-	int LoadOpusFromMem(const void *pData, unsigned DataSize, bool ForceLoad, const char *pContextName) override REQUIRES(!m_SoundLock);
-	int LoadWVFromMem(const void *pData, unsigned DataSize, bool ForceLoad, const char *pContextName) override REQUIRES(!m_SoundLock);
-	void UnloadSample(int SampleId) override REQUIRES(!m_SoundLock);
+	int LoadOpus(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override REQUIRES(!m_SoundLock, !m_MixLock);
+	int LoadWV(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override REQUIRES(!m_SoundLock, !m_MixLock);
+	int LoadOpusFromMem(const void *pData, unsigned DataSize, bool ForceLoad, const char *pContextName) override REQUIRES(!m_SoundLock, !m_MixLock);
+	int LoadWVFromMem(const void *pData, unsigned DataSize, bool ForceLoad, const char *pContextName) override REQUIRES(!m_SoundLock, !m_MixLock);
+	void UnloadSample(int SampleId) override REQUIRES(!m_SoundLock, !m_MixLock);
 
 	float GetSampleTotalTime(int SampleId) override REQUIRES(!m_SoundLock); // in s
 	float GetSampleCurrentTime(int SampleId) override REQUIRES(!m_SoundLock); // in s
@@ -139,7 +170,7 @@ public:
 	bool IsPlaying(int SampleId) override REQUIRES(!m_SoundLock);
 
 	int MixingRate() const override { return m_MixingRate; }
-	void Mix(short *pFinalOut, unsigned Frames) override REQUIRES(!m_SoundLock);
+	void Mix(short *pFinalOut, unsigned Frames) override REQUIRES(!m_SoundLock, !m_MixLock);
 
 	void PauseAudioDevice() override;
 	void UnpauseAudioDevice() override;
@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/dbg.h>
+#include <base/lock.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/mem.h>
@@ -8,8 +9,12 @@
 #include <base/time.h>
 
 #include <engine/console.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
+#include <engine/shared/config.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/json.h>
+#include <engine/shared/profiler.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
 
@@ -19,9 +24,12 @@
 
 #include <chrono>
 #include <cstddef>
+#include <iterator>
 #include <limits>
+#include <memory>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 using namespace std::chrono_literals;
@@ -36,6 +44,8 @@ struct SGlyph
 	enum class EState
 	{
 		UNINITIALIZED,
+		// metrics and atlas position are known, the pixels are still being rasterized
+		QUEUED,
 		RENDERED,
 		ERROR,
 	};
@@ -274,6 +284,218 @@ public:
 	}
 };
 
+/**
+ * Rasterizes glyphs in job threads. FreeType faces must not be used by
+ * multiple threads at once, so the rasterizer creates its own faces from
+ * the same font data as the faces of the glyph map.
+ */
+class CGlyphRasterizer
+{
+public:
+	struct SRequest
+	{
+		// face of the glyph map, only used as a key
+		FT_Face m_Face;
+		int m_Chr;
+		FT_UInt m_GlyphIndex;
+		int m_FontSize;
+
+		// reserved space in the atlas, including the padding for the outline
+		int m_X;
+		int m_Y;
+		unsigned m_Width;
+		unsigned m_Height;
+		int m_Padding;
+		int m_OutlineThickness;
+
+		// owned by the request until uploaded
+		uint8_t *m_pDataFill = nullptr;
+		uint8_t *m_pDataOutline = nullptr;
+	};
+
+private:
+	struct SFontSource
+	{
+		FT_Face m_Face;
+		const FT_Byte *m_pData;
+		FT_Long m_DataSize;
+		FT_Long m_FaceIndex;
+	};
+
+	CLock m_Lock;
+	bool m_Shutdown GUARDED_BY(m_Lock) = false;
+	FT_Library m_Library GUARDED_BY(m_Lock) = nullptr;
+	std::vector<SFontSource> m_vSources GUARDED_BY(m_Lock);
+	std::unordered_map<FT_Face, FT_Face> m_Faces GUARDED_BY(m_Lock);
+
+	FT_Face Face(FT_Face Face) REQUIRES(m_Lock)
+	{
+		auto Existing = m_Faces.find(Face);
+		if(Existing != m_Faces.end())
+			return Existing->second;
+
+		FT_Face OwnFace = nullptr;
+		for(const SFontSource &Source : m_vSources)
+		{
+			if(Source.m_Face != Face)
+				continue;
+			if(m_Library == nullptr && FT_Init_FreeType(&m_Library))
+			{
+				m_Library = nullptr;
+				break;
+			}
+			if(FT_New_Memory_Face(m_Library, Source.m_pData, Source.m_DataSize, Source.m_FaceIndex, &OwnFace))
+				OwnFace = nullptr;
+			break;
+		}
+		m_Faces[Face] = OwnFace;
+		return OwnFace;
+	}
+
+public:
+	~CGlyphRasterizer()
+	{
+		Shutdown();
+	}
+
+	void AddFace(FT_Face Face, const FT_Byte *pData, FT_Long DataSize, FT_Long FaceIndex) REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		m_vSources.push_back({Face, pData, DataSize, FaceIndex});
+	}
+
+	// Frees the faces before the font data is freed, jobs which are still
+	// queued will not rasterize anything afterwards.
+	void Shutdown() REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Shutdown = true;
+		m_Faces.clear();
+		m_vSources.clear();
+		if(m_Library != nullptr)
+			FT_Done_FreeType(m_Library);
+		m_Library = nullptr;
+	}
+
+	bool Rasterize(SRequest &Request) REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		if(m_Shutdown)
+			return false;
+
+		FT_Face OwnFace = Face(Request.m_Face);
+		if(OwnFace == nullptr)
+		{
+			log_debug("textrender", "Error creating face for glyph rasterization. Chr=%d", Request.m_Chr);
+			return false;
+		}
+
+		FT_Set_Pixel_Sizes(OwnFace, 0, Request.m_FontSize);
+		if(FT_Load_Glyph(OwnFace, Request.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+		{
+			log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Request.m_Chr, Request.m_GlyphIndex);
+			return false;
+		}
+
+		const FT_Bitmap *pBitmap = &OwnFace->glyph->bitmap;
+		if(pBitmap->pixel_mode != FT_PIXEL_MODE_GRAY)
+		{
+			log_debug("textrender", "Error loading glyph, unsupported pixel mode. Chr=%d GlyphIndex=%u PixelMode=%d", Request.m_Chr, Request.m_GlyphIndex, pBitmap->pixel_mode);
+			return false;
+		}
+
+		CreateGlyphData(pBitmap, Request.m_Padding, Request.m_Width, Request.m_Height, Request.m_OutlineThickness, &Request.m_pDataFill, &Request.m_pDataOutline);
+		return true;
+	}
+
+	static void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount)
+	{
+		for(int y = 0; y < h; y++)
+		{
+			for(int x = 0; x < w; x++)
+			{
+				int c = pIn[y * w + x];
+
+				for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
+				{
+					for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
+					{
+						int GetX = x + sx;
+						int GetY = y + sy;
+						if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
+						{
+							int Index = GetY * w + GetX;
+							float Mask = 1.f - std::clamp(length(vec2(sx, sy)) - OutlineCount, 0.f, 1.f);
+							c = maximum(c, int(pIn[Index] * Mask));
+						}
+					}
+				}
+
+				pOut[y * w + x] = c;
+			}
+		}
+	}
+
+	static int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize)
+	{
+		if(FontSize > 48)
+			OutlineThickness *= 4;
+		else if(FontSize >= 18)
+			OutlineThickness *= 2;
+		return OutlineThickness;
+	}
+
+	// The bitmap is placed at the padding and clipped to the reserved size,
+	// in case it is larger than predicted by the metrics.
+	static void CreateGlyphData(const FT_Bitmap *pBitmap, int Padding, unsigned Width, unsigned Height, int OutlineThickness, uint8_t **ppDataFill, uint8_t **ppDataOutline)
+	{
+		const size_t GlyphDataSize = (size_t)Width * Height * sizeof(uint8_t);
+		uint8_t *pGlyphDataFill = static_cast<uint8_t *>(malloc(GlyphDataSize));
+		uint8_t *pGlyphDataOutline = static_cast<uint8_t *>(malloc(GlyphDataSize));
+		mem_zero(pGlyphDataFill, GlyphDataSize);
+		const unsigned CopyWidth = minimum<unsigned>(pBitmap->width, Width - Padding);
+		const unsigned CopyHeight = minimum<unsigned>(pBitmap->rows, Height - Padding);
+		for(unsigned py = 0; py < CopyHeight; ++py)
+		{
+			mem_copy(&pGlyphDataFill[(py + Padding) * Width + Padding], &pBitmap->buffer[py * pBitmap->width], CopyWidth);
+		}
+		Grow(pGlyphDataFill, pGlyphDataOutline, Width, Height, OutlineThickness);
+		*ppDataFill = pGlyphDataFill;
+		*ppDataOutline = pGlyphDataOutline;
+	}
+};
+
+class CGlyphRasterizationJob : public IJob
+{
+	std::shared_ptr<CGlyphRasterizer> m_pRasterizer;
+	std::vector<CGlyphRasterizer::SRequest> m_vRequests;
+
+	void Run() override
+	{
+		const CProfileScope ProfileScope("glyph_rasterization");
+		for(CGlyphRasterizer::SRequest &Request : m_vRequests)
+			m_pRasterizer->Rasterize(Request);
+	}
+
+public:
+	CGlyphRasterizationJob(std::shared_ptr<CGlyphRasterizer> pRasterizer, std::vector<CGlyphRasterizer::SRequest> &&vRequests) :
+		m_pRasterizer(std::move(pRasterizer)), m_vRequests(std::move(vRequests))
+	{
+	}
+
+	~CGlyphRasterizationJob() override
+	{
+		for(CGlyphRasterizer::SRequest &Request : m_vRequests)
+		{
+			free(Request.m_pDataFill);
+			free(Request.m_pDataOutline);
+		}
+	}
+
+	// Only valid once the job is done.
+	std::vector<CGlyphRasterizer::SRequest> &Requests() { return m_vRequests; }
+};
+
 class CGlyphMap
 {
 public:
@@ -312,8 +534,33 @@ private:
 	 */
 	static constexpr int REPLACEMENT_CHARACTER = 0x25a1;
 
+	/**
+	 * Characters rasterized in the background when a font size is first used,
+	 * depending on gfx_text_prewarm.
+	 */
+	static constexpr std::pair<int, int> PREWARM_RANGES[] = {
+		{0x0020, 0x007e}, // Basic Latin
+		{0x00a0, 0x00ff}, // Latin-1 Supplement
+		{0x0100, 0x017f}, // Latin Extended-A
+		{0x0370, 0x03ff}, // Greek and Coptic
+		{0x0400, 0x04ff}, // Cyrillic
+		{0x3000, 0x303f}, // CJK Symbols and Punctuation
+		{0x3040, 0x309f}, // Hiragana
+		{0x30a0, 0x30ff}, // Katakana
+	};
+	static constexpr int NUM_PREWARM_RANGES_LATIN = 2;
+
+	/**
+	 * Prewarming loads the metrics of this many glyphs about once a frame,
+	 * so it doesn't stall the frame in which a font size is first used.
+	 */
+	static constexpr int PREWARM_GLYPHS_PER_STEP = 16;
+	static constexpr std::chrono::nanoseconds PREWARM_STEP_INTERVAL = std::chrono::milliseconds(16);
+
 	IGraphics *m_pGraphics;
+	IEngine *m_pEngine;
 	IGraphics *Graphics() { return m_pGraphics; }
+	IEngine *Engine() { return m_pEngine; }
 
 	// Atlas textures and data
 	IGraphics::CTextureHandle m_aTextures[NUM_FONT_TEXTURES];
@@ -324,6 +571,17 @@ private:
 	CAtlas m_TextureAtlas;
 	std::unordered_map<std::tuple<FT_Face, int, int>, SGlyph, SGlyphKeyHash, SGlyphKeyEquals> m_Glyphs;
 
+	// Background rasterization, at most one job is running at a time
+	std::shared_ptr<CGlyphRasterizer> m_pRasterizer;
+	std::shared_ptr<CGlyphRasterizationJob> m_pRasterizationJob;
+	std::vector<CGlyphRasterizer::SRequest> m_vRasterizationRequests;
+	bool m_aPrewarmedFontSizes[MAX_FONT_SIZE + 1] = {};
+	// font sizes waiting to be prewarmed, the first one continues at m_PrewarmChr
+	std::vector<int> m_vPrewarmFontSizes;
+	int m_PrewarmRange = 0;
+	int m_PrewarmChr = PREWARM_RANGES[0].first;
+	std::chrono::nanoseconds m_LastPrewarmStep{0};
+
 	// Font faces
 	FT_Face m_DefaultFace = nullptr;
 	FT_Face m_IconFace = nullptr;
@@ -448,43 +706,6 @@ private:
 		return GlyphIndex;
 	}
 
-	void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount) const
-	{
-		for(int y = 0; y < h; y++)
-		{
-			for(int x = 0; x < w; x++)
-			{
-				int c = pIn[y * w + x];
-
-				for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
-				{
-					for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
-					{
-						int GetX = x + sx;
-						int GetY = y + sy;
-						if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
-						{
-							int Index = GetY * w + GetX;
-							float Mask = 1.f - std::clamp(length(vec2(sx, sy)) - OutlineCount, 0.f, 1.f);
-							c = maximum(c, int(pIn[Index] * Mask));
-						}
-					}
-				}
-
-				pOut[y * w + x] = c;
-			}
-		}
-	}
-
-	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize) const
-	{
-		if(FontSize > 48)
-			OutlineThickness *= 4;
-		else if(FontSize >= 18)
-			OutlineThickness *= 2;
-		return OutlineThickness;
-	}
-
 	void UploadGlyph(int TextureIndex, int PosX, int PosY, size_t Width, size_t Height, uint8_t *pData)
 	{
 		for(size_t y = 0; y < Height; ++y)
@@ -503,21 +724,35 @@ private:
 	{
 		FT_Set_Pixel_Sizes(Glyph.m_Face, 0, Glyph.m_FontSize);
 
-		if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+		// Only load the metrics if the glyph is rasterized in the background,
+		// they are enough for the layout and to reserve space in the atlas.
+		bool Rasterize = !g_Config.m_GfxTextAsync;
+		if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, Rasterize ? FT_LOAD_RENDER | FT_LOAD_NO_BITMAP : FT_LOAD_NO_BITMAP))
 		{
 			log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Glyph.m_Chr, Glyph.m_GlyphIndex);
 			return false;
 		}
 
+		if(!Rasterize && Glyph.m_Face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+		{
+			Rasterize = true;
+			if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+			{
+				log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Glyph.m_Chr, Glyph.m_GlyphIndex);
+				return false;
+			}
+		}
+
 		const FT_Bitmap *pBitmap = &Glyph.m_Face->glyph->bitmap;
-		if(pBitmap->pixel_mode != FT_PIXEL_MODE_GRAY)
+		if(Rasterize && pBitmap->pixel_mode != FT_PIXEL_MODE_GRAY)
 		{
 			log_debug("textrender", "Error loading glyph, unsupported pixel mode. Chr=%d GlyphIndex=%u PixelMode=%d", Glyph.m_Chr, Glyph.m_GlyphIndex, pBitmap->pixel_mode);
 			return false;
 		}
 
-		const unsigned RealWidth = pBitmap->width;
-		const unsigned RealHeight = pBitmap->rows;
+		// hinted metrics are grid-fitted, so they match the size of the bitmap
+		const unsigned RealWidth = Rasterize ? pBitmap->width : (unsigned)(Glyph.m_Face->glyph->metrics.width >> 6);
+		const unsigned RealHeight = Rasterize ? pBitmap->rows : (unsigned)(Glyph.m_Face->glyph->metrics.height >> 6);
 
 		// adjust spacing
 		int OutlineThickness = 0;
@@ -525,7 +760,7 @@ private:
 		int y = 0;
 		if(RealWidth > 0)
 		{
-			OutlineThickness = AdjustOutlineThicknessToFontSize(1, Glyph.m_FontSize);
+			OutlineThickness = CGlyphRasterizer::AdjustOutlineThicknessToFontSize(1, Glyph.m_FontSize);
 			x += (OutlineThickness + 1);
 			y += (OutlineThickness + 1);
 		}
@@ -536,6 +771,7 @@ private:
 		int X = 0;
 		int Y = 0;
 
+		bool Queued = false;
 		if(Width > 0 && Height > 0)
 		{
 			// find space in atlas, or increase size if necessary
@@ -548,20 +784,33 @@ private:
 				}
 			}
 
-			// prepare glyph data
-			const size_t GlyphDataSize = (size_t)Width * Height * sizeof(uint8_t);
-			uint8_t *pGlyphDataFill = static_cast<uint8_t *>(malloc(GlyphDataSize));
-			uint8_t *pGlyphDataOutline = static_cast<uint8_t *>(malloc(GlyphDataSize));
-			mem_zero(pGlyphDataFill, GlyphDataSize);
-			for(unsigned py = 0; py < pBitmap->rows; ++py)
+			if(Rasterize)
 			{
-				mem_copy(&pGlyphDataFill[(py + y) * Width + x], &pBitmap->buffer[py * pBitmap->width], pBitmap->width);
-			}
-			Grow(pGlyphDataFill, pGlyphDataOutline, Width, Height, OutlineThickness);
+				uint8_t *pGlyphDataFill;
+				uint8_t *pGlyphDataOutline;
+				CGlyphRasterizer::CreateGlyphData(pBitmap, x, Width, Height, OutlineThickness, &pGlyphDataFill, &pGlyphDataOutline);
 
-			// upload the glyph
-			UploadGlyph(FONT_TEXTURE_FILL, X, Y, Width, Height, pGlyphDataFill);
-			UploadGlyph(FONT_TEXTURE_OUTLINE, X, Y, Width, Height, pGlyphDataOutline);
+				// upload the glyph
+				UploadGlyph(FONT_TEXTURE_FILL, X, Y, Width, Height, pGlyphDataFill);
+				UploadGlyph(FONT_TEXTURE_OUTLINE, X, Y, Width, Height, pGlyphDataOutline);
+			}
+			else
+			{
+				// the reserved space stays empty until the glyph is uploaded
+				CGlyphRasterizer::SRequest Request;
+				Request.m_Face = Glyph.m_Face;
+				Request.m_Chr = Glyph.m_Chr;
+				Request.m_GlyphIndex = Glyph.m_GlyphIndex;
+				Request.m_FontSize = Glyph.m_FontSize;
+				Request.m_X = X;
+				Request.m_Y = Y;
+				Request.m_Width = Width;
+				Request.m_Height = Height;
+				Request.m_Padding = x;
+				Request.m_OutlineThickness = OutlineThickness;
+				m_vRasterizationRequests.push_back(Request);
+				Queued = true;
+			}
 		}
 
 		// set glyph info
@@ -579,15 +828,48 @@ private:
 			Glyph.m_aUVs[2] = Glyph.m_aUVs[0] + Width;
 			Glyph.m_aUVs[3] = Glyph.m_aUVs[1] + Height;
 
-			Glyph.m_State = SGlyph::EState::RENDERED;
+			Glyph.m_State = Queued ? SGlyph::EState::QUEUED : SGlyph::EState::RENDERED;
 		}
 		return true;
 	}
 
+	// Queues the glyphs of the next few prewarmed characters for rasterization.
+	void PrewarmGlyphs()
+	{
+		if(m_vPrewarmFontSizes.empty() || !g_Config.m_GfxTextPrewarm || !g_Config.m_GfxTextAsync)
+			return;
+		const std::chrono::nanoseconds Now = time_get_nanoseconds();
+		if(Now - m_LastPrewarmStep < PREWARM_STEP_INTERVAL)
+			return;
+		m_LastPrewarmStep = Now;
+
+		const int NumRanges = g_Config.m_GfxTextPrewarm >= 2 ? (int)std::size(PREWARM_RANGES) : NUM_PREWARM_RANGES_LATIN;
+		for(int i = 0; i < PREWARM_GLYPHS_PER_STEP && !m_vPrewarmFontSizes.empty(); ++i)
+		{
+			GetGlyph(m_PrewarmChr, m_vPrewarmFontSizes.front());
+			if(m_PrewarmChr < PREWARM_RANGES[m_PrewarmRange].second)
+			{
+				++m_PrewarmChr;
+			}
+			else if(++m_PrewarmRange < NumRanges)
+			{
+				m_PrewarmChr = PREWARM_RANGES[m_PrewarmRange].first;
+			}
+			else
+			{
+				m_vPrewarmFontSizes.erase(m_vPrewarmFontSizes.begin());
+				m_PrewarmRange = 0;
+				m_PrewarmChr = PREWARM_RANGES[0].first;
+			}
+		}
+	}
+
 public:
-	CGlyphMap(IGraphics *pGraphics)
+	CGlyphMap(IGraphics *pGraphics, IEngine *pEngine)
 	{
 		m_pGraphics = pGraphics;
+		m_pEngine = pEngine;
+		m_pRasterizer = std::make_shared<CGlyphRasterizer>();
 		for(auto &pTextureData : m_apTextureData)
 		{
 			pTextureData = new uint8_t[m_TextureDimension * m_TextureDimension];
@@ -600,6 +882,8 @@ public:
 
 	~CGlyphMap()
 	{
+		// a job which has not finished yet keeps the rasterizer alive, but must not use the faces anymore
+		m_pRasterizer->Shutdown();
 		UnloadTextures();
 		for(auto &pTextureData : m_apTextureData)
 		{
@@ -617,9 +901,10 @@ public:
 		return m_IconFace;
 	}
 
-	void AddFace(FT_Face Face)
+	void AddFace(FT_Face Face, const FT_Byte *pData, FT_Long DataSize, FT_Long FaceIndex)
 	{
 		m_vFtFaces.push_back(Face);
+		m_pRasterizer->AddFace(Face, pData, DataSize, FaceIndex);
 	}
 
 	bool SetDefaultFaceByName(const char *pFamilyName)
@@ -670,8 +955,8 @@ public:
 		FT_Face Face = GetFaceByName(pFamilyName);
 		if(m_VariantFace != Face)
 		{
+			// Glyphs are cached per face, so the atlas stays valid and is not rebuilt.
 			m_VariantFace = Face;
-			Clear(); // rebuild atlas after changing variant font
 			if(!Face && pFamilyName != nullptr)
 			{
 				log_error("textrender", "The variant font face '%s' could not be found", pFamilyName);
@@ -694,22 +979,56 @@ public:
 		}
 	}
 
-	void Clear()
+	// Uploads the glyphs rasterized by the last job and starts a job for
+	// the glyphs queued since then. Must be called regularly.
+	void UpdateRasterization()
 	{
-		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES; ++TextureIndex)
+		if(m_pRasterizationJob)
 		{
-			mem_zero(m_apTextureData[TextureIndex], m_TextureDimension * m_TextureDimension * sizeof(uint8_t));
-			Graphics()->UpdateTextTexture(m_aTextures[TextureIndex], 0, 0, m_TextureDimension, m_TextureDimension, m_apTextureData[TextureIndex], false);
+			if(!m_pRasterizationJob->Done())
+				return;
+
+			for(CGlyphRasterizer::SRequest &Request : m_pRasterizationJob->Requests())
+			{
+				auto Glyph = m_Glyphs.find(std::make_tuple(Request.m_Face, Request.m_Chr, Request.m_FontSize));
+				if(Glyph == m_Glyphs.end() || Glyph->second.m_State != SGlyph::EState::QUEUED)
+					continue;
+
+				if(Request.m_pDataFill == nullptr)
+				{
+					// the space stays empty, but don't use the glyph for new text
+					Glyph->second.m_State = SGlyph::EState::ERROR;
+					continue;
+				}
+
+				UploadGlyph(FONT_TEXTURE_FILL, Request.m_X, Request.m_Y, Request.m_Width, Request.m_Height, Request.m_pDataFill);
+				UploadGlyph(FONT_TEXTURE_OUTLINE, Request.m_X, Request.m_Y, Request.m_Width, Request.m_Height, Request.m_pDataOutline);
+				Request.m_pDataFill = nullptr;
+				Request.m_pDataOutline = nullptr;
+				Glyph->second.m_State = SGlyph::EState::RENDERED;
+			}
+			m_pRasterizationJob = nullptr;
 		}
 
-		m_TextureAtlas.Clear(m_TextureDimension);
-		m_Glyphs.clear();
+		PrewarmGlyphs();
+		if(!m_vRasterizationRequests.empty())
+		{
+			m_pRasterizationJob = std::make_shared<CGlyphRasterizationJob>(m_pRasterizer, std::move(m_vRasterizationRequests));
+			m_vRasterizationRequests.clear();
+			Engine()->AddJob(m_pRasterizationJob);
+		}
 	}
 
 	const SGlyph *GetGlyph(int Chr, int FontSize)
 	{
 		FontSize = std::clamp(FontSize, MIN_FONT_SIZE, MAX_FONT_SIZE);
 
+		if(g_Config.m_GfxTextPrewarm && g_Config.m_GfxTextAsync && !m_aPrewarmedFontSizes[FontSize])
+		{
+			m_aPrewarmedFontSizes[FontSize] = true;
+			m_vPrewarmFontSizes.push_back(FontSize);
+		}
+
 		// Find glyph index and most appropriate font face.
 		FT_Face Face;
 		FT_UInt GlyphIndex = GetCharGlyph(Chr, &Face, false);
@@ -722,7 +1041,7 @@ public:
 
 		// Check if glyph for this (font face, character, font size)-combination was already rendered.
 		SGlyph &Glyph = m_Glyphs[std::make_tuple(Face, Chr, FontSize)];
-		if(Glyph.m_State == SGlyph::EState::RENDERED)
+		if(Glyph.m_State == SGlyph::EState::RENDERED || Glyph.m_State == SGlyph::EState::QUEUED)
 			return &Glyph;
 		else if(Glyph.m_State == SGlyph::EState::ERROR)
 			return nullptr;
@@ -953,6 +1272,7 @@ struct SFontLanguageVariant
 class CTextRender : public IEngineTextRender
 {
 	IConsole *m_pConsole;
+	IEngine *m_pEngine;
 	IGraphics *m_pGraphics;
 	IStorage *m_pStorage;
 	IConsole *Console() { return m_pConsole; }
@@ -1063,7 +1383,7 @@ class CTextRender : public IEngineTextRender
 				continue;
 			}
 
-			m_pGlyphMap->AddFace(FtFace);
+			m_pGlyphMap->AddFace(FtFace, pFontData, FontDataSize, FaceIndex);
 
 			log_debug("textrender", "Loaded font face %ld '%s %s' from font file '%s'", FaceIndex, FtFace->family_name, FtFace->style_name, pFontName);
 			LoadedAny = true;
@@ -1092,6 +1412,7 @@ public:
 	CTextRender()
 	{
 		m_pConsole = nullptr;
+		m_pEngine = nullptr;
 		m_pGraphics = nullptr;
 		m_pStorage = nullptr;
 		m_pGlyphMap = nullptr;
@@ -1109,10 +1430,11 @@ public:
 	void Init() override
 	{
 		m_pConsole = Kernel()->RequestInterface<IConsole>();
+		m_pEngine = Kernel()->RequestInterface<IEngine>();
 		m_pGraphics = Kernel()->RequestInterface<IGraphics>();
 		m_pStorage = Kernel()->RequestInterface<IStorage>();
 		FT_Init_FreeType(&m_FTLibrary);
-		m_pGlyphMap = new CGlyphMap(m_pGraphics);
+		m_pGlyphMap = new CGlyphMap(m_pGraphics, m_pEngine);
 
 		// print freetype version
 		{
@@ -1171,6 +1493,7 @@ public:
 		m_DefaultTextContainerInfo.m_vAttributes.clear();
 
 		m_pConsole = nullptr;
+		m_pEngine = nullptr;
 		m_pGraphics = nullptr;
 		m_pStorage = nullptr;
 	}
@@ -2118,6 +2441,8 @@ public:
 
 	void RenderTextContainer(STextContainerIndex TextContainerIndex, const ColorRGBA &TextColor, const ColorRGBA &TextOutlineColor) override
 	{
+		m_pGlyphMap->UpdateRasterization();
+
 		const STextContainer &TextContainer = GetTextContainer(TextContainerIndex);
 
 		if(!TextContainer.m_StringInfo.m_vCharacterQuads.empty())
@@ -141,6 +141,8 @@ public:
 
 	static LEVEL ToLogLevel(int ConsoleLevel);
 	static int ToLogLevelFilter(int ConsoleLevel);
+	// Drops log messages before formatting that none of the configurable log outputs would accept.
+	static void UpdateLogMaxLevel();
 
 	// DDRace
 
@@ -280,6 +280,18 @@ public:
 	virtual uint64_t StreamedMemoryUsage() const = 0;
 	virtual uint64_t StagingMemoryUsage() const = 0;
 
+	class CFrameStatistics
+	{
+	public:
+		int m_NumCommands = 0;
+		int m_NumDrawCalls = 0;
+		// indexed vertices are counted once per index
+		int64_t m_NumVertices = 0;
+		int m_NumTextureSwitches = 0;
+	};
+	// Commands added during the last frame, updated on `Swap`.
+	virtual const CFrameStatistics &FrameStatistics() const = 0;
+
 	virtual const TTwGraphicsGpuList &GetGpus() const = 0;
 
 	virtual bool LoadPng(CImageInfo &Image, const char *pFilename, int StorageType) = 0;
@@ -292,6 +304,8 @@ public:
 	virtual CTextureHandle LoadTextureRaw(const CImageInfo &Image, int Flags, const char *pTexName = nullptr) = 0;
 	virtual CTextureHandle LoadTextureRawMove(CImageInfo &Image, int Flags, const char *pTexName = nullptr) = 0;
 	virtual CTextureHandle LoadTexture(const char *pFilename, int StorageType, int Flags = 0) = 0;
+	// texture returned by LoadTexture if the image could not be loaded
+	virtual CTextureHandle NullTexture() const = 0;
 	virtual void TextureSet(CTextureHandle Texture) = 0;
 	void TextureClear() { TextureSet(CTextureHandle()); }
 
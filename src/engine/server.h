@@ -141,7 +141,7 @@ public:
 		{
 			str_format(aBuf, sizeof(aBuf), "%s: %s", ClientName(MsgCopy.m_ClientId), MsgCopy.m_pMessage);
 			MsgCopy.m_pMessage = aBuf;
-			MsgCopy.m_ClientId = VANILLA_MAX_CLIENTS - 1;
+			MsgCopy.m_ClientId = IsSixup(ClientId) ? -1 : VANILLA_MAX_CLIENTS - 1;
 		}
 
 		if(IsSixup(ClientId))
@@ -174,6 +174,8 @@ public:
 		{
 			protocol7::CNetMsg_Sv_RaceFinish Msg7;
 			Msg7.m_ClientId = pMsg->m_ClientId;
+			if(!Translate(Msg7.m_ClientId, ClientId))
+				return 0;
 			Msg7.m_Diff = pMsg->m_Diff;
 			Msg7.m_Time = pMsg->m_Time;
 			Msg7.m_RecordPersonal = pMsg->m_RecordPersonal;
@@ -196,8 +198,9 @@ public:
 
 	bool Translate(int &Target, int Client)
 	{
+		// 0.7 clients do not know the clients they cannot address
 		if(IsSixup(Client))
-			return true;
+			return Target < SIXUP_MAX_CLIENTS;
 		if(GetClientVersion(Client) >= VERSION_DDNET_OLD)
 			return true;
 		int *pMap = GetIdMap(Client);
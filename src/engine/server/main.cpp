@@ -179,6 +179,7 @@ int main(int argc, const char **argv)
 	// parse the command line arguments
 	if(argc > 1)
 		pConsole->ParseArguments(argc - 1, &argv[1]);
+	IConsole::UpdateLogMaxLevel();
 
 	pConfigManager->SetReadOnly("sv_max_clients", true);
 	pConfigManager->SetReadOnly("sv_test_cmds", true);
@@ -140,6 +140,12 @@ class CRegister : public IRegister
 	CUuid m_ChallengeSecret = RandomUuid();
 	bool m_GotServerInfo = false;
 	char m_aServerInfo[32768];
+	bool m_InfoExpired = false;
+	std::function<std::string()> m_GetInfo;
+
+	bool StoreInfo(const char *pInfo);
+	void FetchExpiredInfo();
+	bool InfoSendDue() const;
 
 public:
 	CRegister(CConfig *pConfig, IConsole *pConsole, IEngine *pEngine, IHttp *pHttp, int ServerPort, unsigned SixupSecurityToken);
@@ -147,6 +153,7 @@ public:
 	void OnConfigChange() override;
 	bool OnPacket(const CNetChunk *pPacket) override;
 	void OnNewInfo(const char *pInfo) override;
+	void OnInfoExpired(std::function<std::string()> GetInfo) override;
 	void OnShutdown() override;
 };
 
@@ -274,6 +281,8 @@ void CRegister::CProtocol::SendRegister()
 	FormatUuid(m_pParent->m_ChallengeSecret, aChallengeUuid, sizeof(aChallengeUuid));
 	char aChallengeSecret[64];
 	str_format(aChallengeSecret, sizeof(aChallengeSecret), "%s:%s", aChallengeUuid, ProtocolToString(m_Protocol));
+
+	m_pParent->FetchExpiredInfo();
 	int InfoSerial;
 	bool SendInfo;
 
@@ -555,6 +564,11 @@ void CRegister::Update()
 		}
 		m_GotFirstUpdateCall = true;
 	}
+	if(m_InfoExpired && InfoSendDue())
+	{
+		m_InfoExpired = false;
+		OnNewInfo(m_GetInfo().c_str());
+	}
 	if(!m_GotServerInfo)
 	{
 		return;
@@ -720,12 +734,12 @@ bool CRegister::OnPacket(const CNetChunk *pPacket)
 	return false;
 }
 
-void CRegister::OnNewInfo(const char *pInfo)
+bool CRegister::StoreInfo(const char *pInfo)
 {
 	log_trace("register", "info: %s", pInfo);
 	if(m_GotServerInfo && str_comp(m_aServerInfo, pInfo) == 0)
 	{
-		return;
+		return false;
 	}
 
 	m_GotServerInfo = true;
@@ -734,6 +748,58 @@ void CRegister::OnNewInfo(const char *pInfo)
 		const CLockScope LockScope(m_pGlobal->m_Lock);
 		m_pGlobal->m_InfoSerial += 1;
 	}
+	return true;
+}
+
+void CRegister::FetchExpiredInfo()
+{
+	if(m_InfoExpired)
+	{
+		m_InfoExpired = false;
+		StoreInfo(m_GetInfo().c_str());
+	}
+}
+
+bool CRegister::InfoSendDue() const
+{
+	// Mirrors the scheduling in `OnNewInfo`, so the info is built exactly
+	// when it would have been sent if it had been passed immediately.
+	if(!m_GotServerInfo || !m_GotFirstUpdateCall)
+	{
+		return true;
+	}
+	int64_t Now = time_get();
+	int64_t MaximumPrevRegister = -1;
+	bool AnyEnabled = false;
+	for(int i = 0; i < NUM_PROTOCOLS; i++)
+	{
+		if(!m_aProtocolEnabled[i])
+		{
+			continue;
+		}
+		AnyEnabled = true;
+		if(m_aProtocols[i].m_NextRegister == -1 || Now >= m_aProtocols[i].m_NextRegister)
+		{
+			return true;
+		}
+		MaximumPrevRegister = std::max(MaximumPrevRegister, m_aProtocols[i].m_PrevRegister);
+	}
+	return AnyEnabled && Now >= MaximumPrevRegister + time_freq();
+}
+
+void CRegister::OnInfoExpired(std::function<std::string()> GetInfo)
+{
+	m_GetInfo = std::move(GetInfo);
+	m_InfoExpired = true;
+}
+
+void CRegister::OnNewInfo(const char *pInfo)
+{
+	m_InfoExpired = false;
+	if(!StoreInfo(pInfo))
+	{
+		return;
+	}
 
 	// Don't start registering before the first `CRegister::Update` call.
 	if(!m_GotFirstUpdateCall)
@@ -1,6 +1,9 @@
 #ifndef ENGINE_SERVER_REGISTER_H
 #define ENGINE_SERVER_REGISTER_H
 
+#include <functional>
+#include <string>
+
 class CConfig;
 class IConsole;
 class IEngine;
@@ -21,6 +24,9 @@ public:
 	virtual bool OnPacket(const CNetChunk *pPacket) = 0;
 	// `pInfo` must be an encoded JSON object.
 	virtual void OnNewInfo(const char *pInfo) = 0;
+	// Marks the info as outdated. `GetInfo` is only called to get the new
+	// info, an encoded JSON object, once it is about to be sent.
+	virtual void OnInfoExpired(std::function<std::string()> GetInfo) = 0;
 	virtual void OnShutdown() = 0;
 };
 
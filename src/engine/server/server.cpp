@@ -233,6 +233,8 @@ void CServer::CClient::Reset()
 CServer::CServer()
 {
 	m_pConfig = &g_Config;
+	for(auto &Client : m_aClients)
+		Client.m_Snapshots.SetPool(&m_SnapshotPool);
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true);
 	m_aDemoRecorder[RECORDER_MANUAL] = CDemoRecorder(&m_SnapshotDelta, false);
@@ -1005,6 +1007,7 @@ void CServer::DoSnapshot()
 	if(m_aDemoRecorder[RECORDER_MANUAL].IsRecording() || m_aDemoRecorder[RECORDER_AUTO].IsRecording())
 	{
 		// create snapshot for demo recording
+		const CProfileScope ProfileScope("demo");
 		CSnapshotBuffer Data;
 
 		// build snap and possibly add some messages
@@ -1039,14 +1042,18 @@ void CServer::DoSnapshot()
 			continue;
 
 		{
-			m_SnapshotBuilder.Init(m_aClients[i].m_Sixup);
+			CSnapshotBuffer Data;
+			int SnapshotSize;
+			{
+				const CProfileScope ProfileScope("build");
+				m_SnapshotBuilder.Init(m_aClients[i].m_Sixup);
 
-			// only snap events on global ticks
-			GameServer()->OnSnap(i, IsGlobalSnap, m_aDemoRecorder[i].IsRecording());
+				// only snap events on global ticks
+				GameServer()->OnSnap(i, IsGlobalSnap, m_aDemoRecorder[i].IsRecording());
 
-			// finish snapshot
-			CSnapshotBuffer Data;
-			int SnapshotSize = m_SnapshotBuilder.Finish(&Data);
+				// finish snapshot
+				SnapshotSize = m_SnapshotBuilder.Finish(&Data);
+			}
 
 			if(m_aDemoRecorder[i].IsRecording())
 			{
@@ -1078,10 +1085,15 @@ void CServer::DoSnapshot()
 				}
 			}
 
-			// create delta
+			// create delta, identical snapshots are stored only once so the delta is empty if they are the same
 			CSnapshotDelta *const pSnapshotDelta = IsSixup(i) ? &m_SnapshotDeltaSixup : &m_SnapshotDelta;
 			char aDeltaData[CSnapshot::MAX_SIZE];
-			int DeltaSize = pSnapshotDelta->CreateDelta(pDeltashot, Data.AsSnapshot(), aDeltaData);
+			int DeltaSize = 0;
+			if(pDeltashot != m_aClients[i].m_Snapshots.m_pLast->m_pSnap)
+			{
+				const CProfileScope ProfileScope("delta");
+				DeltaSize = pSnapshotDelta->CreateDelta(pDeltashot, Data.AsSnapshot(), aDeltaData);
+			}
 
 			if(DeltaSize)
 			{
@@ -2213,7 +2225,8 @@ CServer::CCache::~CCache()
 
 CServer::CCache::CCacheChunk::CCacheChunk(const void *pData, int Size)
 {
-	m_vData.assign((const uint8_t *)pData, (const uint8_t *)pData + Size);
+	m_vData.resize(HEADROOM + Size);
+	mem_copy(Data(), pData, Size);
 }
 
 void CServer::CCache::AddChunk(const void *pData, int Size)
@@ -2226,6 +2239,69 @@ void CServer::CCache::Clear()
 	m_vCache.clear();
 }
 
+void CServer::UpdateServerInfoClient(int ClientId)
+{
+	CServerInfoClient &Info = m_aServerInfoClients[ClientId];
+	const char *pName = ClientName(ClientId);
+	const char *pClan = ClientClan(ClientId);
+	const std::optional<int> Score = m_aClients[ClientId].m_Score;
+	const bool Player = GameServer()->IsClientPlayer(ClientId);
+	if(Info.m_Valid &&
+		str_comp(Info.m_aName, pName) == 0 &&
+		str_comp(Info.m_aClan, pClan) == 0 &&
+		Info.m_Country == m_aClients[ClientId].m_Country &&
+		Info.m_Score == Score &&
+		Info.m_Player == Player)
+	{
+		return;
+	}
+
+	Info.m_Valid = true;
+	str_copy(Info.m_aName, pName);
+	str_copy(Info.m_aClan, pClan);
+	Info.m_Country = m_aClients[ClientId].m_Country;
+	Info.m_Score = Score;
+	Info.m_Player = Player;
+
+	char aBuf[16];
+	CPacker p;
+	p.Reset();
+	p.AddString(pName, MAX_NAME_LENGTH); // client name
+	p.AddString(pClan, MAX_CLAN_LENGTH); // client clan
+
+	str_format(aBuf, sizeof(aBuf), "%d", Info.m_Country); // client country (ISO 3166-1 numeric)
+	p.AddString(aBuf, 0);
+
+	int InfoScore;
+	if(Score.has_value())
+	{
+		InfoScore = Score.value();
+		if(InfoScore == -FinishTime::NOT_FINISHED_TIMESCORE)
+			InfoScore = FinishTime::NOT_FINISHED_TIMESCORE - 1;
+		else if(InfoScore == 0) // 0 time isn't displayed otherwise.
+			InfoScore = -1;
+		else
+			InfoScore = -InfoScore;
+	}
+	else
+	{
+		InfoScore = FinishTime::NOT_FINISHED_TIMESCORE;
+	}
+
+	str_format(aBuf, sizeof(aBuf), "%d", InfoScore); // client score
+	p.AddString(aBuf, 0);
+	p.AddString(Player ? "1" : "0", 0); // is player?
+	Info.m_vEntry.assign(p.Data(), p.Data() + p.Size());
+
+	p.Reset();
+	p.AddString(pName, MAX_NAME_LENGTH); // client name
+	p.AddString(pClan, MAX_CLAN_LENGTH); // client clan
+	p.AddInt(Info.m_Country); // client country (ISO 3166-1 numeric)
+	p.AddInt(Score.value_or(-1)); // client score
+	p.AddInt(Player ? 0 : 1); // flag spectator=1, bot=2 (player=0)
+	Info.m_vEntrySixup.assign(p.Data(), p.Data() + p.Size());
+}
+
 void CServer::CacheServerInfo(CCache *pCache, int Type, bool SendClients)
 {
 	pCache->Clear();
@@ -2390,29 +2466,8 @@ void CServer::CacheServerInfo(CCache *pCache, int Type, bool SendClients)
 
 			int PreviousSize = q.Size();
 
-			q.AddString(ClientName(i), MAX_NAME_LENGTH); // client name
-			q.AddString(ClientClan(i), MAX_CLAN_LENGTH); // client clan
-
-			ADD_INT(q, m_aClients[i].m_Country); // client country (ISO 3166-1 numeric)
-
-			int Score;
-			if(m_aClients[i].m_Score.has_value())
-			{
-				Score = m_aClients[i].m_Score.value();
-				if(Score == -FinishTime::NOT_FINISHED_TIMESCORE)
-					Score = FinishTime::NOT_FINISHED_TIMESCORE - 1;
-				else if(Score == 0) // 0 time isn't displayed otherwise.
-					Score = -1;
-				else
-					Score = -Score;
-			}
-			else
-			{
-				Score = FinishTime::NOT_FINISHED_TIMESCORE;
-			}
-
-			ADD_INT(q, Score); // client score
-			ADD_INT(q, GameServer()->IsClientPlayer(i) ? 1 : 0); // is player?
+			const std::vector<uint8_t> &vEntry = m_aServerInfoClients[i].m_vEntry;
+			q.AddRaw(vEntry.data(), vEntry.size());
 			if(Type == SERVERINFO_EXTENDED)
 				q.AddString("", 0); // extra info, reserved
 
@@ -2503,11 +2558,8 @@ void CServer::CacheServerInfoSixup(CCache *pCache, bool SendClients, int MaxCons
 		{
 			if(m_aClients[i].IncludedInServerInfo())
 			{
-				Packer.AddString(ClientName(i), MAX_NAME_LENGTH); // client name
-				Packer.AddString(ClientClan(i), MAX_CLAN_LENGTH); // client clan
-				Packer.AddInt(m_aClients[i].m_Country); // client country (ISO 3166-1 numeric)
-				Packer.AddInt(m_aClients[i].m_Score.value_or(-1)); // client score
-				Packer.AddInt(GameServer()->IsClientPlayer(i) ? 0 : 1); // flag spectator=1, bot=2 (player=0)
+				const std::vector<uint8_t> &vEntry = m_aServerInfoClients[i].m_vEntrySixup;
+				Packer.AddRaw(vEntry.data(), vEntry.size());
 
 				const int MaxPacketSize = NET_MAX_PAYLOAD - 128;
 				if(MaxConsideredClients == MAX_CLIENTS)
@@ -2534,62 +2586,56 @@ void CServer::CacheServerInfoSixup(CCache *pCache, bool SendClients, int MaxCons
 
 void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients)
 {
-	CPacker p;
-	char aBuf[128];
-	p.Reset();
-
 	CCache *pCache = &m_aServerInfoCache[GetCacheIndex(Type, SendClients)];
 
-#define ADD_RAW(p, x) (p).AddRaw(x, sizeof(x))
-#define ADD_INT(p, x) \
-	do \
-	{ \
-		str_format(aBuf, sizeof(aBuf), "%d", x); \
-		(p).AddString(aBuf, 0); \
-	} while(0)
+	const unsigned char *pType;
+	if(Type == SERVERINFO_EXTENDED)
+		pType = SERVERBROWSE_INFO_EXTENDED;
+	else if(Type == SERVERINFO_64_LEGACY)
+		pType = SERVERBROWSE_INFO_64_LEGACY;
+	else if(Type == SERVERINFO_VANILLA || Type == SERVERINFO_INGAME)
+		pType = SERVERBROWSE_INFO;
+	else
+		dbg_assert_failed("Invalid serverinfo Type: %d", Type);
 
-	CNetChunk Packet;
-	Packet.m_ClientId = -1;
-	Packet.m_Address = *pAddr;
-	Packet.m_Flags = NETSENDFLAG_CONNLESS;
+	char aToken[16];
+	const int TokenSize = str_format(aToken, sizeof(aToken), "%d", Token) + 1;
+	const int PrefixSize = SERVERBROWSE_SIZE + TokenSize;
+	static_assert(NET_CONNLESS_HEADER_SIZE + SERVERBROWSE_SIZE + sizeof(aToken) <= CCache::CCacheChunk::HEADROOM);
 
-	for(const auto &Chunk : pCache->m_vCache)
+	// The chunks are packed with room in front of them, only the type
+	// and the token are written there for each request.
+	for(auto &Chunk : pCache->m_vCache)
 	{
-		p.Reset();
-		if(Type == SERVERINFO_EXTENDED)
-		{
-			if(&Chunk == &pCache->m_vCache.front())
-				p.AddRaw(SERVERBROWSE_INFO_EXTENDED, sizeof(SERVERBROWSE_INFO_EXTENDED));
-			else
-				p.AddRaw(SERVERBROWSE_INFO_EXTENDED_MORE, sizeof(SERVERBROWSE_INFO_EXTENDED_MORE));
-			ADD_INT(p, Token);
-		}
-		else if(Type == SERVERINFO_64_LEGACY)
-		{
-			ADD_RAW(p, SERVERBROWSE_INFO_64_LEGACY);
-			ADD_INT(p, Token);
-		}
-		else if(Type == SERVERINFO_VANILLA || Type == SERVERINFO_INGAME)
-		{
-			ADD_RAW(p, SERVERBROWSE_INFO);
-			ADD_INT(p, Token);
-		}
-		else
-		{
-			dbg_assert_failed("Invalid serverinfo Type: %d", Type);
-		}
+		if(Type == SERVERINFO_EXTENDED && &Chunk != &pCache->m_vCache.front())
+			pType = SERVERBROWSE_INFO_EXTENDED_MORE;
 
-		p.AddRaw(Chunk.m_vData.data(), Chunk.m_vData.size());
-		Packet.m_pData = p.Data();
-		Packet.m_DataSize = p.Size();
-		m_NetServer.Send(&Packet);
+		unsigned char *pPrefix = Chunk.Data() - PrefixSize;
+		mem_copy(pPrefix, pType, SERVERBROWSE_SIZE);
+		mem_copy(pPrefix + SERVERBROWSE_SIZE, aToken, TokenSize);
+		CNetBase::SendPacketConnlessInPlace(m_NetServer.Socket(), pAddr, pPrefix, PrefixSize + Chunk.Size());
 	}
 }
 
+void CServer::SendServerInfoSixupConnless(const NETADDR *pAddr, int Token, SECURITY_TOKEN ResponseToken)
+{
+	CCache::CCacheChunk &Chunk = m_aSixupServerInfoCache[RateLimitServerInfoConnless()].m_vCache.front();
+
+	unsigned char aToken[CVariableInt::MAX_BYTES_PACKED];
+	const int TokenSize = CVariableInt::Pack(aToken, Token, sizeof(aToken)) - aToken;
+	const int PrefixSize = SERVERBROWSE_SIZE + TokenSize;
+	static_assert(NET_CONNLESS_HEADER_SIZE_7 + SERVERBROWSE_SIZE + sizeof(aToken) <= CCache::CCacheChunk::HEADROOM);
+
+	unsigned char *pPrefix = Chunk.Data() - PrefixSize;
+	mem_copy(pPrefix, SERVERBROWSE_INFO, SERVERBROWSE_SIZE);
+	mem_copy(pPrefix + SERVERBROWSE_SIZE, aToken, TokenSize);
+	CNetBase::SendPacketConnlessWithToken7InPlace(m_NetServer.Socket(), pAddr, pPrefix, PrefixSize + Chunk.Size(), ResponseToken, m_NetServer.GetToken(*pAddr));
+}
+
 void CServer::GetServerInfoSixup(CPacker *pPacker, bool SendClients)
 {
 	CCache::CCacheChunk &FirstChunk = m_aSixupServerInfoCache[SendClients].m_vCache.front();
-	pPacker->AddRaw(FirstChunk.m_vData.data(), FirstChunk.m_vData.size());
+	pPacker->AddRaw(FirstChunk.Data(), FirstChunk.Size());
 }
 
 void CServer::FillAntibot(CAntibotRoundData *pData)
@@ -2628,7 +2674,7 @@ void CServer::ExpireServerInfoAndQueueResend()
 	m_ServerInfoNeedsResend = true;
 }
 
-void CServer::UpdateRegisterServerInfo()
+std::string CServer::RegisterServerInfo()
 {
 	// count the players
 	int PlayerCount = 0, ClientCount = 0;
@@ -2762,7 +2808,7 @@ void CServer::UpdateRegisterServerInfo()
 	JsonWriter.EndArray();
 	JsonWriter.EndObject();
 
-	m_pRegister->OnNewInfo(JsonWriter.GetOutputString().c_str());
+	return JsonWriter.GetOutputString();
 }
 
 void CServer::UpdateServerInfo(bool Resend)
@@ -2770,7 +2816,12 @@ void CServer::UpdateServerInfo(bool Resend)
 	if(m_RunServer == UNINITIALIZED)
 		return;
 
-	UpdateRegisterServerInfo();
+	// only built once the register is about to send it
+	m_pRegister->OnInfoExpired([this]() { return RegisterServerInfo(); });
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(m_aClients[i].IncludedInServerInfo())
+			UpdateServerInfoClient(i);
 
 	for(int i = 0; i < 3; i++)
 		for(int j = 0; j < 2; j++)
@@ -2848,12 +2899,7 @@ void CServer::PumpNetwork(bool PacketWaiting)
 							continue;
 						}
 
-						CPacker Packer;
-						Packer.Reset();
-						Packer.AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
-						Packer.AddInt(SrvBrwsToken);
-						GetServerInfoSixup(&Packer, RateLimitServerInfoConnless());
-						CNetBase::SendPacketConnlessWithToken7(m_NetServer.Socket(), &Packet.m_Address, Packer.Data(), Packer.Size(), ResponseToken, m_NetServer.GetToken(Packet.m_Address));
+						SendServerInfoSixupConnless(&Packet.m_Address, SrvBrwsToken, ResponseToken);
 					}
 					else if(Type != -1)
 					{
@@ -3005,6 +3051,32 @@ int CServer::LoadMap(const char *pMapName)
 	return 1;
 }
 
+void CServer::ConnectDebugDummy(int ClientId, bool Sixup)
+{
+	NewClientCallback(ClientId, this, Sixup);
+	CClient &Client = m_aClients[ClientId];
+	Client.m_DebugDummy = true;
+
+	// See https://en.wikipedia.org/wiki/Unique_local_address
+	Client.m_DebugDummyAddr.type = NETTYPE_IPV6;
+	Client.m_DebugDummyAddr.ip[0] = 0xfd;
+	// Global ID (40 bits): random
+	secure_random_fill(&Client.m_DebugDummyAddr.ip[1], 5);
+	// Subnet ID (16 bits): constant
+	Client.m_DebugDummyAddr.ip[6] = 0xc0;
+	Client.m_DebugDummyAddr.ip[7] = 0xde;
+	// Interface ID (64 bits): set to client ID
+	Client.m_DebugDummyAddr.ip[8] = 0x00;
+	Client.m_DebugDummyAddr.ip[9] = 0x00;
+	Client.m_DebugDummyAddr.ip[10] = 0x00;
+	Client.m_DebugDummyAddr.ip[11] = 0x00;
+	uint_to_bytes_be(&Client.m_DebugDummyAddr.ip[12], ClientId);
+	// Port: random like normal clients
+	Client.m_DebugDummyAddr.port = secure_rand_below(65535 - 1024) + 1024;
+	net_addr_str(&Client.m_DebugDummyAddr, Client.m_aDebugDummyAddrString.data(), Client.m_aDebugDummyAddrString.size(), true);
+	net_addr_str(&Client.m_DebugDummyAddr, Client.m_aDebugDummyAddrStringNoPort.data(), Client.m_aDebugDummyAddrStringNoPort.size(), false);
+}
+
 void CServer::UpdateDebugDummies(bool ForceDisconnect)
 {
 	if(m_PreviousDebugDummies == g_Config.m_DbgDummies && !ForceDisconnect)
@@ -3018,28 +3090,7 @@ void CServer::UpdateDebugDummies(bool ForceDisconnect)
 		CClient &Client = m_aClients[ClientId];
 		if(AddDummy && m_aClients[ClientId].m_State == CClient::STATE_EMPTY)
 		{
-			NewClientCallback(ClientId, this, false);
-			Client.m_DebugDummy = true;
-
-			// See https://en.wikipedia.org/wiki/Unique_local_address
-			Client.m_DebugDummyAddr.type = NETTYPE_IPV6;
-			Client.m_DebugDummyAddr.ip[0] = 0xfd;
-			// Global ID (40 bits): random
-			secure_random_fill(&Client.m_DebugDummyAddr.ip[1], 5);
-			// Subnet ID (16 bits): constant
-			Client.m_DebugDummyAddr.ip[6] = 0xc0;
-			Client.m_DebugDummyAddr.ip[7] = 0xde;
-			// Interface ID (64 bits): set to client ID
-			Client.m_DebugDummyAddr.ip[8] = 0x00;
-			Client.m_DebugDummyAddr.ip[9] = 0x00;
-			Client.m_DebugDummyAddr.ip[10] = 0x00;
-			Client.m_DebugDummyAddr.ip[11] = 0x00;
-			uint_to_bytes_be(&Client.m_DebugDummyAddr.ip[12], ClientId);
-			// Port: random like normal clients
-			Client.m_DebugDummyAddr.port = secure_rand_below(65535 - 1024) + 1024;
-			net_addr_str(&Client.m_DebugDummyAddr, Client.m_aDebugDummyAddrString.data(), Client.m_aDebugDummyAddrString.size(), true);
-			net_addr_str(&Client.m_DebugDummyAddr, Client.m_aDebugDummyAddrStringNoPort.data(), Client.m_aDebugDummyAddrStringNoPort.size(), false);
-
+			ConnectDebugDummy(ClientId, false);
 			GameServer()->OnClientConnected(ClientId, nullptr);
 			Client.m_State = CClient::STATE_INGAME;
 			str_format(Client.m_aName, sizeof(Client.m_aName), "Debug dummy %d", DummyIndex + 1);
@@ -3064,18 +3115,8 @@ void CServer::UpdateDebugDummies(bool ForceDisconnect)
 	m_PreviousDebugDummies = ForceDisconnect ? 0 : g_Config.m_DbgDummies;
 }
 
-int CServer::Run()
+bool CServer::InitMapAndDatabases()
 {
-	if(m_RunServer == UNINITIALIZED)
-		m_RunServer = RUNNING;
-
-	m_AuthManager.Init();
-
-	if(Config()->m_Debug)
-	{
-		g_UuidManager.DebugDump();
-	}
-
 	{
 		int Size = GameServer()->PersistentClientDataSize();
 		for(auto &Client : m_aClients)
@@ -3090,7 +3131,7 @@ int CServer::Run()
 	if(!LoadMap(Config()->m_SvMap))
 	{
 		log_error("server", "failed to load map. mapname='%s'", Config()->m_SvMap);
-		return -1;
+		return false;
 	}
 
 	if(Config()->m_SvSqliteFile[0] != '\0')
@@ -3108,6 +3149,42 @@ int CServer::Run()
 			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFullPath);
 		}
 	}
+	return true;
+}
+
+void CServer::InitGameServer()
+{
+	m_Econ.Init(Config(), Console(), &m_ServerBan);
+
+	m_Fifo.Init(Console(), Config()->m_SvInputFifo, CFGFLAG_SERVER);
+
+	Antibot()->Init();
+	GameServer()->OnInit(nullptr);
+	if(ErrorShutdown())
+	{
+		m_RunServer = STOPPING;
+	}
+
+	ReadAnnouncementsFile();
+	InitMaplist();
+}
+
+int CServer::Run()
+{
+	if(m_RunServer == UNINITIALIZED)
+		m_RunServer = RUNNING;
+
+	m_AuthManager.Init();
+
+	if(Config()->m_Debug)
+	{
+		g_UuidManager.DebugDump();
+	}
+
+	if(!InitMapAndDatabases())
+	{
+		return -1;
+	}
 
 	// start server
 	NETADDR BindAddr;
@@ -3150,20 +3227,11 @@ int CServer::Run()
 
 	m_NetServer.SetCallbacks(NewClientCallback, NewClientNoAuthCallback, ClientRejoinCallback, DelClientCallback, this);
 
-	m_Econ.Init(Config(), Console(), &m_ServerBan);
-
-	m_Fifo.Init(Console(), Config()->m_SvInputFifo, CFGFLAG_SERVER);
-
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", Config()->m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
-	Antibot()->Init();
-	GameServer()->OnInit(nullptr);
-	if(ErrorShutdown())
-	{
-		m_RunServer = STOPPING;
-	}
+	InitGameServer();
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "version " GAME_RELEASE_VERSION " on " CONF_PLATFORM_STRING " " CONF_ARCH_STRING);
 	if(GIT_SHORTREV_HASH)
 	{
@@ -3171,9 +3239,6 @@ int CServer::Run()
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 	}
 
-	ReadAnnouncementsFile();
-	InitMaplist();
-
 	// process pending commands
 	m_pConsole->StoreCommands(false);
 	m_pRegister->OnConfigChange();
@@ -3282,50 +3347,63 @@ int CServer::Run()
 
 			while(LastTime > TickStartTime(m_CurrentGameTick + 1))
 			{
-				GameServer()->OnPreTickTeehistorian();
+				const CProfileScope TickScope("tick");
+				{
+					const CProfileScope ProfileScope("teehistorian");
+					GameServer()->OnPreTickTeehistorian();
+				}
 				UpdateDebugDummies(false);
 
-				for(int c = 0; c < MAX_CLIENTS; c++)
 				{
-					if(m_aClients[c].m_State != CClient::STATE_INGAME)
-						continue;
-					bool ClientHadInput = false;
-					for(auto &Input : m_aClients[c].m_aInputs)
+					const CProfileScope ProfileScope("early_input");
+					for(int c = 0; c < MAX_CLIENTS; c++)
 					{
-						if(Input.m_GameTick == Tick() + 1)
+						if(m_aClients[c].m_State != CClient::STATE_INGAME)
+							continue;
+						bool ClientHadInput = false;
+						for(auto &Input : m_aClients[c].m_aInputs)
 						{
-							GameServer()->OnClientPredictedEarlyInput(c, Input.m_aData);
-							ClientHadInput = true;
-							break;
+							if(Input.m_GameTick == Tick() + 1)
+							{
+								GameServer()->OnClientPredictedEarlyInput(c, Input.m_aData);
+								ClientHadInput = true;
+								break;
+							}
 						}
+						if(!ClientHadInput)
+							GameServer()->OnClientPredictedEarlyInput(c, nullptr);
 					}
-					if(!ClientHadInput)
-						GameServer()->OnClientPredictedEarlyInput(c, nullptr);
 				}
 
 				m_CurrentGameTick++;
 				NewTicks++;
 
 				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
 				{
-					if(m_aClients[c].m_State != CClient::STATE_INGAME)
-						continue;
-					bool ClientHadInput = false;
-					for(auto &Input : m_aClients[c].m_aInputs)
+					const CProfileScope ProfileScope("input");
+					for(int c = 0; c < MAX_CLIENTS; c++)
 					{
-						if(Input.m_GameTick == Tick())
+						if(m_aClients[c].m_State != CClient::STATE_INGAME)
+							continue;
+						bool ClientHadInput = false;
+						for(auto &Input : m_aClients[c].m_aInputs)
 						{
-							GameServer()->OnClientPredictedInput(c, Input.m_aData);
-							ClientHadInput = true;
-							break;
+							if(Input.m_GameTick == Tick())
+							{
+								GameServer()->OnClientPredictedInput(c, Input.m_aData);
+								ClientHadInput = true;
+								break;
+							}
 						}
+						if(!ClientHadInput)
+							GameServer()->OnClientPredictedInput(c, nullptr);
 					}
-					if(!ClientHadInput)
-						GameServer()->OnClientPredictedInput(c, nullptr);
 				}
 
-				GameServer()->OnTick();
+				{
+					const CProfileScope ProfileScope("game");
+					GameServer()->OnTick();
+				}
 				if(ErrorShutdown())
 				{
 					break;
@@ -3335,7 +3413,10 @@ int CServer::Run()
 			// snap game
 			if(NewTicks)
 			{
-				DoSnapshot();
+				{
+					const CProfileScope ProfileScope("snapshot");
+					DoSnapshot();
+				}
 
 				const int CommandSendingClientId = Tick() % MAX_CLIENTS;
 				UpdateClientRconCommands(CommandSendingClientId);
@@ -3352,7 +3433,10 @@ int CServer::Run()
 #endif
 
 				// master server stuff
-				m_pRegister->Update();
+				{
+					const CProfileScope ProfileScope("register");
+					m_pRegister->Update();
+				}
 
 				if(m_ServerInfoNeedsUpdate)
 				{
@@ -3414,7 +3498,10 @@ int CServer::Run()
 			}
 
 			if(!NonActive)
+			{
+				const CProfileScope ProfileScope("network");
 				PumpNetwork(PacketWaiting);
+			}
 
 			NonActive = true;
 			for(const auto &Client : m_aClients)
@@ -4322,6 +4409,7 @@ void CServer::ConchainLoglevel(IConsole::IResult *pResult, void *pUserData, ICon
 	if(pResult->NumArguments())
 	{
 		pSelf->m_pFileLogger->SetFilter(CLogFilter{IConsole::ToLogLevelFilter(g_Config.m_Loglevel)});
+		IConsole::UpdateLogMaxLevel();
 	}
 }
 
@@ -4333,6 +4421,19 @@ void CServer::ConchainStdoutOutputLevel(IConsole::IResult *pResult, void *pUserD
 	{
 		pSelf->m_pStdoutLogger->SetFilter(CLogFilter{IConsole::ToLogLevelFilter(g_Config.m_StdoutOutputLevel)});
 	}
+	if(pResult->NumArguments())
+	{
+		IConsole::UpdateLogMaxLevel();
+	}
+}
+
+void CServer::ConchainOutputLevel(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	pfnCallback(pResult, pCallbackUserData);
+	if(pResult->NumArguments())
+	{
+		IConsole::UpdateLogMaxLevel();
+	}
 }
 
 void CServer::ConchainAnnouncementFilename(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
@@ -4440,6 +4541,8 @@ void CServer::RegisterCommands()
 
 	Console()->Chain("loglevel", ConchainLoglevel, this);
 	Console()->Chain("stdout_output_level", ConchainStdoutOutputLevel, this);
+	Console()->Chain("console_output_level", ConchainOutputLevel, this);
+	Console()->Chain("ec_output_level", ConchainOutputLevel, this);
 
 	Console()->Chain("sv_announcement_filename", ConchainAnnouncementFilename, this);
 
@@ -4452,6 +4555,7 @@ void CServer::RegisterCommands()
 	// register console commands in sub parts
 	m_ServerBan.InitServerBan(Console(), Storage(), this);
 	m_NameBans.InitConsole(Console());
+	m_Profiler.Init(Console(), Storage());
 	m_pGameServer->OnConsoleInit();
 	Console()->SetCanUseCommandCallback(CanClientUseCommandCallback, this);
 }
@@ -18,12 +18,14 @@
 #include <engine/shared/http.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 #include <engine/shared/uuid_manager.h>
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #if defined(CONF_UPNP)
@@ -61,6 +63,8 @@ public:
 class CServer : public IServer
 {
 	friend class CServerLogger;
+	friend class CTickBenchmark;
+	friend class CTestGameWorld;
 
 	class IGameServer *m_pGameServer;
 	class CConfig *m_pConfig;
@@ -208,6 +212,7 @@ public:
 
 	IConsole::EAccessLevel ConsoleAccessLevel(int ClientId) const;
 
+	CSnapshotPool m_SnapshotPool; // must outlive the snapshot storages of the clients
 	CClient m_aClients[MAX_CLIENTS];
 	int m_aIdMap[MAX_CLIENTS * VANILLA_MAX_CLIENTS];
 
@@ -219,6 +224,7 @@ public:
 	CEcon m_Econ;
 	CFifo m_Fifo;
 	CServerBan m_ServerBan;
+	CProfiler m_Profiler;
 	CHttp m_Http;
 
 	int64_t m_GameStartTime;
@@ -330,6 +336,9 @@ public:
 
 	void DoSnapshot();
 
+	// Occupies a client slot with a client that has no network connection.
+	void ConnectDebugDummy(int ClientId, bool Sixup);
+
 	static int NewClientCallback(int ClientId, void *pUser, bool Sixup);
 	static int NewClientNoAuthCallback(int ClientId, void *pUser);
 	static int DelClientCallback(int ClientId, const char *pReason, void *pUser);
@@ -382,10 +391,17 @@ public:
 		class CCacheChunk
 		{
 		public:
+			// Space in front of the data, so the packet headers and the
+			// requester's token can be written in place before sending.
+			static constexpr int HEADROOM = 32;
+
 			CCacheChunk(const void *pData, int Size);
 			CCacheChunk(const CCacheChunk &) = delete;
 			CCacheChunk(CCacheChunk &&) = default;
 
+			unsigned char *Data() { return m_vData.data() + HEADROOM; }
+			int Size() const { return (int)m_vData.size() - HEADROOM; }
+
 			std::vector<uint8_t> m_vData;
 		};
 
@@ -399,6 +415,23 @@ public:
 	};
 	CCache m_aServerInfoCache[3 * 2];
 	CCache m_aSixupServerInfoCache[2];
+
+	// The server info entries of a client, only repacked when the values
+	// they're packed from change.
+	class CServerInfoClient
+	{
+	public:
+		bool m_Valid = false;
+		char m_aName[MAX_NAME_LENGTH];
+		char m_aClan[MAX_CLAN_LENGTH];
+		int m_Country;
+		std::optional<int> m_Score;
+		bool m_Player;
+
+		std::vector<uint8_t> m_vEntry;
+		std::vector<uint8_t> m_vEntrySixup;
+	};
+	CServerInfoClient m_aServerInfoClients[MAX_CLIENTS];
 	bool m_ServerInfoNeedsUpdate = false;
 	bool m_ServerInfoNeedsResend = false;
 
@@ -409,10 +442,12 @@ public:
 	void CacheServerInfo(CCache *pCache, int Type, bool SendClients);
 	void CacheServerInfoSixup(CCache *pCache, bool SendClients, int MaxConsideredClients);
 	void SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients);
+	void SendServerInfoSixupConnless(const NETADDR *pAddr, int Token, SECURITY_TOKEN ResponseToken);
 	void GetServerInfoSixup(CPacker *pPacker, bool SendClients);
 	bool RateLimitServerInfoConnless();
 	void SendServerInfoConnless(const NETADDR *pAddr, int Token, int Type);
-	void UpdateRegisterServerInfo();
+	void UpdateServerInfoClient(int ClientId);
+	std::string RegisterServerInfo();
 	void UpdateServerInfo(bool Resend);
 
 	void PumpNetwork(bool PacketWaiting);
@@ -427,6 +462,10 @@ public:
 	bool IsRecording(int ClientId) override;
 	void StopDemos() override;
 
+	// allocates the persistent client data, loads `sv_map` and registers the sqlite databases
+	bool InitMapAndDatabases();
+	// initializes the econ, the input fifo, the antibot and the game server
+	void InitGameServer();
 	int Run();
 
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
@@ -470,6 +509,7 @@ public:
 	static void ConchainRegisterCommunityTokenRedact(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainLoglevel(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainStdoutOutputLevel(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConchainOutputLevel(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainAnnouncementFilename(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainInputFifo(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 
@@ -3,9 +3,18 @@
 #include "compression.h"
 
 #include <base/dbg.h>
+#include <base/detect.h>
+#include <base/mem.h>
 
+#include <bit>
+#include <cstdint>
 #include <iterator> // std::size
 
+#if defined(CONF_ARCH_AMD64) || defined(__SSE2__)
+#define COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
 // Format: ESDDDDDD EDDDDDDD EDD... Extended, Data, Sign
 unsigned char *CVariableInt::Pack(unsigned char *pDst, int i, int DstSize)
 {
@@ -65,6 +74,41 @@ const unsigned char *CVariableInt::Unpack(const unsigned char *pSrc, int *pInOut
 	return pSrc;
 }
 
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+// Branch-free versions of Pack and Unpack, which always access a whole 8 byte word.
+static inline int PackWord(unsigned char *pDst, int i)
+{
+	const uint32_t Sign = (uint32_t)(i >> 31);
+	const uint32_t Value = (uint32_t)i ^ Sign;
+	uint64_t Word = (Value & 0x3F) | (Sign & 0x40) |
+			(uint64_t)((Value >> 6) & 0x7F) << 8 |
+			(uint64_t)((Value >> 13) & 0x7F) << 16 |
+			(uint64_t)((Value >> 20) & 0x7F) << 24 |
+			(uint64_t)(Value >> 27) << 32;
+	// 6 bits in the first byte and 7 bits in each of the following ones
+	const int Size = 1 + std::bit_width(Value) / 7;
+	Word |= 0x80808080ull & ((1ull << ((Size - 1) * 8)) - 1); // set extend bits
+	mem_copy(pDst, &Word, sizeof(Word));
+	return Size;
+}
+
+static inline int UnpackWord(const unsigned char *pSrc, int *pOut)
+{
+	uint64_t Word;
+	mem_copy(&Word, pSrc, sizeof(Word));
+	// the extend bit of the fifth byte is ignored
+	const int Size = std::countr_zero((~Word & 0x80808080ull) | 0x8000000000ull) / 8 + 1;
+	Word &= (1ull << (Size * 8)) - 1;
+	const uint32_t Value = (Word & 0x3F) |
+			((Word >> 8) & 0x7F) << 6 |
+			((Word >> 16) & 0x7F) << 13 |
+			((Word >> 24) & 0x7F) << 20 |
+			((Word >> 32) & 0x0F) << 27;
+	*pOut = (int)(Value ^ -(uint32_t)((Word >> 6) & 1));
+	return Size;
+}
+#endif
+
 long CVariableInt::Decompress(const void *pSrc, int SrcSize, void *pDst, int DstSize)
 {
 	dbg_assert(DstSize % sizeof(int) == 0, "invalid bounds");
@@ -73,6 +117,35 @@ long CVariableInt::Decompress(const void *pSrc, int SrcSize, void *pDst, int Dst
 	const unsigned char *pCharSrcEnd = pCharSrc + SrcSize;
 	int *pIntDst = (int *)pDst;
 	const int *pIntDstEnd = pIntDst + DstSize / sizeof(int); // NOLINT(bugprone-sizeof-expression)
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+	while(pCharSrcEnd - pCharSrc >= 8 && pIntDst < pIntDstEnd)
+	{
+#if defined(COMPRESSION_SSE2)
+		// most ints in snapshot deltas are small and packed into a single byte
+		if(pCharSrcEnd - pCharSrc >= 16 && pIntDstEnd - pIntDst >= 16)
+		{
+			const __m128i In = _mm_loadu_si128((const __m128i *)pCharSrc);
+			// flip the magnitude of negative ints, the resulting byte is the signed value
+			const __m128i Sign = _mm_cmpgt_epi8(In, _mm_set1_epi8(0x3F));
+			const __m128i Values = _mm_xor_si128(_mm_and_si128(In, _mm_set1_epi8(0x3F)), Sign);
+			const __m128i Low = _mm_unpacklo_epi8(Values, Values);
+			const __m128i High = _mm_unpackhi_epi8(Values, Values);
+			// all 16 ints are stored, but only the ones before the first extended byte are kept
+			__m128i *pOut = (__m128i *)pIntDst;
+			_mm_storeu_si128(pOut, _mm_srai_epi32(_mm_unpacklo_epi16(Low, Low), 24));
+			_mm_storeu_si128(pOut + 1, _mm_srai_epi32(_mm_unpackhi_epi16(Low, Low), 24));
+			_mm_storeu_si128(pOut + 2, _mm_srai_epi32(_mm_unpacklo_epi16(High, High), 24));
+			_mm_storeu_si128(pOut + 3, _mm_srai_epi32(_mm_unpackhi_epi16(High, High), 24));
+			const int NumSingle = std::countr_zero((unsigned)_mm_movemask_epi8(In) | 0x10000u);
+			pCharSrc += NumSingle;
+			pIntDst += NumSingle;
+			if(NumSingle == 16 || pCharSrcEnd - pCharSrc < 8)
+				continue;
+		}
+#endif
+		pCharSrc += UnpackWord(pCharSrc, pIntDst++);
+	}
+#endif
 	while(pCharSrc < pCharSrcEnd)
 	{
 		if(pIntDst >= pIntDstEnd)
@@ -90,15 +163,46 @@ long CVariableInt::Compress(const void *pSrc, int SrcSize, void *pDst, int DstSi
 	dbg_assert(SrcSize % sizeof(int) == 0, "invalid bounds");
 
 	const int *pIntSrc = (int *)pSrc;
+	const int *pIntSrcEnd = pIntSrc + SrcSize / sizeof(int); // NOLINT(bugprone-sizeof-expression)
 	unsigned char *pCharDst = (unsigned char *)pDst;
 	const unsigned char *pCharDstEnd = pCharDst + DstSize;
-	SrcSize /= sizeof(int);
-	while(SrcSize)
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+	while(pIntSrc < pIntSrcEnd && pCharDstEnd - pCharDst >= 8)
+	{
+#if defined(COMPRESSION_SSE2)
+		if(pIntSrcEnd - pIntSrc >= 8)
+		{
+			const __m128i In0 = _mm_loadu_si128((const __m128i *)pIntSrc);
+			const __m128i In1 = _mm_loadu_si128((const __m128i *)(pIntSrc + 4));
+			const __m128i Sign0 = _mm_srai_epi32(In0, 31);
+			const __m128i Sign1 = _mm_srai_epi32(In1, 31);
+			const __m128i Value0 = _mm_xor_si128(In0, Sign0);
+			const __m128i Value1 = _mm_xor_si128(In1, Sign1);
+			const __m128i Max = _mm_set1_epi32(0x3F);
+			if(_mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi32(Value0, Max), _mm_cmpgt_epi32(Value1, Max))) == 0)
+			{
+				// all eight ints fit into a single byte
+				const __m128i SignBit = _mm_set1_epi32(0x40);
+				const __m128i Packed = _mm_packs_epi32(
+					_mm_or_si128(Value0, _mm_and_si128(Sign0, SignBit)),
+					_mm_or_si128(Value1, _mm_and_si128(Sign1, SignBit)));
+				_mm_storel_epi64((__m128i *)pCharDst, _mm_packus_epi16(Packed, Packed));
+				pIntSrc += 8;
+				pCharDst += 8;
+				continue;
+			}
+		}
+#endif
+		// pack a few ints one by one before trying the vector path again
+		for(int i = 0; i < 8 && pIntSrc < pIntSrcEnd && pCharDstEnd - pCharDst >= 8; i++)
+			pCharDst += PackWord(pCharDst, *pIntSrc++);
+	}
+#endif
+	while(pIntSrc < pIntSrcEnd)
 	{
 		pCharDst = CVariableInt::Pack(pCharDst, *pIntSrc, pCharDstEnd - pCharDst);
 		if(!pCharDst)
 			return -1;
-		SrcSize--;
 		pIntSrc++;
 	}
 	return (long)(pCharDst - (unsigned char *)pDst);
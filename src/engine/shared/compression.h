@@ -15,6 +15,8 @@ public:
 	static unsigned char *Pack(unsigned char *pDst, int i, int DstSize);
 	static const unsigned char *Unpack(const unsigned char *pSrc, int *pInOut, int SrcSize);
 
+	// Pack and unpack whole buffers of ints, returning the number of bytes written or -1 if the buffer is too small.
+	// The contents of pDst beyond the returned size are undefined.
 	static long Compress(const void *pSrc, int SrcSize, void *pDst, int DstSize);
 	static long Decompress(const void *pSrc, int SrcSize, void *pDst, int DstSize);
 };
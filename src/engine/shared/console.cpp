@@ -354,6 +354,17 @@ int IConsole::ToLogLevelFilter(int Level)
 	return Level + 2;
 }
 
+void IConsole::UpdateLogMaxLevel()
+{
+	// loggers without a config variable, like the rcon and chat loggers, use the default filter level
+	int MaxLevel = LEVEL_INFO;
+	for(int Level : {g_Config.m_Loglevel, g_Config.m_StdoutOutputLevel, g_Config.m_ConsoleOutputLevel, g_Config.m_EcOutputLevel})
+	{
+		MaxLevel = maximum(MaxLevel, ToLogLevelFilter(Level));
+	}
+	log_set_max_level(MaxLevel);
+}
+
 static LOG_COLOR ColorToLogColor(ColorRGBA Color)
 {
 	return LOG_COLOR{
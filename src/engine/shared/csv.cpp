@@ -13,7 +13,8 @@ void CsvWrite(IOHANDLE File, int NumColumns, const char *const *ppColumns)
 		}
 		const char *pColumn = ppColumns[i];
 		int ColumnLength = str_length(pColumn);
-		if(!str_find(pColumn, "\"") && !str_find(pColumn, ","))
+		// line breaks inside of fields are only allowed in quotes
+		if(!str_find(pColumn, "\"") && !str_find(pColumn, ",") && !str_find(pColumn, "\n") && !str_find(pColumn, "\r"))
 		{
 			io_write(File, pColumn, ColumnLength);
 			continue;
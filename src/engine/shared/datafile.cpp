@@ -3,6 +3,7 @@
 
 #include "datafile.h"
 
+#include "jobs.h"
 #include "uuid_manager.h"
 
 #include <base/bytes.h>
@@ -19,13 +20,17 @@
 
 #include <zlib.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <limits>
+#include <thread>
 #include <unordered_set>
 
 static constexpr int MAX_ITEM_TYPE = 0xFFFF;
 static constexpr int MAX_ITEM_ID = 0xFFFF;
 static constexpr int OFFSET_UUID_TYPE = 0x8000;
+// Compressing less data than this in parallel is not worth the overhead of starting threads.
+static constexpr int64_t MIN_PARALLEL_COMPRESSION_SIZE = 512 * 1024;
 
 static inline void SwapEndianInPlace(void *pObj, size_t Size)
 {
@@ -140,14 +145,103 @@ public:
 	unsigned m_FileSize;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
+	// The header and info are hashed while reading them in Open, the data is only hashed when the hashes are needed.
+	bool m_HashesCalculated;
+	SHA256_CTX m_Sha256Ctxt;
 
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
 	int m_DataStartOffset;
 	void **m_ppDataPtrs;
 	int *m_pDataSizes;
+	uint64_t *m_pDataLastUsed;
 	char *m_pData;
 
+	int64_t m_LoadedDataSize;
+	int64_t m_MaxLoadedDataSize;
+	uint64_t m_DataUseCounter;
+
+	static constexpr uint64_t DATA_PINNED = std::numeric_limits<uint64_t>::max();
+
+	void CalculateHashes()
+	{
+		if(m_HashesCalculated)
+		{
+			return;
+		}
+		m_HashesCalculated = true;
+
+		if(io_seek(m_File, m_DataStartOffset, IOSEEK_START) != 0)
+		{
+			log_error("datafile", "could not seek to data for calculating hashes");
+		}
+		else
+		{
+			int64_t Remaining = m_Header.m_DataSize;
+			unsigned char aBuffer[64 * 1024];
+			while(Remaining > 0)
+			{
+				const unsigned Bytes = io_read(m_File, aBuffer, minimum<int64_t>(Remaining, sizeof(aBuffer)));
+				if(Bytes == 0)
+				{
+					log_error("datafile", "truncation error. could not read all data for calculating hashes. missing=%" PRId64, Remaining);
+					break;
+				}
+				Remaining -= Bytes;
+				m_Crc = crc32(m_Crc, aBuffer, Bytes);
+				sha256_update(&m_Sha256Ctxt, aBuffer, Bytes);
+			}
+		}
+		m_Sha256 = sha256_finish(&m_Sha256Ctxt);
+	}
+
+	void UseData(int Index)
+	{
+		if(m_pDataLastUsed[Index] != DATA_PINNED)
+		{
+			m_pDataLastUsed[Index] = ++m_DataUseCounter;
+		}
+	}
+
+	void FreeData(int Index)
+	{
+		if(m_ppDataPtrs[Index] != nullptr)
+		{
+			m_LoadedDataSize -= m_pDataSizes[Index];
+		}
+		free(m_ppDataPtrs[Index]);
+		m_ppDataPtrs[Index] = nullptr;
+		m_pDataSizes[Index] = 0;
+		m_pDataLastUsed[Index] = 0;
+	}
+
+	// Unloads the least recently used data until the given additional size fits into the limit.
+	void ReserveLoadedDataSize(int64_t Size, int ExceptIndex)
+	{
+		if(m_MaxLoadedDataSize <= 0)
+		{
+			return;
+		}
+		while(m_LoadedDataSize + Size > m_MaxLoadedDataSize)
+		{
+			int LeastRecentlyUsed = -1;
+			for(int Index = 0; Index < m_Header.m_NumRawData; Index++)
+			{
+				if(Index != ExceptIndex && m_ppDataPtrs[Index] != nullptr && m_pDataLastUsed[Index] != DATA_PINNED &&
+					(LeastRecentlyUsed == -1 || m_pDataLastUsed[Index] < m_pDataLastUsed[LeastRecentlyUsed]))
+				{
+					LeastRecentlyUsed = Index;
+				}
+			}
+			if(LeastRecentlyUsed == -1)
+			{
+				break;
+			}
+			log_trace("datafile", "unloading least recently used data. index=%d size=%d", LeastRecentlyUsed, m_pDataSizes[LeastRecentlyUsed]);
+			FreeData(LeastRecentlyUsed);
+		}
+	}
+
 	int GetFileDataSize(int Index) const
 	{
 		dbg_assert(Index >= 0 && Index < m_Header.m_NumRawData, "Invalid Index: %d", Index);
@@ -188,7 +282,7 @@ public:
 		return Size;
 	}
 
-	void *GetData(int Index, bool Swap) const
+	void *GetData(int Index, bool Swap)
 	{
 		// Invalid data indices may appear in map items
 		if(Index < 0 || Index >= m_Header.m_NumRawData)
@@ -199,6 +293,7 @@ public:
 		// Data already loaded
 		if(m_ppDataPtrs[Index] != nullptr)
 		{
+			UseData(Index);
 			return m_ppDataPtrs[Index];
 		}
 
@@ -222,6 +317,8 @@ public:
 				return nullptr;
 			}
 
+			ReserveLoadedDataSize(OriginalUncompressedSize, Index);
+
 			// read the compressed data
 			void *pCompressedData = malloc(DataSize);
 			if(pCompressedData == nullptr)
@@ -270,6 +367,7 @@ public:
 		else
 		{
 			log_trace("datafile", "loading data. index=%d size=%d", Index, DataSize);
+			ReserveLoadedDataSize(DataSize, Index);
 			m_ppDataPtrs[Index] = malloc(DataSize);
 			if(m_ppDataPtrs[Index] == nullptr)
 			{
@@ -292,6 +390,8 @@ public:
 			}
 			m_pDataSizes[Index] = DataSize;
 		}
+		m_LoadedDataSize += m_pDataSizes[Index];
+		UseData(Index);
 		if(Swap)
 		{
 			SwapEndianInPlace(m_ppDataPtrs[Index], m_pDataSizes[Index]);
@@ -464,31 +564,17 @@ bool CDataFileReader::Open(const char *pFullName, IStorage *pStorage, const char
 		return false;
 	}
 
-	// determine size and hashes of the file and store them
-	int64_t FileSize = 0;
-	unsigned Crc = 0;
-	SHA256_DIGEST Sha256;
+	// determine size of the file, the hashes are calculated while reading
+	const int64_t FileSize = io_length(File);
+	if(FileSize < 0)
 	{
-		SHA256_CTX Sha256Ctxt;
-		sha256_init(&Sha256Ctxt);
-		unsigned char aBuffer[64 * 1024];
-		while(true)
-		{
-			const unsigned Bytes = io_read(File, aBuffer, sizeof(aBuffer));
-			if(Bytes == 0)
-				break;
-			FileSize += Bytes;
-			Crc = crc32(Crc, aBuffer, Bytes);
-			sha256_update(&Sha256Ctxt, aBuffer, Bytes);
-		}
-		Sha256 = sha256_finish(&Sha256Ctxt);
-		if(io_seek(File, 0, IOSEEK_START) != 0)
-		{
-			io_close(File);
-			log_error("datafile", "could not seek to start after calculating hashes");
-			return false;
-		}
+		io_close(File);
+		log_error("datafile", "could not determine file size");
+		return false;
 	}
+	unsigned Crc = 0;
+	SHA256_CTX Sha256Ctxt;
+	sha256_init(&Sha256Ctxt);
 
 	// read header
 	CDatafileHeader Header;
@@ -498,6 +584,8 @@ bool CDataFileReader::Open(const char *pFullName, IStorage *pStorage, const char
 		log_error("datafile", "could not read file header. file truncated or not a datafile.");
 		return false;
 	}
+	Crc = crc32(Crc, reinterpret_cast<const Bytef *>(&Header), sizeof(Header));
+	sha256_update(&Sha256Ctxt, &Header, sizeof(Header));
 
 	// check header magic
 	if((Header.m_aId[0] != 'A' || Header.m_aId[1] != 'T' || Header.m_aId[2] != 'A' || Header.m_aId[3] != 'D') &&
@@ -596,6 +684,7 @@ bool CDataFileReader::Open(const char *pFullName, IStorage *pStorage, const char
 	AllocSize += sizeof(CDatafile); // add space for info structure
 	AllocSize += (int64_t)Header.m_NumRawData * sizeof(void *); // add space for data pointers
 	AllocSize += (int64_t)Header.m_NumRawData * sizeof(int); // add space for data sizes
+	AllocSize += (int64_t)Header.m_NumRawData * sizeof(uint64_t); // add space for data usage
 	if(AllocSize > MaxAllocSize)
 	{
 		io_close(File);
@@ -613,18 +702,23 @@ bool CDataFileReader::Open(const char *pFullName, IStorage *pStorage, const char
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
 	pTmpDataFile->m_ppDataPtrs = (void **)(pTmpDataFile + 1);
-	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
+	pTmpDataFile->m_pDataLastUsed = (uint64_t *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
+	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_pDataLastUsed + Header.m_NumRawData);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
 	pTmpDataFile->m_File = File;
 	str_copy(pTmpDataFile->m_aFullName, pFullName);
 	pTmpDataFile->m_pBaseName = fs_filename(pTmpDataFile->m_aFullName);
 	str_copy(pTmpDataFile->m_aPath, pPath);
 	pTmpDataFile->m_FileSize = FileSize;
-	pTmpDataFile->m_Sha256 = Sha256;
 	pTmpDataFile->m_Crc = Crc;
+	pTmpDataFile->m_HashesCalculated = false;
+	pTmpDataFile->m_LoadedDataSize = 0;
+	pTmpDataFile->m_MaxLoadedDataSize = 0;
+	pTmpDataFile->m_DataUseCounter = 0;
 
-	// clear the data pointers and sizes
+	// clear the data pointers, sizes and usage
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData * sizeof(void *));
+	mem_zero(pTmpDataFile->m_pDataLastUsed, Header.m_NumRawData * sizeof(uint64_t));
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
 
 	// read types, offsets, sizes and item data
@@ -636,6 +730,9 @@ bool CDataFileReader::Open(const char *pFullName, IStorage *pStorage, const char
 		log_error("datafile", "truncation error. could not read all item data. wanted=%" PRId64 " got=%d", Size, ReadSize);
 		return false;
 	}
+	pTmpDataFile->m_Crc = crc32(pTmpDataFile->m_Crc, reinterpret_cast<const Bytef *>(pTmpDataFile->m_pData), Size);
+	sha256_update(&Sha256Ctxt, pTmpDataFile->m_pData, Size);
+	pTmpDataFile->m_Sha256Ctxt = Sha256Ctxt;
 
 	// The swap len also includes the size of the header (without the size offset), but the header was already swapped above.
 	const int64_t DataSwapLen = pTmpDataFile->m_Header.m_Swaplen - (int)(sizeof(Header) - Header.SizeOffset());
@@ -755,9 +852,16 @@ void CDataFileReader::ReplaceData(int Index, char *pData, size_t Size)
 	dbg_assert(m_pDataFile != nullptr, "File not open");
 	dbg_assert(Index >= 0 && Index < m_pDataFile->m_Header.m_NumRawData, "Index invalid: %d", Index);
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
+	// replaced data cannot be loaded again from the file, so it's never unloaded automatically
+	m_pDataFile->FreeData(Index);
+	m_pDataFile->ReserveLoadedDataSize(Size, Index);
 	m_pDataFile->m_ppDataPtrs[Index] = pData;
 	m_pDataFile->m_pDataSizes[Index] = Size;
+	if(pData != nullptr)
+	{
+		m_pDataFile->m_pDataLastUsed[Index] = CDatafile::DATA_PINNED;
+		m_pDataFile->m_LoadedDataSize += Size;
+	}
 }
 
 void CDataFileReader::UnloadData(int Index)
@@ -767,9 +871,23 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
-	m_pDataFile->m_ppDataPtrs[Index] = nullptr;
-	m_pDataFile->m_pDataSizes[Index] = 0;
+	m_pDataFile->FreeData(Index);
+}
+
+void CDataFileReader::SetMaxLoadedDataSize(int64_t MaxSize)
+{
+	dbg_assert(m_pDataFile != nullptr, "File not open");
+	dbg_assert(MaxSize >= 0, "Invalid MaxSize: %" PRId64, MaxSize);
+
+	m_pDataFile->m_MaxLoadedDataSize = MaxSize;
+	m_pDataFile->ReserveLoadedDataSize(0, -1);
+}
+
+int64_t CDataFileReader::LoadedDataSize() const
+{
+	dbg_assert(m_pDataFile != nullptr, "File not open");
+
+	return m_pDataFile->m_LoadedDataSize;
 }
 
 int CDataFileReader::NumData() const
@@ -938,6 +1056,7 @@ SHA256_DIGEST CDataFileReader::Sha256() const
 {
 	dbg_assert(m_pDataFile != nullptr, "File not open");
 
+	m_pDataFile->CalculateHashes();
 	return m_pDataFile->m_Sha256;
 }
 
@@ -945,6 +1064,7 @@ unsigned CDataFileReader::Crc() const
 {
 	dbg_assert(m_pDataFile != nullptr, "File not open");
 
+	m_pDataFile->CalculateHashes();
 	return m_pDataFile->m_Crc;
 }
 
@@ -958,6 +1078,7 @@ int CDataFileReader::Size() const
 CDataFileWriter::CDataFileWriter()
 {
 	m_File = nullptr;
+	m_MaxCompressionThreads = 0;
 }
 
 CDataFileWriter::~CDataFileWriter()
@@ -1144,22 +1265,88 @@ static int CompressionLevelToZlib(CDataFileWriter::ECompressionLevel Compression
 	}
 }
 
-void CDataFileWriter::Finish()
+class CDataFileWriter::CCompressDataJob : public IJob
 {
-	dbg_assert((bool)m_File, "File not open");
+	CDataInfo *m_pDataInfo;
 
-	// Compress data. This takes the majority of the time when saving a datafile,
-	// so it's delayed until the end so it can be off-loaded to another thread.
+	void Run() override
+	{
+		CompressData(*m_pDataInfo);
+	}
+
+public:
+	CCompressDataJob(CDataInfo *pDataInfo) :
+		m_pDataInfo(pDataInfo)
+	{
+	}
+};
+
+void CDataFileWriter::CompressData(CDataInfo &DataInfo)
+{
+	unsigned long CompressedSize = compressBound(DataInfo.m_UncompressedSize);
+	DataInfo.m_pCompressedData = malloc(CompressedSize);
+	const int Result = compress2(static_cast<Bytef *>(DataInfo.m_pCompressedData), &CompressedSize, static_cast<Bytef *>(DataInfo.m_pUncompressedData), DataInfo.m_UncompressedSize, CompressionLevelToZlib(DataInfo.m_CompressionLevel));
+	DataInfo.m_CompressedSize = CompressedSize;
+	free(DataInfo.m_pUncompressedData);
+	DataInfo.m_pUncompressedData = nullptr;
+	dbg_assert(Result == Z_OK, "datafile zlib compression failed with error %d", Result);
+}
+
+void CDataFileWriter::CompressAllData()
+{
+	int64_t TotalUncompressedSize = 0;
+	for(const CDataInfo &DataInfo : m_vDatas)
+	{
+		TotalUncompressedSize += DataInfo.m_UncompressedSize;
+	}
+
+	int NumThreads = m_MaxCompressionThreads > 0 ? m_MaxCompressionThreads : (int)std::thread::hardware_concurrency();
+	NumThreads = std::min<int64_t>(NumThreads, m_vDatas.size());
+	if(NumThreads <= 1 || TotalUncompressedSize < MIN_PARALLEL_COMPRESSION_SIZE)
+	{
+		for(CDataInfo &DataInfo : m_vDatas)
+		{
+			CompressData(DataInfo);
+		}
+		return;
+	}
+
+	// Every data is compressed independently into its own buffer, so the
+	// output does not depend on which thread compressed which data.
+	// Larger data is queued first so one large image is not started last.
+	std::vector<CDataInfo *> vpSortedDatas;
+	vpSortedDatas.reserve(m_vDatas.size());
 	for(CDataInfo &DataInfo : m_vDatas)
 	{
-		unsigned long CompressedSize = compressBound(DataInfo.m_UncompressedSize);
-		DataInfo.m_pCompressedData = malloc(CompressedSize);
-		const int Result = compress2(static_cast<Bytef *>(DataInfo.m_pCompressedData), &CompressedSize, static_cast<Bytef *>(DataInfo.m_pUncompressedData), DataInfo.m_UncompressedSize, CompressionLevelToZlib(DataInfo.m_CompressionLevel));
-		DataInfo.m_CompressedSize = CompressedSize;
-		free(DataInfo.m_pUncompressedData);
-		DataInfo.m_pUncompressedData = nullptr;
-		dbg_assert(Result == Z_OK, "datafile zlib compression failed with error %d", Result);
+		vpSortedDatas.push_back(&DataInfo);
 	}
+	std::stable_sort(vpSortedDatas.begin(), vpSortedDatas.end(), [](const CDataInfo *pLeft, const CDataInfo *pRight) {
+		return pLeft->m_UncompressedSize > pRight->m_UncompressedSize;
+	});
+
+	// The jobs are not abortable, so shutting down the pool waits for all of them to complete.
+	CJobPool CompressionPool;
+	CompressionPool.Init(NumThreads);
+	for(CDataInfo *pDataInfo : vpSortedDatas)
+	{
+		CompressionPool.Add(std::make_shared<CCompressDataJob>(pDataInfo));
+	}
+	CompressionPool.Shutdown();
+}
+
+void CDataFileWriter::SetMaxCompressionThreads(int MaxThreads)
+{
+	dbg_assert(MaxThreads >= 0, "Invalid MaxThreads: %d", MaxThreads);
+	m_MaxCompressionThreads = MaxThreads;
+}
+
+void CDataFileWriter::Finish()
+{
+	dbg_assert((bool)m_File, "File not open");
+
+	// Compress data. This takes the majority of the time when saving a datafile,
+	// so it's delayed until the end so it can be off-loaded to other threads.
+	CompressAllData();
 
 	// Calculate total size of items
 	int64_t ItemSize = 0;
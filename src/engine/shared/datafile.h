@@ -43,6 +43,11 @@ public:
 	const char *GetDataString(int Index);
 	void ReplaceData(int Index, char *pData, size_t Size); // memory for data must have been allocated with malloc
 	void UnloadData(int Index);
+	// Limits the total size of loaded data, 0 means unlimited. When loading more data would exceed the limit,
+	// the least recently used data is unloaded, so pointers returned by GetData may only be used until the next
+	// call to GetData. Data set with ReplaceData is never unloaded automatically.
+	void SetMaxLoadedDataSize(int64_t MaxSize);
+	int64_t LoadedDataSize() const;
 	int NumData() const;
 
 	int GetItemSize(int Index) const;
@@ -81,6 +86,8 @@ private:
 		ECompressionLevel m_CompressionLevel;
 	};
 
+	class CCompressDataJob;
+
 	class CItemInfo
 	{
 	public:
@@ -112,9 +119,12 @@ private:
 	std::vector<CItemInfo> m_vItems;
 	std::vector<CDataInfo> m_vDatas;
 	std::vector<CExtendedItemType> m_vExtendedItemTypes;
+	int m_MaxCompressionThreads;
 
 	int GetTypeFromIndex(int Index) const;
 	int GetExtendedItemTypeIndex(int Type, const CUuid *pUuid);
+	static void CompressData(CDataInfo &DataInfo);
+	void CompressAllData();
 
 public:
 	CDataFileWriter();
@@ -126,6 +136,7 @@ public:
 		m_vItems = std::move(Other.m_vItems);
 		m_vDatas = std::move(Other.m_vDatas);
 		m_vExtendedItemTypes = std::move(Other.m_vExtendedItemTypes);
+		m_MaxCompressionThreads = Other.m_MaxCompressionThreads;
 	}
 	~CDataFileWriter();
 
@@ -134,6 +145,9 @@ public:
 	int AddData(size_t Size, const void *pData, ECompressionLevel CompressionLevel = COMPRESSION_DEFAULT);
 	int AddDataSwapped(size_t Size, const void *pData);
 	int AddDataString(const char *pStr);
+	// Maximum number of threads used to compress the data in Finish, 0 chooses automatically and 1 disables threading.
+	// The written file is identical regardless of the number of threads.
+	void SetMaxCompressionThreads(int MaxThreads);
 	void Finish();
 };
 
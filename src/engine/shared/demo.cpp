@@ -953,6 +953,9 @@ bool CDemoPlayer::ExtractMap(IStorage *pStorage)
 
 int64_t CDemoPlayer::Time()
 {
+	if(m_FixedFrameTime > 0)
+		return m_FixedTime;
+
 #if defined(CONF_VIDEORECORDER)
 	if(m_UseVideo && IVideo::Current())
 	{
@@ -1129,8 +1132,17 @@ void CDemoPlayer::AdjustSpeedIndex(int Offset)
 	SetSpeedIndex(std::clamp(m_SpeedIndex + Offset, 0, (int)(std::size(DEMO_SPEEDS) - 1)));
 }
 
+void CDemoPlayer::SetFixedFrameTime(int64_t FrameTime)
+{
+	m_FixedFrameTime = FrameTime;
+	m_FixedTime = 0;
+	m_Info.m_LastUpdate = Time();
+	m_Info.m_LastScan = m_Info.m_LastUpdate;
+}
+
 void CDemoPlayer::Update(bool RealTime)
 {
+	m_FixedTime += m_FixedFrameTime;
 	const int64_t Now = Time();
 	const int64_t Freq = time_freq();
 	const int64_t DeltaTime = Now - m_Info.m_LastUpdate;
@@ -145,6 +145,8 @@ private:
 #if defined(CONF_VIDEORECORDER)
 	bool m_WasRecording = false;
 #endif
+	int64_t m_FixedFrameTime = 0;
+	int64_t m_FixedTime = 0;
 
 	enum EReadChunkHeaderResult
 	{
@@ -197,6 +199,10 @@ public:
 	const char *ErrorMessage() const override { return m_aErrorMessage; }
 
 	void Update(bool RealTime = true);
+	// Advance the playback by a fixed time per `Update` instead of the real
+	// time that passed, so playback doesn't depend on the frame rate.
+	// 0 restores real time playback.
+	void SetFixedFrameTime(int64_t FrameTime);
 	bool IsSixup() const { return m_Sixup; }
 
 	const CPlaybackInfo *Info() const { return &m_Info; }
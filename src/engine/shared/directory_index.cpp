@@ -0,0 +1,265 @@
+#include "directory_index.h"
+
+#include <base/fs.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#if defined(CONF_PLATFORM_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+
+// how long folders that can't be watched are used without checking them again
+static constexpr std::chrono::nanoseconds REVALIDATE_INTERVAL = 1s;
+
+CDirectoryIndex::CDirectoryIndex()
+{
+#if defined(CONF_PLATFORM_LINUX)
+	m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+CDirectoryIndex::~CDirectoryIndex()
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(m_Inotify >= 0)
+		close(m_Inotify);
+#endif
+}
+
+std::string CDirectoryIndex::NormalizePath(const char *pPath)
+{
+	std::string Path = pPath;
+	while(Path.size() > 1 && (Path.back() == '/' || Path.back() == '\\'))
+		Path.pop_back();
+	return Path;
+}
+
+int CDirectoryIndex::ListCallback(const char *pName, int IsDir, int Type, void *pUser)
+{
+	CDirectory *pDirectory = static_cast<CDirectory *>(pUser);
+	pDirectory->m_vEntries.push_back({pName, IsDir != 0});
+	if(!IsDir)
+		pDirectory->m_Files.emplace(pName);
+	else if(str_comp(pName, ".") != 0 && str_comp(pName, "..") != 0)
+		pDirectory->m_vSubdirectories.emplace_back(pName);
+	return 0;
+}
+
+CDirectoryIndex::CDirectory &CDirectoryIndex::Lookup(const std::string &Path)
+{
+	CDirectory &Directory = m_Directories[Path];
+	if(Directory.m_Listed && Directory.m_Watch < 0)
+	{
+		const std::chrono::nanoseconds Now = time_get_nanoseconds();
+		if(Now - Directory.m_LastChecked >= REVALIDATE_INTERVAL)
+		{
+			Directory.m_LastChecked = Now;
+			// the modification time only has a resolution of seconds, so
+			// changes in the second of the last listing could go unnoticed
+			time_t Created, Modified;
+			const bool Exists = fs_file_time(Path.c_str(), &Created, &Modified) == 0;
+			if(Exists != Directory.m_Exists || (Exists && (Modified != Directory.m_Modified || Modified >= Directory.m_ListedTimestamp - 1)))
+				Directory.m_Listed = false;
+		}
+	}
+	if(!Directory.m_Listed)
+		List(Path, Directory);
+	return Directory;
+}
+
+void CDirectoryIndex::List(const std::string &Path, CDirectory &Directory)
+{
+	// watch before listing, so changes during the listing aren't missed
+	if(Directory.m_Watch < 0)
+		AddWatch(Path, Directory);
+
+	Directory.m_Listed = true;
+	Directory.m_LastChecked = time_get_nanoseconds();
+	Directory.m_ListedTimestamp = time_timestamp();
+	time_t Created;
+	Directory.m_Exists = fs_file_time(Path.c_str(), &Created, &Directory.m_Modified) == 0;
+
+	std::vector<std::string> vOldSubdirectories = std::move(Directory.m_vSubdirectories);
+	Directory.m_vEntries.clear();
+	Directory.m_Files.clear();
+	Directory.m_vSubdirectories.clear();
+	if(Directory.m_Exists)
+		fs_listdir(Path.c_str(), ListCallback, 0, &Directory);
+
+	// forget about subfolders that are gone, they might be recreated with different contents
+	if(!vOldSubdirectories.empty())
+	{
+		const std::unordered_set<std::string> Subdirectories(Directory.m_vSubdirectories.begin(), Directory.m_vSubdirectories.end());
+		for(const std::string &Name : vOldSubdirectories)
+		{
+			if(!Subdirectories.contains(Name))
+				Forget(Path + "/" + Name);
+		}
+	}
+}
+
+void CDirectoryIndex::Forget(const std::string &Path)
+{
+	auto It = m_Directories.find(Path);
+	if(It == m_Directories.end())
+		return;
+	const std::vector<std::string> vSubdirectories = std::move(It->second.m_vSubdirectories);
+	RemoveWatch(Path, It->second);
+	m_Directories.erase(It);
+	for(const std::string &Name : vSubdirectories)
+		Forget(Path + "/" + Name);
+}
+
+void CDirectoryIndex::Find(const std::string &Path, const std::string &Prefix, const std::string &Filename, bool All, std::vector<std::string> *pvFound)
+{
+	// references into the map stay valid while searching, only subfolders of
+	// relisted folders are removed
+	const CDirectory &Current = Lookup(Path);
+	if(Current.m_Files.contains(Filename))
+	{
+		pvFound->push_back(Prefix + Filename);
+		if(!All)
+			return;
+	}
+	for(const std::string &Name : Current.m_vSubdirectories)
+	{
+		if(Name[0] == '.')
+			continue;
+		Find(Path + "/" + Name, Prefix + Name + "/", Filename, All, pvFound);
+		if(!All && !pvFound->empty())
+			return;
+	}
+}
+
+std::vector<CDirectoryIndex::CEntry> CDirectoryIndex::ListDirectory(const char *pPath)
+{
+	const CLockScope LockScope(m_Lock);
+	ProcessEvents();
+	return Lookup(NormalizePath(pPath)).m_vEntries;
+}
+
+bool CDirectoryIndex::FindFile(const char *pPath, const char *pFilename, std::string *pFound)
+{
+	const CLockScope LockScope(m_Lock);
+	ProcessEvents();
+	std::vector<std::string> vFound;
+	Find(NormalizePath(pPath), "", pFilename, false, &vFound);
+	if(vFound.empty())
+		return false;
+	*pFound = std::move(vFound.front());
+	return true;
+}
+
+void CDirectoryIndex::FindFiles(const char *pPath, const char *pFilename, std::vector<std::string> *pvFound)
+{
+	const CLockScope LockScope(m_Lock);
+	ProcessEvents();
+	Find(NormalizePath(pPath), "", pFilename, true, pvFound);
+}
+
+void CDirectoryIndex::Invalidate(const char *pPath)
+{
+	const CLockScope LockScope(m_Lock);
+	std::string Path = NormalizePath(pPath);
+	for(int i = 0; i < 2; i++)
+	{
+		auto It = m_Directories.find(Path);
+		if(It != m_Directories.end())
+			It->second.m_Listed = false;
+
+		const size_t Separator = Path.find_last_of("/\\");
+		if(Separator == std::string::npos)
+			break;
+		Path.resize(Separator);
+	}
+}
+
+void CDirectoryIndex::ProcessEvents()
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(m_Inotify < 0)
+		return;
+
+	alignas(inotify_event) char aBuffer[4096];
+	while(true)
+	{
+		const ssize_t Size = read(m_Inotify, aBuffer, sizeof(aBuffer));
+		if(Size <= 0)
+			break;
+		for(ssize_t Offset = 0; Offset < Size;)
+		{
+			const inotify_event *pEvent = reinterpret_cast<const inotify_event *>(aBuffer + Offset);
+			Offset += sizeof(inotify_event) + pEvent->len;
+			if(pEvent->mask & IN_Q_OVERFLOW)
+			{
+				// events were lost
+				for(auto &[Path, Directory] : m_Directories)
+					Directory.m_Listed = false;
+				continue;
+			}
+
+			// the folder itself is gone, a new folder at its path needs a new watch
+			const bool WatchGone = pEvent->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF);
+			const auto [Begin, End] = m_Watches.equal_range(pEvent->wd);
+			for(auto It = Begin; It != End; ++It)
+			{
+				auto DirectoryIt = m_Directories.find(It->second);
+				if(DirectoryIt == m_Directories.end())
+					continue;
+				DirectoryIt->second.m_Listed = false;
+				if(WatchGone)
+					DirectoryIt->second.m_Watch = -1;
+			}
+			if(WatchGone)
+			{
+				if(!(pEvent->mask & IN_IGNORED))
+					inotify_rm_watch(m_Inotify, pEvent->wd);
+				m_Watches.erase(pEvent->wd);
+			}
+		}
+	}
+#endif
+}
+
+void CDirectoryIndex::AddWatch(const std::string &Path, CDirectory &Directory)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(m_Inotify < 0)
+		return;
+
+	// fails for missing folders or when running out of watches, these are revalidated by time
+	Directory.m_Watch = inotify_add_watch(m_Inotify, Path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if(Directory.m_Watch >= 0)
+		m_Watches.emplace(Directory.m_Watch, Path);
+#endif
+}
+
+void CDirectoryIndex::RemoveWatch(const std::string &Path, CDirectory &Directory)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	if(Directory.m_Watch < 0)
+		return;
+
+	// the same folder can be reached by different paths, which share one watch
+	bool Shared = false;
+	const auto [Begin, End] = m_Watches.equal_range(Directory.m_Watch);
+	for(auto It = Begin; It != End;)
+	{
+		if(It->second == Path)
+		{
+			It = m_Watches.erase(It);
+		}
+		else
+		{
+			Shared = true;
+			++It;
+		}
+	}
+	if(!Shared)
+		inotify_rm_watch(m_Inotify, Directory.m_Watch);
+	Directory.m_Watch = -1;
+#endif
+}
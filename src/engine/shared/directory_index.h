@@ -0,0 +1,83 @@
+#ifndef ENGINE_SHARED_DIRECTORY_INDEX_H
+#define ENGINE_SHARED_DIRECTORY_INDEX_H
+
+#include <base/detect.h>
+#include <base/lock.h>
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Caches the entries of folders, so repeated listings and recursive file
+// searches don't have to read the whole tree from disk every time. Folders are
+// listed lazily when first used. On Linux, inotify reports changes to listed
+// folders. Elsewhere, or if a folder cannot be watched, a folder is checked
+// for changes via its modification time at most once per second. Changes made
+// through the storage are passed to `Invalidate` and are visible immediately.
+// Paths are complete paths as passed to `fs_listdir`. All functions are
+// thread-safe.
+class CDirectoryIndex
+{
+public:
+	class CEntry
+	{
+	public:
+		std::string m_Name;
+		bool m_IsDir;
+	};
+
+	CDirectoryIndex();
+	~CDirectoryIndex();
+
+	// Returns the entries of the folder in the order of `fs_listdir`,
+	// including "." and "..". Empty if the folder doesn't exist.
+	std::vector<CEntry> ListDirectory(const char *pPath);
+
+	// Search the folder and its subfolders for files with the given name,
+	// skipping subfolders whose names start with '.'. Found paths are relative
+	// to `pPath`. Files in a folder are found before files in its subfolders.
+	bool FindFile(const char *pPath, const char *pFilename, std::string *pFound);
+	void FindFiles(const char *pPath, const char *pFilename, std::vector<std::string> *pvFound);
+
+	// Marks the file or folder at the given path and its parent folder as changed.
+	void Invalidate(const char *pPath);
+
+private:
+	class CDirectory
+	{
+	public:
+		bool m_Listed = false;
+		bool m_Exists = false;
+		std::vector<CEntry> m_vEntries;
+		std::unordered_set<std::string> m_Files;
+		// all subfolders except "." and ".."
+		std::vector<std::string> m_vSubdirectories;
+		time_t m_Modified = 0;
+		int64_t m_ListedTimestamp = 0;
+		std::chrono::nanoseconds m_LastChecked = std::chrono::nanoseconds::zero();
+		int m_Watch = -1;
+	};
+
+	static std::string NormalizePath(const char *pPath);
+	static int ListCallback(const char *pName, int IsDir, int Type, void *pUser);
+
+	CDirectory &Lookup(const std::string &Path) REQUIRES(m_Lock);
+	void List(const std::string &Path, CDirectory &Directory) REQUIRES(m_Lock);
+	void Forget(const std::string &Path) REQUIRES(m_Lock);
+	void Find(const std::string &Path, const std::string &Prefix, const std::string &Filename, bool All, std::vector<std::string> *pvFound) REQUIRES(m_Lock);
+	void ProcessEvents() REQUIRES(m_Lock);
+	void AddWatch(const std::string &Path, CDirectory &Directory) REQUIRES(m_Lock);
+	void RemoveWatch(const std::string &Path, CDirectory &Directory) REQUIRES(m_Lock);
+
+	CLock m_Lock;
+	std::unordered_map<std::string, CDirectory> m_Directories GUARDED_BY(m_Lock);
+#if defined(CONF_PLATFORM_LINUX)
+	int m_Inotify = -1;
+	std::unordered_multimap<int, std::string> m_Watches GUARDED_BY(m_Lock);
+#endif
+};
+
+#endif
@@ -2,9 +2,11 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "huffman.h"
 
+#include <base/detect.h>
 #include <base/mem.h>
 
 #include <algorithm>
+#include <cstdint>
 
 const unsigned CHuffman::ms_aFreqTable[HUFFMAN_MAX_SYMBOLS] = {
 	1 << 30, 4545, 2657, 431, 1950, 919, 444, 482, 2244, 617, 838, 542, 715, 1814, 304, 240, 754, 212, 647, 186,
@@ -96,36 +98,42 @@ void CHuffman::Init(const unsigned *pFrequencies)
 {
 	// make sure to cleanout every thing
 	mem_zero(m_aNodes, sizeof(m_aNodes));
-	mem_zero(m_apDecodeLut, sizeof(m_apDecodeLut));
+	mem_zero(m_aDecodeLut, sizeof(m_aDecodeLut));
 	m_pStartNode = nullptr;
 	m_NumNodes = 0;
 
 	// construct the tree
 	ConstructTree(pFrequencies);
 
-	// build decode LUT
+	m_MaxNumBits = 0;
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		m_MaxNumBits = std::max(m_MaxNumBits, m_aNodes[i].m_NumBits);
+
+	// build decode LUT, each entry contains as many symbols as the index bits decode to
 	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
 	{
+		CDecodeEntry *pEntry = &m_aDecodeLut[i];
 		unsigned Bits = i;
-		int k;
-		CNode *pNode = m_pStartNode;
-		for(k = 0; k < HUFFMAN_LUTBITS; k++)
+		const CNode *pNode = m_pStartNode;
+		for(int k = 0; k < HUFFMAN_LUTBITS; k++)
 		{
 			pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
 			Bits >>= 1;
 
-			if(!pNode)
-				break;
+			if(!pNode->m_NumBits)
+				continue;
 
-			if(pNode->m_NumBits)
+			pEntry->m_NumBits = k + 1;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			{
-				m_apDecodeLut[i] = pNode;
+				pEntry->m_Eof = true;
 				break;
 			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
+			if(pEntry->m_NumSymbols == HUFFMAN_LUT_MAX_SYMBOLS)
+				break;
+			pNode = m_pStartNode;
 		}
-
-		if(k == HUFFMAN_LUTBITS)
-			m_apDecodeLut[i] = pNode;
 	}
 }
 
@@ -136,7 +144,7 @@ int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int Out
 #define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
 	do \
 	{ \
-		Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
+		Bits |= (uint64_t)m_aNodes[Sym].m_Bits << Bitcount; \
 		Bitcount += m_aNodes[Sym].m_NumBits; \
 	} while(0)
 
@@ -160,30 +168,29 @@ int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int Out
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// symbol variables, no code is longer than 32 bits so the symbols can
+	// be collected until at least 32 bits are available
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	for(; pSrc != pSrcEnd; pSrc++)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		HUFFMAN_MACRO_LOADSYMBOL(*pSrc);
+		if(Bitcount < 32)
+			continue;
 
-		while(pSrc != pSrcEnd)
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+		// write all complete bytes at once, the incomplete ones are overwritten by the next write
+		if(pDstEnd - pDst >= (int)sizeof(Bits))
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol);
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE();
+			const unsigned NumBytes = Bitcount / 8;
+			mem_copy(pDst, &Bits, sizeof(Bits));
+			pDst += NumBytes;
+			Bits >>= NumBytes * 8;
+			Bitcount -= NumBytes * 8;
+			continue;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol);
+#endif
 		HUFFMAN_MACRO_WRITE();
 	}
 
@@ -207,69 +214,111 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *)pOutput;
-	unsigned char *pSrc = (unsigned char *)pInput;
+	const unsigned char *pSrc = (const unsigned char *)pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
 	const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
 
-	while(true)
+	// {A} decode multiple symbols per lookup while the bits of the longest code are available
+	const unsigned FastBitcount = std::max<unsigned>(m_MaxNumBits, HUFFMAN_LUTBITS);
+	bool Fast = true;
+	while(Fast)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		const CNode *pNode = nullptr;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		// fill with new bits
+#if defined(CONF_ARCH_ENDIAN_LITTLE)
+		if(pSrcEnd - pSrc >= (int)sizeof(Bits))
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
+			// the bits of the following bytes are shifted in again by the next refill
+			uint64_t Word;
+			mem_copy(&Word, pSrc, sizeof(Word));
+			Bits |= Word << Bitcount;
+			pSrc += (63 - Bitcount) / 8;
+			Bitcount |= 56;
 		}
-
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		if(!pNode)
-			return -1;
-
-		// {D} check if we hit a symbol already
-		if(pNode->m_NumBits)
+		else
+#endif
 		{
-			// remove the bits for that symbol
-			Bits >>= pNode->m_NumBits;
-			Bitcount -= pNode->m_NumBits;
+			while(Bitcount <= 56 && pSrc != pSrcEnd)
+			{
+				Bits |= (uint64_t)(*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
 		}
-		else
+
+		if(Bitcount < FastBitcount)
+			break;
+
+		while(Bitcount >= FastBitcount)
 		{
-			// remove the bits that the lut checked up for us
-			Bits >>= HUFFMAN_LUTBITS;
-			Bitcount -= HUFFMAN_LUTBITS;
+			const CDecodeEntry *pEntry = &m_aDecodeLut[Bits & HUFFMAN_LUTMASK];
+			if(!pEntry->m_NumBits)
+			{
+				// walk the tree bit by bit for long codes
+				const CNode *pNode = m_pStartNode;
+				do
+				{
+					pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
+					Bits >>= 1;
+					Bitcount--;
+				} while(!pNode->m_NumBits);
+
+				if(pNode == pEof)
+					return (int)(pDst - (const unsigned char *)pOutput);
+				if(pDst == pDstEnd)
+					return -1;
+				*pDst++ = pNode->m_Symbol;
+				continue;
+			}
 
-			// walk the tree bit by bit
-			while(true)
+			// let {B} handle running out of space
+			if(pDstEnd - pDst < pEntry->m_NumSymbols)
 			{
-				// traverse tree
-				pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
+				Fast = false;
+				break;
+			}
 
-				// remove bit
-				Bitcount--;
-				Bits >>= 1;
+			if(pDstEnd - pDst >= HUFFMAN_LUT_MAX_SYMBOLS)
+				mem_copy(pDst, pEntry->m_aSymbols, HUFFMAN_LUT_MAX_SYMBOLS);
+			else
+				mem_copy(pDst, pEntry->m_aSymbols, pEntry->m_NumSymbols);
+			pDst += pEntry->m_NumSymbols;
+			Bits >>= pEntry->m_NumBits;
+			Bitcount -= pEntry->m_NumBits;
 
-				// check if we hit a symbol
-				if(pNode->m_NumBits)
-					break;
+			if(pEntry->m_Eof)
+				return (int)(pDst - (const unsigned char *)pOutput);
+		}
+	}
 
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
-			}
+	// {B} decode the remaining symbols one by one. This keeps the behavior for
+	// truncated input, where missing bits are read as zeros until a symbol
+	// longer than 10 bits runs out of bits.
+	while(true)
+	{
+		while(Bitcount < 24 && pSrc != pSrcEnd)
+		{
+			Bits |= (uint64_t)(*pSrc++) << Bitcount;
+			Bitcount += 8;
 		}
 
+		const CNode *pNode = m_pStartNode;
+		unsigned NumBits = 0;
+		do
+		{
+			pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
+			Bits >>= 1;
+			NumBits++;
+
+			// no more bits, decoding error
+			if(!pNode->m_NumBits && NumBits > 10 && NumBits == Bitcount)
+				return -1;
+		} while(!pNode->m_NumBits);
+		Bitcount -= NumBits;
+
 		// check for eof
 		if(pNode == pEof)
 			break;
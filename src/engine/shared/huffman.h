@@ -12,9 +12,10 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS = HUFFMAN_EOF_SYMBOL + 1,
 		HUFFMAN_MAX_NODES = HUFFMAN_MAX_SYMBOLS * 2 - 1,
 
-		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTBITS = 12,
 		HUFFMAN_LUTSIZE = (1 << HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1),
+		HUFFMAN_LUT_MAX_SYMBOLS = 8,
 	};
 
 	struct CNode
@@ -30,17 +31,30 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
-	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
+	// all symbols whose codes are completely contained in the LUT index
+	struct CDecodeEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_LUT_MAX_SYMBOLS];
+		unsigned char m_NumSymbols;
+		// number of bits used by the symbols, 0 if the first code is longer than the index
+		unsigned char m_NumBits;
+		// whether the EOF symbol follows the symbols
+		bool m_Eof;
+	};
 
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
-	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CDecodeEntry m_aDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
+	unsigned m_MaxNumBits;
 
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
 
 public:
+	// frequencies of the bytes in network packets, used by default
+	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
+
 	/*
 		Function: Init
 			Inits the compressor/decompressor.
@@ -5,13 +5,25 @@
 #include <base/dbg.h>
 #include <base/str.h>
 #include <base/thread.h>
+#include <base/time.h>
 
 #include <algorithm>
+#include <typeinfo>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+// The worker thread of the job pool that the current thread belongs to, if any.
+static thread_local const void *gs_pCurrentWorkerPool = nullptr;
+static thread_local int gs_CurrentWorkerIndex = -1;
 
 IJob::IJob() :
-	m_pNext(nullptr),
 	m_State(STATE_QUEUED),
-	m_Abortable(false)
+	m_Abortable(false),
+	m_Priority(PRIORITY_INTERACTIVE),
+	m_Affinity(-1),
+	m_QueuedTime(0)
 {
 }
 
@@ -47,6 +59,33 @@ bool IJob::IsAbortable() const
 	return m_Abortable;
 }
 
+void IJob::SetPriority(EPriority Priority)
+{
+	dbg_assert(Priority >= 0 && Priority < NUM_PRIORITIES, "Invalid Priority: %d", static_cast<int>(Priority));
+	m_Priority = Priority;
+}
+
+IJob::EPriority IJob::Priority() const
+{
+	return m_Priority;
+}
+
+void IJob::SetAffinity(int Worker)
+{
+	dbg_assert(Worker >= -1, "Invalid Worker: %d", Worker);
+	m_Affinity = Worker;
+}
+
+int IJob::Affinity() const
+{
+	return m_Affinity;
+}
+
+const char *IJob::Name() const
+{
+	return nullptr;
+}
+
 CJobPool::CJobPool()
 {
 	m_Shutdown = true;
@@ -62,91 +101,200 @@ CJobPool::~CJobPool()
 
 void CJobPool::WorkerThread(void *pUser)
 {
-	static_cast<CJobPool *>(pUser)->RunLoop();
+	CWorker *pWorker = static_cast<CWorker *>(pUser);
+	gs_pCurrentWorkerPool = pWorker->m_pPool;
+	gs_CurrentWorkerIndex = pWorker->m_Index;
+	pWorker->m_pPool->RunLoop(pWorker);
 }
 
-void CJobPool::RunLoop()
+std::shared_ptr<IJob> CJobPool::TakeJob(CWorker *pWorker)
 {
-	while(true)
+	for(int Priority = 0; Priority < IJob::NUM_PRIORITIES; Priority++)
 	{
-		// wait for job to become available
-		sphore_wait(&m_Semaphore);
-
-		// fetch job from queue
-		std::shared_ptr<IJob> pJob = nullptr;
+		// Jobs with affinity are exempt from the background limit, as no other worker could run them.
 		{
-			const CLockScope LockScope(m_Lock);
-			if(m_pFirstJob)
+			const CLockScope LockScope(pWorker->m_QueueLock);
+			std::deque<std::shared_ptr<IJob>> &AffineQueue = pWorker->m_aAffineQueues[Priority];
+			if(!AffineQueue.empty())
 			{
-				pJob = m_pFirstJob;
-				m_pFirstJob = m_pFirstJob->m_pNext;
-				// allow remaining objects in list to destruct, even when current object stays alive
-				pJob->m_pNext = nullptr;
-				if(!m_pFirstJob)
-					m_pLastJob = nullptr;
+				std::shared_ptr<IJob> pJob = std::move(AffineQueue.front());
+				AffineQueue.pop_front();
+				if(Priority == IJob::PRIORITY_BACKGROUND)
+				{
+					m_NumRunningBackground++;
+				}
+				return pJob;
 			}
 		}
 
-		if(pJob)
+		if(Priority == IJob::PRIORITY_BACKGROUND)
 		{
-			IJob::EJobState OldStateQueued = IJob::STATE_QUEUED;
-			if(!pJob->m_State.compare_exchange_strong(OldStateQueued, IJob::STATE_RUNNING))
+			int NumRunning = m_NumRunningBackground.load();
+			do
 			{
-				if(OldStateQueued == IJob::STATE_ABORTED)
+				if(NumRunning >= m_MaxRunningBackground)
 				{
-					// job was aborted before it was started
-					pJob->m_State = IJob::STATE_ABORTED;
-					continue;
+					return nullptr;
 				}
-				dbg_assert_failed("Job state invalid. Job was reused or uninitialized.");
-			}
+			} while(!m_NumRunningBackground.compare_exchange_weak(NumRunning, NumRunning + 1));
+		}
 
-			// remember running jobs so we can abort them
-			{
-				const CLockScope LockScope(m_LockRunning);
-				m_RunningJobs.push_back(pJob);
-			}
-			pJob->Run();
+		// Take from the own queue first, then steal from the other workers.
+		const int NumWorkers = m_vpWorkers.size();
+		for(int Offset = 0; Offset < NumWorkers; Offset++)
+		{
+			CWorker *pVictim = m_vpWorkers[(pWorker->m_Index + Offset) % NumWorkers].get();
+			const CLockScope LockScope(pVictim->m_QueueLock);
+			std::deque<std::shared_ptr<IJob>> &Queue = pVictim->m_aQueues[Priority];
+			if(!Queue.empty())
 			{
-				const CLockScope LockScope(m_LockRunning);
-				m_RunningJobs.erase(std::find(m_RunningJobs.begin(), m_RunningJobs.end(), pJob));
+				std::shared_ptr<IJob> pJob = std::move(Queue.front());
+				Queue.pop_front();
+				return pJob;
 			}
+		}
+
+		if(Priority == IJob::PRIORITY_BACKGROUND)
+		{
+			m_NumRunningBackground--;
+		}
+	}
+	return nullptr;
+}
 
-			// do not change state to done if job was not completed successfully
-			IJob::EJobState OldStateRunning = IJob::STATE_RUNNING;
-			if(!pJob->m_State.compare_exchange_strong(OldStateRunning, IJob::STATE_DONE))
+void CJobPool::RunJob(const std::shared_ptr<IJob> &pJob)
+{
+	IJob::EJobState OldStateQueued = IJob::STATE_QUEUED;
+	if(!pJob->m_State.compare_exchange_strong(OldStateQueued, IJob::STATE_RUNNING))
+	{
+		if(OldStateQueued == IJob::STATE_ABORTED)
+		{
+			// job was aborted before it was started
+			pJob->m_State = IJob::STATE_ABORTED;
+			return;
+		}
+		dbg_assert_failed("Job state invalid. Job was reused or uninitialized.");
+	}
+
+	// remember running jobs so we can abort them
+	{
+		const CLockScope LockScope(m_LockRunning);
+		m_RunningJobs.push_back(pJob);
+	}
+	const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+	pJob->Run();
+	const std::chrono::nanoseconds EndTime = time_get_nanoseconds();
+	{
+		const CLockScope LockScope(m_LockRunning);
+		m_RunningJobs.erase(std::find(m_RunningJobs.begin(), m_RunningJobs.end(), pJob));
+	}
+
+	{
+		const IJob &Job = *pJob;
+		const std::chrono::nanoseconds QueueTime = StartTime - pJob->m_QueuedTime;
+		const std::chrono::nanoseconds RunTime = EndTime - StartTime;
+		const char *pName = Job.Name();
+		const CLockScope LockScope(m_StatisticsLock);
+		const std::string Name = pName != nullptr ? std::string(pName) : TypeName(Job);
+		CJobStatistics &Statistics = m_Statistics[Name];
+		Statistics.m_Name = Name;
+		Statistics.m_NumJobs++;
+		Statistics.m_TotalQueueTime += QueueTime;
+		Statistics.m_MaxQueueTime = std::max(Statistics.m_MaxQueueTime, QueueTime);
+		Statistics.m_TotalRunTime += RunTime;
+		Statistics.m_MaxRunTime = std::max(Statistics.m_MaxRunTime, RunTime);
+	}
+
+	// do not change state to done if job was not completed successfully
+	IJob::EJobState OldStateRunning = IJob::STATE_RUNNING;
+	if(!pJob->m_State.compare_exchange_strong(OldStateRunning, IJob::STATE_DONE))
+	{
+		if(OldStateRunning != IJob::STATE_ABORTED)
+		{
+			dbg_assert_failed("Job state invalid, must be either running or aborted");
+		}
+	}
+}
+
+void CJobPool::RunLoop(CWorker *pWorker)
+{
+	while(true)
+	{
+		std::shared_ptr<IJob> pJob = TakeJob(pWorker);
+		if(!pJob)
+		{
+			// Mark this worker as idle before checking the queues again, so a job
+			// added in between either is found now or wakes this worker up.
+			pWorker->m_Idle = true;
+			pJob = TakeJob(pWorker);
+			if(!pJob)
 			{
-				if(OldStateRunning != IJob::STATE_ABORTED)
+				if(m_Shutdown)
 				{
-					dbg_assert_failed("Job state invalid, must be either running or aborted");
+					// shut down worker thread when pool is shutting down and no more jobs are left
+					break;
 				}
+				pWorker->m_Semaphore.Wait();
+				pWorker->m_Idle = false;
+				continue;
 			}
+			pWorker->m_Idle = false;
+		}
+
+		const bool Background = pJob->m_Priority == IJob::PRIORITY_BACKGROUND;
+		RunJob(pJob);
+		pJob = nullptr;
+		if(Background)
+		{
+			m_NumRunningBackground--;
 		}
-		else if(m_Shutdown)
+	}
+}
+
+void CJobPool::WakeWorker(CWorker *pWorker)
+{
+	pWorker->m_Idle = false;
+	pWorker->m_Semaphore.Signal();
+}
+
+void CJobPool::WakeIdleWorker()
+{
+	for(const std::unique_ptr<CWorker> &pWorker : m_vpWorkers)
+	{
+		bool Idle = true;
+		if(pWorker->m_Idle.compare_exchange_strong(Idle, false))
 		{
-			// shut down worker thread when pool is shutting down and no more jobs are left
-			break;
+			pWorker->m_Semaphore.Signal();
+			return;
 		}
 	}
+	// All workers are busy and will check all queues before waiting again.
 }
 
 void CJobPool::Init(int NumThreads)
 {
 	dbg_assert(m_Shutdown, "Job pool already running");
+	dbg_assert(NumThreads > 0, "Invalid NumThreads: %d", NumThreads);
 	m_Shutdown = false;
+	m_NumRunningBackground = 0;
+	// keep one worker thread free for interactive jobs
+	m_MaxRunningBackground = std::max(1, NumThreads - 1);
 
-	const CLockScope LockScope(m_Lock);
-	sphore_init(&m_Semaphore);
-	m_pFirstJob = nullptr;
-	m_pLastJob = nullptr;
+	m_vpWorkers.reserve(NumThreads);
+	for(int i = 0; i < NumThreads; i++)
+	{
+		std::unique_ptr<CWorker> pWorker = std::make_unique<CWorker>();
+		pWorker->m_pPool = this;
+		pWorker->m_Index = i;
+		m_vpWorkers.push_back(std::move(pWorker));
+	}
 
 	// start worker threads
 	char aName[16]; // unix kernel length limit
-	m_vpThreads.reserve(NumThreads);
-	for(int i = 0; i < NumThreads; i++)
+	for(const std::unique_ptr<CWorker> &pWorker : m_vpWorkers)
 	{
-		str_format(aName, sizeof(aName), "CJobPool W%d", i);
-		m_vpThreads.push_back(thread_init(WorkerThread, this, aName));
+		str_format(aName, sizeof(aName), "CJobPool W%d", pWorker->m_Index);
+		pWorker->m_pThread = thread_init(WorkerThread, pWorker.get(), aName);
 	}
 }
 
@@ -155,34 +303,21 @@ void CJobPool::Shutdown()
 	dbg_assert(!m_Shutdown, "Job pool already shut down");
 	m_Shutdown = true;
 
-	// abort queued jobs
+	// abort queued jobs, only remove abortable jobs from queue
+	const auto &&RemoveAbortedJobs = [](std::deque<std::shared_ptr<IJob>> &Queue) {
+		Queue.erase(std::remove_if(Queue.begin(), Queue.end(), [](const std::shared_ptr<IJob> &pJob) {
+			return pJob->Abort();
+		}),
+			Queue.end());
+	};
+	for(const std::unique_ptr<CWorker> &pWorker : m_vpWorkers)
 	{
-		const CLockScope LockScope(m_Lock);
-		std::shared_ptr<IJob> pJob = m_pFirstJob;
-		std::shared_ptr<IJob> pPrev = nullptr;
-		while(pJob != nullptr)
+		const CLockScope LockScope(pWorker->m_QueueLock);
+		for(int Priority = 0; Priority < IJob::NUM_PRIORITIES; Priority++)
 		{
-			std::shared_ptr<IJob> pNext = pJob->m_pNext;
-			if(pJob->Abort())
-			{
-				// only remove abortable jobs from queue
-				pJob->m_pNext = nullptr;
-				if(pPrev)
-				{
-					pPrev->m_pNext = pNext;
-				}
-				else
-				{
-					m_pFirstJob = pNext;
-				}
-			}
-			else
-			{
-				pPrev = pJob;
-			}
-			pJob = pNext;
+			RemoveAbortedJobs(pWorker->m_aQueues[Priority]);
+			RemoveAbortedJobs(pWorker->m_aAffineQueues[Priority]);
 		}
-		m_pLastJob = pPrev;
 	}
 
 	// abort running jobs
@@ -195,19 +330,18 @@ void CJobPool::Shutdown()
 	}
 
 	// wake up all worker threads
-	for(size_t i = 0; i < m_vpThreads.size(); i++)
+	for(const std::unique_ptr<CWorker> &pWorker : m_vpWorkers)
 	{
-		sphore_signal(&m_Semaphore);
+		WakeWorker(pWorker.get());
 	}
 
 	// wait for all worker threads to finish
-	for(void *pThread : m_vpThreads)
+	for(const std::unique_ptr<CWorker> &pWorker : m_vpWorkers)
 	{
-		thread_wait(pThread);
+		thread_wait(pWorker->m_pThread);
 	}
 
-	m_vpThreads.clear();
-	sphore_destroy(&m_Semaphore);
+	m_vpWorkers.clear();
 }
 
 void CJobPool::Add(std::shared_ptr<IJob> pJob)
@@ -219,16 +353,137 @@ void CJobPool::Add(std::shared_ptr<IJob> pJob)
 		return;
 	}
 
-	// add job to queue
+	pJob->m_QueuedTime = time_get_nanoseconds();
+	const int Priority = pJob->m_Priority;
+	const int NumWorkers = m_vpWorkers.size();
+	if(pJob->m_Affinity >= 0)
 	{
-		const CLockScope LockScope(m_Lock);
-		if(m_pLastJob)
-			m_pLastJob->m_pNext = pJob;
-		m_pLastJob = std::move(pJob);
-		if(!m_pFirstJob)
-			m_pFirstJob = m_pLastJob;
+		CWorker *pWorker = m_vpWorkers[pJob->m_Affinity % NumWorkers].get();
+		{
+			const CLockScope LockScope(pWorker->m_QueueLock);
+			pWorker->m_aAffineQueues[Priority].push_back(std::move(pJob));
+		}
+		WakeWorker(pWorker);
+		return;
+	}
+
+	// prefer the queue of the current worker thread, otherwise distribute jobs evenly
+	const int WorkerIndex = gs_pCurrentWorkerPool == this ? gs_CurrentWorkerIndex : m_NextWorker.fetch_add(1) % NumWorkers;
+	CWorker *pWorker = m_vpWorkers[WorkerIndex].get();
+	{
+		const CLockScope LockScope(pWorker->m_QueueLock);
+		pWorker->m_aQueues[Priority].push_back(std::move(pJob));
+	}
+	WakeIdleWorker();
+}
+
+int CJobPool::NumThreads() const
+{
+	return m_vpWorkers.size();
+}
+
+const std::string &CJobPool::TypeName(const IJob &Job)
+{
+	auto [It, Inserted] = m_TypeNames.try_emplace(std::type_index(typeid(Job)));
+	if(Inserted)
+	{
+		const char *pName = typeid(Job).name();
+#if defined(__GNUC__)
+		int Status;
+		char *pDemangled = abi::__cxa_demangle(pName, nullptr, nullptr, &Status);
+		if(pDemangled)
+		{
+			It->second = pDemangled;
+			free(pDemangled);
+			return It->second;
+		}
+#endif
+		// MSVC returns readable names prefixed by "class "
+		const char *pClass = str_startswith(pName, "class ");
+		It->second = pClass ? pClass : pName;
 	}
+	return It->second;
+}
 
-	// signal a worker thread that a job is available
-	sphore_signal(&m_Semaphore);
+std::vector<CJobPool::CJobStatistics> CJobPool::Statistics() const
+{
+	const CLockScope LockScope(m_StatisticsLock);
+	std::vector<CJobStatistics> vStatistics;
+	vStatistics.reserve(m_Statistics.size());
+	for(const auto &[_, Statistics] : m_Statistics)
+	{
+		vStatistics.push_back(Statistics);
+	}
+	return vStatistics;
+}
+
+class CJobGroup::CState
+{
+public:
+	// signaled once for every task run by a worker thread
+	CSemaphore m_TaskDone;
+};
+
+class CJobGroup::CTaskJob : public IJob
+{
+	std::shared_ptr<CState> m_pState;
+	const char *m_pName;
+
+	void Run() override
+	{
+		if(Claim())
+		{
+			m_Task();
+			m_pState->m_TaskDone.Signal();
+		}
+	}
+
+public:
+	std::function<void()> m_Task;
+	std::atomic<bool> m_Claimed = false;
+
+	CTaskJob(std::shared_ptr<CState> pState, const char *pName, std::function<void()> &&Task) :
+		m_pState(std::move(pState)),
+		m_pName(pName),
+		m_Task(std::move(Task))
+	{
+	}
+
+	const char *Name() const override { return m_pName; }
+
+	// whether the caller is the first to start the task
+	bool Claim() { return !m_Claimed.exchange(true); }
+};
+
+CJobGroup::CJobGroup() :
+	m_pState(std::make_shared<CState>())
+{
+}
+
+CJobGroup::~CJobGroup()
+{
+	Wait();
+}
+
+std::shared_ptr<IJob> CJobGroup::Add(const char *pName, std::function<void()> &&Task)
+{
+	std::shared_ptr<CTaskJob> pJob = std::make_shared<CTaskJob>(m_pState, pName, std::move(Task));
+	pJob->SetPriority(IJob::PRIORITY_INTERACTIVE);
+	m_vpJobs.push_back(pJob);
+	return pJob;
+}
+
+void CJobGroup::Wait()
+{
+	int NumRunByWorkers = 0;
+	for(const std::shared_ptr<CTaskJob> &pJob : m_vpJobs)
+	{
+		if(pJob->Claim())
+			pJob->m_Task();
+		else
+			NumRunByWorkers++;
+	}
+	for(int i = 0; i < NumRunByWorkers; i++)
+		m_pState->m_TaskDone.Wait();
+	m_vpJobs.clear();
 }
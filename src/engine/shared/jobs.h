@@ -7,8 +7,13 @@
 #include <base/sphore.h>
 
 #include <atomic>
+#include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -50,10 +55,35 @@ public:
 		STATE_ABORTED,
 	};
 
+	/**
+	 * The priority class of a job. Queued jobs of a higher priority class are
+	 * always started before queued jobs of a lower one.
+	 */
+	enum EPriority
+	{
+		/**
+		 * Short jobs that something is waiting for, e.g. loading a skin
+		 * that should be rendered soon. This is the default.
+		 */
+		PRIORITY_INTERACTIVE = 0,
+
+		/**
+		 * Long-running jobs that nothing is waiting for immediately, e.g.
+		 * saving a map or encoding a video. Background jobs never occupy
+		 * all worker threads at the same time, if more than one worker
+		 * thread exists, so interactive jobs can always start quickly.
+		 */
+		PRIORITY_BACKGROUND,
+
+		NUM_PRIORITIES,
+	};
+
 private:
-	std::shared_ptr<IJob> m_pNext;
 	std::atomic<EJobState> m_State;
 	std::atomic<bool> m_Abortable;
+	EPriority m_Priority;
+	int m_Affinity;
+	std::chrono::nanoseconds m_QueuedTime;
 
 protected:
 	/**
@@ -117,28 +147,117 @@ public:
 	 * @return `true` if the job can be aborted, `false` otherwise.
 	 */
 	bool IsAbortable() const;
+
+	/**
+	 * Sets the priority class of this job. Must be called before the job is added
+	 * to a job pool. Jobs have @link PRIORITY_INTERACTIVE @endlink by default.
+	 *
+	 * @param Priority The priority class.
+	 */
+	void SetPriority(EPriority Priority);
+
+	/**
+	 * Returns the priority class of this job.
+	 *
+	 * @return The priority class.
+	 */
+	EPriority Priority() const;
+
+	/**
+	 * Sets the worker thread this job must run on. Must be called before the job
+	 * is added to a job pool. Jobs with affinity are never stolen by other worker
+	 * threads, so jobs that share thread-local state can be serialized this way.
+	 *
+	 * @param Worker Index of the worker thread, modulo the number of worker
+	 * threads, or `-1` to allow running on any worker thread, which is the default.
+	 */
+	void SetAffinity(int Worker);
+
+	/**
+	 * Returns the worker thread this job must run on.
+	 *
+	 * @return Index of the worker thread or `-1` if the job can run on any worker thread.
+	 */
+	int Affinity() const;
+
+	/**
+	 * Returns the name under which the job pool collects the statistics of this
+	 * job. Job types which run different functions, e.g. given as lambdas, should
+	 * override this so their statistics can be told apart.
+	 *
+	 * @return The name, which must stay valid while the job exists, or `nullptr`
+	 * to use the name of the type of the job, which is the default.
+	 */
+	virtual const char *Name() const;
 };
 
 /**
  * A job pool which runs jobs in one or more worker threads.
  *
+ * Every worker thread has its own queues, one per priority class. Jobs are
+ * distributed over the workers when they are added and idle workers steal
+ * jobs from the queues of other workers, so the workers only contend for
+ * the lock of a queue when stealing.
+ *
  * @see IJob
  */
 class CJobPool
 {
-	std::vector<void *> m_vpThreads;
-	std::atomic<bool> m_Shutdown;
+public:
+	/**
+	 * Timing statistics for all jobs with the same name that were run by the job pool.
+	 */
+	class CJobStatistics
+	{
+	public:
+		/**
+		 * The name of the jobs, see @link IJob::Name @endlink.
+		 */
+		std::string m_Name;
+		int64_t m_NumJobs = 0;
+		std::chrono::nanoseconds m_TotalQueueTime = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds m_MaxQueueTime = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds m_TotalRunTime = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds m_MaxRunTime = std::chrono::nanoseconds::zero();
+	};
+
+private:
+	class CWorker
+	{
+	public:
+		CJobPool *m_pPool;
+		int m_Index;
+		void *m_pThread = nullptr;
+		CSemaphore m_Semaphore;
+		std::atomic<bool> m_Idle = false;
 
-	CLock m_Lock;
-	SEMAPHORE m_Semaphore;
-	std::shared_ptr<IJob> m_pFirstJob GUARDED_BY(m_Lock);
-	std::shared_ptr<IJob> m_pLastJob GUARDED_BY(m_Lock);
+		CLock m_QueueLock;
+		std::deque<std::shared_ptr<IJob>> m_aQueues[IJob::NUM_PRIORITIES] GUARDED_BY(m_QueueLock);
+		std::deque<std::shared_ptr<IJob>> m_aAffineQueues[IJob::NUM_PRIORITIES] GUARDED_BY(m_QueueLock);
+	};
+
+	std::vector<std::unique_ptr<CWorker>> m_vpWorkers;
+	std::atomic<bool> m_Shutdown;
+	std::atomic<unsigned> m_NextWorker = 0;
+	std::atomic<int> m_NumRunningBackground = 0;
+	int m_MaxRunningBackground = 1;
 
 	CLock m_LockRunning;
 	std::deque<std::shared_ptr<IJob>> m_RunningJobs GUARDED_BY(m_LockRunning);
 
+	mutable CLock m_StatisticsLock;
+	std::unordered_map<std::string, CJobStatistics> m_Statistics GUARDED_BY(m_StatisticsLock);
+	// demangled names of the job types without a name of their own
+	std::unordered_map<std::type_index, std::string> m_TypeNames GUARDED_BY(m_StatisticsLock);
+
+	const std::string &TypeName(const IJob &Job) REQUIRES(m_StatisticsLock);
+
 	static void WorkerThread(void *pUser) NO_THREAD_SAFETY_ANALYSIS;
-	void RunLoop() NO_THREAD_SAFETY_ANALYSIS;
+	void RunLoop(CWorker *pWorker) NO_THREAD_SAFETY_ANALYSIS;
+	std::shared_ptr<IJob> TakeJob(CWorker *pWorker) NO_THREAD_SAFETY_ANALYSIS;
+	void RunJob(const std::shared_ptr<IJob> &pJob) REQUIRES(!m_LockRunning) REQUIRES(!m_StatisticsLock);
+	void WakeWorker(CWorker *pWorker);
+	void WakeIdleWorker();
 
 public:
 	CJobPool();
@@ -151,7 +270,7 @@ public:
 	 *
 	 * @remark Must be called on the main thread.
 	 */
-	void Init(int NumThreads) REQUIRES(!m_Lock);
+	void Init(int NumThreads);
 
 	/**
 	 * Shuts down the job pool. Aborts all abortable jobs. Then waits for all
@@ -159,7 +278,7 @@ public:
 	 *
 	 * @remark Must be called on the main thread.
 	 */
-	void Shutdown() REQUIRES(!m_Lock) REQUIRES(!m_LockRunning);
+	void Shutdown() REQUIRES(!m_LockRunning);
 
 	/**
 	 * Adds a job to the queue of the job pool.
@@ -168,7 +287,64 @@ public:
 	 *
 	 * @remark If the job pool is already shutting down, no additional jobs
 	 * will be enqueue anymore. Abortable jobs will immediately be aborted.
+	 *
+	 * @remark Jobs added from a worker thread of this job pool are queued on
+	 * that worker thread, unless they have an affinity.
+	 */
+	void Add(std::shared_ptr<IJob> pJob);
+
+	/**
+	 * Returns the number of worker threads.
+	 *
+	 * @return The number of worker threads.
+	 */
+	int NumThreads() const;
+
+	/**
+	 * Returns the timing statistics for all jobs that were completed so far.
+	 *
+	 * @return The statistics, one entry per job name.
+	 *
+	 * @remark Can be called from any thread.
+	 */
+	std::vector<CJobStatistics> Statistics() const REQUIRES(!m_StatisticsLock);
+};
+
+/**
+ * Tasks that run as jobs of a job pool while one thread waits for all of
+ * them. The waiting thread runs the tasks that were not started by a worker
+ * thread yet itself, so waiting does not depend on other jobs of the pool.
+ *
+ * @remark The tasks may reference data of the waiting thread, because a task
+ * is never started after @link Wait @endlink returned.
+ */
+class CJobGroup
+{
+	class CState;
+	class CTaskJob;
+
+	std::shared_ptr<CState> m_pState;
+	std::vector<std::shared_ptr<CTaskJob>> m_vpJobs;
+
+public:
+	CJobGroup();
+	~CJobGroup();
+
+	/**
+	 * Creates a job that runs the task, which must be added to a job pool.
+	 * The job has @link IJob::PRIORITY_INTERACTIVE @endlink.
+	 *
+	 * @param pName The name of the job for the statistics, see @link IJob::Name @endlink.
+	 * @param Task The task.
+	 *
+	 * @return The job.
+	 */
+	std::shared_ptr<IJob> Add(const char *pName, std::function<void()> &&Task);
+
+	/**
+	 * Runs all tasks that have not been started yet on this thread, in the
+	 * order they were added, and waits for the others to complete.
 	 */
-	void Add(std::shared_ptr<IJob> pJob) REQUIRES(!m_Lock);
+	void Wait();
 };
 #endif
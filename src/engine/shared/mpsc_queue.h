@@ -0,0 +1,92 @@
+#ifndef ENGINE_SHARED_MPSC_QUEUE_H
+#define ENGINE_SHARED_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Bounded lock-free queue for many producers and a single consumer.
+ *
+ * Every slot carries a sequence number which tells producers and the consumer
+ * whether the slot is free or filled for the current lap around the buffer,
+ * so neither side ever has to wait for the other. Pushing to a full queue fails
+ * instead of blocking.
+ *
+ * @tparam T Trivially copyable item type.
+ * @tparam CAPACITY Number of items, must be a power of two.
+ */
+template<typename T, uint32_t CAPACITY>
+class CMpscQueue
+{
+	static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+	class CSlot
+	{
+	public:
+		std::atomic<uint32_t> m_Sequence;
+		T m_Item;
+	};
+
+	CSlot m_aSlots[CAPACITY];
+	alignas(64) std::atomic<uint32_t> m_PushPosition = 0;
+	// only accessed by the consumer
+	alignas(64) uint32_t m_PopPosition = 0;
+
+public:
+	CMpscQueue()
+	{
+		for(uint32_t i = 0; i < CAPACITY; i++)
+			m_aSlots[i].m_Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Adds an item, can be called from any thread.
+	 *
+	 * @return `true` on success, `false` if the queue is full.
+	 */
+	bool TryPush(const T &Item)
+	{
+		uint32_t Position = m_PushPosition.load(std::memory_order_relaxed);
+		CSlot *pSlot;
+		while(true)
+		{
+			pSlot = &m_aSlots[Position & (CAPACITY - 1)];
+			const int32_t Difference = (int32_t)(pSlot->m_Sequence.load(std::memory_order_acquire) - Position);
+			if(Difference == 0)
+			{
+				if(m_PushPosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(Difference < 0)
+			{
+				// the consumer has not freed this slot from the previous lap yet
+				return false;
+			}
+			else
+			{
+				Position = m_PushPosition.load(std::memory_order_relaxed);
+			}
+		}
+		pSlot->m_Item = Item;
+		pSlot->m_Sequence.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Removes the oldest item, must only be called by one thread at a time.
+	 *
+	 * @return `true` on success, `false` if the queue is empty.
+	 */
+	bool TryPop(T *pItem)
+	{
+		CSlot *pSlot = &m_aSlots[m_PopPosition & (CAPACITY - 1)];
+		if((int32_t)(pSlot->m_Sequence.load(std::memory_order_acquire) - (m_PopPosition + 1)) < 0)
+			return false;
+		*pItem = pSlot->m_Item;
+		pSlot->m_Sequence.store(m_PopPosition + CAPACITY, std::memory_order_release);
+		m_PopPosition++;
+		return true;
+	}
+};
+
+#endif
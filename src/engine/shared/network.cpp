@@ -144,6 +144,7 @@ void CNetBase::SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
 	static constexpr int DATA_OFFSET = sizeof(NET_HEADER_EXTENDED) + NET_CONNLESS_EXTRA_SIZE;
+	static_assert(DATA_OFFSET == NET_CONNLESS_HEADER_SIZE);
 	dbg_assert(DataSize <= (int)sizeof(aBuffer) - DATA_OFFSET,
 		"Invalid DataSize for CNetBase::SendPacketConnless: %d > %d", DataSize, (int)sizeof(aBuffer) - DATA_OFFSET);
 
@@ -164,6 +165,7 @@ void CNetBase::SendPacketConnlessWithToken7(NETSOCKET Socket, NETADDR *pAddr, co
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
 	static constexpr int DATA_OFFSET = 1 + 2 * sizeof(SECURITY_TOKEN);
+	static_assert(DATA_OFFSET == NET_CONNLESS_HEADER_SIZE_7);
 	dbg_assert(DataSize <= (int)sizeof(aBuffer) - DATA_OFFSET,
 		"Invalid DataSize for CNetBase::SendPacketConnlessWithToken7: %d > %d", DataSize, (int)sizeof(aBuffer) - DATA_OFFSET);
 
@@ -174,6 +176,28 @@ void CNetBase::SendPacketConnlessWithToken7(NETSOCKET Socket, NETADDR *pAddr, co
 	net_udp_send(Socket, pAddr, aBuffer, DataSize + DATA_OFFSET);
 }
 
+void CNetBase::SendPacketConnlessInPlace(NETSOCKET Socket, const NETADDR *pAddr, unsigned char *pData, int DataSize)
+{
+	dbg_assert(DataSize <= NET_MAX_PACKETSIZE - NET_CONNLESS_HEADER_SIZE,
+		"Invalid DataSize for CNetBase::SendPacketConnlessInPlace: %d > %d", DataSize, NET_MAX_PACKETSIZE - NET_CONNLESS_HEADER_SIZE);
+
+	unsigned char *pPacket = pData - NET_CONNLESS_HEADER_SIZE;
+	std::fill(pPacket, pData, 0xFF);
+	net_udp_send(Socket, pAddr, pPacket, DataSize + NET_CONNLESS_HEADER_SIZE);
+}
+
+void CNetBase::SendPacketConnlessWithToken7InPlace(NETSOCKET Socket, const NETADDR *pAddr, unsigned char *pData, int DataSize, SECURITY_TOKEN Token, SECURITY_TOKEN ResponseToken)
+{
+	dbg_assert(DataSize <= NET_MAX_PACKETSIZE - NET_CONNLESS_HEADER_SIZE_7,
+		"Invalid DataSize for CNetBase::SendPacketConnlessWithToken7InPlace: %d > %d", DataSize, NET_MAX_PACKETSIZE - NET_CONNLESS_HEADER_SIZE_7);
+
+	unsigned char *pPacket = pData - NET_CONNLESS_HEADER_SIZE_7;
+	pPacket[0] = (NET_PACKETFLAG_CONNLESS << 2) | 1;
+	WriteSecurityToken(pPacket + 1, Token);
+	WriteSecurityToken(pPacket + 1 + sizeof(SECURITY_TOKEN), ResponseToken);
+	net_udp_send(Socket, pAddr, pPacket, DataSize + NET_CONNLESS_HEADER_SIZE_7);
+}
+
 void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken, bool Sixup)
 {
 	dbg_assert(IsValidConnectionOrientedPacket(pPacket), "Invalid packet to send. Flags=%d Ack=%d NumChunks=%d Size=%d",
@@ -3,6 +3,7 @@
 #ifndef ENGINE_SHARED_NETWORK_H
 #define ENGINE_SHARED_NETWORK_H
 
+#include "protocol.h"
 #include "ringbuffer.h"
 #include "stun.h"
 
@@ -11,6 +12,7 @@
 
 #include <array>
 #include <optional>
+#include <unordered_map>
 
 class CHuffman;
 class CNetBan;
@@ -76,7 +78,10 @@ enum
 	NET_MAX_CHUNKHEADERSIZE = 3,
 	NET_PACKETHEADERSIZE = 3,
 	NET_CONNLESS_EXTRA_SIZE = 4,
-	NET_MAX_CLIENTS = 64,
+	// size of the headers in front of connless data, see `CNetBase::SendPacketConnlessInPlace`
+	NET_CONNLESS_HEADER_SIZE = 2 + NET_CONNLESS_EXTRA_SIZE,
+	NET_CONNLESS_HEADER_SIZE_7 = 1 + 2 * 4,
+	NET_MAX_CLIENTS = SERVER_MAX_CLIENTS,
 	NET_MAX_CONSOLE_CLIENTS = 4,
 	NET_MAX_SEQUENCE = 1 << 10,
 	NET_MAX_PACKET_CHUNKS = 0xFF,
@@ -426,6 +431,8 @@ class CNetServer
 	CNetBan *m_pNetBan;
 	CSlot m_aSlots[NET_MAX_CLIENTS];
 	int m_MaxClients = NET_MAX_CLIENTS;
+	// maps peer addresses to slots, entries are validated against the slot on lookup
+	std::unordered_map<NETADDR, int> m_SlotByAddr;
 	int m_MaxClientsPerIp;
 
 	NETFUNC_NEWCLIENT m_pfnNewClient;
@@ -451,6 +458,7 @@ class CNetServer
 	void OnConnCtrlMsg(NETADDR &Addr, int ClientId, int ControlMsg, const CNetPacketConstruct &Packet);
 	bool ClientExists(const NETADDR &Addr) { return GetClientSlot(Addr) != -1; }
 	int GetClientSlot(const NETADDR &Addr);
+	void SetClientSlot(int ClientId);
 	void SendControl(NETADDR &Addr, int ControlMsg, const void *pExtra, int ExtraSize, SECURITY_TOKEN SecurityToken);
 
 	int TryAcceptClient(NETADDR &Addr, SECURITY_TOKEN SecurityToken, bool VanillaAuth = false, bool Sixup = false, SECURITY_TOKEN Token = 0);
@@ -636,6 +644,10 @@ public:
 	static void SendControlMsgWithToken7(NETSOCKET Socket, NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended);
 	static void SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, bool Extended, unsigned char aExtra[NET_CONNLESS_EXTRA_SIZE]);
 	static void SendPacketConnlessWithToken7(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, SECURITY_TOKEN Token, SECURITY_TOKEN ResponseToken);
+	// Same as above, but the header is written directly in front of `pData` instead of copying
+	// the data, so the `NET_CONNLESS_HEADER_SIZE(_7)` bytes in front of it must be writable.
+	static void SendPacketConnlessInPlace(NETSOCKET Socket, const NETADDR *pAddr, unsigned char *pData, int DataSize);
+	static void SendPacketConnlessWithToken7InPlace(NETSOCKET Socket, const NETADDR *pAddr, unsigned char *pData, int DataSize, SECURITY_TOKEN Token, SECURITY_TOKEN ResponseToken);
 	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken, bool Sixup = false);
 
 	static std::optional<int> UnpackPacketFlags(unsigned char *pBuffer, int Size);
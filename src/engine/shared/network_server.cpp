@@ -104,6 +104,11 @@ void CNetServer::Drop(int ClientId, const char *pReason)
 	if(m_pfnDelClient)
 		m_pfnDelClient(ClientId, pReason, m_pUser);
 
+	const auto It = m_SlotByAddr.find(*m_aSlots[ClientId].m_Connection.PeerAddress());
+	if(It != m_SlotByAddr.end() && It->second == ClientId)
+	{
+		m_SlotByAddr.erase(It);
+	}
 	m_aSlots[ClientId].m_Connection.Disconnect(pReason);
 }
 
@@ -229,8 +234,10 @@ int CNetServer::TryAcceptClient(NETADDR &Addr, SECURITY_TOKEN SecurityToken, boo
 		return -1; // failed to add client
 	}
 
+	// 0.7 clients are limited to the slots they can address
+	const int MaxSlots = Sixup ? minimum(MaxClients(), (int)SIXUP_MAX_CLIENTS) : MaxClients();
 	int Slot = -1;
-	for(int i = 0; i < MaxClients(); i++)
+	for(int i = 0; i < MaxSlots; i++)
 	{
 		if(m_aSlots[i].m_Connection.State() == CNetConnection::EState::OFFLINE)
 		{
@@ -249,6 +256,7 @@ int CNetServer::TryAcceptClient(NETADDR &Addr, SECURITY_TOKEN SecurityToken, boo
 
 	// init connection slot
 	m_aSlots[Slot].m_Connection.DirectInit(Addr, SecurityToken, Token, Sixup);
+	SetClientSlot(Slot);
 
 	if(VanillaAuth)
 	{
@@ -552,18 +560,28 @@ int CNetServer::OnSixupCtrlMsg(NETADDR &Addr, CNetChunk *pChunk, int ControlMsg,
 
 int CNetServer::GetClientSlot(const NETADDR &Addr)
 {
-	for(int i = 0; i < MaxClients(); i++)
+	const auto It = m_SlotByAddr.find(Addr);
+	if(It == m_SlotByAddr.end())
 	{
-		if(m_aSlots[i].m_Connection.State() != CNetConnection::EState::OFFLINE &&
-			m_aSlots[i].m_Connection.State() != CNetConnection::EState::ERROR &&
-			net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
-		{
-			return i;
-		}
+		return -1;
+	}
+	const int Slot = It->second;
+	if(m_aSlots[Slot].m_Connection.State() != CNetConnection::EState::OFFLINE &&
+		m_aSlots[Slot].m_Connection.State() != CNetConnection::EState::ERROR &&
+		net_addr_comp(m_aSlots[Slot].m_Connection.PeerAddress(), &Addr) == 0)
+	{
+		return Slot;
 	}
+	// the slot was reset or reused since, remove the stale entry
+	m_SlotByAddr.erase(It);
 	return -1;
 }
 
+void CNetServer::SetClientSlot(int ClientId)
+{
+	m_SlotByAddr[*m_aSlots[ClientId].m_Connection.PeerAddress()] = ClientId;
+}
+
 static bool IsDDNetControlMsg(const CNetPacketConstruct *pPacket)
 {
 	if(!(pPacket->m_Flags & NET_PACKETFLAG_CONTROL) || pPacket->m_DataSize < 1)
@@ -745,6 +763,7 @@ void CNetServer::ResumeOldConnection(int ClientId, int OrigId)
 {
 	m_aSlots[ClientId].m_Connection.ResumeConnection(ClientAddr(OrigId), m_aSlots[OrigId].m_Connection.SeqSequence(), m_aSlots[OrigId].m_Connection.AckSequence(), m_aSlots[OrigId].m_Connection.SecurityToken(), m_aSlots[OrigId].m_Connection.ResendBuffer(), m_aSlots[OrigId].m_Connection.m_Sixup);
 	m_aSlots[OrigId].m_Connection.Reset();
+	SetClientSlot(ClientId);
 }
 
 void CNetServer::IgnoreTimeouts(int ClientId)
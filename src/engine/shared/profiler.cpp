@@ -0,0 +1,297 @@
+#include "profiler.h"
+
+#include <base/io.h>
+#include <base/lock.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+
+std::atomic<bool> CProfiler::ms_Running = false;
+
+class CProfilerThreadBuffer
+{
+public:
+	int m_Thread;
+	CLock m_Lock;
+	std::vector<CProfiler::CEvent> m_vEvents GUARDED_BY(m_Lock);
+	int64_t m_NumRecorded GUARDED_BY(m_Lock) = 0;
+};
+
+static CLock gs_ThreadsLock;
+static std::vector<std::shared_ptr<CProfilerThreadBuffer>> gs_vpThreads GUARDED_BY(gs_ThreadsLock);
+static int gs_NextThread GUARDED_BY(gs_ThreadsLock) = 0;
+
+static thread_local std::shared_ptr<CProfilerThreadBuffer> gs_pThreadBuffer;
+static thread_local int gs_Depth = 0;
+
+void CProfiler::Init(IConsole *pConsole, IStorage *pStorage)
+{
+	m_pConsole = pConsole;
+	m_pStorage = pStorage;
+
+	Console()->Register("profiler_start", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, ConProfilerStart, this, "Start recording profiler scopes, discarding the previous ones");
+	Console()->Register("profiler_stop", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, ConProfilerStop, this, "Stop recording profiler scopes");
+	Console()->Register("profiler_summary", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, ConProfilerSummary, this, "Show count, median, 99th percentile and maximum duration of the recorded profiler scopes");
+	Console()->Register("profiler_dump", "?s[file]", CFGFLAG_SERVER | CFGFLAG_CLIENT, ConProfilerDump, this, "Save the recorded profiler scopes as Chrome trace (.json) and folded stacks (.folded) in the profiles folder");
+}
+
+void CProfiler::Start()
+{
+	{
+		const CLockScope LockScope(gs_ThreadsLock);
+		// forget threads that have exited
+		gs_vpThreads.erase(std::remove_if(gs_vpThreads.begin(), gs_vpThreads.end(), [](const std::shared_ptr<CProfilerThreadBuffer> &pThread) {
+			return pThread.use_count() == 1;
+		}),
+			gs_vpThreads.end());
+		for(const auto &pThread : gs_vpThreads)
+		{
+			const CLockScope ThreadLockScope(pThread->m_Lock);
+			pThread->m_vEvents.clear();
+			pThread->m_NumRecorded = 0;
+		}
+	}
+	ms_Running.store(true, std::memory_order_relaxed);
+}
+
+void CProfiler::Stop()
+{
+	ms_Running.store(false, std::memory_order_relaxed);
+}
+
+int64_t CProfiler::BeginScope()
+{
+	gs_Depth++;
+	return time_get_nanoseconds().count();
+}
+
+void CProfiler::EndScope(const char *pName, int64_t Start)
+{
+	const int64_t End = time_get_nanoseconds().count();
+	gs_Depth--;
+
+	if(!gs_pThreadBuffer)
+	{
+		gs_pThreadBuffer = std::make_shared<CProfilerThreadBuffer>();
+		const CLockScope LockScope(gs_ThreadsLock);
+		gs_pThreadBuffer->m_Thread = gs_NextThread++;
+		gs_vpThreads.push_back(gs_pThreadBuffer);
+	}
+
+	// only contended while the events are copied
+	CProfilerThreadBuffer &Buffer = *gs_pThreadBuffer;
+	const CLockScope LockScope(Buffer.m_Lock);
+	const CEvent Event = {pName, Start, End - Start, gs_Depth};
+	if(Buffer.m_vEvents.size() < (size_t)MAX_EVENTS)
+		Buffer.m_vEvents.push_back(Event);
+	else
+		Buffer.m_vEvents[Buffer.m_NumRecorded % MAX_EVENTS] = Event;
+	Buffer.m_NumRecorded++;
+}
+
+std::vector<CProfiler::CThreadEvents> CProfiler::Events(int64_t Since)
+{
+	std::vector<CThreadEvents> vThreads;
+	const CLockScope LockScope(gs_ThreadsLock);
+	for(const auto &pThread : gs_vpThreads)
+	{
+		CThreadEvents &Thread = vThreads.emplace_back();
+		Thread.m_Thread = pThread->m_Thread;
+		{
+			const CLockScope ThreadLockScope(pThread->m_Lock);
+			std::copy_if(pThread->m_vEvents.begin(), pThread->m_vEvents.end(), std::back_inserter(Thread.m_vEvents), [&](const CEvent &Event) {
+				return Event.m_Start >= Since;
+			});
+		}
+		// scopes are recorded when they end, sort them so that enclosing scopes come first
+		std::sort(Thread.m_vEvents.begin(), Thread.m_vEvents.end(), [](const CEvent &Left, const CEvent &Right) {
+			return Left.m_Start != Right.m_Start ? Left.m_Start < Right.m_Start : Left.m_Depth < Right.m_Depth;
+		});
+	}
+	return vThreads;
+}
+
+std::vector<CProfiler::CPathStats> CProfiler::Summarize(const std::vector<CThreadEvents> &vThreads)
+{
+	class CPathData
+	{
+	public:
+		std::vector<int64_t> m_vDurations;
+		int64_t m_Self = 0;
+	};
+	std::map<std::string, CPathData> Paths;
+
+	for(const CThreadEvents &Thread : vThreads)
+	{
+		const std::vector<CEvent> &vEvents = Thread.m_vEvents;
+		std::vector<std::string> vPaths(vEvents.size());
+		std::vector<int64_t> vNestedDurations(vEvents.size(), 0);
+		// indices of the scopes enclosing the current one
+		std::vector<size_t> vStack;
+		for(size_t i = 0; i < vEvents.size(); i++)
+		{
+			const CEvent &Event = vEvents[i];
+			// the enclosing scopes might have been overwritten in the ring buffer
+			while(!vStack.empty() && (vEvents[vStack.back()].m_Start + vEvents[vStack.back()].m_Duration <= Event.m_Start || vEvents[vStack.back()].m_Depth >= Event.m_Depth))
+				vStack.pop_back();
+			if(vStack.empty())
+			{
+				vPaths[i] = Event.m_pName;
+			}
+			else
+			{
+				vPaths[i] = vPaths[vStack.back()] + ";" + Event.m_pName;
+				vNestedDurations[vStack.back()] += Event.m_Duration;
+			}
+			vStack.push_back(i);
+		}
+		for(size_t i = 0; i < vEvents.size(); i++)
+		{
+			CPathData &Data = Paths[vPaths[i]];
+			Data.m_vDurations.push_back(vEvents[i].m_Duration);
+			Data.m_Self += vEvents[i].m_Duration - vNestedDurations[i];
+		}
+	}
+
+	std::vector<CPathStats> vStats;
+	for(auto &[Path, Data] : Paths)
+	{
+		std::vector<int64_t> &vDurations = Data.m_vDurations;
+		CPathStats &Stats = vStats.emplace_back();
+		Stats.m_Path = Path;
+		Stats.m_Count = vDurations.size();
+		Stats.m_Self = Data.m_Self;
+		Stats.m_Total = 0;
+		for(int64_t Duration : vDurations)
+			Stats.m_Total += Duration;
+		std::sort(vDurations.begin(), vDurations.end());
+		Stats.m_Median = vDurations[vDurations.size() / 2];
+		Stats.m_P99 = vDurations[std::min(vDurations.size() - 1, vDurations.size() * 99 / 100)];
+		Stats.m_Max = vDurations.back();
+	}
+	return vStats;
+}
+
+void CProfiler::WriteChromeTrace(IOHANDLE File, const std::vector<CThreadEvents> &vThreads)
+{
+	int64_t FirstStart = INT64_MAX;
+	for(const CThreadEvents &Thread : vThreads)
+	{
+		if(!Thread.m_vEvents.empty())
+			FirstStart = std::min(FirstStart, Thread.m_vEvents.front().m_Start);
+	}
+
+	const char *pHeader = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	io_write(File, pHeader, str_length(pHeader));
+	bool First = true;
+	for(const CThreadEvents &Thread : vThreads)
+	{
+		for(const CEvent &Event : Thread.m_vEvents)
+		{
+			char aName[128];
+			char *pDst = aName;
+			str_escape(&pDst, Event.m_pName, aName + sizeof(aName));
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				First ? "" : ",", aName, Thread.m_Thread, (Event.m_Start - FirstStart) / 1000.0, Event.m_Duration / 1000.0);
+			io_write(File, aBuf, str_length(aBuf));
+			First = false;
+		}
+	}
+	io_write(File, "\n]}", 3);
+	io_write_newline(File);
+}
+
+void CProfiler::WriteFoldedStacks(IOHANDLE File, const std::vector<CPathStats> &vStats)
+{
+	for(const CPathStats &Stats : vStats)
+	{
+		const int64_t Self = Stats.m_Self / 1000;
+		if(Self <= 0)
+			continue;
+		char aSelf[32];
+		str_format(aSelf, sizeof(aSelf), " %lld", (long long)Self);
+		io_write(File, Stats.m_Path.c_str(), Stats.m_Path.size());
+		io_write(File, aSelf, str_length(aSelf));
+		io_write_newline(File);
+	}
+}
+
+void CProfiler::ConProfilerStart(IConsole::IResult *pResult, void *pUser)
+{
+	CProfiler *pSelf = static_cast<CProfiler *>(pUser);
+	Start();
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", "Started recording");
+}
+
+void CProfiler::ConProfilerStop(IConsole::IResult *pResult, void *pUser)
+{
+	CProfiler *pSelf = static_cast<CProfiler *>(pUser);
+	Stop();
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", "Stopped recording");
+}
+
+void CProfiler::ConProfilerSummary(IConsole::IResult *pResult, void *pUser)
+{
+	CProfiler *pSelf = static_cast<CProfiler *>(pUser);
+	const std::vector<CPathStats> vStats = Summarize(Events());
+	if(vStats.empty())
+	{
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", "No scopes recorded, use profiler_start");
+		return;
+	}
+	for(const CPathStats &Stats : vStats)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "%s: count=%d median=%.1fus p99=%.1fus max=%.1fus total=%.1fms self=%.1fms",
+			Stats.m_Path.c_str(), Stats.m_Count, Stats.m_Median / 1e3, Stats.m_P99 / 1e3, Stats.m_Max / 1e3, Stats.m_Total / 1e6, Stats.m_Self / 1e6);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+	}
+}
+
+void CProfiler::ConProfilerDump(IConsole::IResult *pResult, void *pUser)
+{
+	CProfiler *pSelf = static_cast<CProfiler *>(pUser);
+
+	char aName[IO_MAX_PATH_LENGTH];
+	if(pResult->NumArguments())
+	{
+		str_copy(aName, pResult->GetString(0));
+	}
+	else
+	{
+		char aTimestamp[20];
+		str_timestamp(aTimestamp, sizeof(aTimestamp));
+		str_format(aName, sizeof(aName), "profile_%s", aTimestamp);
+	}
+
+	const std::vector<CThreadEvents> vThreads = Events();
+	pSelf->Storage()->CreateFolder("profiles", IStorage::TYPE_SAVE);
+	char aBuf[IO_MAX_PATH_LENGTH + 64];
+	for(const char *pExtension : {"json", "folded"})
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "profiles/%s.%s", aName, pExtension);
+		IOHANDLE File = pSelf->Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!File)
+		{
+			str_format(aBuf, sizeof(aBuf), "Failed to open '%s' for writing", aFilename);
+			pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+			return;
+		}
+		if(str_comp(pExtension, "json") == 0)
+			WriteChromeTrace(File, vThreads);
+		else
+			WriteFoldedStacks(File, Summarize(vThreads));
+		io_close(File);
+		str_format(aBuf, sizeof(aBuf), "Saved '%s'", aFilename);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+	}
+}
@@ -0,0 +1,117 @@
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/types.h>
+
+#include <engine/console.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class IStorage;
+
+// Scoped timers for finding out where the time of a tick or frame is spent.
+// While the profiler is running, every `CProfileScope` is recorded into a ring
+// buffer of the thread it ends on. Otherwise a scope only costs a relaxed
+// atomic load. Scopes nest, each scope is reported under the path of the
+// scopes enclosing it on the same thread, e.g. "tick;game;world;character".
+class CProfiler
+{
+public:
+	// number of scopes kept per thread, older ones are overwritten
+	static constexpr int MAX_EVENTS = 1 << 18;
+
+	class CEvent
+	{
+	public:
+		const char *m_pName;
+		int64_t m_Start;
+		int64_t m_Duration;
+		int m_Depth;
+	};
+
+	class CThreadEvents
+	{
+	public:
+		int m_Thread;
+		// sorted by start time
+		std::vector<CEvent> m_vEvents;
+	};
+
+	class CPathStats
+	{
+	public:
+		std::string m_Path;
+		int m_Count;
+		// nanoseconds, self time excludes the time spent in nested scopes
+		int64_t m_Total;
+		int64_t m_Self;
+		int64_t m_Median;
+		int64_t m_P99;
+		int64_t m_Max;
+	};
+
+	void Init(IConsole *pConsole, IStorage *pStorage);
+
+	static bool Running() { return ms_Running.load(std::memory_order_relaxed); }
+	// Discards all recorded scopes and starts recording.
+	static void Start();
+	static void Stop();
+
+	// Used by `CProfileScope`. Names must stay valid until the profiler is
+	// restarted, so they should be string literals.
+	static int64_t BeginScope();
+	static void EndScope(const char *pName, int64_t Start);
+
+	// Copies the scopes recorded so far that started at or after Since, in
+	// nanoseconds like `time_get_nanoseconds`.
+	static std::vector<CThreadEvents> Events(int64_t Since = 0);
+	// Sorted by path.
+	static std::vector<CPathStats> Summarize(const std::vector<CThreadEvents> &vThreads);
+	// Trace event format, can be loaded in chrome://tracing or Perfetto.
+	static void WriteChromeTrace(IOHANDLE File, const std::vector<CThreadEvents> &vThreads);
+	// One line per path with its self time in microseconds, as used by
+	// flamegraph.pl and speedscope.
+	static void WriteFoldedStacks(IOHANDLE File, const std::vector<CPathStats> &vStats);
+
+private:
+	static std::atomic<bool> ms_Running;
+
+	IConsole *m_pConsole = nullptr;
+	IStorage *m_pStorage = nullptr;
+
+	IConsole *Console() const { return m_pConsole; }
+	IStorage *Storage() const { return m_pStorage; }
+
+	static void ConProfilerStart(IConsole::IResult *pResult, void *pUser);
+	static void ConProfilerStop(IConsole::IResult *pResult, void *pUser);
+	static void ConProfilerSummary(IConsole::IResult *pResult, void *pUser);
+	static void ConProfilerDump(IConsole::IResult *pResult, void *pUser);
+};
+
+class CProfileScope
+{
+	const char *m_pName;
+	int64_t m_Start;
+
+public:
+	CProfileScope(const char *pName) :
+		m_pName(CProfiler::Running() ? pName : nullptr)
+	{
+		if(m_pName)
+			m_Start = CProfiler::BeginScope();
+	}
+
+	~CProfileScope()
+	{
+		if(m_pName)
+			CProfiler::EndScope(m_pName, m_Start);
+	}
+
+	CProfileScope(const CProfileScope &) = delete;
+	CProfileScope &operator=(const CProfileScope &) = delete;
+};
+
+#endif
@@ -75,6 +75,12 @@ enum
 	NUM_NETMSGS,
 };
 
+// number of client slots of the server, can be raised up to MAX_CLIENTS with the SERVER_MAX_CLIENTS build option.
+// MAX_CLIENTS itself is part of the protocol, clients reject client ids above it.
+#ifndef CONF_SERVER_MAX_CLIENTS
+#define CONF_SERVER_MAX_CLIENTS 64
+#endif
+
 // this should be revised
 enum
 {
@@ -88,7 +94,9 @@ enum
 	SERVERINFO_MAX_CLIENTS = 128,
 	MAX_CLIENTS = 128,
 	VANILLA_MAX_CLIENTS = 16,
-	SERVER_MAX_CLIENTS = 64,
+	// 0.7 clients can only address this many client ids
+	SIXUP_MAX_CLIENTS = 64,
+	SERVER_MAX_CLIENTS = CONF_SERVER_MAX_CLIENTS,
 	MAX_CHECKPOINTS = 25,
 	MIN_TICK = 0,
 	MAX_TICK = 0x6FFFFFFF,
@@ -123,6 +131,8 @@ enum
 	MSGFLAG_NOSEND = 1 << 4,
 };
 
+static_assert(SERVER_MAX_CLIENTS >= 1 && SERVER_MAX_CLIENTS <= MAX_CLIENTS, "SERVER_MAX_CLIENTS must be between 1 and MAX_CLIENTS");
+
 enum
 {
 	VERSION_NONE = -1,
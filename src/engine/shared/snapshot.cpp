@@ -603,6 +603,79 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshotBuffer *pTo, co
 	return Builder.Finish(pTo);
 }
 
+// CSnapshotPool
+
+static uint64_t HashSnapshotData(const void *pData, size_t DataSize)
+{
+	// four independent lanes to not be limited by the latency of the multiplications
+	static const uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	uint64_t aHash[4] = {DataSize, 1, 2, 3};
+	size_t i = 0;
+	for(; i + 32 <= DataSize; i += 32)
+	{
+		uint64_t aWords[4];
+		mem_copy(aWords, pBytes + i, sizeof(aWords));
+		for(int Lane = 0; Lane < 4; Lane++)
+			aHash[Lane] = (aHash[Lane] ^ aWords[Lane]) * PRIME;
+	}
+	uint64_t Hash = aHash[0] ^ (aHash[1] >> 7) ^ (aHash[2] >> 15) ^ (aHash[3] >> 23);
+	for(; i < DataSize; i++)
+		Hash = (Hash ^ pBytes[i]) * PRIME;
+	return Hash ^ (Hash >> 32);
+}
+
+CSnapshotPool::~CSnapshotPool()
+{
+	dbg_assert(m_Entries.empty(), "Snapshot pool destroyed while snapshots are still in use");
+}
+
+CSnapshot *CSnapshotPool::Acquire(const void *pData, size_t DataSize)
+{
+	dbg_assert(DataSize <= (size_t)CSnapshot::MAX_SIZE, "Snapshot data size invalid");
+
+	const uint64_t Hash = HashSnapshotData(pData, DataSize);
+	const auto [Begin, End] = m_Entries.equal_range(Hash);
+	for(auto It = Begin; It != End; ++It)
+	{
+		CEntry *pEntry = It->second;
+		if((size_t)pEntry->m_Size == DataSize && mem_comp(pEntry->Snapshot(), pData, DataSize) == 0)
+		{
+			pEntry->m_Refcount++;
+			return pEntry->Snapshot();
+		}
+	}
+
+	CEntry *pEntry = static_cast<CEntry *>(malloc(sizeof(CEntry) + DataSize));
+	pEntry->m_Hash = Hash;
+	pEntry->m_Size = DataSize;
+	pEntry->m_Refcount = 1;
+	mem_copy(pEntry->Snapshot(), pData, DataSize);
+	m_Entries.emplace(Hash, pEntry);
+	m_MemoryUsage += DataSize;
+	return pEntry->Snapshot();
+}
+
+void CSnapshotPool::Release(CSnapshot *pSnapshot)
+{
+	CEntry *pEntry = (CEntry *)pSnapshot - 1;
+	dbg_assert(pEntry->m_Refcount > 0, "Snapshot released too often");
+	if(--pEntry->m_Refcount > 0)
+		return;
+
+	const auto [Begin, End] = m_Entries.equal_range(pEntry->m_Hash);
+	for(auto It = Begin; It != End; ++It)
+	{
+		if(It->second == pEntry)
+		{
+			m_Entries.erase(It);
+			break;
+		}
+	}
+	m_MemoryUsage -= pEntry->m_Size;
+	free(pEntry);
+}
+
 // CSnapshotStorage
 
 void CSnapshotStorage::Init()
@@ -611,14 +684,28 @@ void CSnapshotStorage::Init()
 	m_pLast = nullptr;
 }
 
+void CSnapshotStorage::SetPool(CSnapshotPool *pPool)
+{
+	dbg_assert(!m_pFirst, "Snapshot storage must be empty to change the pool");
+	m_pPool = pPool;
+}
+
+void CSnapshotStorage::Free(CHolder *pHolder)
+{
+	if(m_pPool)
+		m_pPool->Release(pHolder->m_pSnap);
+	else
+		free(pHolder->m_pSnap);
+	free(pHolder->m_pAltSnap);
+	free(pHolder);
+}
+
 void CSnapshotStorage::PurgeAll()
 {
 	while(m_pFirst)
 	{
 		CHolder *pNext = m_pFirst->m_pNext;
-		free(m_pFirst->m_pSnap);
-		free(m_pFirst->m_pAltSnap);
-		free(m_pFirst);
+		Free(m_pFirst);
 		m_pFirst = pNext;
 	}
 	m_pLast = nullptr;
@@ -633,9 +720,7 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 		CHolder *pNext = pHolder->m_pNext;
 		if(pHolder->m_Tick >= Tick)
 			return; // no more to remove
-		free(pHolder->m_pSnap);
-		free(pHolder->m_pAltSnap);
-		free(pHolder);
+		Free(pHolder);
 
 		// did we come to the end of the list?
 		if(!pNext)
@@ -660,8 +745,13 @@ void CSnapshotStorage::Add(int Tick, int64_t Tagtime, size_t DataSize, const voi
 	pHolder->m_Tick = Tick;
 	pHolder->m_Tagtime = Tagtime;
 
-	pHolder->m_pSnap = static_cast<CSnapshot *>(malloc(DataSize));
-	mem_copy(pHolder->m_pSnap, pData, DataSize);
+	if(m_pPool)
+		pHolder->m_pSnap = m_pPool->Acquire(pData, DataSize);
+	else
+	{
+		pHolder->m_pSnap = static_cast<CSnapshot *>(malloc(DataSize));
+		mem_copy(pHolder->m_pSnap, pData, DataSize);
+	}
 	pHolder->m_SnapSize = DataSize;
 
 	if(AltDataSize) // create alternative if wanted
@@ -8,6 +8,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <unordered_map>
 
 // CSnapshot
 
@@ -120,6 +121,35 @@ public:
 	int DebugDumpDelta(const void *pSrcData, int DataSize);
 };
 
+// CSnapshotPool
+
+// Stores identical snapshots only once, so that snapshot storages can share their memory.
+class CSnapshotPool
+{
+	class CEntry
+	{
+	public:
+		uint64_t m_Hash;
+		int m_Size;
+		int m_Refcount;
+
+		CSnapshot *Snapshot() { return (CSnapshot *)(this + 1); }
+	};
+
+	std::unordered_multimap<uint64_t, CEntry *> m_Entries;
+	size_t m_MemoryUsage = 0;
+
+public:
+	~CSnapshotPool();
+
+	// returns a reference counted copy of the snapshot, which must be released again
+	CSnapshot *Acquire(const void *pData, size_t DataSize);
+	void Release(CSnapshot *pSnapshot);
+
+	int NumSnapshots() const { return m_Entries.size(); }
+	size_t MemoryUsage() const { return m_MemoryUsage; }
+};
+
 // CSnapshotStorage
 
 class CSnapshotStorage
@@ -144,9 +174,17 @@ public:
 	CHolder *m_pFirst;
 	CHolder *m_pLast;
 
+private:
+	CSnapshotPool *m_pPool = nullptr;
+
+	void Free(CHolder *pHolder);
+
+public:
 	CSnapshotStorage() { Init(); }
 	~CSnapshotStorage() { PurgeAll(); }
 	void Init();
+	// store the snapshots in the pool to share identical ones with other storages
+	void SetPool(CSnapshotPool *pPool);
 	void PurgeAll();
 	void PurgeUntil(int Tick);
 	void Add(int Tick, int64_t Tagtime, size_t DataSize, const void *pData, size_t AltDataSize, const void *pAltData);
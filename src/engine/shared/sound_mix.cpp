@@ -0,0 +1,93 @@
+#include "sound_mix.h"
+
+#include <base/detect.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#if defined(CONF_ARCH_AMD64) || defined(__SSE2__)
+#define SOUND_MIX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(SOUND_MIX_SSE2)
+// Multiplies eight 16 bit samples with the volumes and adds the 32 bit products to the four stereo frames at pOut.
+static inline void AccumulateFrames(int *pOut, __m128i In, __m128i Volume)
+{
+	// the volumes fit into 16 bits, so the low and high halves of the products give the exact result
+	const __m128i ProductLow = _mm_mullo_epi16(In, Volume);
+	const __m128i ProductHigh = _mm_mulhi_epi16(In, Volume);
+	__m128i *pOut0 = (__m128i *)pOut;
+	__m128i *pOut1 = (__m128i *)(pOut + 4);
+	_mm_storeu_si128(pOut0, _mm_add_epi32(_mm_loadu_si128(pOut0), _mm_unpacklo_epi16(ProductLow, ProductHigh)));
+	_mm_storeu_si128(pOut1, _mm_add_epi32(_mm_loadu_si128(pOut1), _mm_unpackhi_epi16(ProductLow, ProductHigh)));
+}
+
+static inline __m128i ScaleSamples(__m128i In, __m128d MasterVolume, __m128d Divisor)
+{
+	// The products are exact in double precision and the quotient is never close enough
+	// to the next integer to round over it, so this matches the integer division.
+	__m128d Low = _mm_cvtepi32_pd(In);
+	__m128d High = _mm_cvtepi32_pd(_mm_shuffle_epi32(In, _MM_SHUFFLE(1, 0, 3, 2)));
+	Low = _mm_div_pd(_mm_mul_pd(Low, MasterVolume), Divisor);
+	High = _mm_div_pd(_mm_mul_pd(High, MasterVolume), Divisor);
+	return _mm_srai_epi32(_mm_unpacklo_epi64(_mm_cvttpd_epi32(Low), _mm_cvttpd_epi32(High)), 8);
+}
+#endif
+
+void CSoundMix::AccumulateMono(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIX_SSE2)
+	const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+	for(; i + 8 <= Frames; i += 8)
+	{
+		const __m128i In = _mm_loadu_si128((const __m128i *)(pIn + i));
+		AccumulateFrames(pOut + i * 2, _mm_unpacklo_epi16(In, In), Volume);
+		AccumulateFrames(pOut + i * 2 + 8, _mm_unpackhi_epi16(In, In), Volume);
+	}
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[i * 2] += pIn[i] * VolumeL;
+		pOut[i * 2 + 1] += pIn[i] * VolumeR;
+	}
+}
+
+void CSoundMix::AccumulateStereo(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIX_SSE2)
+	const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+	for(; i + 4 <= Frames; i += 4)
+	{
+		AccumulateFrames(pOut + i * 2, _mm_loadu_si128((const __m128i *)(pIn + i * 2)), Volume);
+	}
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[i * 2] += pIn[i * 2] * VolumeL;
+		pOut[i * 2 + 1] += pIn[i * 2 + 1] * VolumeR;
+	}
+}
+
+void CSoundMix::Clamp(short *pOut, const int *pIn, unsigned Samples, int MasterVolume)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIX_SSE2)
+	const __m128d Volume = _mm_set1_pd(MasterVolume);
+	const __m128d Divisor = _mm_set1_pd(101.0);
+	for(; i + 8 <= Samples; i += 8)
+	{
+		const __m128i Low = ScaleSamples(_mm_loadu_si128((const __m128i *)(pIn + i)), Volume, Divisor);
+		const __m128i High = ScaleSamples(_mm_loadu_si128((const __m128i *)(pIn + i + 4)), Volume, Divisor);
+		// saturating pack does the clamping
+		_mm_storeu_si128((__m128i *)(pOut + i), _mm_packs_epi32(Low, High));
+	}
+#endif
+	for(; i < Samples; i++)
+	{
+		pOut[i] = std::clamp<int64_t>(((pIn[i] * (int64_t)MasterVolume) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	}
+}
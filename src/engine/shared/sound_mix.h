@@ -0,0 +1,16 @@
+#ifndef ENGINE_SHARED_SOUND_MIX_H
+#define ENGINE_SHARED_SOUND_MIX_H
+
+// kernels of the sound mixer, working on interleaved stereo frames
+class CSoundMix
+{
+public:
+	// Adds a mono source to both channels of the mix buffer, volumes must be in [0, 255].
+	static void AccumulateMono(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR);
+	// Adds an interleaved stereo source to the mix buffer, volumes must be in [0, 255].
+	static void AccumulateStereo(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR);
+	// Scales the mix buffer by the master volume in [0, 100] and clamps it to 16 bit samples.
+	static void Clamp(short *pOut, const int *pIn, unsigned Samples, int MasterVolume);
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <base/str.h>
 
 #include <engine/client/updater.h>
+#include <engine/shared/directory_index.h>
 #include <engine/shared/linereader.h>
 #include <engine/storage.h>
 
@@ -29,6 +30,7 @@ class CStorage : public IStorage
 	char m_aDatadir[IO_MAX_PATH_LENGTH] = "";
 	char m_aCurrentdir[IO_MAX_PATH_LENGTH] = "";
 	char m_aBinarydir[IO_MAX_PATH_LENGTH] = "";
+	CDirectoryIndex m_DirectoryIndex;
 
 public:
 	bool Init(EInitializationType InitializationType, int NumArgs, const char **ppArguments)
@@ -461,6 +463,16 @@ public:
 		return 0;
 	}
 
+	void ListIndexedDirectory(const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, int Type, void *pUser)
+	{
+		// the entries are copied, so callbacks can use the storage themselves
+		for(const CDirectoryIndex::CEntry &Entry : m_DirectoryIndex.ListDirectory(pPath))
+		{
+			if(pfnCallback(Entry.m_Name.c_str(), Entry.m_IsDir, Type, pUser))
+				break;
+		}
+	}
+
 	void ListDirectory(int Type, const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, void *pUser) override
 	{
 		char aBuffer[IO_MAX_PATH_LENGTH];
@@ -471,12 +483,12 @@ public:
 			Data.m_pDelegateUser = pUser;
 			// list all available directories
 			for(int i = TYPE_SAVE; i < m_NumPaths; ++i)
-				fs_listdir(GetPath(i, pPath, aBuffer, sizeof(aBuffer)), ListDirectoryUniqueCallback, i, &Data);
+				ListIndexedDirectory(GetPath(i, pPath, aBuffer, sizeof(aBuffer)), ListDirectoryUniqueCallback, i, &Data);
 		}
 		else if(Type >= TYPE_SAVE && Type < m_NumPaths)
 		{
 			// list wanted directory
-			fs_listdir(GetPath(Type, pPath, aBuffer, sizeof(aBuffer)), pfnCallback, Type, pUser);
+			ListIndexedDirectory(GetPath(Type, pPath, aBuffer, sizeof(aBuffer)), pfnCallback, Type, pUser);
 		}
 		else
 		{
@@ -505,6 +517,15 @@ public:
 			Type = fs_is_relative_path(pPath) ? TYPE_ALL : TYPE_ABSOLUTE;
 	}
 
+	IOHANDLE OpenPath(const char *pPath, int Flags)
+	{
+		IOHANDLE Handle = io_open(pPath, Flags);
+		// opening for writing might have created the file
+		if(Handle && (Flags & (IOFLAG_WRITE | IOFLAG_APPEND)))
+			m_DirectoryIndex.Invalidate(pPath);
+		return Handle;
+	}
+
 	IOHANDLE OpenFile(const char *pFilename, int Flags, int Type, char *pBuffer = nullptr, int BufferSize = 0) override
 	{
 		TranslateType(Type, pFilename);
@@ -521,7 +542,7 @@ public:
 
 		if(Type == TYPE_ABSOLUTE)
 		{
-			return io_open(GetPath(TYPE_ABSOLUTE, pFilename, pBuffer, BufferSize), Flags);
+			return OpenPath(GetPath(TYPE_ABSOLUTE, pFilename, pBuffer, BufferSize), Flags);
 		}
 
 		if(str_startswith(pFilename, "mapres/../skins/"))
@@ -553,7 +574,7 @@ public:
 		else if(Type >= TYPE_SAVE && Type < m_NumPaths)
 		{
 			// check wanted directory
-			return io_open(GetPath(Type, pFilename, pBuffer, BufferSize), Flags);
+			return OpenPath(GetPath(Type, pFilename, pBuffer, BufferSize), Flags);
 		}
 		else
 		{
@@ -667,139 +688,65 @@ public:
 		return true;
 	}
 
-	struct CFindCBData
-	{
-		CStorage *m_pStorage;
-		const char *m_pFilename;
-		const char *m_pPath;
-		char *m_pBuffer;
-		int m_BufferSize;
-	};
-
-	static int FindFileCallback(const char *pName, int IsDir, int Type, void *pUser)
-	{
-		CFindCBData Data = *static_cast<CFindCBData *>(pUser);
-		if(IsDir)
-		{
-			if(pName[0] == '.')
-				return 0;
-
-			// search within the folder
-			char aBuf[IO_MAX_PATH_LENGTH];
-			char aPath[IO_MAX_PATH_LENGTH];
-			str_format(aPath, sizeof(aPath), "%s/%s", Data.m_pPath, pName);
-			Data.m_pPath = aPath;
-			fs_listdir(Data.m_pStorage->GetPath(Type, aPath, aBuf, sizeof(aBuf)), FindFileCallback, Type, &Data);
-			if(Data.m_pBuffer[0])
-				return 1;
-		}
-		else if(!str_comp(pName, Data.m_pFilename))
-		{
-			// found the file = end
-			str_format(Data.m_pBuffer, Data.m_BufferSize, "%s/%s", Data.m_pPath, Data.m_pFilename);
-			return 1;
-		}
-
-		return 0;
-	}
-
 	bool FindFile(const char *pFilename, const char *pPath, int Type, char *pBuffer, int BufferSize) override
 	{
 		dbg_assert(BufferSize >= 1, "BufferSize invalid");
 
 		pBuffer[0] = 0;
 
-		CFindCBData Data;
-		Data.m_pStorage = this;
-		Data.m_pFilename = pFilename;
-		Data.m_pPath = pPath;
-		Data.m_pBuffer = pBuffer;
-		Data.m_BufferSize = BufferSize;
-
 		char aBuf[IO_MAX_PATH_LENGTH];
+		std::string Found;
 		if(Type == TYPE_ALL)
 		{
 			// search within all available directories
 			for(int i = TYPE_SAVE; i < m_NumPaths; ++i)
 			{
-				fs_listdir(GetPath(i, pPath, aBuf, sizeof(aBuf)), FindFileCallback, i, &Data);
-				if(pBuffer[0])
-					return true;
+				if(m_DirectoryIndex.FindFile(GetPath(i, pPath, aBuf, sizeof(aBuf)), pFilename, &Found))
+					break;
 			}
 		}
 		else if(Type >= TYPE_SAVE && Type < m_NumPaths)
 		{
 			// search within wanted directory
-			fs_listdir(GetPath(Type, pPath, aBuf, sizeof(aBuf)), FindFileCallback, Type, &Data);
+			m_DirectoryIndex.FindFile(GetPath(Type, pPath, aBuf, sizeof(aBuf)), pFilename, &Found);
 		}
 		else
 		{
 			dbg_assert_failed("Type invalid");
 		}
 
+		if(!Found.empty())
+			str_format(pBuffer, BufferSize, "%s/%s", pPath, Found.c_str());
 		return pBuffer[0] != 0;
 	}
 
-	struct SFindFilesCallbackData
-	{
-		CStorage *m_pStorage;
-		const char *m_pFilename;
-		const char *m_pPath;
-		std::set<std::string> *m_pEntries;
-	};
-
-	static int FindFilesCallback(const char *pName, int IsDir, int Type, void *pUser)
-	{
-		SFindFilesCallbackData Data = *static_cast<SFindFilesCallbackData *>(pUser);
-		if(IsDir)
-		{
-			if(pName[0] == '.')
-				return 0;
-
-			// search within the folder
-			char aBuf[IO_MAX_PATH_LENGTH];
-			char aPath[IO_MAX_PATH_LENGTH];
-			str_format(aPath, sizeof(aPath), "%s/%s", Data.m_pPath, pName);
-			Data.m_pPath = aPath;
-			fs_listdir(Data.m_pStorage->GetPath(Type, aPath, aBuf, sizeof(aBuf)), FindFilesCallback, Type, &Data);
-		}
-		else if(!str_comp(pName, Data.m_pFilename))
-		{
-			char aBuffer[IO_MAX_PATH_LENGTH];
-			str_format(aBuffer, sizeof(aBuffer), "%s/%s", Data.m_pPath, Data.m_pFilename);
-			Data.m_pEntries->emplace(aBuffer);
-		}
-
-		return 0;
-	}
-
 	size_t FindFiles(const char *pFilename, const char *pPath, int Type, std::set<std::string> *pEntries) override
 	{
-		SFindFilesCallbackData Data;
-		Data.m_pStorage = this;
-		Data.m_pFilename = pFilename;
-		Data.m_pPath = pPath;
-		Data.m_pEntries = pEntries;
-
 		char aBuf[IO_MAX_PATH_LENGTH];
+		std::vector<std::string> vFound;
 		if(Type == TYPE_ALL)
 		{
 			// search within all available directories
 			for(int i = TYPE_SAVE; i < m_NumPaths; ++i)
 			{
-				fs_listdir(GetPath(i, pPath, aBuf, sizeof(aBuf)), FindFilesCallback, i, &Data);
+				m_DirectoryIndex.FindFiles(GetPath(i, pPath, aBuf, sizeof(aBuf)), pFilename, &vFound);
 			}
 		}
 		else if(Type >= TYPE_SAVE && Type < m_NumPaths)
 		{
 			// search within wanted directory
-			fs_listdir(GetPath(Type, pPath, aBuf, sizeof(aBuf)), FindFilesCallback, Type, &Data);
+			m_DirectoryIndex.FindFiles(GetPath(Type, pPath, aBuf, sizeof(aBuf)), pFilename, &vFound);
 		}
 		else
 		{
 			dbg_assert_failed("Type invalid");
 		}
 
+		for(const std::string &Found : vFound)
+		{
+			str_format(aBuf, sizeof(aBuf), "%s/%s", pPath, Found.c_str());
+			pEntries->emplace(aBuf);
+		}
 		return pEntries->size();
 	}
 
@@ -810,7 +757,9 @@ public:
 		char aBuffer[IO_MAX_PATH_LENGTH];
 		GetPath(Type, pFilename, aBuffer, sizeof(aBuffer));
 
-		return fs_remove(aBuffer) == 0;
+		const bool Success = fs_remove(aBuffer) == 0;
+		m_DirectoryIndex.Invalidate(aBuffer);
+		return Success;
 	}
 
 	bool RemoveFolder(const char *pFilename, int Type) override
@@ -820,7 +769,9 @@ public:
 		char aBuffer[IO_MAX_PATH_LENGTH];
 		GetPath(Type, pFilename, aBuffer, sizeof(aBuffer));
 
-		return fs_removedir(aBuffer) == 0;
+		const bool Success = fs_removedir(aBuffer) == 0;
+		m_DirectoryIndex.Invalidate(aBuffer);
+		return Success;
 	}
 
 	bool RemoveBinaryFile(const char *pFilename) override
@@ -840,7 +791,10 @@ public:
 		GetPath(Type, pOldFilename, aOldBuffer, sizeof(aOldBuffer));
 		GetPath(Type, pNewFilename, aNewBuffer, sizeof(aNewBuffer));
 
-		return fs_rename(aOldBuffer, aNewBuffer) == 0;
+		const bool Success = fs_rename(aOldBuffer, aNewBuffer) == 0;
+		m_DirectoryIndex.Invalidate(aOldBuffer);
+		m_DirectoryIndex.Invalidate(aNewBuffer);
+		return Success;
 	}
 
 	bool RenameBinaryFile(const char *pOldFilename, const char *pNewFilename) override
@@ -866,7 +820,9 @@ public:
 		char aBuffer[IO_MAX_PATH_LENGTH];
 		GetPath(Type, pFoldername, aBuffer, sizeof(aBuffer));
 
-		return fs_makedir(aBuffer) == 0;
+		const bool Success = fs_makedir(aBuffer) == 0;
+		m_DirectoryIndex.Invalidate(aBuffer);
+		return Success;
 	}
 
 	void GetCompletePath(int Type, const char *pDir, char *pBuffer, unsigned BufferSize) override
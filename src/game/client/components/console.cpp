@@ -1730,6 +1730,7 @@ void CGameConsole::ConchainConsoleOutputLevel(IConsole::IResult *pResult, void *
 	if(pResult->NumArguments())
 	{
 		pSelf->m_pConsoleLogger->SetFilter(CLogFilter{IConsole::ToLogLevelFilter(g_Config.m_ConsoleOutputLevel)});
+		IConsole::UpdateLogMaxLevel();
 	}
 }
 
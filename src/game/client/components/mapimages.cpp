@@ -4,8 +4,10 @@
 
 #include <base/log.h>
 
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/map.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
 
@@ -16,6 +18,33 @@
 #include <game/localization.h>
 #include <game/mapitems.h>
 
+#include <thread>
+
+class CMapImageLoad
+{
+	IGraphics *m_pGraphics;
+
+public:
+	CMapImageLoad(IGraphics *pGraphics, int Index, int LoadFlag, const char *pPath) :
+		m_pGraphics(pGraphics),
+		m_Index(Index),
+		m_LoadFlag(LoadFlag)
+	{
+		str_copy(m_aPath, pPath);
+	}
+
+	void Load()
+	{
+		m_Success = m_pGraphics->LoadPng(m_Image, m_aPath, IStorage::TYPE_ALL);
+	}
+
+	int m_Index;
+	int m_LoadFlag;
+	char m_aPath[IO_MAX_PATH_LENGTH];
+	CImageInfo m_Image;
+	bool m_Success = false;
+};
+
 CMapImages::CMapImages()
 {
 	m_Count = 0;
@@ -97,6 +126,13 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 
 	const int TextureLoadFlag = Graphics()->Uses2DTextureArrays() ? IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE : IGraphics::TEXLOAD_TO_3D_TEXTURE;
 
+	// External images are decoded by engine jobs while the embedded images are
+	// read on this thread, because the map data can only be accessed here.
+	// Only the texture creation has to wait for the decoding to finish.
+	const bool LoadInJobs = std::thread::hardware_concurrency() > 1 && m_Count > 1;
+	CJobGroup LoadJobs;
+	std::vector<std::unique_ptr<CMapImageLoad>> vpLoads;
+
 	// load new textures
 	bool ShowWarning = false;
 	for(int i = 0; i < m_Count; i++)
@@ -144,7 +180,13 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 					!str_comp(pName, "easter");
 			}
 			str_format(aPath, sizeof(aPath), "mapres/%s%s.png", pName, Translated ? "_0.7" : "");
-			m_aTextures[i] = Graphics()->LoadTexture(aPath, IStorage::TYPE_ALL, LoadFlag);
+			CMapImageLoad *pLoad = vpLoads.emplace_back(std::make_unique<CMapImageLoad>(Graphics(), i, LoadFlag, aPath)).get();
+			if(LoadInJobs)
+				Engine()->AddJob(LoadJobs.Add("map image load", [pLoad] { pLoad->Load(); }));
+			else
+				pLoad->Load();
+			pMap->UnloadData(pImg->m_ImageName);
+			continue;
 		}
 		else
 		{
@@ -171,6 +213,18 @@ void CMapImages::OnMapLoadImpl(class CLayers *pLayers, IMap *pMap)
 		pMap->UnloadData(pImg->m_ImageName);
 		ShowWarning = ShowWarning || m_aTextures[i].IsNullTexture();
 	}
+
+	// decodes the images no worker has started yet on this thread
+	LoadJobs.Wait();
+	for(const std::unique_ptr<CMapImageLoad> &pLoad : vpLoads)
+	{
+		IGraphics::CTextureHandle Texture;
+		if(pLoad->m_Success)
+			Texture = Graphics()->LoadTextureRawMove(pLoad->m_Image, pLoad->m_LoadFlag, pLoad->m_aPath);
+		m_aTextures[pLoad->m_Index] = Texture.IsValid() ? Texture : Graphics()->NullTexture();
+		ShowWarning = ShowWarning || m_aTextures[pLoad->m_Index].IsNullTexture();
+	}
+
 	if(ShowWarning)
 	{
 		Client()->AddWarning(SWarning(Localize("Some map images could not be loaded. Check the local console for details.")));
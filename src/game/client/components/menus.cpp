@@ -2422,6 +2422,7 @@ void CMenus::OnReset()
 void CMenus::OnShutdown()
 {
 	m_CommunityIcons.Shutdown();
+	AbortDemoIndexing();
 }
 
 bool CMenus::OnCursorMove(float x, float y, IInput::ECursorType CursorType)
@@ -7,6 +7,7 @@
 #include <base/types.h>
 #include <base/vmath.h>
 
+#include <engine/client/demo_info_cache.h>
 #include <engine/console.h>
 #include <engine/demo.h>
 #include <engine/friends.h>
@@ -27,6 +28,7 @@
 
 #include <chrono>
 #include <deque>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -291,6 +293,7 @@ protected:
 
 		bool m_InfosLoaded;
 		bool m_Valid;
+		int m_IndexEntry;
 		CDemoHeader m_Info;
 		CTimelineMarkers m_TimelineMarkers;
 		CMapInfo m_MapInfo;
@@ -310,6 +313,15 @@ protected:
 			return bytes_be_to_uint(m_Info.m_aMapSize);
 		}
 
+		void ApplyInfo(const CDemoInfo &Info)
+		{
+			m_InfosLoaded = true;
+			m_Valid = Info.m_Valid;
+			m_Info = Info.m_Header;
+			m_TimelineMarkers = Info.m_TimelineMarkers;
+			m_MapInfo = Info.m_MapInfo;
+		}
+
 		bool operator<(const CDemoItem &Other) const
 		{
 			if(!str_comp(Other.m_aFilename, ".."))
@@ -361,6 +373,15 @@ protected:
 
 	std::chrono::nanoseconds m_DemoPopulateStartTime{0};
 
+	// demo infos are read from the cache or parsed in the background
+	class CDemoIndexJob;
+	std::shared_ptr<IDemoInfoCache> m_pDemoInfoCache;
+	std::shared_ptr<CDemoIndexJob> m_pDemoIndexJob;
+	bool m_DemoIndexNeedsResort = false;
+	void StartDemoIndexing();
+	void UpdateDemoIndexing();
+	void AbortDemoIndexing();
+
 	void DemolistOnUpdate(bool Reset);
 	static int DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser);
 
@@ -485,7 +506,6 @@ protected:
 	int m_SkipDurationIndex = DEFAULT_SKIP_DURATION_INDEX;
 	static bool DemoFilterChat(const void *pData, int Size, void *pUser);
 	bool FetchHeader(CDemoItem &Item);
-	void FetchAllHeaders();
 	void HandleDemoSeeking(float PositionToSeek, float TimeToSeek);
 	void RenderDemoPlayer(CUIRect MainView);
 	void RenderDemoPlayerSliceSavePopup(CUIRect MainView);
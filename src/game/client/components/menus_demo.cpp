@@ -7,15 +7,19 @@
 #include <base/fs.h>
 #include <base/hash.h>
 #include <base/io.h>
+#include <base/lock.h>
 #include <base/math.h>
 #include <base/str.h>
 #include <base/time.h>
 
 #include <engine/client.h>
+#include <engine/client/demo_info_cache.h>
 #include <engine/demo.h>
+#include <engine/engine.h>
 #include <engine/font_icons.h>
 #include <engine/graphics.h>
 #include <engine/keys.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/localization.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
@@ -29,9 +33,104 @@
 #include <game/localization.h>
 
 #include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace std::chrono_literals;
 
+// Looks the demo up in the cache and parses and caches it if it's missing or has
+// changed, unless ParseMissing is false. Returns whether the info is available.
+static bool LoadDemoInfo(IStorage *pStorage, const IDemoPlayer *pDemoPlayer, IDemoInfoCache *pCache, const char *pPath, int StorageType, int64_t Size, time_t TimeModified, bool ParseMissing, CDemoInfo *pInfo)
+{
+	char aCompletePath[IO_MAX_PATH_LENGTH];
+	pStorage->GetCompletePath(StorageType, pPath, aCompletePath, sizeof(aCompletePath));
+	if(pCache->Lookup(aCompletePath, Size, TimeModified, pInfo))
+		return true;
+	if(!ParseMissing)
+		return false;
+	pInfo->m_Valid = pDemoPlayer->GetDemoInfo(pStorage, nullptr, pPath, StorageType, &pInfo->m_Header, &pInfo->m_TimelineMarkers, &pInfo->m_MapInfo);
+	pCache->Store(aCompletePath, Size, TimeModified, *pInfo);
+	return true;
+}
+
+class CMenus::CDemoIndexJob : public IJob
+{
+public:
+	class CEntry
+	{
+	public:
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		int m_StorageType;
+		int64_t m_Size;
+		time_t m_TimeModified;
+	};
+
+	class CResult
+	{
+	public:
+		int m_Entry;
+		CDemoInfo m_Info;
+	};
+
+private:
+	IStorage *m_pStorage;
+	const IDemoPlayer *m_pDemoPlayer;
+	std::shared_ptr<IDemoInfoCache> m_pCache;
+	bool m_ParseMissing;
+	std::vector<CEntry> m_vEntries;
+	// complete paths of the listed folders and of all demos in them
+	std::vector<std::string> m_vListedFolders;
+	std::vector<std::string> m_vListedDemos;
+
+	CLock m_ResultsLock;
+	std::vector<CResult> m_vResults GUARDED_BY(m_ResultsLock);
+
+	void Run() override
+	{
+		// forget demos that have been deleted or renamed since they were cached
+		for(const std::string &Folder : m_vListedFolders)
+			m_pCache->Prune(Folder.c_str(), m_vListedDemos);
+
+		for(size_t i = 0; i < m_vEntries.size(); ++i)
+		{
+			if(State() == IJob::STATE_ABORTED)
+				return;
+
+			const CEntry &Entry = m_vEntries[i];
+			CResult Result;
+			Result.m_Entry = i;
+			if(!LoadDemoInfo(m_pStorage, m_pDemoPlayer, m_pCache.get(), Entry.m_aPath, Entry.m_StorageType, Entry.m_Size, Entry.m_TimeModified, m_ParseMissing, &Result.m_Info))
+				continue;
+
+			const CLockScope LockScope(m_ResultsLock);
+			m_vResults.push_back(Result);
+		}
+	}
+
+public:
+	CDemoIndexJob(IStorage *pStorage, const IDemoPlayer *pDemoPlayer, std::shared_ptr<IDemoInfoCache> pCache, bool ParseMissing, std::vector<CEntry> &&vEntries, std::vector<std::string> &&vListedFolders, std::vector<std::string> &&vListedDemos) :
+		m_pStorage(pStorage),
+		m_pDemoPlayer(pDemoPlayer),
+		m_pCache(std::move(pCache)),
+		m_ParseMissing(ParseMissing),
+		m_vEntries(std::move(vEntries)),
+		m_vListedFolders(std::move(vListedFolders)),
+		m_vListedDemos(std::move(vListedDemos))
+	{
+		Abortable(true);
+		SetPriority(PRIORITY_BACKGROUND);
+	}
+
+	int NumEntries() const { return m_vEntries.size(); }
+
+	void TakeResults(std::vector<CResult> &vResults)
+	{
+		const CLockScope LockScope(m_ResultsLock);
+		vResults.swap(m_vResults);
+	}
+};
+
 bool CMenus::DemoFilterChat(const void *pData, int Size, void *pUser)
 {
 	bool DoFilterChat = *(bool *)pUser;
@@ -941,8 +1040,10 @@ int CMenus::DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int Stora
 		str_truncate(Item.m_aName, sizeof(Item.m_aName), pInfo->m_pName, str_length(pInfo->m_pName) - str_length(".demo"));
 		Item.m_Date = pInfo->m_TimeModified;
 	}
+	Item.m_Size = IsDir ? 0 : pInfo->m_Size;
 	Item.m_InfosLoaded = false;
 	Item.m_Valid = false;
+	Item.m_IndexEntry = -1;
 	Item.m_IsDir = IsDir != 0;
 	Item.m_IsLink = false;
 	Item.m_StorageType = StorageType;
@@ -958,6 +1059,7 @@ int CMenus::DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int Stora
 
 void CMenus::DemolistPopulate()
 {
+	AbortDemoIndexing();
 	m_vDemos.clear();
 
 	int NumStoragesWithDemos = 0;
@@ -978,6 +1080,7 @@ void CMenus::DemolistPopulate()
 			str_copy(Item.m_aName, Localize("All combined"));
 			Item.m_InfosLoaded = false;
 			Item.m_Valid = false;
+			Item.m_IndexEntry = -1;
 			Item.m_Date = 0;
 			Item.m_IsDir = true;
 			Item.m_IsLink = true;
@@ -995,6 +1098,7 @@ void CMenus::DemolistPopulate()
 				str_append(Item.m_aName, "/", sizeof(Item.m_aName));
 				Item.m_InfosLoaded = false;
 				Item.m_Valid = false;
+				Item.m_IndexEntry = -1;
 				Item.m_Date = 0;
 				Item.m_IsDir = true;
 				Item.m_IsLink = true;
@@ -1007,15 +1111,98 @@ void CMenus::DemolistPopulate()
 	{
 		m_DemoPopulateStartTime = time_get_nanoseconds();
 		Storage()->ListDirectoryInfo(m_DemolistStorageType, m_aCurrentDemoFolder, DemolistFetchCallback, this);
-
-		if(g_Config.m_BrDemoFetchInfo)
-			FetchAllHeaders();
-
 		std::stable_sort(m_vDemos.begin(), m_vDemos.end());
+		StartDemoIndexing();
 	}
 	RefreshFilteredDemos();
 }
 
+void CMenus::StartDemoIndexing()
+{
+	if(!m_pDemoInfoCache)
+		m_pDemoInfoCache = std::shared_ptr<IDemoInfoCache>(CreateDemoInfoCache(Console(), Storage()));
+
+	std::vector<CDemoIndexJob::CEntry> vEntries;
+	std::vector<std::string> vListedDemos;
+	for(auto &Item : m_vDemos)
+	{
+		Item.m_IndexEntry = -1;
+		if(Item.m_IsDir)
+			continue;
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "%s/%s", m_aCurrentDemoFolder, Item.m_aFilename);
+		char aCompletePath[IO_MAX_PATH_LENGTH];
+		Storage()->GetCompletePath(Item.m_StorageType, aPath, aCompletePath, sizeof(aCompletePath));
+		vListedDemos.emplace_back(aCompletePath);
+		if(Item.m_InfosLoaded)
+			continue;
+		Item.m_IndexEntry = vEntries.size();
+		CDemoIndexJob::CEntry &Entry = vEntries.emplace_back();
+		str_copy(Entry.m_aPath, aPath);
+		Entry.m_StorageType = Item.m_StorageType;
+		Entry.m_Size = Item.m_Size;
+		Entry.m_TimeModified = Item.m_Date;
+	}
+
+	std::vector<std::string> vListedFolders;
+	for(int StorageType = IStorage::TYPE_SAVE; StorageType < Storage()->NumPaths(); ++StorageType)
+	{
+		if(m_DemolistStorageType != IStorage::TYPE_ALL && m_DemolistStorageType != StorageType)
+			continue;
+		char aCompletePath[IO_MAX_PATH_LENGTH];
+		Storage()->GetCompletePath(StorageType, m_aCurrentDemoFolder, aCompletePath, sizeof(aCompletePath));
+		vListedFolders.emplace_back(aCompletePath);
+	}
+
+	// without auto fetching, only demos which are already cached are filled in
+	m_pDemoIndexJob = std::make_shared<CDemoIndexJob>(Storage(), DemoPlayer(), m_pDemoInfoCache, g_Config.m_BrDemoFetchInfo != 0, std::move(vEntries), std::move(vListedFolders), std::move(vListedDemos));
+	m_DemoIndexNeedsResort = false;
+	Engine()->AddJob(m_pDemoIndexJob);
+}
+
+void CMenus::UpdateDemoIndexing()
+{
+	if(!m_pDemoIndexJob)
+		return;
+
+	// check before taking the results, so none can be missed when the job is done
+	const bool Done = m_pDemoIndexJob->Done();
+	std::vector<CDemoIndexJob::CResult> vResults;
+	m_pDemoIndexJob->TakeResults(vResults);
+	if(!vResults.empty())
+	{
+		std::vector<const CDemoInfo *> vpInfos(m_pDemoIndexJob->NumEntries(), nullptr);
+		for(const auto &Result : vResults)
+			vpInfos[Result.m_Entry] = &Result.m_Info;
+		for(auto &Item : m_vDemos)
+		{
+			if(Item.m_IndexEntry >= 0 && !Item.m_InfosLoaded && vpInfos[Item.m_IndexEntry] != nullptr)
+				Item.ApplyInfo(*vpInfos[Item.m_IndexEntry]);
+		}
+		m_DemoIndexNeedsResort = true;
+	}
+
+	if(Done)
+	{
+		m_pDemoIndexJob = nullptr;
+		// resort once instead of every time results arrive
+		if(m_DemoIndexNeedsResort && (g_Config.m_BrDemoSort == SORT_MARKERS || g_Config.m_BrDemoSort == SORT_LENGTH))
+		{
+			std::stable_sort(m_vDemos.begin(), m_vDemos.end());
+			DemolistOnUpdate(false);
+		}
+	}
+}
+
+void CMenus::AbortDemoIndexing()
+{
+	if(m_pDemoIndexJob)
+	{
+		m_pDemoIndexJob->Abort();
+		m_pDemoIndexJob = nullptr;
+	}
+}
+
 void CMenus::RefreshFilteredDemos()
 {
 	m_vpFilteredDemos.clear();
@@ -1069,30 +1256,18 @@ bool CMenus::FetchHeader(CDemoItem &Item)
 {
 	if(!Item.m_InfosLoaded)
 	{
+		if(!m_pDemoInfoCache)
+			m_pDemoInfoCache = std::shared_ptr<IDemoInfoCache>(CreateDemoInfoCache(Console(), Storage()));
+
 		char aBuffer[IO_MAX_PATH_LENGTH];
 		str_format(aBuffer, sizeof(aBuffer), "%s/%s", m_aCurrentDemoFolder, Item.m_aFilename);
-		IOHANDLE File;
-		Item.m_Valid = DemoPlayer()->GetDemoInfo(Storage(), nullptr, aBuffer, Item.m_StorageType, &Item.m_Info, &Item.m_TimelineMarkers, &Item.m_MapInfo, &File);
-		Item.m_InfosLoaded = true;
-
-		if(Item.m_Valid && File)
-		{
-			Item.m_Size = io_length(File);
-			io_close(File);
-		}
+		CDemoInfo Info;
+		LoadDemoInfo(Storage(), DemoPlayer(), m_pDemoInfoCache.get(), aBuffer, Item.m_StorageType, Item.m_Size, Item.m_Date, true, &Info);
+		Item.ApplyInfo(Info);
 	}
 	return Item.m_Valid;
 }
 
-void CMenus::FetchAllHeaders()
-{
-	for(auto &Item : m_vDemos)
-	{
-		FetchHeader(Item);
-	}
-	std::stable_sort(m_vDemos.begin(), m_vDemos.end());
-}
-
 void CMenus::RenderDemoBrowser(CUIRect MainView)
 {
 	GameClient()->m_MenuBackground.ChangePosition(CMenuBackground::POS_DEMOS);
@@ -1118,6 +1293,7 @@ void CMenus::RenderDemoBrowserList(CUIRect ListView, bool &WasListboxItemActivat
 		DemolistOnUpdate(true);
 		m_DemoBrowserListInitialized = true;
 	}
+	UpdateDemoIndexing();
 
 #if defined(CONF_VIDEORECORDER)
 	if(!m_DemoRenderInput.IsEmpty())
@@ -1504,7 +1680,10 @@ void CMenus::RenderDemoBrowserButtons(CUIRect ButtonsView, bool WasListboxItemAc
 		{
 			g_Config.m_BrDemoFetchInfo ^= 1;
 			if(g_Config.m_BrDemoFetchInfo)
-				FetchAllHeaders();
+			{
+				AbortDemoIndexing();
+				StartDemoIndexing();
+			}
 		}
 	}
 
@@ -21,6 +21,7 @@ CSoundLoading::CSoundLoading(CGameClient *pGameClient, bool Render) :
 	m_Render(Render)
 {
 	Abortable(true);
+	SetPriority(PRIORITY_BACKGROUND);
 }
 
 void CSoundLoading::Run()
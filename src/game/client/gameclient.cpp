@@ -65,6 +65,7 @@
 #include <engine/serverbrowser.h>
 #include <engine/shared/config.h>
 #include <engine/shared/csv.h>
+#include <engine/shared/profiler.h>
 #include <engine/sound.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
@@ -84,9 +85,33 @@
 
 #include <chrono>
 #include <limits>
+#include <map>
+#include <typeinfo>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
 
 using namespace std::chrono_literals;
 
+static std::string ComponentName(const CComponent *pComponent)
+{
+	const char *pName = typeid(*pComponent).name();
+#if defined(__GNUC__)
+	int Status;
+	char *pDemangled = abi::__cxa_demangle(pName, nullptr, nullptr, &Status);
+	if(pDemangled)
+	{
+		std::string Name = pDemangled;
+		free(pDemangled);
+		return Name;
+	}
+#endif
+	// MSVC returns readable names prefixed by "class "
+	const char *pClass = str_startswith(pName, "class ");
+	return pClass ? pClass : pName;
+}
+
 const char *CGameClient::Version() const { return GAME_VERSION; }
 const char *CGameClient::NetVersion() const { return GAME_NETVERSION; }
 const char *CGameClient::NetVersion7() const { return GAME_NETVERSION7; }
@@ -182,6 +207,18 @@ void CGameClient::OnConsoleInit()
 						  &m_TouchControls,
 						  &m_Binds});
 
+	// names of the components for the profiler, e.g. "CMapLayers" and "CMapLayers#2"
+	std::map<std::string, int> NameCounts;
+	m_vComponentNames.clear();
+	for(const CComponent *pComponent : m_vpAll)
+	{
+		std::string Name = ComponentName(pComponent);
+		const int Count = ++NameCounts[Name];
+		if(Count > 1)
+			Name += "#" + std::to_string(Count);
+		m_vComponentNames.push_back(Name);
+	}
+
 	// initialize client data
 	for(int ClientId = 0; ClientId < MAX_CLIENTS; ClientId++)
 	{
@@ -313,6 +350,8 @@ void CGameClient::OnInit()
 	const int64_t OnInitStart = time_get();
 
 	Client()->SetLoadingCallback([this](IClient::ELoadingCallbackDetail Detail) {
+		m_MapLoadStartTime = time_get_nanoseconds();
+
 		const char *pTitle;
 		if(Detail == IClient::LOADING_CALLBACK_DETAIL_DEMO || DemoPlayer()->IsPlaying())
 		{
@@ -507,9 +546,10 @@ void CGameClient::OnUpdate()
 		m_Binds.m_MouseOnAction = false;
 	}
 
-	for(auto &pComponent : m_vpAll)
+	for(size_t i = 0; i < m_vpAll.size(); i++)
 	{
-		pComponent->OnUpdate();
+		const CProfileScope ComponentScope(m_vComponentNames[i].c_str());
+		m_vpAll[i]->OnUpdate();
 	}
 }
 
@@ -602,6 +642,9 @@ void CGameClient::OnConnected()
 	ConfigManager()->ResetGameSettings();
 	LoadMapSettings();
 
+	// the next frame is the first one that renders the map
+	log_debug("gameclient", "map ready for rendering %.2fms after loading started", std::chrono::duration<double, std::milli>(time_get_nanoseconds() - m_MapLoadStartTime).count());
+
 	if(Client()->State() != IClient::STATE_DEMOPLAYBACK)
 	{
 		Client()->SetLoadingStateDetail(IClient::LOADING_STATE_DETAIL_GETTING_READY);
@@ -840,8 +883,11 @@ void CGameClient::OnRender()
 	UpdateSpectatorCursor();
 
 	// render all systems
-	for(auto &pComponent : m_vpAll)
-		pComponent->OnRender();
+	for(size_t i = 0; i < m_vpAll.size(); i++)
+	{
+		const CProfileScope ComponentScope(m_vComponentNames[i].c_str());
+		m_vpAll[i]->OnRender();
+	}
 
 	// clear all events/input for this frame
 	Input()->Clear();
@@ -1724,6 +1770,8 @@ void CGameClient::InvalidateSnapshot()
 
 void CGameClient::OnNewSnapshot()
 {
+	const CProfileScope ProfileScope("new_snapshot");
+
 	auto &&Evolve = [this](CNetObj_Character *pCharacter, int Tick) {
 		CWorldCore TempWorld;
 		CCharacterCore TempCore = CCharacterCore();
@@ -2412,8 +2460,11 @@ void CGameClient::OnNewSnapshot()
 	m_LastFollowFactor = FollowFactor;
 	m_LastDummyConnected = Client()->DummyConnected();
 
-	for(auto &pComponent : m_vpAll)
-		pComponent->OnNewSnapshot();
+	for(size_t i = 0; i < m_vpAll.size(); i++)
+	{
+		const CProfileScope ComponentScope(m_vComponentNames[i].c_str());
+		m_vpAll[i]->OnNewSnapshot();
+	}
 
 	// notify editor when local character moved
 	UpdateEditorIngameMoved();
@@ -2595,6 +2646,8 @@ void CGameClient::ApplyPreInputs(int Tick, bool Direct, CGameWorld &GameWorld)
 
 void CGameClient::OnPredict()
 {
+	const CProfileScope ProfileScope("predict");
+
 	// store the previous values so we can detect prediction errors
 	CCharacterCore BeforePrevChar = m_PredictedPrevChar;
 	CCharacterCore BeforeChar = m_PredictedChar;
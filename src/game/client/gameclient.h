@@ -69,7 +69,9 @@
 #include "components/touch_controls.h"
 #include "components/voting.h"
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 class IMap;
@@ -193,6 +195,8 @@ public:
 
 private:
 	std::vector<class CComponent *> m_vpAll;
+	// parallel to m_vpAll, used as profiler scope names
+	std::vector<std::string> m_vComponentNames;
 	std::vector<class CComponent *> m_vpInput;
 	CNetObjHandler m_NetObjHandler;
 	protocol7::CNetObjHandler m_NetObjHandler7;
@@ -929,6 +933,7 @@ private:
 
 	void LoadMapSettings();
 	CMapBugs m_MapBugs;
+	std::chrono::nanoseconds m_MapLoadStartTime{0}; // time when the client started loading the map file, set by the loading callback
 
 	// tunings for every zone on the map, 0 is a global tune
 	CTuningParams m_aTuningList[TuneZone::NUM];
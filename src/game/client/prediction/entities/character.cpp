@@ -1147,7 +1147,8 @@ void CCharacter::DDRacePostCoreTick()
 	HandleSkippableTiles(CurrentIndex);
 
 	// handle Anti-Skip tiles
-	std::vector<int> vIndices = Collision()->GetMapIndices(m_PrevPos, m_Pos);
+	std::vector<int> &vIndices = GameWorld()->m_vMapIndices;
+	Collision()->GetMapIndices(m_PrevPos, m_Pos, vIndices);
 	if(!vIndices.empty())
 		for(int Index : vIndices)
 			HandleTiles(Index);
@@ -92,6 +92,9 @@ public:
 
 	int m_LocalClientId;
 
+	// reused for the tiles along the path of characters to avoid allocations
+	std::vector<int> m_vMapIndices;
+
 	bool IsLocalTeam(int OwnerId) const;
 	void OnModified() const;
 	void NetObjBegin(CTeamsCore Teams, int LocalClientId);
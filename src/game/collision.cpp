@@ -147,6 +147,18 @@ void CCollision::Init(class CLayers *pLayers)
 			}
 		}
 	}
+
+	m_vCollisionTiles.resize((size_t)m_Width * m_Height);
+	m_vMoveRestrictions.resize((size_t)m_Width * m_Height);
+	for(int i = 0; i < m_Width * m_Height; i++)
+		UpdateCompactTile(i);
+
+	m_vTileExistsMask.assign(((size_t)m_Width * m_Height + 63) / 64, 0);
+	for(int i = 0; i < m_Width * m_Height; i++)
+	{
+		if(CheckTileExists(i))
+			m_vTileExistsMask[i / 64] |= (uint64_t)1 << (i % 64);
+	}
 }
 
 void CCollision::Unload()
@@ -162,6 +174,9 @@ void CCollision::Unload()
 	m_TeleOuts.clear();
 	m_TeleCheckOuts.clear();
 	m_TeleOthers.clear();
+	m_vCollisionTiles.clear();
+	m_vMoveRestrictions.clear();
+	m_vTileExistsMask.clear();
 
 	m_pTele = nullptr;
 	m_pSpeedup = nullptr;
@@ -282,22 +297,12 @@ int CCollision::GetMoveRestrictions(CALLBACK_SWITCHACTIVE pfnSwitchActive, void
 		{
 			ModMapIndex = OverrideCenterTileIndex;
 		}
-		for(int Front = 0; Front < 2; Front++)
-		{
-			int Tile;
-			int Flags;
-			if(!Front)
-			{
-				Tile = GetTileIndex(ModMapIndex);
-				Flags = GetTileFlags(ModMapIndex);
-			}
-			else
-			{
-				Tile = GetFrontTileIndex(ModMapIndex);
-				Flags = GetFrontTileFlags(ModMapIndex);
-			}
-			Restrictions |= ::GetMoveRestrictions(d, Tile, Flags);
-		}
+		// same as ::GetMoveRestrictions for the game and front tile
+		const int TileRestrictions = m_vMoveRestrictions[ModMapIndex];
+		if(d == MR_DIR_HERE)
+			Restrictions |= TileRestrictions >> 4;
+		else
+			Restrictions |= TileRestrictions & GetMoveRestrictionsMask(d);
 		if(pfnSwitchActive)
 		{
 			CDoorTile DoorTile;
@@ -319,11 +324,25 @@ int CCollision::GetTile(int x, int y) const
 
 	int Nx = std::clamp(x / 32, 0, m_Width - 1);
 	int Ny = std::clamp(y / 32, 0, m_Height - 1);
-	const int Index = Ny * m_Width + Nx;
+	return m_vCollisionTiles[Ny * m_Width + Nx];
+}
 
-	if(m_pTiles[Index].m_Index >= TILE_SOLID && m_pTiles[Index].m_Index <= TILE_NOLASER)
-		return m_pTiles[Index].m_Index;
-	return 0;
+void CCollision::UpdateCompactTile(int Index)
+{
+	const int Tile = m_pTiles[Index].m_Index;
+	m_vCollisionTiles[Index] = Tile >= TILE_SOLID && Tile <= TILE_NOLASER ? Tile : 0;
+
+	int Restrictions = 0;
+	for(const CTile *pLayer : {m_pTiles, m_pFront})
+	{
+		if(!pLayer)
+			continue;
+		const int LayerRestrictions = GetMoveRestrictionsRaw(MR_DIR_HERE, pLayer[Index].m_Index, pLayer[Index].m_Flags);
+		Restrictions |= LayerRestrictions;
+		if(pLayer[Index].m_Index == TILE_STOP)
+			Restrictions |= LayerRestrictions << 4;
+	}
+	m_vMoveRestrictions[Index] = Restrictions;
 }
 
 // TODO: rewrite this smarter!
@@ -847,6 +866,33 @@ int CCollision::GetPureMapIndex(float x, float y) const
 }
 
 bool CCollision::TileExists(int Index) const
+{
+	if(Index < 0)
+		return false;
+	return (m_vTileExistsMask[Index / 64] >> (Index % 64)) & 1;
+}
+
+void CCollision::UpdateTileExists(int Index)
+{
+	const uint64_t Bit = (uint64_t)1 << (Index % 64);
+	if(CheckTileExists(Index))
+		m_vTileExistsMask[Index / 64] |= Bit;
+	else
+		m_vTileExistsMask[Index / 64] &= ~Bit;
+}
+
+void CCollision::UpdateTileExistsAround(int Index)
+{
+	// TileExistsNext depends on the direct neighbours of a tile
+	const int aNeighbours[] = {Index, Index - 1, Index + 1, Index - m_Width, Index + m_Width};
+	for(const int Neighbour : aNeighbours)
+	{
+		if(Neighbour >= 0 && Neighbour < m_Width * m_Height)
+			UpdateTileExists(Neighbour);
+	}
+}
+
+bool CCollision::CheckTileExists(int Index) const
 {
 	if(Index < 0)
 		return false;
@@ -925,6 +971,13 @@ int CCollision::GetMapIndex(vec2 Pos) const
 std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices) const
 {
 	std::vector<int> vIndices;
+	GetMapIndices(PrevPos, Pos, vIndices, MaxIndices);
+	return vIndices;
+}
+
+void CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, std::vector<int> &vIndices, unsigned MaxIndices) const
+{
+	vIndices.clear();
 	float d = distance(PrevPos, Pos);
 	int End(d + 1);
 	if(!d)
@@ -934,12 +987,7 @@ std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxI
 		int Index = Ny * m_Width + Nx;
 
 		if(TileExists(Index))
-		{
 			vIndices.push_back(Index);
-			return vIndices;
-		}
-		else
-			return vIndices;
 	}
 	else
 	{
@@ -954,13 +1002,11 @@ std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxI
 			if(TileExists(Index) && LastIndex != Index)
 			{
 				if(MaxIndices && vIndices.size() > MaxIndices)
-					return vIndices;
+					return;
 				vIndices.push_back(Index);
 				LastIndex = Index;
 			}
 		}
-
-		return vIndices;
 	}
 }
 
@@ -1090,6 +1136,8 @@ void CCollision::SetCollisionAt(float x, float y, int Index)
 	int Ny = std::clamp(round_to_int(y) / 32, 0, m_Height - 1);
 
 	m_pTiles[Ny * m_Width + Nx].m_Index = Index;
+	UpdateCompactTile(Ny * m_Width + Nx);
+	UpdateTileExistsAround(Ny * m_Width + Nx);
 }
 
 void CCollision::SetDoorCollisionAt(float x, float y, int Type, int Flags, int Number)
@@ -1102,6 +1150,7 @@ void CCollision::SetDoorCollisionAt(float x, float y, int Type, int Flags, int N
 	m_pDoor[Ny * m_Width + Nx].m_Index = Type;
 	m_pDoor[Ny * m_Width + Nx].m_Flags = Flags;
 	m_pDoor[Ny * m_Width + Nx].m_Number = Number;
+	UpdateTileExistsAround(Ny * m_Width + Nx);
 }
 
 void CCollision::GetDoorTile(int Index, CDoorTile *pDoorTile) const
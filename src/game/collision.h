@@ -7,6 +7,7 @@
 
 #include <engine/shared/protocol.h>
 
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -78,6 +79,12 @@ public:
 	int GetPureMapIndex(float x, float y) const;
 	int GetPureMapIndex(vec2 Pos) const { return GetPureMapIndex(Pos.x, Pos.y); }
 	std::vector<int> GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices = 0) const;
+	/**
+	 * Same as the other overload, but reuses the given vector to avoid allocations.
+	 *
+	 * @param vIndices Cleared and filled with the indices of the tiles along the path.
+	 */
+	void GetMapIndices(vec2 PrevPos, vec2 Pos, std::vector<int> &vIndices, unsigned MaxIndices = 0) const;
 	int GetMapIndex(vec2 Pos) const;
 	bool TileExists(int Index) const;
 	bool TileExistsNext(int Index) const;
@@ -159,6 +166,23 @@ private:
 	CTuneTile *m_pTune;
 	CDoorTile *m_pDoor;
 
+	// Compact copies of what the hot queries read from the game and front
+	// layer, one byte per tile, so each sample touches a single small array
+	// instead of several 4-byte tiles. Built in Init, updated by SetCollisionAt.
+	// GetTile result: the game tile index if it is a collision tile, else 0
+	std::vector<uint8_t> m_vCollisionTiles;
+	// CANTMOVE_* flags of the stoppers in the game and front layer in the low
+	// nibble, those of one-way stoppers in the high nibble, because these also
+	// restrict moving away from the tile they are on
+	std::vector<uint8_t> m_vMoveRestrictions;
+	void UpdateCompactTile(int Index);
+
+	// one bit per tile, set if TileExists is true for that tile
+	std::vector<uint64_t> m_vTileExistsMask;
+	bool CheckTileExists(int Index) const;
+	void UpdateTileExists(int Index);
+	void UpdateTileExistsAround(int Index);
+
 	// TILE_TELEIN
 	std::map<int, std::vector<vec2>> m_TeleIns;
 	// TILE_TELEOUT
@@ -0,0 +1,655 @@
+#include "auto_map_rules.h"
+
+#include <base/math.h>
+#include <base/str.h>
+
+#include <engine/engine.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/linereader.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cstdio> // sscanf
+#include <thread>
+
+using CIndexInfo = CAutoMapRules::CIndexInfo;
+using CPosRule = CAutoMapRules::CPosRule;
+using CModuloRule = CAutoMapRules::CModuloRule;
+using CIndexRule = CAutoMapRules::CIndexRule;
+using CRun = CAutoMapRules::CRun;
+using CConfiguration = CAutoMapRules::CConfiguration;
+using CTileChange = CAutoMapRules::CTileChange;
+
+// Based on triple32inc from https://github.com/skeeto/hash-prospector/tree/79a6074062a84907df6e45b756134b74e2956760
+static uint32_t HashUInt32(uint32_t Num)
+{
+	Num++;
+	Num ^= Num >> 17;
+	Num *= 0xed5ad4bbu;
+	Num ^= Num >> 11;
+	Num *= 0xac4c1b51u;
+	Num ^= Num >> 15;
+	Num *= 0x31848babu;
+	Num ^= Num >> 14;
+	return Num;
+}
+
+#define HASH_MAX 65536
+
+static int HashLocation(uint32_t Seed, uint32_t Run, uint32_t Rule, uint32_t X, uint32_t Y)
+{
+	const uint32_t Prime = 31;
+	uint32_t Hash = 1;
+	Hash = Hash * Prime + HashUInt32(Seed);
+	Hash = Hash * Prime + HashUInt32(Run);
+	Hash = Hash * Prime + HashUInt32(Rule);
+	Hash = Hash * Prime + HashUInt32(X);
+	Hash = Hash * Prime + HashUInt32(Y);
+	Hash = HashUInt32(Hash * Prime); // Just to double-check that values are well-distributed
+	return Hash % HASH_MAX;
+}
+
+// Runs which read from a copy of the layer are split into row bands of at
+// least this many tiles that are automapped in parallel
+static constexpr int MIN_PARALLEL_TILES = 64 * 64;
+
+// The rules of one run in a flat layout, so evaluating a tile does not chase
+// the pointers of the nested rule vectors. Rules at the position of the tile
+// itself are checked first, as they reject most tiles. If the run reads from a
+// copy of the layer, the index rules that can match are also precomputed for
+// every tile index, so most rules are never looked at for a tile.
+class CCompiledRun
+{
+public:
+	class CCompiledPosRule
+	{
+	public:
+		int m_X;
+		int m_Y;
+		bool m_Invert;
+		// indices 0-255 that match regardless of the flags
+		std::bitset<256> m_Indices;
+		// all other entries of the index list, in m_vIndexInfos
+		int m_IndexInfosStart;
+		int m_NumIndexInfos;
+	};
+
+	class CCompiledIndexRule
+	{
+	public:
+		const CIndexRule *m_pRule;
+		int m_PosRulesStart;
+		int m_NumPosRules;
+		int m_NumCenterPosRules;
+	};
+
+	std::vector<CCompiledIndexRule> m_vIndexRules;
+	std::vector<CCompiledPosRule> m_vPosRules;
+	std::vector<CIndexInfo> m_vIndexInfos;
+	// the index rules that can match a tile with index i, in order, are m_vCandidates[m_aCandidatesStart[i]] to m_vCandidates[m_aCandidatesStart[i + 1] - 1]
+	std::vector<int> m_vCandidates;
+	int m_aCandidatesStart[256 + 1];
+
+	const CTile *m_pReadTiles;
+	CTile *m_pTiles;
+	int m_Width;
+	int m_Height;
+	int m_Seed;
+	int m_RunIndex;
+	int m_SeedOffsetX;
+	int m_SeedOffsetY;
+	bool m_IsFilterable;
+
+	CCompiledRun(const CRun &Run, const CAutoMapRules::CRunParams &Params) :
+		m_pReadTiles(Params.m_pReadTiles),
+		m_pTiles(Params.m_pTiles),
+		m_Width(Params.m_Width),
+		m_Height(Params.m_Height),
+		m_Seed(Params.m_Seed),
+		m_RunIndex(Params.m_RunIndex),
+		m_SeedOffsetX(Params.m_SeedOffsetX),
+		m_SeedOffsetY(Params.m_SeedOffsetY),
+		m_IsFilterable(Params.m_IsFilterable)
+	{
+		const bool ReadsCopy = m_pReadTiles != m_pTiles;
+		m_vIndexRules.reserve(Run.m_vIndexRules.size());
+		for(const CIndexRule &IndexRule : Run.m_vIndexRules)
+		{
+			CCompiledIndexRule &CompiledIndexRule = m_vIndexRules.emplace_back();
+			CompiledIndexRule.m_pRule = &IndexRule;
+			CompiledIndexRule.m_PosRulesStart = m_vPosRules.size();
+			CompiledIndexRule.m_NumPosRules = IndexRule.m_vRules.size();
+			for(const CPosRule &PosRule : IndexRule.m_vRules)
+			{
+				if(PosRule.m_X == 0 && PosRule.m_Y == 0)
+					AddPosRule(PosRule);
+			}
+			CompiledIndexRule.m_NumCenterPosRules = m_vPosRules.size() - CompiledIndexRule.m_PosRulesStart;
+			for(const CPosRule &PosRule : IndexRule.m_vRules)
+			{
+				if(PosRule.m_X != 0 || PosRule.m_Y != 0)
+					AddPosRule(PosRule);
+			}
+		}
+
+		// A run that reads the layer it writes sees the index of a tile change
+		// while its rules are applied, so all rules must be checked then.
+		for(int Index = 0; Index < 256; Index++)
+		{
+			m_aCandidatesStart[Index] = m_vCandidates.size();
+			for(size_t i = 0; i < m_vIndexRules.size(); ++i)
+			{
+				if(!ReadsCopy || CanMatchIndex(m_vIndexRules[i], Index))
+					m_vCandidates.push_back(i);
+			}
+		}
+		m_aCandidatesStart[256] = m_vCandidates.size();
+	}
+
+	// whether the index rule can match a tile with the given index, judging only by the tile itself
+	bool CanMatchIndex(const CCompiledIndexRule &IndexRule, int Index) const
+	{
+		const CIndexRule *pIndexRule = IndexRule.m_pRule;
+		if(Index == 0 && m_IsFilterable) // the lazy workaround applies to every index rule
+			return true;
+		if(Index == 0 && pIndexRule->m_SkipEmpty)
+			return false;
+		if(Index != 0 && pIndexRule->m_SkipFull)
+			return false;
+
+		for(int j = IndexRule.m_PosRulesStart; j < IndexRule.m_PosRulesStart + IndexRule.m_NumCenterPosRules; ++j)
+		{
+			const CCompiledPosRule &Rule = m_vPosRules[j];
+			bool Matches = Rule.m_Indices[Index];
+			bool DependsOnFlags = false;
+			for(int k = Rule.m_IndexInfosStart; k < Rule.m_IndexInfosStart + Rule.m_NumIndexInfos; ++k)
+			{
+				const CIndexInfo &IndexInfo = m_vIndexInfos[k];
+				if(IndexInfo.m_Id == Index)
+				{
+					if(IndexInfo.m_TestFlag)
+						DependsOnFlags = true;
+					else
+						Matches = true;
+				}
+			}
+			if(!Matches && DependsOnFlags)
+				continue;
+			if(Matches == Rule.m_Invert)
+				return false;
+		}
+		return true;
+	}
+
+	void AddPosRule(const CPosRule &PosRule)
+	{
+		CCompiledPosRule &CompiledPosRule = m_vPosRules.emplace_back();
+		CompiledPosRule.m_X = PosRule.m_X;
+		CompiledPosRule.m_Y = PosRule.m_Y;
+		CompiledPosRule.m_Invert = PosRule.m_Value == CPosRule::NOTINDEX;
+		CompiledPosRule.m_IndexInfosStart = m_vIndexInfos.size();
+		for(const CIndexInfo &Index : PosRule.m_vIndexList)
+		{
+			if(!Index.m_TestFlag && Index.m_Id >= 0 && Index.m_Id < (int)CompiledPosRule.m_Indices.size())
+				CompiledPosRule.m_Indices.set(Index.m_Id);
+			else
+				m_vIndexInfos.push_back(Index);
+		}
+		CompiledPosRule.m_NumIndexInfos = m_vIndexInfos.size() - CompiledPosRule.m_IndexInfosStart;
+	}
+
+	bool RespectsRules(const CCompiledIndexRule &IndexRule, int x, int y) const
+	{
+		for(int j = IndexRule.m_PosRulesStart; j < IndexRule.m_PosRulesStart + IndexRule.m_NumPosRules; ++j)
+		{
+			const CCompiledPosRule &Rule = m_vPosRules[j];
+
+			int CheckIndex, CheckFlags;
+			int CheckX = x + Rule.m_X;
+			int CheckY = y + Rule.m_Y;
+			if(CheckX >= 0 && CheckX < m_Width && CheckY >= 0 && CheckY < m_Height)
+			{
+				const CTile &CheckTile = m_pReadTiles[CheckY * m_Width + CheckX];
+				CheckIndex = CheckTile.m_Index;
+				CheckFlags = CheckTile.m_Flags & (TILEFLAG_ROTATE | TILEFLAG_XFLIP | TILEFLAG_YFLIP);
+			}
+			else
+			{
+				CheckIndex = -1;
+				CheckFlags = 0;
+			}
+
+			bool Matches = CheckIndex >= 0 && Rule.m_Indices[CheckIndex];
+			for(int k = Rule.m_IndexInfosStart; k < Rule.m_IndexInfosStart + Rule.m_NumIndexInfos && !Matches; ++k)
+			{
+				const CIndexInfo &Index = m_vIndexInfos[k];
+				Matches = CheckIndex == Index.m_Id && (!Index.m_TestFlag || CheckFlags == Index.m_Flag);
+			}
+			if(Matches == Rule.m_Invert)
+				return false;
+		}
+		return true;
+	}
+
+	// Automaps the rows [FromY, ToY). Only the tiles of these rows are written, so
+	// bands can be processed in parallel if the read tiles are not the output tiles.
+	void ProceedRows(int FromY, int ToY, std::vector<CTileChange> &vChanges) const
+	{
+		// tile writes may alias any member, so keep what the loop needs in locals
+		const int Width = m_Width;
+		const uint32_t Seed = m_Seed;
+		const uint32_t RunIndex = m_RunIndex;
+		const int SeedOffsetX = m_SeedOffsetX;
+		const int SeedOffsetY = m_SeedOffsetY;
+		const bool IsFilterable = m_IsFilterable;
+		const int *pCandidates = m_vCandidates.data();
+		const CCompiledIndexRule *pIndexRules = m_vIndexRules.data();
+
+		for(int y = FromY; y < ToY; y++)
+		{
+			CTile *pTiles = &m_pTiles[y * Width];
+			const CTile *pReadTiles = &m_pReadTiles[y * Width];
+			for(int x = 0; x < Width; x++)
+			{
+				CTile *pTile = &pTiles[x];
+				const CTile *pReadTile = &pReadTiles[x];
+				const CTile Previous = *pTile;
+				bool Changed = false;
+
+				// in runs without a copy, the lists of all indices are the same
+				const int FirstCandidate = m_aCandidatesStart[pReadTile->m_Index];
+				const int EndCandidate = m_aCandidatesStart[pReadTile->m_Index + 1];
+				for(int Candidate = FirstCandidate; Candidate < EndCandidate; ++Candidate)
+				{
+					const int i = pCandidates[Candidate];
+					const CCompiledIndexRule &CompiledIndexRule = pIndexRules[i];
+					const CIndexRule *pIndexRule = CompiledIndexRule.m_pRule;
+					if(pReadTile->m_Index == 0)
+					{
+						if(pTile->m_Index != 0 && IsFilterable) // TODO: This is a lazy workaround
+						{
+							pTile->m_Index = 0;
+							pTile->m_Flags = pIndexRule->m_Flag;
+							Changed = true;
+							continue;
+						}
+
+						if(pIndexRule->m_SkipEmpty) // skip empty tiles
+							continue;
+					}
+					if(pIndexRule->m_SkipFull && pReadTile->m_Index != 0) // skip full tiles
+						continue;
+
+					if(!RespectsRules(CompiledIndexRule, x, y))
+						continue;
+
+					bool PassesModuloCheck;
+					if(pIndexRule->m_vModuloRules.empty())
+						PassesModuloCheck = true;
+					else
+						PassesModuloCheck = std::any_of(pIndexRule->m_vModuloRules.cbegin(), pIndexRule->m_vModuloRules.cend(), [&](const CModuloRule &ModuloRule) {
+							return (x + SeedOffsetX + ModuloRule.m_OffsetX) % ModuloRule.m_ModX == 0 && (y + SeedOffsetY + ModuloRule.m_OffsetY) % ModuloRule.m_ModY == 0;
+						});
+
+					if(PassesModuloCheck &&
+						(pIndexRule->m_RandomProbability >= 1.0f || HashLocation(Seed, RunIndex, i, x + SeedOffsetX, y + SeedOffsetY) < HASH_MAX * pIndexRule->m_RandomProbability))
+					{
+						pTile->m_Index = pIndexRule->m_Id;
+						pTile->m_Flags = pIndexRule->m_Flag;
+						Changed = true;
+					}
+				}
+
+				if(Changed)
+					vChanges.push_back({x, y, Previous});
+			}
+		}
+	}
+};
+
+void CAutoMapRules::Load(CLineReader &LineReader)
+{
+	m_vConfigs.clear();
+
+	CConfiguration *pCurrentConf = nullptr;
+	CRun *pCurrentRun = nullptr;
+	CIndexRule *pCurrentIndex = nullptr;
+
+	// read each line
+	while(const char *pLine = LineReader.Get())
+	{
+		// skip blank/empty lines as well as comments
+		if(str_length(pLine) > 0 && pLine[0] != '#' && pLine[0] != '\n' && pLine[0] != '\r' && pLine[0] != '\t' && pLine[0] != '\v' && pLine[0] != ' ')
+		{
+			if(pLine[0] == '[')
+			{
+				// new configuration, get the name
+				pLine++;
+				CConfiguration NewConf;
+				NewConf.m_aName[0] = '\0';
+				NewConf.m_StartX = 0;
+				NewConf.m_StartY = 0;
+				NewConf.m_EndX = 0;
+				NewConf.m_EndY = 0;
+				m_vConfigs.push_back(NewConf);
+				int ConfigurationId = m_vConfigs.size() - 1;
+				pCurrentConf = &m_vConfigs[ConfigurationId];
+				str_copy(pCurrentConf->m_aName, pLine, minimum<int>(sizeof(pCurrentConf->m_aName), str_length(pLine)));
+
+				// add start run
+				CRun NewRun;
+				NewRun.m_AutomapCopy = true;
+				pCurrentConf->m_vRuns.push_back(NewRun);
+				int RunId = pCurrentConf->m_vRuns.size() - 1;
+				pCurrentRun = &pCurrentConf->m_vRuns[RunId];
+			}
+			else if(str_startswith(pLine, "NewRun") && pCurrentConf)
+			{
+				// add new run
+				CRun NewRun;
+				NewRun.m_AutomapCopy = true;
+				pCurrentConf->m_vRuns.push_back(NewRun);
+				int RunId = pCurrentConf->m_vRuns.size() - 1;
+				pCurrentRun = &pCurrentConf->m_vRuns[RunId];
+			}
+			else if(str_startswith(pLine, "Index") && pCurrentRun)
+			{
+				// new index
+				CIndexRule NewIndexRule;
+
+				char aOrientation1[128] = "";
+				char aOrientation2[128] = "";
+				char aOrientation3[128] = "";
+
+				sscanf(pLine, "Index %d %127s %127s %127s", &NewIndexRule.m_Id, aOrientation1, aOrientation2, aOrientation3);
+
+				NewIndexRule.m_Flag = 0;
+				NewIndexRule.m_RandomProbability = 1.0f;
+				NewIndexRule.m_DefaultRule = true;
+				NewIndexRule.m_SkipEmpty = false;
+				NewIndexRule.m_SkipFull = false;
+
+				if(str_length(aOrientation1) > 0)
+					NewIndexRule.m_Flag = CheckIndexFlag(NewIndexRule.m_Flag, aOrientation1, false);
+
+				if(str_length(aOrientation2) > 0)
+					NewIndexRule.m_Flag = CheckIndexFlag(NewIndexRule.m_Flag, aOrientation2, false);
+
+				if(str_length(aOrientation3) > 0)
+					NewIndexRule.m_Flag = CheckIndexFlag(NewIndexRule.m_Flag, aOrientation3, false);
+
+				// add the index rule object and make it current
+				pCurrentRun->m_vIndexRules.push_back(NewIndexRule);
+				int IndexRuleId = pCurrentRun->m_vIndexRules.size() - 1;
+				pCurrentIndex = &pCurrentRun->m_vIndexRules[IndexRuleId];
+			}
+			else if(str_startswith(pLine, "Pos") && pCurrentIndex)
+			{
+				int x = 0, y = 0;
+				char aValue[128];
+				int Value = CPosRule::NORULE;
+				std::vector<CIndexInfo> vNewIndexList;
+
+				sscanf(pLine, "Pos %d %d %127s", &x, &y, aValue);
+
+				if(!str_comp(aValue, "EMPTY"))
+				{
+					Value = CPosRule::INDEX;
+					CIndexInfo NewIndexInfo = {0, 0, false};
+					vNewIndexList.push_back(NewIndexInfo);
+				}
+				else if(!str_comp(aValue, "FULL"))
+				{
+					Value = CPosRule::NOTINDEX;
+					CIndexInfo NewIndexInfo1 = {0, 0, false};
+					// CIndexInfo NewIndexInfo2 = {-1, 0};
+					vNewIndexList.push_back(NewIndexInfo1);
+					// vNewIndexList.push_back(NewIndexInfo2);
+				}
+				else if(!str_comp(aValue, "INDEX") || !str_comp(aValue, "NOTINDEX"))
+				{
+					if(!str_comp(aValue, "INDEX"))
+						Value = CPosRule::INDEX;
+					else
+						Value = CPosRule::NOTINDEX;
+
+					int pWord = 4;
+					while(true)
+					{
+						CIndexInfo NewIndexInfo;
+
+						char aOrientation1[128] = "";
+						char aOrientation2[128] = "";
+						char aOrientation3[128] = "";
+						char aOrientation4[128] = "";
+						sscanf(str_trim_words(pLine, pWord), "%d %127s %127s %127s %127s", &NewIndexInfo.m_Id, aOrientation1, aOrientation2, aOrientation3, aOrientation4);
+
+						NewIndexInfo.m_Flag = 0;
+						NewIndexInfo.m_TestFlag = false;
+
+						if(!str_comp(aOrientation1, "OR"))
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							pWord += 2;
+							continue;
+						}
+						else if(str_length(aOrientation1) > 0)
+						{
+							NewIndexInfo.m_Flag = CheckIndexFlag(NewIndexInfo.m_Flag, aOrientation1, true);
+							NewIndexInfo.m_TestFlag = !(NewIndexInfo.m_Flag == 0 && str_comp(aOrientation1, "NONE"));
+						}
+						else
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							break;
+						}
+
+						if(!str_comp(aOrientation2, "OR"))
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							pWord += 3;
+							continue;
+						}
+						else if(str_length(aOrientation2) > 0 && NewIndexInfo.m_Flag != 0)
+						{
+							NewIndexInfo.m_Flag = CheckIndexFlag(NewIndexInfo.m_Flag, aOrientation2, false);
+						}
+						else
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							break;
+						}
+
+						if(!str_comp(aOrientation3, "OR"))
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							pWord += 4;
+							continue;
+						}
+						else if(str_length(aOrientation3) > 0 && NewIndexInfo.m_Flag != 0)
+						{
+							NewIndexInfo.m_Flag = CheckIndexFlag(NewIndexInfo.m_Flag, aOrientation3, false);
+						}
+						else
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							break;
+						}
+
+						if(!str_comp(aOrientation4, "OR"))
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							pWord += 5;
+							continue;
+						}
+						else
+						{
+							vNewIndexList.push_back(NewIndexInfo);
+							break;
+						}
+					}
+				}
+
+				if(Value != CPosRule::NORULE)
+				{
+					CPosRule NewPosRule = {x, y, Value, vNewIndexList};
+					pCurrentIndex->m_vRules.push_back(NewPosRule);
+
+					pCurrentConf->m_StartX = minimum(pCurrentConf->m_StartX, NewPosRule.m_X);
+					pCurrentConf->m_StartY = minimum(pCurrentConf->m_StartY, NewPosRule.m_Y);
+					pCurrentConf->m_EndX = maximum(pCurrentConf->m_EndX, NewPosRule.m_X);
+					pCurrentConf->m_EndY = maximum(pCurrentConf->m_EndY, NewPosRule.m_Y);
+
+					if(x == 0 && y == 0)
+					{
+						for(const auto &Index : vNewIndexList)
+						{
+							if(Index.m_Id == 0 && Value == CPosRule::INDEX)
+							{
+								// Skip full tiles if we have a rule "POS 0 0 INDEX 0"
+								// because that forces the tile to be empty
+								pCurrentIndex->m_SkipFull = true;
+							}
+							else if((Index.m_Id > 0 && Value == CPosRule::INDEX) || (Index.m_Id == 0 && Value == CPosRule::NOTINDEX))
+							{
+								// Skip empty tiles if we have a rule "POS 0 0 INDEX i" where i > 0
+								// or if we have a rule "POS 0 0 NOTINDEX 0"
+								pCurrentIndex->m_SkipEmpty = true;
+							}
+						}
+					}
+				}
+			}
+			else if(str_startswith(pLine, "Random") && pCurrentIndex)
+			{
+				float Value;
+				char Specifier = ' ';
+				sscanf(pLine, "Random %f%c", &Value, &Specifier);
+				if(Specifier == '%')
+				{
+					pCurrentIndex->m_RandomProbability = Value / 100.0f;
+				}
+				else
+				{
+					pCurrentIndex->m_RandomProbability = 1.0f / Value;
+				}
+			}
+			else if(str_startswith(pLine, "Modulo") && pCurrentIndex)
+			{
+				CModuloRule NewModuloRule;
+				sscanf(pLine, "Modulo %d %d %d %d", &NewModuloRule.m_ModX, &NewModuloRule.m_ModY, &NewModuloRule.m_OffsetX, &NewModuloRule.m_OffsetY);
+				if(NewModuloRule.m_ModX == 0)
+					NewModuloRule.m_ModX = 1;
+				if(NewModuloRule.m_ModY == 0)
+					NewModuloRule.m_ModY = 1;
+				pCurrentIndex->m_vModuloRules.push_back(NewModuloRule);
+			}
+			else if(str_startswith(pLine, "NoDefaultRule") && pCurrentIndex)
+			{
+				pCurrentIndex->m_DefaultRule = false;
+			}
+			else if(str_startswith(pLine, "NoLayerCopy") && pCurrentRun)
+			{
+				pCurrentRun->m_AutomapCopy = false;
+			}
+		}
+	}
+
+	// add default rule for Pos 0 0 if there is none
+	for(auto &Config : m_vConfigs)
+	{
+		for(auto &Run : Config.m_vRuns)
+		{
+			for(auto &IndexRule : Run.m_vIndexRules)
+			{
+				bool Found = false;
+
+				// Search for the exact rule "POS 0 0 INDEX 0" which corresponds to the default rule
+				for(const auto &Rule : IndexRule.m_vRules)
+				{
+					if(Rule.m_X == 0 && Rule.m_Y == 0 && Rule.m_Value == CPosRule::INDEX)
+					{
+						for(const auto &Index : Rule.m_vIndexList)
+						{
+							if(Index.m_Id == 0)
+								Found = true;
+						}
+						break;
+					}
+
+					if(Found)
+						break;
+				}
+
+				// If the default rule was not found, and we require it, then add it
+				if(!Found && IndexRule.m_DefaultRule)
+				{
+					std::vector<CIndexInfo> vNewIndexList;
+					CIndexInfo NewIndexInfo = {0, 0, false};
+					vNewIndexList.push_back(NewIndexInfo);
+					CPosRule NewPosRule = {0, 0, CPosRule::NOTINDEX, vNewIndexList};
+					IndexRule.m_vRules.push_back(NewPosRule);
+
+					IndexRule.m_SkipEmpty = true;
+					IndexRule.m_SkipFull = false;
+				}
+
+				if(IndexRule.m_SkipEmpty && IndexRule.m_SkipFull)
+				{
+					IndexRule.m_SkipEmpty = false;
+					IndexRule.m_SkipFull = false;
+				}
+			}
+		}
+	}
+}
+
+int CAutoMapRules::CheckIndexFlag(int Flag, const char *pFlag, bool CheckNone)
+{
+	if(!str_comp(pFlag, "XFLIP"))
+		Flag |= TILEFLAG_XFLIP;
+	else if(!str_comp(pFlag, "YFLIP"))
+		Flag |= TILEFLAG_YFLIP;
+	else if(!str_comp(pFlag, "ROTATE"))
+		Flag |= TILEFLAG_ROTATE;
+	else if(!str_comp(pFlag, "NONE") && CheckNone)
+		Flag = 0;
+
+	return Flag;
+}
+
+
+void CAutoMapRules::ProceedRun(const CRun &Run, const CRunParams &Params, IEngine *pEngine, std::vector<CTileChange> &vChanges)
+{
+	const CCompiledRun CompiledRun(Run, Params);
+
+	// Every tile only depends on the read tiles and its position, so the
+	// result does not depend on how the rows are split. Runs that read
+	// from the tiles they write to must stay in row-major order.
+	const int NumTiles = Params.m_Width * Params.m_Height;
+	int NumBands = 1;
+	if(pEngine != nullptr && Params.m_pReadTiles != Params.m_pTiles && NumTiles >= 2 * MIN_PARALLEL_TILES)
+	{
+		// a few bands per thread, so uneven bands do not leave threads idle
+		NumBands = std::min({Params.m_Height, NumTiles / MIN_PARALLEL_TILES, (int)std::thread::hardware_concurrency() * 4});
+	}
+	if(NumBands <= 1)
+	{
+		CompiledRun.ProceedRows(0, Params.m_Height, vChanges);
+		return;
+	}
+
+	// the row bands no worker has started yet are automapped on this thread
+	std::vector<std::vector<CTileChange>> vvBandChanges(NumBands);
+	CJobGroup Jobs;
+	for(int Band = 0; Band < NumBands; Band++)
+	{
+		const int FromY = Params.m_Height * Band / NumBands;
+		const int ToY = Params.m_Height * (Band + 1) / NumBands;
+		std::vector<CTileChange> *pBandChanges = &vvBandChanges[Band];
+		pEngine->AddJob(Jobs.Add("automap rows", [&CompiledRun, FromY, ToY, pBandChanges] { CompiledRun.ProceedRows(FromY, ToY, *pBandChanges); }));
+	}
+	Jobs.Wait();
+	for(const std::vector<CTileChange> &vBandChanges : vvBandChanges)
+		vChanges.insert(vChanges.end(), vBandChanges.begin(), vBandChanges.end());
+}
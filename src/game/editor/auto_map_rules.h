@@ -0,0 +1,119 @@
+#ifndef GAME_EDITOR_AUTO_MAP_RULES_H
+#define GAME_EDITOR_AUTO_MAP_RULES_H
+
+#include <game/mapitems.h>
+
+#include <vector>
+
+class CLineReader;
+class IEngine;
+
+// The configurations of an automapper rules file and their evaluation on
+// plain tile arrays. Unlike CAutoMapper this does not depend on the editor,
+// so the rules can be tested on their own.
+class CAutoMapRules
+{
+public:
+	class CIndexInfo
+	{
+	public:
+		int m_Id;
+		int m_Flag;
+		bool m_TestFlag;
+	};
+
+	class CPosRule
+	{
+	public:
+		int m_X;
+		int m_Y;
+		int m_Value;
+		std::vector<CIndexInfo> m_vIndexList;
+		bool m_IsGuide;
+
+		enum
+		{
+			NORULE = 0,
+			INDEX,
+			NOTINDEX
+		};
+	};
+
+	class CModuloRule
+	{
+	public:
+		int m_ModX;
+		int m_ModY;
+		int m_OffsetX;
+		int m_OffsetY;
+	};
+
+	class CIndexRule
+	{
+	public:
+		int m_Id;
+		std::vector<CPosRule> m_vRules;
+		int m_Flag;
+		float m_RandomProbability;
+		std::vector<CModuloRule> m_vModuloRules;
+		bool m_DefaultRule;
+		bool m_SkipEmpty;
+		bool m_SkipFull;
+	};
+
+	class CRun
+	{
+	public:
+		std::vector<CIndexRule> m_vIndexRules;
+		bool m_AutomapCopy;
+	};
+
+	class CConfiguration
+	{
+	public:
+		std::vector<CRun> m_vRuns;
+		char m_aName[128];
+		int m_StartX;
+		int m_StartY;
+		int m_EndX;
+		int m_EndY;
+	};
+
+	// The tiles one run of a configuration is applied to
+	class CRunParams
+	{
+	public:
+		// the tiles the rules are checked against, either a copy of the layer or m_pTiles
+		const CTile *m_pReadTiles;
+		CTile *m_pTiles;
+		int m_Width;
+		int m_Height;
+		int m_Seed;
+		int m_RunIndex;
+		int m_SeedOffsetX;
+		int m_SeedOffsetY;
+		// whether empty read tiles clear the tile, for the first run with a reference
+		bool m_IsFilterable;
+	};
+
+	// A tile that was changed by a run, with its value from before the run
+	class CTileChange
+	{
+	public:
+		int m_X;
+		int m_Y;
+		CTile m_Previous;
+	};
+
+	std::vector<CConfiguration> m_vConfigs;
+
+	void Load(CLineReader &LineReader);
+	static int CheckIndexFlag(int Flag, const char *pFlag, bool CheckNone);
+
+	// Applies the run with compiled rules. Large runs that read from a copy
+	// of the layer are split into row bands that run as jobs of pEngine,
+	// unless it is nullptr. The changes are appended in row-major order.
+	static void ProceedRun(const CRun &Run, const CRunParams &Params, IEngine *pEngine, std::vector<CTileChange> &vChanges);
+};
+
+#endif
@@ -66,6 +66,7 @@ CDataFileWriterFinishJob::CDataFileWriterFinishJob(IStorage *pStorage, const cha
 	str_copy(m_aRealFilename, pRealFilename);
 	str_copy(m_aTempFilename, pTempFilename);
 	m_aErrorMessage[0] = '\0';
+	SetPriority(PRIORITY_BACKGROUND);
 }
 
 bool CEditorMap::Save(const char *pFilename, const FErrorHandler &ErrorHandler)
@@ -2,9 +2,16 @@
 
 #include <base/dbg.h>
 #include <base/log.h>
+#include <base/time.h>
+
+#include <engine/engine.h>
+#include <engine/shared/jobs.h>
 
 #include <game/map/envelope_manager.h>
 
+#include <chrono>
+#include <thread>
+
 const int LAYER_DEFAULT_TILESET = -1;
 
 void CMapRenderer::Clear()
@@ -14,10 +21,53 @@ void CMapRenderer::Clear()
 	m_vpRenderLayers.clear();
 }
 
-void CMapRenderer::Load(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, std::optional<FRenderUploadCallback> RenderCallbackOptional)
+void CMapRenderer::Load(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, IEngine *pEngine, std::optional<FRenderUploadCallback> RenderCallbackOptional)
 {
 	Clear();
 
+	const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+	CreateLayers(Type, pLayers, pMapImages, pEnvelopeEval, RenderCallbackOptional);
+	const int NumJobs = BuildLayers(pEngine);
+	const std::chrono::nanoseconds BuildEndTime = time_get_nanoseconds();
+
+	// only the uploads have to run on the main thread and in order
+	for(auto &pRenderLayer : m_vpRenderLayers)
+		pRenderLayer->Upload();
+
+	const std::chrono::nanoseconds EndTime = time_get_nanoseconds();
+	using FMilliseconds = std::chrono::duration<double, std::milli>;
+	log_debug("map_renderer", "loaded %d layers in %.2fms (build %.2fms in %d jobs, upload %.2fms)",
+		(int)m_vpRenderLayers.size(), FMilliseconds(EndTime - StartTime).count(), FMilliseconds(BuildEndTime - StartTime).count(), NumJobs, FMilliseconds(EndTime - BuildEndTime).count());
+}
+
+int CMapRenderer::BuildLayers(IEngine *pEngine)
+{
+	if(pEngine == nullptr || std::thread::hardware_concurrency() <= 1 || m_vpRenderLayers.size() <= 1)
+	{
+		for(auto &pRenderLayer : m_vpRenderLayers)
+			pRenderLayer->Build();
+		return 0;
+	}
+
+	// Every layer only reads the map data and writes its own visuals, so the
+	// layers can be built independently on the engine job pool.
+	CJobGroup BuildJobs;
+	int NumJobs = 0;
+	for(auto &pRenderLayer : m_vpRenderLayers)
+	{
+		if(pRenderLayer->IsGroup())
+			continue;
+		CRenderLayer *pLayer = pRenderLayer.get();
+		pEngine->AddJob(BuildJobs.Add("map layer build", [pLayer] { pLayer->Build(); }));
+		NumJobs++;
+	}
+	// builds the layers no worker has started yet on this thread
+	BuildJobs.Wait();
+	return NumJobs;
+}
+
+void CMapRenderer::CreateLayers(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, std::optional<FRenderUploadCallback> &RenderCallbackOptional)
+{
 	std::shared_ptr<CEnvelopeManager> pEnvelopeManager = std::make_shared<CEnvelopeManager>(pEnvelopeEval, pLayers->Map());
 	bool PassedGameLayer = false;
 
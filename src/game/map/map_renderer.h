@@ -7,16 +7,20 @@
 #include <game/map/render_component.h>
 #include <game/map/render_layer.h>
 
+class IEngine;
+
 class CMapRenderer : public CRenderComponent
 {
 public:
 	CMapRenderer() = default;
 
 	void Clear();
-	void Load(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, std::optional<FRenderUploadCallback> RenderCallbackOptional);
+	void Load(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, IEngine *pEngine, std::optional<FRenderUploadCallback> RenderCallbackOptional);
 	void Render(const CRenderLayerParams &Params);
 
 private:
+	void CreateLayers(ERenderType Type, CLayers *pLayers, IMapImages *pMapImages, IEnvelopeEval *pEnvelopeEval, std::optional<FRenderUploadCallback> &RenderCallbackOptional);
+	int BuildLayers(IEngine *pEngine);
 	int GetLayerType(const CMapItemLayer *pLayer, const CLayers *pLayers) const;
 
 	std::vector<std::unique_ptr<CRenderLayer>> m_vpRenderLayers;
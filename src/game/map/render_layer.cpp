@@ -579,10 +579,21 @@ void CRenderLayerTile::Init()
 		m_TextureHandle = m_pMapImages->Get(m_pLayerTilemap->m_Image);
 	else
 		m_TextureHandle.Invalidate();
-	UploadTileData(m_VisualTiles, 0, false);
+	// resolving the texture may load it, so this cannot be done in Build
+	m_DoTextureCoords = GetTexture().IsValid();
 }
 
-void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsOptional, int CurOverlay, bool AddAsSpeedup, bool IsGameLayer)
+void CRenderLayerTile::Build()
+{
+	BuildTileData(m_VisualTiles, 0, false);
+}
+
+void CRenderLayerTile::Upload()
+{
+	UploadTileData(m_VisualTiles);
+}
+
+void CRenderLayerTile::BuildTileData(std::optional<CTileLayerVisuals> &VisualsOptional, int CurOverlay, bool AddAsSpeedup, bool IsGameLayer)
 {
 	if(!Graphics()->IsTileBufferingEnabled())
 		return;
@@ -601,7 +612,7 @@ void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsO
 	std::vector<CGraphicTile> vTmpBorderCorners;
 	std::vector<CGraphicTileTextureCoords> vTmpBorderCornersTexCoords;
 
-	const bool DoTextureCoords = GetTexture().IsValid();
+	const bool DoTextureCoords = m_DoTextureCoords;
 
 	// create the visual and set it in the optional, afterwards get it
 	CTileLayerVisuals v;
@@ -792,13 +803,10 @@ void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsO
 
 	Visuals.m_BufferContainerIndex = -1;
 
-	// upload data to gpu
+	// prepare the data for the gpu
 	size_t UploadDataSize = vTmpTileTexCoords.size() * sizeof(CGraphicTileTextureCoords) + vTmpTiles.size() * sizeof(CGraphicTile);
 	if(UploadDataSize == 0)
-	{
-		RenderLoading();
 		return;
-	}
 
 	void *pUploadData = malloc(UploadDataSize);
 
@@ -834,8 +842,28 @@ void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsO
 		mem_copy(pUploadData, vTmpTiles.data(), vTmpTiles.size() * sizeof(CGraphicTile));
 	}
 
-	// first create the buffer object
-	int BufferObjectIndex = Graphics()->CreateBufferObject(UploadDataSize, pUploadData, 0, true);
+	Visuals.m_pUploadData = pUploadData;
+	Visuals.m_UploadDataSize = UploadDataSize;
+	Visuals.m_NumUploadTiles = vTmpTiles.size();
+}
+
+void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsOptional)
+{
+	if(!VisualsOptional.has_value())
+		return;
+
+	CTileLayerVisuals &Visuals = VisualsOptional.value();
+	if(Visuals.m_pUploadData == nullptr)
+	{
+		RenderLoading();
+		return;
+	}
+	const bool DoTextureCoords = Visuals.m_IsTextured;
+
+	// first create the buffer object, which takes ownership of the data
+	int BufferObjectIndex = Graphics()->CreateBufferObject(Visuals.m_UploadDataSize, Visuals.m_pUploadData, 0, true);
+	Visuals.m_pUploadData = nullptr;
+	Visuals.m_UploadDataSize = 0;
 
 	// then create the buffer container
 	SBufferContainerInfo ContainerInfo;
@@ -861,7 +889,7 @@ void CRenderLayerTile::UploadTileData(std::optional<CTileLayerVisuals> &VisualsO
 
 	Visuals.m_BufferContainerIndex = Graphics()->CreateBufferContainer(&ContainerInfo);
 	// and finally inform the backend how many indices are required
-	Graphics()->IndicesNumRequiredNotify(vTmpTiles.size() * 6);
+	Graphics()->IndicesNumRequiredNotify(Visuals.m_NumUploadTiles * 6);
 
 	RenderLoading();
 }
@@ -877,6 +905,8 @@ void CRenderLayerTile::Unload()
 
 void CRenderLayerTile::CTileLayerVisuals::Unload()
 {
+	free(m_pUploadData);
+	m_pUploadData = nullptr;
 	Graphics()->DeleteBufferContainer(m_BufferContainerIndex);
 }
 
@@ -1431,9 +1461,9 @@ IGraphics::CTextureHandle CRenderLayerEntityBase::GetTexture() const
 CRenderLayerEntityGame::CRenderLayerEntityGame(int GroupId, int LayerId, int Flags, CMapItemLayerTilemap *pLayerTilemap) :
 	CRenderLayerEntityBase(GroupId, LayerId, Flags, pLayerTilemap) {}
 
-void CRenderLayerEntityGame::Init()
+void CRenderLayerEntityGame::Build()
 {
-	UploadTileData(m_VisualTiles, 0, false, true);
+	BuildTileData(m_VisualTiles, 0, false, true);
 }
 
 void CRenderLayerEntityGame::RenderTileLayerWithTileBuffer(const ColorRGBA &Color, const CRenderLayerParams &Params)
@@ -1488,10 +1518,16 @@ int CRenderLayerEntityTele::GetDataIndex(unsigned int &TileSize) const
 	return m_pLayerTilemap->m_Tele;
 }
 
-void CRenderLayerEntityTele::Init()
+void CRenderLayerEntityTele::Build()
+{
+	BuildTileData(m_VisualTiles, 0, false);
+	BuildTileData(m_VisualTeleNumbers, 1, false);
+}
+
+void CRenderLayerEntityTele::Upload()
 {
-	UploadTileData(m_VisualTiles, 0, false);
-	UploadTileData(m_VisualTeleNumbers, 1, false);
+	UploadTileData(m_VisualTiles);
+	UploadTileData(m_VisualTeleNumbers);
 }
 
 void CRenderLayerEntityTele::InitTileData()
@@ -1557,11 +1593,18 @@ int CRenderLayerEntitySpeedup::GetDataIndex(unsigned int &TileSize) const
 	return m_pLayerTilemap->m_Speedup;
 }
 
-void CRenderLayerEntitySpeedup::Init()
+void CRenderLayerEntitySpeedup::Build()
+{
+	BuildTileData(m_VisualTiles, 0, true);
+	BuildTileData(m_VisualForce, 1, false);
+	BuildTileData(m_VisualMaxSpeed, 2, false);
+}
+
+void CRenderLayerEntitySpeedup::Upload()
 {
-	UploadTileData(m_VisualTiles, 0, true);
-	UploadTileData(m_VisualForce, 1, false);
-	UploadTileData(m_VisualMaxSpeed, 2, false);
+	UploadTileData(m_VisualTiles);
+	UploadTileData(m_VisualForce);
+	UploadTileData(m_VisualMaxSpeed);
 }
 
 void CRenderLayerEntitySpeedup::InitTileData()
@@ -1637,11 +1680,18 @@ int CRenderLayerEntitySwitch::GetDataIndex(unsigned int &TileSize) const
 	return m_pLayerTilemap->m_Switch;
 }
 
-void CRenderLayerEntitySwitch::Init()
+void CRenderLayerEntitySwitch::Build()
+{
+	BuildTileData(m_VisualTiles, 0, false);
+	BuildTileData(m_VisualSwitchNumberTop, 1, false);
+	BuildTileData(m_VisualSwitchNumberBottom, 2, false);
+}
+
+void CRenderLayerEntitySwitch::Upload()
 {
-	UploadTileData(m_VisualTiles, 0, false);
-	UploadTileData(m_VisualSwitchNumberTop, 1, false);
-	UploadTileData(m_VisualSwitchNumberBottom, 2, false);
+	UploadTileData(m_VisualTiles);
+	UploadTileData(m_VisualSwitchNumberTop);
+	UploadTileData(m_VisualSwitchNumberBottom);
 }
 
 void CRenderLayerEntitySwitch::InitTileData()
@@ -68,6 +68,10 @@ public:
 	virtual void OnInit(IGraphics *pGraphics, ITextRender *pTextRender, CRenderMap *pRenderMap, std::shared_ptr<CEnvelopeManager> &pEnvelopeManager, IMap *pMap, IMapImages *pMapImages, std::optional<FRenderUploadCallback> &FRenderUploadCallbackOptional);
 
 	virtual void Init() = 0;
+	// builds the vertex data after Init, possibly on a worker thread, so it must not call into the graphics backend
+	virtual void Build() {}
+	// uploads the data prepared by Build, always called on the main thread in layer order
+	virtual void Upload() {}
 	virtual void Render(const CRenderLayerParams &Params) = 0;
 	virtual bool DoRender(const CRenderLayerParams &Params) = 0;
 	virtual bool IsValid() const { return true; }
@@ -119,6 +123,8 @@ public:
 	void Render(const CRenderLayerParams &Params) override;
 	bool DoRender(const CRenderLayerParams &Params) override;
 	void Init() override;
+	void Build() override;
+	void Upload() override;
 	void OnInit(IGraphics *pGraphics, ITextRender *pTextRender, CRenderMap *pRenderMap, std::shared_ptr<CEnvelopeManager> &pEnvelopeManager, IMap *pMap, IMapImages *pMapImages, std::optional<FRenderUploadCallback> &FRenderUploadCallbackOptional) override;
 
 	virtual int GetDataIndex(unsigned int &TileSize) const;
@@ -208,9 +214,15 @@ protected:
 		unsigned int m_Height;
 		int m_BufferContainerIndex;
 		bool m_IsTextured;
+
+		// vertex data built by BuildTileData, ownership is moved to the graphics backend by UploadTileData
+		void *m_pUploadData = nullptr;
+		size_t m_UploadDataSize = 0;
+		size_t m_NumUploadTiles = 0;
 	};
 
-	void UploadTileData(std::optional<CTileLayerVisuals> &VisualsOptional, int CurOverlay, bool AddAsSpeedup, bool IsGameLayer = false);
+	void BuildTileData(std::optional<CTileLayerVisuals> &VisualsOptional, int CurOverlay, bool AddAsSpeedup, bool IsGameLayer = false);
+	void UploadTileData(std::optional<CTileLayerVisuals> &VisualsOptional);
 
 	virtual void RenderTileLayerWithTileBuffer(const ColorRGBA &Color, const CRenderLayerParams &Params);
 	virtual void RenderTileLayerNoTileBuffer(const ColorRGBA &Color, const CRenderLayerParams &Params);
@@ -222,6 +234,7 @@ protected:
 	std::optional<CRenderLayerTile::CTileLayerVisuals> m_VisualTiles;
 	CMapItemLayerTilemap *m_pLayerTilemap;
 	ColorRGBA m_Color;
+	bool m_DoTextureCoords = false;
 };
 
 class CRenderLayerQuads : public CRenderLayer
@@ -295,7 +308,7 @@ class CRenderLayerEntityGame final : public CRenderLayerEntityBase
 {
 public:
 	CRenderLayerEntityGame(int GroupId, int LayerId, int Flags, CMapItemLayerTilemap *pLayerTilemap);
-	void Init() override;
+	void Build() override;
 
 protected:
 	void RenderTileLayerWithTileBuffer(const ColorRGBA &Color, const CRenderLayerParams &Params) override;
@@ -317,7 +330,8 @@ class CRenderLayerEntityTele final : public CRenderLayerEntityBase
 public:
 	CRenderLayerEntityTele(int GroupId, int LayerId, int Flags, CMapItemLayerTilemap *pLayerTilemap);
 	int GetDataIndex(unsigned int &TileSize) const override;
-	void Init() override;
+	void Build() override;
+	void Upload() override;
 	void InitTileData() override;
 	void Unload() override;
 
@@ -336,7 +350,8 @@ class CRenderLayerEntitySpeedup final : public CRenderLayerEntityBase
 public:
 	CRenderLayerEntitySpeedup(int GroupId, int LayerId, int Flags, CMapItemLayerTilemap *pLayerTilemap);
 	int GetDataIndex(unsigned int &TileSize) const override;
-	void Init() override;
+	void Build() override;
+	void Upload() override;
 	void InitTileData() override;
 	void Unload() override;
 
@@ -357,7 +372,8 @@ class CRenderLayerEntitySwitch final : public CRenderLayerEntityBase
 public:
 	CRenderLayerEntitySwitch(int GroupId, int LayerId, int Flags, CMapItemLayerTilemap *pLayerTilemap);
 	int GetDataIndex(unsigned int &TileSize) const override;
-	void Init() override;
+	void Build() override;
+	void Upload() override;
 	void InitTileData() override;
 	void Unload() override;
 
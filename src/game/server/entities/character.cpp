@@ -1174,6 +1174,12 @@ void CCharacter::SnapCharacter(int SnappingClient, int Id)
 		// will consider invalid. https://github.com/ddnet/ddnet/issues/3915
 		pCharacter->m_HookTick = maximum(0, pCharacter->m_HookTick);
 
+		if(pCharacter->m_HookedPlayer != -1)
+		{
+			if(!Server()->Translate(pCharacter->m_HookedPlayer, SnappingClient))
+				pCharacter->m_HookedPlayer = -1;
+		}
+
 		pCharacter->m_Tick = Tick;
 		pCharacter->m_Emote = Emote;
 		pCharacter->m_AttackTick = m_AttackTick;
@@ -2292,7 +2298,8 @@ void CCharacter::DDRacePostCoreTick()
 		return;
 
 	// handle Anti-Skip tiles
-	std::vector<int> vIndices = Collision()->GetMapIndices(m_PrevPos, m_Pos);
+	std::vector<int> &vIndices = GameWorld()->m_vMapIndices;
+	Collision()->GetMapIndices(m_PrevPos, m_Pos, vIndices);
 	if(!vIndices.empty())
 	{
 		for(int &Index : vIndices)
@@ -31,6 +31,7 @@
 #include <engine/shared/json.h>
 #include <engine/shared/linereader.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/protocolglue.h>
 #include <engine/storage.h>
@@ -1148,6 +1149,7 @@ void CGameContext::OnTick()
 
 	if(m_TeeHistorianActive)
 	{
+		const CProfileScope ProfileScope("teehistorian");
 		int Error = aio_error(m_pTeeHistorianFile);
 		if(Error)
 		{
@@ -1166,28 +1168,37 @@ void CGameContext::OnTick()
 
 	// copy tuning
 	*m_World.GetTuning(0) = m_aTuningList[0];
-	m_World.Tick();
+	{
+		const CProfileScope ProfileScope("world");
+		m_World.Tick();
+	}
 
 	UpdatePlayerMaps();
 
-	m_pController->Tick();
+	{
+		const CProfileScope ProfileScope("controller");
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		const CProfileScope ProfileScope("players");
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			// send vote options
-			ProgressVoteOptions(i);
+			if(m_apPlayers[i])
+			{
+				// send vote options
+				ProgressVoteOptions(i);
 
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+			}
 		}
-	}
 
-	for(auto &pPlayer : m_apPlayers)
-	{
-		if(pPlayer)
-			pPlayer->PostPostTick();
+		for(auto &pPlayer : m_apPlayers)
+		{
+			if(pPlayer)
+				pPlayer->PostPostTick();
+		}
 	}
 
 	// update voting
@@ -1443,6 +1454,7 @@ void CGameContext::OnTick()
 	// Record player position at the end of the tick
 	if(m_TeeHistorianActive)
 	{
+		const CProfileScope ProfileScope("teehistorian");
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
 			if(m_apPlayers[i] && m_apPlayers[i]->GetCharacter())
@@ -6,6 +6,7 @@
 
 #include <engine/server.h>
 #include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/protocol7.h>
 
@@ -231,6 +232,7 @@ void CGameControllerDDNet::Tick()
 {
 	IGameController::Tick();
 	Teams().ProcessSaveTeam();
+	const CProfileScope ProfileScope("teams");
 	Teams().Tick();
 }
 
@@ -9,12 +9,16 @@
 #include "gamecontroller.h"
 
 #include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
 
 #include <game/collision.h>
 
 #include <algorithm>
 #include <utility>
 
+// profiler scope names of the entity types
+static constexpr const char *ENTITY_TYPE_NAMES[CGameWorld::NUM_ENTTYPES] = {"projectile", "laser", "pickup", "flag", "character"};
+
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
@@ -117,11 +121,14 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 //
 void CGameWorld::Snap(int SnappingClient)
 {
-	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt;)
 	{
-		m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-		pEnt->Snap(SnappingClient);
-		pEnt = m_pNextTraverseEntity;
+		const CProfileScope ProfileScope(ENTITY_TYPE_NAMES[ENTTYPE_CHARACTER]);
+		for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt;)
+		{
+			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			pEnt->Snap(SnappingClient);
+			pEnt = m_pNextTraverseEntity;
+		}
 	}
 
 	for(int i = 0; i < NUM_ENTTYPES; i++)
@@ -129,6 +136,7 @@ void CGameWorld::Snap(int SnappingClient)
 		if(i == ENTTYPE_CHARACTER)
 			continue;
 
+		const CProfileScope ProfileScope(ENTITY_TYPE_NAMES[i]);
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
 		{
 			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
@@ -210,6 +218,7 @@ void CGameWorld::Tick()
 		// update all objects
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 		{
+			const CProfileScope ProfileScope(ENTITY_TYPE_NAMES[i]);
 			// It's important to call PreTick() and Tick() after each other.
 			// If we call PreTick() before, and Tick() after other entities have been processed, it causes physics changes such as a stronger shotgun or grenade.
 			if(g_Config.m_SvNoWeakHook && i == ENTTYPE_CHARACTER)
@@ -232,6 +241,7 @@ void CGameWorld::Tick()
 			}
 		}
 
+		const CProfileScope ProfileScope("deferred");
 		for(auto *pEnt : m_apFirstEntityTypes)
 			for(; pEnt;)
 			{
@@ -52,6 +52,9 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	// reused for the tiles along the path of characters to avoid allocations
+	std::vector<int> m_vMapIndices;
+
 	CGameWorld();
 	~CGameWorld();
 
@@ -384,8 +384,11 @@ void CPlayer::Snap(int SnappingClient)
 			if(!pSpectatorInfo)
 				return;
 
-			pSpectatorInfo->m_SpecMode = m_SpectatorId == SPEC_FREEVIEW ? protocol7::SPEC_FREEVIEW : protocol7::SPEC_PLAYER;
-			pSpectatorInfo->m_SpectatorId = m_SpectatorId;
+			int SpectatorId = m_SpectatorId;
+			if(!Server()->Translate(SpectatorId, SnappingClient))
+				SpectatorId = SPEC_FREEVIEW;
+			pSpectatorInfo->m_SpecMode = SpectatorId == SPEC_FREEVIEW ? protocol7::SPEC_FREEVIEW : protocol7::SPEC_PLAYER;
+			pSpectatorInfo->m_SpectatorId = SpectatorId;
 			pSpectatorInfo->m_X = m_ViewPos.x;
 			pSpectatorInfo->m_Y = m_ViewPos.y;
 		}
@@ -12,6 +12,8 @@
 
 #include <game/gamecore.h>
 
+#include <iterator>
+
 class CTeehistorianPacker : public CAbstractPacker
 {
 public:
@@ -880,3 +882,207 @@ void CTeeHistorian::Finish()
 
 	Write(Buffer.Data(), Buffer.Size());
 }
+
+bool CTeeHistorianReader::Open(const void *pData, int DataSize)
+{
+	m_pHeader = nullptr;
+	m_Error = false;
+	m_Finished = false;
+
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	if(DataSize < (int)sizeof(TEEHISTORIAN_UUID) || mem_comp(pBytes, &TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID)) != 0)
+	{
+		return false;
+	}
+	// the header is a null-terminated JSON object
+	const int HeaderStart = sizeof(TEEHISTORIAN_UUID);
+	int HeaderEnd = HeaderStart;
+	while(HeaderEnd < DataSize && pBytes[HeaderEnd] != 0)
+	{
+		HeaderEnd++;
+	}
+	if(HeaderEnd == DataSize)
+	{
+		return false;
+	}
+	m_pHeader = (const char *)&pBytes[HeaderStart];
+	m_Unpacker.Reset(&pBytes[HeaderEnd + 1], DataSize - (HeaderEnd + 1));
+
+	// Tick 0 is implicit at the start, see `CTeeHistorian::Reset`.
+	m_Tick = 0;
+	m_MaxClientId = MAX_CLIENTS;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aX[i] = 0;
+		m_aY[i] = 0;
+		mem_zero(&m_aInputs[i], sizeof(m_aInputs[i]));
+	}
+	return true;
+}
+
+bool CTeeHistorianReader::ReadClientId(int *pClientId)
+{
+	*pClientId = m_Unpacker.GetInt();
+	return !m_Unpacker.Error() && *pClientId >= 0 && *pClientId < MAX_CLIENTS;
+}
+
+bool CTeeHistorianReader::Read(CChunk *pChunk)
+{
+	while(!m_Error && !m_Finished && m_Unpacker.RemainingSize() > 0)
+	{
+		pChunk->m_ClientId = -1;
+		pChunk->m_pString = nullptr;
+		pChunk->m_vpArguments.clear();
+		pChunk->m_pData = nullptr;
+		pChunk->m_DataSize = 0;
+
+		const int Type = m_Unpacker.GetInt();
+		bool PlayerData = false;
+		if(Type >= 0)
+		{
+			// position difference, the type is the client ID
+			pChunk->m_Type = CHUNK_PLAYER;
+			pChunk->m_ClientId = Type;
+			const int Dx = m_Unpacker.GetInt();
+			const int Dy = m_Unpacker.GetInt();
+			m_Error = m_Unpacker.Error() || Type >= MAX_CLIENTS;
+			if(!m_Error)
+			{
+				m_aX[Type] += Dx;
+				m_aY[Type] += Dy;
+				pChunk->m_X = m_aX[Type];
+				pChunk->m_Y = m_aY[Type];
+			}
+			PlayerData = true;
+		}
+		else
+		{
+			switch(-Type)
+			{
+			case TEEHISTORIAN_FINISH:
+				pChunk->m_Type = CHUNK_FINISH;
+				m_Finished = true;
+				break;
+			case TEEHISTORIAN_TICK_SKIP:
+			{
+				const int Dt = m_Unpacker.GetInt();
+				m_Error = m_Unpacker.Error() || Dt < 0;
+				m_Tick += Dt + 1;
+				m_MaxClientId = -1;
+				continue;
+			}
+			case TEEHISTORIAN_PLAYER_NEW:
+				pChunk->m_Type = CHUNK_PLAYER;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				pChunk->m_X = m_Unpacker.GetInt();
+				pChunk->m_Y = m_Unpacker.GetInt();
+				m_Error = m_Error || m_Unpacker.Error();
+				if(!m_Error)
+				{
+					m_aX[pChunk->m_ClientId] = pChunk->m_X;
+					m_aY[pChunk->m_ClientId] = pChunk->m_Y;
+				}
+				PlayerData = true;
+				break;
+			case TEEHISTORIAN_PLAYER_OLD:
+				pChunk->m_Type = CHUNK_PLAYER_OLD;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				PlayerData = true;
+				break;
+			case TEEHISTORIAN_INPUT_DIFF:
+			case TEEHISTORIAN_INPUT_NEW:
+			{
+				pChunk->m_Type = CHUNK_INPUT;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				int aInput[sizeof(CNetObj_PlayerInput) / sizeof(int32_t)];
+				for(int &Value : aInput)
+				{
+					Value = m_Unpacker.GetInt();
+				}
+				m_Error = m_Error || m_Unpacker.Error();
+				if(!m_Error)
+				{
+					int *pInput = (int *)&m_aInputs[pChunk->m_ClientId];
+					for(size_t i = 0; i < std::size(aInput); i++)
+					{
+						pInput[i] = -Type == TEEHISTORIAN_INPUT_DIFF ? pInput[i] + aInput[i] : aInput[i];
+					}
+					pChunk->m_Input = m_aInputs[pChunk->m_ClientId];
+				}
+				break;
+			}
+			case TEEHISTORIAN_MESSAGE:
+				pChunk->m_Type = CHUNK_MESSAGE;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				pChunk->m_DataSize = m_Unpacker.GetInt();
+				m_Error = m_Error || m_Unpacker.Error() || pChunk->m_DataSize < 0;
+				if(!m_Error)
+				{
+					pChunk->m_pData = m_Unpacker.GetRaw(pChunk->m_DataSize);
+					m_Error = m_Unpacker.Error();
+				}
+				break;
+			case TEEHISTORIAN_JOIN:
+				pChunk->m_Type = CHUNK_JOIN;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				break;
+			case TEEHISTORIAN_DROP:
+				pChunk->m_Type = CHUNK_DROP;
+				m_Error = !ReadClientId(&pChunk->m_ClientId);
+				pChunk->m_pString = m_Unpacker.GetString(0);
+				m_Error = m_Error || m_Unpacker.Error();
+				break;
+			case TEEHISTORIAN_CONSOLE_COMMAND:
+			{
+				pChunk->m_Type = CHUNK_CONSOLE_COMMAND;
+				// console commands not issued by a client have the client ID -1
+				pChunk->m_ClientId = m_Unpacker.GetInt();
+				pChunk->m_FlagMask = m_Unpacker.GetInt();
+				pChunk->m_pString = m_Unpacker.GetString(0);
+				const int NumArguments = m_Unpacker.GetInt();
+				for(int i = 0; i < NumArguments && !m_Unpacker.Error(); i++)
+				{
+					pChunk->m_vpArguments.push_back(m_Unpacker.GetString(0));
+				}
+				m_Error = m_Unpacker.Error() || pChunk->m_ClientId < -1 || pChunk->m_ClientId >= MAX_CLIENTS;
+				break;
+			}
+			case TEEHISTORIAN_EX:
+			{
+				pChunk->m_Type = CHUNK_EX;
+				const CUuid *pUuid = (const CUuid *)m_Unpacker.GetRaw(sizeof(CUuid));
+				pChunk->m_DataSize = m_Unpacker.GetInt();
+				m_Error = m_Unpacker.Error() || pChunk->m_DataSize < 0;
+				if(!m_Error)
+				{
+					pChunk->m_Uuid = *pUuid;
+					pChunk->m_pData = m_Unpacker.GetRaw(pChunk->m_DataSize);
+					m_Error = m_Unpacker.Error();
+				}
+				break;
+			}
+			default:
+				m_Error = true;
+				break;
+			}
+		}
+		if(m_Error)
+		{
+			return false;
+		}
+
+		if(PlayerData)
+		{
+			// player data is written in ascending client ID order, a lower or
+			// equal client ID starts the next tick
+			if(pChunk->m_ClientId <= m_MaxClientId)
+			{
+				m_Tick++;
+			}
+			m_MaxClientId = pChunk->m_ClientId;
+		}
+		pChunk->m_Tick = m_Tick;
+		return true;
+	}
+	return false;
+}
@@ -4,11 +4,14 @@
 #include <base/hash.h>
 
 #include <engine/console.h>
+#include <engine/shared/packer.h>
 #include <engine/shared/protocol.h>
+#include <engine/shared/uuid_manager.h>
 
 #include <generated/protocol.h>
 
 #include <ctime>
+#include <vector>
 
 class CConfig;
 class CTuningParams;
@@ -150,4 +153,100 @@ private:
 	CTeam m_aPrevTeams[MAX_CLIENTS];
 };
 
+/**
+ * Reads the chunks of a teehistorian file written by `CTeeHistorian`.
+ *
+ * Positions and inputs are stored as differences in the file, the reader
+ * keeps track of the previous values and returns absolute ones. Ticks are
+ * mostly implicit in the file, the reader reconstructs the tick of each chunk.
+ * Position chunks of a tick describe the state after that tick, all other
+ * chunks of a tick happened after it, before the next tick.
+ */
+class CTeeHistorianReader
+{
+public:
+	enum EChunk
+	{
+		CHUNK_PLAYER, // position of an alive player
+		CHUNK_PLAYER_OLD, // player is no longer alive
+		CHUNK_INPUT,
+		CHUNK_MESSAGE,
+		CHUNK_JOIN,
+		CHUNK_DROP,
+		CHUNK_CONSOLE_COMMAND,
+		CHUNK_EX,
+		CHUNK_FINISH,
+	};
+
+	class CChunk
+	{
+	public:
+		EChunk m_Type;
+		int m_Tick;
+		int m_ClientId;
+
+		// CHUNK_PLAYER
+		int m_X;
+		int m_Y;
+
+		// CHUNK_INPUT
+		CNetObj_PlayerInput m_Input;
+
+		// CHUNK_DROP reason, CHUNK_CONSOLE_COMMAND command
+		const char *m_pString;
+
+		// CHUNK_CONSOLE_COMMAND
+		int m_FlagMask;
+		std::vector<const char *> m_vpArguments;
+
+		// CHUNK_EX
+		CUuid m_Uuid;
+
+		// CHUNK_MESSAGE, CHUNK_EX
+		const void *m_pData;
+		int m_DataSize;
+	};
+
+	/**
+	 * Starts reading a teehistorian file from memory.
+	 *
+	 * @param pData Contents of the file, must stay valid while reading.
+	 * @param DataSize Size of the file.
+	 *
+	 * @return `true` on success, `false` if the data does not start with a valid header.
+	 */
+	bool Open(const void *pData, int DataSize);
+
+	/**
+	 * @return The JSON header of the file.
+	 */
+	const char *Header() const { return m_pHeader; }
+
+	/**
+	 * Reads the next chunk.
+	 *
+	 * @param pChunk Receives the chunk, strings and data point into the file contents.
+	 *
+	 * @return `true` if a chunk was read, `false` at the end of the file or on error.
+	 */
+	bool Read(CChunk *pChunk);
+
+	bool Error() const { return m_Error; }
+	bool Finished() const { return m_Finished; }
+
+private:
+	bool ReadClientId(int *pClientId);
+
+	CUnpacker m_Unpacker;
+	const char *m_pHeader = nullptr;
+	bool m_Error = false;
+	bool m_Finished = false;
+
+	int m_Tick;
+	int m_MaxClientId;
+	int m_aX[MAX_CLIENTS];
+	int m_aY[MAX_CLIENTS];
+	CNetObj_PlayerInput m_aInputs[MAX_CLIENTS];
+};
+
 #endif // GAME_SERVER_TEEHISTORIAN_H
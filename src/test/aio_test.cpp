@@ -3,11 +3,20 @@
 #include <base/aio.h>
 #include <base/fs.h>
 #include <base/io.h>
+#include <base/log.h>
 #include <base/mem.h>
 #include <base/str.h>
+#include <base/time.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
 static const int BUF_SIZE = 64 * 1024;
 
 class Async : public ::testing::Test
@@ -54,6 +63,19 @@ protected:
 		ASSERT_TRUE(mem_comp(aBuf, pOutput, Read) == 0);
 		Delete = true;
 	}
+
+	std::string ReadAll()
+	{
+		aio_close(m_pAio);
+		aio_wait(m_pAio);
+		aio_free(m_pAio);
+
+		char *pContent = io_read_all_str(io_open(m_Info.m_aFilename, IOFLAG_READ));
+		std::string Content = pContent ? pContent : "";
+		free(pContent);
+		Delete = true;
+		return Content;
+	}
 };
 
 TEST_F(Async, Empty)
@@ -149,3 +171,118 @@ TEST_F(Async, Transaction)
 	}
 	Expect(aText);
 }
+
+TEST_F(Async, LongAfterPieces)
+{
+	std::string Text;
+	for(int i = 0; i < 1000; i++)
+	{
+		Write("abc");
+		Text += "abc";
+	}
+	std::string Long(BUF_SIZE * 2, 'x');
+	Write(Long.c_str());
+	Text += Long;
+	Write("end");
+	Text += "end";
+	EXPECT_EQ(ReadAll(), Text);
+}
+
+TEST_F(Async, MultipleThreads)
+{
+	static const int NUM_THREADS = 4;
+	static const int NUM_LINES_PER_THREAD = 20000;
+
+	// every line has a different length, some of them are too long for the ring buffer
+	const auto &&Line = [](int Thread, int Index) {
+		char aBuf[64];
+		str_format(aBuf, sizeof(aBuf), "%d %d ", Thread, Index);
+		const int Padding = Index % 1000 == 0 ? BUF_SIZE / 2 : Index % 97;
+		return aBuf + std::string(Padding, 'a' + Thread) + "\n";
+	};
+
+	std::vector<std::thread> vThreads;
+	for(int Thread = 0; Thread < NUM_THREADS; Thread++)
+	{
+		vThreads.emplace_back([&, Thread] {
+			for(int i = 0; i < NUM_LINES_PER_THREAD; i++)
+			{
+				const std::string Text = Line(Thread, i);
+				if(i % 2)
+				{
+					aio_write(m_pAio, Text.data(), Text.size());
+				}
+				else
+				{
+					// transactions must not be interleaved either
+					aio_lock(m_pAio);
+					aio_write_unlocked(m_pAio, Text.data(), Text.size() / 2);
+					aio_write_unlocked(m_pAio, Text.data() + Text.size() / 2, Text.size() - Text.size() / 2);
+					aio_unlock(m_pAio);
+				}
+			}
+		});
+	}
+	for(std::thread &Thread : vThreads)
+	{
+		Thread.join();
+	}
+
+	// the lines of each thread must arrive complete and in order
+	const std::string Content = ReadAll();
+	int aNextIndex[NUM_THREADS] = {0};
+	size_t Start = 0;
+	while(Start < Content.size())
+	{
+		const size_t End = Content.find('\n', Start);
+		ASSERT_NE(End, std::string::npos);
+		int Thread, Index;
+		ASSERT_EQ(sscanf(Content.c_str() + Start, "%d %d ", &Thread, &Index), 2);
+		ASSERT_GE(Thread, 0);
+		ASSERT_LT(Thread, NUM_THREADS);
+		ASSERT_EQ(Index, aNextIndex[Thread]);
+		ASSERT_EQ(Content.compare(Start, End + 1 - Start, Line(Thread, Index)), 0);
+		aNextIndex[Thread]++;
+		Start = End + 1;
+	}
+	for(int NextIndex : aNextIndex)
+	{
+		EXPECT_EQ(NextIndex, NUM_LINES_PER_THREAD);
+	}
+}
+
+TEST_F(Async, Benchmark)
+{
+	static const int NUM_THREADS = 4;
+	static const int NUM_LINES_PER_THREAD = 100000;
+	static const char LINE[] = "[2024-01-01 00:00:00][I][server]: player 'nameless tee' joined the game\n";
+
+	std::vector<std::chrono::nanoseconds> vMaxLatency(NUM_THREADS);
+	std::vector<std::thread> vThreads;
+	const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+	for(int Thread = 0; Thread < NUM_THREADS; Thread++)
+	{
+		vThreads.emplace_back([&, Thread] {
+			for(int i = 0; i < NUM_LINES_PER_THREAD; i++)
+			{
+				const std::chrono::nanoseconds WriteStart = time_get_nanoseconds();
+				aio_write(m_pAio, LINE, sizeof(LINE) - 1);
+				vMaxLatency[Thread] = std::max(vMaxLatency[Thread], time_get_nanoseconds() - WriteStart);
+			}
+		});
+	}
+	for(std::thread &Thread : vThreads)
+	{
+		Thread.join();
+	}
+	const std::chrono::duration<double> WriteDuration = time_get_nanoseconds() - StartTime;
+	const size_t Size = ReadAll().size();
+	const std::chrono::duration<double> Duration = time_get_nanoseconds() - StartTime;
+	EXPECT_EQ(Size, (sizeof(LINE) - 1) * NUM_THREADS * NUM_LINES_PER_THREAD);
+
+	const double NumLines = NUM_THREADS * NUM_LINES_PER_THREAD;
+	log_info("aio_test", "%d threads: %.0f lines/s written, %.0f lines/s on disk, average write %.0f ns, maximum write %.0f us",
+		NUM_THREADS, NumLines / WriteDuration.count(), NumLines / Duration.count(),
+		WriteDuration.count() * 1e9 / NUM_LINES_PER_THREAD,
+		std::chrono::duration<double, std::micro>(*std::max_element(vMaxLatency.begin(), vMaxLatency.end())).count());
+}
@@ -0,0 +1,636 @@
+#include "test.h"
+
+#include <base/log.h>
+#include <base/str.h>
+#include <base/time.h>
+#include <base/vmath.h>
+
+#include <engine/shared/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// The collision queries as they were before CCollision kept compact copies of
+// the game and front layer, reading the tiles of the layers directly.
+class CReferenceCollision
+{
+	enum
+	{
+		MR_DIR_HERE = 0,
+		MR_DIR_RIGHT,
+		MR_DIR_DOWN,
+		MR_DIR_LEFT,
+		MR_DIR_UP,
+		NUM_MR_DIRS
+	};
+
+	const CCollision &m_Collision;
+
+	static int GetMoveRestrictionsRaw(int Direction, int Tile, int Flags)
+	{
+		Flags = Flags & (TILEFLAG_XFLIP | TILEFLAG_YFLIP | TILEFLAG_ROTATE);
+		switch(Tile)
+		{
+		case TILE_STOP:
+			switch(Flags)
+			{
+			case ROTATION_0: return CANTMOVE_DOWN;
+			case ROTATION_90: return CANTMOVE_LEFT;
+			case ROTATION_180: return CANTMOVE_UP;
+			case ROTATION_270: return CANTMOVE_RIGHT;
+
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_0): return CANTMOVE_UP;
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_90): return CANTMOVE_RIGHT;
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_180): return CANTMOVE_DOWN;
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_270): return CANTMOVE_LEFT;
+			}
+			break;
+		case TILE_STOPS:
+			switch(Flags)
+			{
+			case ROTATION_0:
+			case ROTATION_180:
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_0):
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_180):
+				return CANTMOVE_DOWN | CANTMOVE_UP;
+			case ROTATION_90:
+			case ROTATION_270:
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_90):
+			case static_cast<int>(TILEFLAG_YFLIP) ^ static_cast<int>(ROTATION_270):
+				return CANTMOVE_LEFT | CANTMOVE_RIGHT;
+			}
+			break;
+		case TILE_STOPA:
+			return CANTMOVE_LEFT | CANTMOVE_RIGHT | CANTMOVE_UP | CANTMOVE_DOWN;
+		}
+		return 0;
+	}
+
+	static int GetMoveRestrictionsMask(int Direction)
+	{
+		switch(Direction)
+		{
+		case MR_DIR_RIGHT: return CANTMOVE_RIGHT;
+		case MR_DIR_DOWN: return CANTMOVE_DOWN;
+		case MR_DIR_LEFT: return CANTMOVE_LEFT;
+		case MR_DIR_UP: return CANTMOVE_UP;
+		}
+		return 0;
+	}
+
+	static int GetMoveRestrictions(int Direction, int Tile, int Flags)
+	{
+		int Result = GetMoveRestrictionsRaw(Direction, Tile, Flags);
+		if(Direction == MR_DIR_HERE && Tile == TILE_STOP)
+		{
+			return Result;
+		}
+		return Result & GetMoveRestrictionsMask(Direction);
+	}
+
+	int TileIndex(int x, int y) const
+	{
+		int Nx = std::clamp(x / 32, 0, m_Collision.GetWidth() - 1);
+		int Ny = std::clamp(y / 32, 0, m_Collision.GetHeight() - 1);
+		return Ny * m_Collision.GetWidth() + Nx;
+	}
+
+	static bool IsStopper(const CTile &Right, const CTile &Left, const CTile &Below, const CTile &Above)
+	{
+		if((Right.m_Index == TILE_STOP && Right.m_Flags == ROTATION_270) || (Left.m_Index == TILE_STOP && Left.m_Flags == ROTATION_90))
+			return true;
+		if((Below.m_Index == TILE_STOP && Below.m_Flags == ROTATION_0) || (Above.m_Index == TILE_STOP && Above.m_Flags == ROTATION_180))
+			return true;
+		if(Right.m_Index == TILE_STOPA || Left.m_Index == TILE_STOPA || Right.m_Index == TILE_STOPS || Left.m_Index == TILE_STOPS)
+			return true;
+		if(Below.m_Index == TILE_STOPA || Above.m_Index == TILE_STOPA || Below.m_Index == TILE_STOPS || Above.m_Index == TILE_STOPS)
+			return true;
+		return false;
+	}
+
+	CTile DoorTile(int Index) const
+	{
+		CDoorTile Door;
+		m_Collision.GetDoorTile(Index, &Door);
+		CTile Tile = {};
+		Tile.m_Index = Door.m_Index;
+		Tile.m_Flags = Door.m_Flags;
+		return Tile;
+	}
+
+public:
+	CReferenceCollision(const CCollision &Collision) :
+		m_Collision(Collision) {}
+
+	int GetTile(int x, int y) const
+	{
+		const CTile *pTiles = m_Collision.GameLayer();
+		const int Index = TileIndex(x, y);
+		if(pTiles[Index].m_Index >= TILE_SOLID && pTiles[Index].m_Index <= TILE_NOLASER)
+			return pTiles[Index].m_Index;
+		return 0;
+	}
+
+	int IsSolid(int x, int y) const
+	{
+		int Index = GetTile(x, y);
+		return Index == TILE_SOLID || Index == TILE_NOHOOK;
+	}
+
+	bool CheckPoint(float x, float y) const { return IsSolid(round_to_int(x), round_to_int(y)); }
+
+	int GetIndex(int Nx, int Ny) const
+	{
+		return m_Collision.GameLayer()[Ny * m_Collision.GetWidth() + Nx].m_Index;
+	}
+
+	int GetFrontIndex(int Nx, int Ny) const
+	{
+		if(!m_Collision.FrontLayer())
+			return 0;
+		return m_Collision.FrontLayer()[Ny * m_Collision.GetWidth() + Nx].m_Index;
+	}
+
+	int GetMoveRestrictions(CALLBACK_SWITCHACTIVE pfnSwitchActive, void *pUser, vec2 Pos, float Distance = 18.0f) const
+	{
+		static const vec2 DIRECTIONS[NUM_MR_DIRS] =
+			{
+				vec2(0, 0),
+				vec2(1, 0),
+				vec2(0, 1),
+				vec2(-1, 0),
+				vec2(0, -1)};
+		int Restrictions = 0;
+		for(int d = 0; d < NUM_MR_DIRS; d++)
+		{
+			vec2 ModPos = Pos + DIRECTIONS[d] * Distance;
+			int ModMapIndex = m_Collision.GetPureMapIndex(ModPos);
+			for(int Front = 0; Front < 2; Front++)
+			{
+				int Tile;
+				int Flags;
+				if(!Front)
+				{
+					Tile = m_Collision.GetTileIndex(ModMapIndex);
+					Flags = m_Collision.GetTileFlags(ModMapIndex);
+				}
+				else
+				{
+					Tile = m_Collision.GetFrontTileIndex(ModMapIndex);
+					Flags = m_Collision.GetFrontTileFlags(ModMapIndex);
+				}
+				Restrictions |= GetMoveRestrictions(d, Tile, Flags);
+			}
+			if(pfnSwitchActive)
+			{
+				CDoorTile DoorTile;
+				m_Collision.GetDoorTile(ModMapIndex, &DoorTile);
+				if(in_range(DoorTile.m_Number, 0, m_Collision.m_HighestSwitchNumber) &&
+					pfnSwitchActive(DoorTile.m_Number, pUser))
+				{
+					Restrictions |= GetMoveRestrictions(d, DoorTile.m_Index, DoorTile.m_Flags);
+				}
+			}
+		}
+		return Restrictions;
+	}
+
+	// TileExists before it was cached in a bit mask
+	bool TileExists(int Index) const
+	{
+		if(Index < 0)
+			return false;
+
+		const CTile *pTiles = m_Collision.GameLayer();
+		const CTile *pFront = m_Collision.FrontLayer();
+		const CTeleTile *pTele = m_Collision.TeleLayer();
+		const CSpeedupTile *pSpeedup = m_Collision.SpeedupLayer();
+		const CSwitchTile *pSwitch = m_Collision.SwitchLayer();
+		const CTuneTile *pTune = m_Collision.TuneLayer();
+		if((pTiles[Index].m_Index >= TILE_FREEZE && pTiles[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (pTiles[Index].m_Index >= TILE_LFREEZE && pTiles[Index].m_Index <= TILE_LUNFREEZE))
+			return true;
+		if(pFront && ((pFront[Index].m_Index >= TILE_FREEZE && pFront[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (pFront[Index].m_Index >= TILE_LFREEZE && pFront[Index].m_Index <= TILE_LUNFREEZE)))
+			return true;
+		if(pTele && (pTele[Index].m_Type == TILE_TELEIN || pTele[Index].m_Type == TILE_TELEINEVIL || pTele[Index].m_Type == TILE_TELECHECKINEVIL || pTele[Index].m_Type == TILE_TELECHECK || pTele[Index].m_Type == TILE_TELECHECKIN))
+			return true;
+		if(pSpeedup && pSpeedup[Index].m_Force > 0)
+			return true;
+		if(DoorTile(Index).m_Index)
+			return true;
+		if(pSwitch && pSwitch[Index].m_Type)
+			return true;
+		if(pTune && pTune[Index].m_Type)
+			return true;
+
+		const int Size = m_Collision.GetWidth() * m_Collision.GetHeight();
+		const int Right = (Index + 1 < Size) ? Index + 1 : Index;
+		const int Left = (Index - 1 > 0) ? Index - 1 : Index;
+		const int Below = (Index + m_Collision.GetWidth() < Size) ? Index + m_Collision.GetWidth() : Index;
+		const int Above = (Index - m_Collision.GetWidth() > 0) ? Index - m_Collision.GetWidth() : Index;
+		if(IsStopper(pTiles[Right], pTiles[Left], pTiles[Below], pTiles[Above]))
+			return true;
+		if(pFront && IsStopper(pFront[Right], pFront[Left], pFront[Below], pFront[Above]))
+			return true;
+		return IsStopper(DoorTile(Right), DoorTile(Left), DoorTile(Below), DoorTile(Above));
+	}
+
+	std::vector<int> GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices = 0) const
+	{
+		std::vector<int> vIndices;
+		float d = distance(PrevPos, Pos);
+		int End(d + 1);
+		if(!d)
+		{
+			int Index = TileIndex((int)Pos.x, (int)Pos.y);
+			if(TileExists(Index))
+				vIndices.push_back(Index);
+			return vIndices;
+		}
+
+		int LastIndex = 0;
+		for(int i = 0; i < End; i++)
+		{
+			float a = i / d;
+			vec2 Tmp = mix(PrevPos, Pos, a);
+			int Index = TileIndex((int)Tmp.x, (int)Tmp.y);
+			if(TileExists(Index) && LastIndex != Index)
+			{
+				if(MaxIndices && vIndices.size() > MaxIndices)
+					return vIndices;
+				vIndices.push_back(Index);
+				LastIndex = Index;
+			}
+		}
+		return vIndices;
+	}
+
+	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
+	{
+		float Distance = distance(Pos0, Pos1);
+		int End(Distance + 1);
+		vec2 Last = Pos0;
+		for(int i = 0; i <= End; i++)
+		{
+			float a = i / (float)End;
+			vec2 Pos = mix(Pos0, Pos1, a);
+			int ix = round_to_int(Pos.x);
+			int iy = round_to_int(Pos.y);
+
+			if(CheckPoint(ix, iy))
+			{
+				if(pOutCollision)
+					*pOutCollision = Pos;
+				if(pOutBeforeCollision)
+					*pOutBeforeCollision = Last;
+				return GetTile(ix, iy);
+			}
+
+			Last = Pos;
+		}
+		if(pOutCollision)
+			*pOutCollision = Pos1;
+		if(pOutBeforeCollision)
+			*pOutBeforeCollision = Pos1;
+		return 0;
+	}
+
+	bool TestBox(vec2 Pos, vec2 Size) const
+	{
+		Size *= 0.5f;
+		if(CheckPoint(Pos.x - Size.x, Pos.y - Size.y))
+			return true;
+		if(CheckPoint(Pos.x + Size.x, Pos.y - Size.y))
+			return true;
+		if(CheckPoint(Pos.x - Size.x, Pos.y + Size.y))
+			return true;
+		if(CheckPoint(Pos.x + Size.x, Pos.y + Size.y))
+			return true;
+		return false;
+	}
+
+	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elasticity, bool *pGrounded = nullptr) const
+	{
+		vec2 Pos = *pInoutPos;
+		vec2 Vel = *pInoutVel;
+
+		float Distance = length(Vel);
+		int Max = (int)Distance;
+
+		if(Distance > 0.00001f)
+		{
+			float Fraction = 1.0f / (float)(Max + 1);
+			float ElasticityX = std::clamp(Elasticity.x, -1.0f, 1.0f);
+			float ElasticityY = std::clamp(Elasticity.y, -1.0f, 1.0f);
+
+			for(int i = 0; i <= Max; i++)
+			{
+				if(Vel == vec2(0, 0))
+				{
+					break;
+				}
+
+				vec2 NewPos = Pos + Vel * Fraction;
+
+				if(NewPos == Pos)
+				{
+					break;
+				}
+
+				if(TestBox(vec2(NewPos.x, NewPos.y), Size))
+				{
+					int Hits = 0;
+
+					if(TestBox(vec2(Pos.x, NewPos.y), Size))
+					{
+						if(pGrounded && ElasticityY > 0 && Vel.y > 0)
+							*pGrounded = true;
+						NewPos.y = Pos.y;
+						Vel.y *= -ElasticityY;
+						Hits++;
+					}
+
+					if(TestBox(vec2(NewPos.x, Pos.y), Size))
+					{
+						NewPos.x = Pos.x;
+						Vel.x *= -ElasticityX;
+						Hits++;
+					}
+
+					if(Hits == 0)
+					{
+						if(pGrounded && ElasticityY > 0 && Vel.y > 0)
+							*pGrounded = true;
+						NewPos.y = Pos.y;
+						Vel.y *= -ElasticityY;
+						NewPos.x = Pos.x;
+						Vel.x *= -ElasticityX;
+					}
+				}
+
+				Pos = NewPos;
+			}
+		}
+
+		*pInoutPos = Pos;
+		*pInoutVel = Vel;
+	}
+};
+
+class CCollisionTestMap
+{
+public:
+	CMap m_Map;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	bool Load(IStorage *pStorage, const char *pPath)
+	{
+		if(!m_Map.Load(pStorage, pPath, IStorage::TYPE_ALL))
+			return false;
+		m_Layers.Init(&m_Map, false);
+		if(!m_Layers.GameLayer())
+			return false;
+		m_Collision.Init(&m_Layers);
+		return true;
+	}
+};
+
+static int CollectMapsCallback(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	if(!IsDir && str_endswith(pName, ".map"))
+		static_cast<std::vector<std::string> *>(pUser)->emplace_back(pName);
+	return 0;
+}
+
+static std::vector<std::string> ShippedMaps(IStorage *pStorage, const char *pFolder)
+{
+	std::vector<std::string> vNames;
+	pStorage->ListDirectory(IStorage::TYPE_ALL, pFolder, CollectMapsCallback, &vNames);
+	std::sort(vNames.begin(), vNames.end());
+	vNames.erase(std::unique(vNames.begin(), vNames.end()), vNames.end());
+	std::vector<std::string> vPaths;
+	for(const std::string &Name : vNames)
+		vPaths.push_back(std::string(pFolder) + "/" + Name);
+	return vPaths;
+}
+
+// switches with an even number are active
+static bool EvenSwitchActive(int Number, void *pUser)
+{
+	return Number % 2 == 0;
+}
+
+static void ExpectSameAsReference(const CCollision &Collision, const char *pMap)
+{
+	const CReferenceCollision Reference(Collision);
+	const vec2 aOffsets[] = {vec2(0.0f, 0.0f), vec2(15.0f, -16.0f)};
+	for(int y = 0; y < Collision.GetHeight(); y++)
+	{
+		for(int x = 0; x < Collision.GetWidth(); x++)
+		{
+			const int PixelX = x * 32 + 16;
+			const int PixelY = y * 32 + 16;
+			EXPECT_EQ(Collision.GetTile(PixelX, PixelY), Reference.GetTile(PixelX, PixelY)) << pMap << " " << x << "," << y;
+			EXPECT_EQ(Collision.IsSolid(PixelX, PixelY), Reference.IsSolid(PixelX, PixelY)) << pMap << " " << x << "," << y;
+			EXPECT_EQ(Collision.GetIndex(x, y), Reference.GetIndex(x, y)) << pMap << " " << x << "," << y;
+			EXPECT_EQ(Collision.GetFrontIndex(x, y), Reference.GetFrontIndex(x, y)) << pMap << " " << x << "," << y;
+			for(const vec2 Offset : aOffsets)
+			{
+				const vec2 Pos = vec2(PixelX, PixelY) + Offset;
+				EXPECT_EQ(Collision.GetMoveRestrictions(Pos), Reference.GetMoveRestrictions(nullptr, nullptr, Pos)) << pMap << " " << x << "," << y;
+				EXPECT_EQ(Collision.GetMoveRestrictions(EvenSwitchActive, nullptr, Pos), Reference.GetMoveRestrictions(EvenSwitchActive, nullptr, Pos)) << pMap << " " << x << "," << y;
+			}
+		}
+		if(::testing::Test::HasFailure())
+			return;
+	}
+}
+
+static void EditCollision(CCollision &Collision, std::mt19937 &Random, int NumEdits)
+{
+	static const int TILES[] = {TILE_AIR, TILE_SOLID, TILE_DEATH, TILE_NOHOOK, TILE_NOLASER, TILE_THROUGH_CUT, TILE_FREEZE, TILE_STOP, TILE_STOPS, TILE_STOPA};
+	static const int DOOR_TILES[] = {TILE_AIR, TILE_SOLID, TILE_NOHOOK, TILE_STOP, TILE_STOPS, TILE_STOPA};
+	std::uniform_real_distribution<float> DistributionX(0.0f, Collision.GetWidth() * 32.0f);
+	std::uniform_real_distribution<float> DistributionY(0.0f, Collision.GetHeight() * 32.0f);
+	for(int i = 0; i < NumEdits; i++)
+	{
+		Collision.SetCollisionAt(DistributionX(Random), DistributionY(Random), TILES[Random() % std::size(TILES)]);
+		Collision.SetDoorCollisionAt(DistributionX(Random), DistributionY(Random), DOOR_TILES[Random() % std::size(DOOR_TILES)], Random() % 16, Random() % (Collision.m_HighestSwitchNumber + 2));
+	}
+}
+
+TEST(Collision, ShippedMapsMatchReference)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+
+	std::vector<std::string> vMaps = ShippedMaps(pStorage.get(), "maps");
+	const std::vector<std::string> vMaps7 = ShippedMaps(pStorage.get(), "maps7");
+	vMaps.insert(vMaps.end(), vMaps7.begin(), vMaps7.end());
+	ASSERT_FALSE(vMaps.empty());
+
+	std::mt19937 Random(42);
+	for(const std::string &Map : vMaps)
+	{
+		CCollisionTestMap TestMap;
+		ASSERT_TRUE(TestMap.Load(pStorage.get(), Map.c_str())) << Map;
+		ExpectSameAsReference(TestMap.m_Collision, Map.c_str());
+		// the compact copies must follow the edits the game makes at runtime
+		EditCollision(TestMap.m_Collision, Random, TestMap.m_Collision.GetWidth() * TestMap.m_Collision.GetHeight() / 16);
+		ExpectSameAsReference(TestMap.m_Collision, Map.c_str());
+		if(HasFailure())
+			return;
+	}
+}
+
+TEST(Collision, Benchmark)
+{
+	static const int NUM_SAMPLES = 5000;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+
+	const std::vector<std::string> vMaps = ShippedMaps(pStorage.get(), "maps");
+	ASSERT_FALSE(vMaps.empty());
+
+	std::mt19937 Random(42);
+	std::vector<std::unique_ptr<CCollisionTestMap>> vpTestMaps;
+	std::vector<std::vector<vec2>> vvPositions;
+	std::vector<std::vector<vec2>> vvVelocities;
+	for(const std::string &Map : vMaps)
+	{
+		vpTestMaps.push_back(std::make_unique<CCollisionTestMap>());
+		CCollision &Collision = vpTestMaps.back()->m_Collision;
+		ASSERT_TRUE(vpTestMaps.back()->Load(pStorage.get(), Map.c_str())) << Map;
+		EditCollision(Collision, Random, 100);
+
+		std::uniform_real_distribution<float> DistributionX(0.0f, Collision.GetWidth() * 32.0f);
+		std::uniform_real_distribution<float> DistributionY(0.0f, Collision.GetHeight() * 32.0f);
+		std::uniform_real_distribution<float> DistributionVel(-40.0f, 40.0f);
+		vvPositions.emplace_back();
+		vvVelocities.emplace_back();
+		for(int i = 0; i < NUM_SAMPLES; i++)
+		{
+			vvPositions.back().emplace_back(DistributionX(Random), DistributionY(Random));
+			vvVelocities.back().emplace_back(DistributionVel(Random), DistributionVel(Random));
+		}
+	}
+
+	std::vector<vec2> vResults;
+	std::vector<vec2> vReferenceResults;
+	const auto &&Measure = [&](std::vector<vec2> &vOut, auto &&Function) {
+		vOut.clear();
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		for(size_t Map = 0; Map < vpTestMaps.size(); Map++)
+			for(int i = 0; i < NUM_SAMPLES; i++)
+				vOut.push_back(Function(vpTestMaps[Map]->m_Collision, vvPositions[Map][i], vvVelocities[Map][i]));
+		return std::chrono::duration<double, std::milli>(time_get_nanoseconds() - StartTime).count();
+	};
+
+	const double MoveBox = Measure(vResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		Collision.MoveBox(&Pos, &Vel, vec2(28.0f, 28.0f), vec2(0.0f, 0.0f));
+		return Pos;
+	});
+	const double ReferenceMoveBox = Measure(vReferenceResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		CReferenceCollision(Collision).MoveBox(&Pos, &Vel, vec2(28.0f, 28.0f), vec2(0.0f, 0.0f));
+		return Pos;
+	});
+	EXPECT_EQ(vResults, vReferenceResults);
+
+	// hook and laser sized lines
+	const double IntersectLine = Measure(vResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		vec2 Out;
+		Collision.IntersectLine(Pos, Pos + Vel * 10.0f, &Out, nullptr);
+		return Out;
+	});
+	const double ReferenceIntersectLine = Measure(vReferenceResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		vec2 Out;
+		CReferenceCollision(Collision).IntersectLine(Pos, Pos + Vel * 10.0f, &Out, nullptr);
+		return Out;
+	});
+	EXPECT_EQ(vResults, vReferenceResults);
+
+	const double MoveRestrictions = Measure(vResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		return vec2(Collision.GetMoveRestrictions(EvenSwitchActive, nullptr, Pos), 0.0f);
+	});
+	const double ReferenceMoveRestrictions = Measure(vReferenceResults, [](const CCollision &Collision, vec2 Pos, vec2 Vel) {
+		return vec2(CReferenceCollision(Collision).GetMoveRestrictions(EvenSwitchActive, nullptr, Pos), 0.0f);
+	});
+	EXPECT_EQ(vResults, vReferenceResults);
+
+	log_info("collision_test", "%d samples on %d maps: MoveBox %.2fms (reference %.2fms), IntersectLine %.2fms (reference %.2fms), GetMoveRestrictions %.2fms (reference %.2fms)",
+		NUM_SAMPLES, (int)vpTestMaps.size(), MoveBox, ReferenceMoveBox, IntersectLine, ReferenceIntersectLine, MoveRestrictions, ReferenceMoveRestrictions);
+}
+
+static void ExpectTileExistsAsReference(const CCollision &Collision, const char *pMap)
+{
+	const CReferenceCollision Reference(Collision);
+	for(int Index = 0; Index < Collision.GetWidth() * Collision.GetHeight(); Index++)
+	{
+		EXPECT_EQ(Collision.TileExists(Index), Reference.TileExists(Index)) << pMap << " " << Index;
+		if(::testing::Test::HasFailure())
+			return;
+	}
+}
+
+TEST(Collision, TileExistsMatchesReference)
+{
+	static const int NUM_PATHS = 2000;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+
+	std::vector<std::string> vMaps = ShippedMaps(pStorage.get(), "maps");
+	const std::vector<std::string> vMaps7 = ShippedMaps(pStorage.get(), "maps7");
+	vMaps.insert(vMaps.end(), vMaps7.begin(), vMaps7.end());
+	ASSERT_FALSE(vMaps.empty());
+
+	std::mt19937 Random(42);
+	std::vector<int> vIndices;
+	for(const std::string &Map : vMaps)
+	{
+		CCollisionTestMap TestMap;
+		CCollision &Collision = TestMap.m_Collision;
+		ASSERT_TRUE(TestMap.Load(pStorage.get(), Map.c_str())) << Map;
+		ExpectTileExistsAsReference(Collision, Map.c_str());
+		// the mask is only updated around the edited tiles
+		EditCollision(Collision, Random, Collision.GetWidth() * Collision.GetHeight() / 16);
+		ExpectTileExistsAsReference(Collision, Map.c_str());
+
+		const CReferenceCollision Reference(Collision);
+		std::uniform_real_distribution<float> DistributionX(-64.0f, Collision.GetWidth() * 32.0f + 64.0f);
+		std::uniform_real_distribution<float> DistributionY(-64.0f, Collision.GetHeight() * 32.0f + 64.0f);
+		std::uniform_real_distribution<float> DistributionVel(-80.0f, 80.0f);
+		for(int i = 0; i < NUM_PATHS; i++)
+		{
+			const vec2 PrevPos = vec2(DistributionX(Random), DistributionY(Random));
+			// some paths without movement, which are sampled only once
+			const vec2 Pos = i % 8 == 0 ? PrevPos : PrevPos + vec2(DistributionVel(Random), DistributionVel(Random));
+			const unsigned MaxIndices = i % 2 == 0 ? 0 : 1 + Random() % 4;
+			const std::vector<int> vExpected = Reference.GetMapIndices(PrevPos, Pos, MaxIndices);
+			EXPECT_EQ(Collision.GetMapIndices(PrevPos, Pos, MaxIndices), vExpected) << Map;
+			// the reused vector must be cleared first
+			Collision.GetMapIndices(PrevPos, Pos, vIndices, MaxIndices);
+			EXPECT_EQ(vIndices, vExpected) << Map;
+		}
+		if(HasFailure())
+			return;
+	}
+}
@@ -1,7 +1,19 @@
+#include <base/log.h>
+#include <base/mem.h>
+#include <base/time.h>
+
 #include <engine/shared/compression.h>
+#include <engine/shared/snapshot.h>
+
+#include <generated/protocol.h>
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
 static const int DATA[] = {0, 1, -1, 32, 64, 256, -512, 12345, -123456, 1234567, 12345678, 123456789, 2147483647, (-2147483647 - 1)};
 static const int NUM = std::size(DATA);
 static const int SIZES[NUM] = {1, 1, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4, 5, 5};
@@ -82,3 +94,195 @@ TEST(CVariableInt, DecompressBufferTooSmall)
 	long CompressedSize = CVariableInt::Decompress(aCompressed, sizeof(aCompressed), aUncompressed, sizeof(aUncompressed));
 	ASSERT_EQ(CompressedSize, -1);
 }
+
+// The previous implementations of Compress and Decompress, the optimized ones must behave exactly the same.
+static long ReferenceCompress(const int *pSrc, int Num, unsigned char *pDst, int DstSize)
+{
+	unsigned char *pCharDst = pDst;
+	for(int i = 0; i < Num; i++)
+	{
+		pCharDst = CVariableInt::Pack(pCharDst, pSrc[i], pDst + DstSize - pCharDst);
+		if(!pCharDst)
+			return -1;
+	}
+	return pCharDst - pDst;
+}
+
+static long ReferenceDecompress(const unsigned char *pSrc, int SrcSize, int *pDst, int DstNum)
+{
+	const unsigned char *pSrcEnd = pSrc + SrcSize;
+	int Num = 0;
+	while(pSrc < pSrcEnd)
+	{
+		if(Num >= DstNum)
+			return -1;
+		pSrc = CVariableInt::Unpack(pSrc, &pDst[Num], pSrcEnd - pSrc);
+		if(!pSrc)
+			return -1;
+		Num++;
+	}
+	return Num * sizeof(int);
+}
+
+static std::vector<int> RandomInts(std::mt19937 &Random, int Num)
+{
+	// mostly small values like in snapshot deltas, with runs of bigger ones
+	std::uniform_int_distribution<int> Bits(0, 32);
+	std::uniform_int_distribution<unsigned> Value;
+	std::vector<int> vInts(Num);
+	int MaxBits = 6;
+	for(int &Int : vInts)
+	{
+		if(Random() % 16 == 0)
+			MaxBits = Random() % 2 ? 6 : Bits(Random);
+		const int NumBits = Bits(Random) % (MaxBits + 1);
+		Int = NumBits == 32 ? (int)Value(Random) : (int)(Value(Random) & ((1u << NumBits) - 1));
+		if(Random() % 2)
+			Int = ~Int;
+	}
+	return vInts;
+}
+
+TEST(CVariableInt, FuzzEquivalence)
+{
+	std::mt19937 Random(42);
+	for(int Iteration = 0; Iteration < 3000; Iteration++)
+	{
+		const int Num = Random() % 200;
+		const std::vector<int> vInts = RandomInts(Random, Num);
+
+		// compress into buffers of any size, including too small ones
+		const int MaxSize = Num * CVariableInt::MAX_BYTES_PACKED;
+		std::vector<unsigned char> vExpected(MaxSize);
+		const long ExpectedSize = ReferenceCompress(vInts.data(), Num, vExpected.data(), MaxSize);
+		ASSERT_GE(ExpectedSize, 0);
+		vExpected.resize(ExpectedSize);
+		const int DstSize = Iteration % 2 ? MaxSize : Random() % (ExpectedSize + 10);
+		std::vector<unsigned char> vCompressed(DstSize);
+		const long Size = CVariableInt::Compress(vInts.data(), Num * sizeof(int), vCompressed.data(), DstSize);
+		if(DstSize < ExpectedSize)
+		{
+			EXPECT_EQ(Size, -1) << "Iteration=" << Iteration;
+			continue;
+		}
+		ASSERT_EQ(Size, ExpectedSize) << "Iteration=" << Iteration;
+		vCompressed.resize(Size);
+		EXPECT_EQ(vCompressed, vExpected) << "Iteration=" << Iteration;
+
+		// decompress valid, truncated and random data into buffers of any size
+		std::vector<unsigned char> vSrc = vCompressed;
+		if(Iteration % 3 == 1)
+			vSrc.resize(Random() % (vSrc.size() + 1));
+		else if(Iteration % 3 == 2)
+		{
+			for(unsigned char &Byte : vSrc)
+				Byte = Random() % 4 ? Random() & 0x7F : Random();
+		}
+		const int DstNum = Iteration % 4 ? Num + 2 : Random() % (Num + 2);
+		std::vector<int> vExpectedInts(DstNum, 0);
+		std::vector<int> vDecompressed(DstNum, 0);
+		const long ExpectedIntSize = ReferenceDecompress(vSrc.data(), vSrc.size(), vExpectedInts.data(), DstNum);
+		const long IntSize = CVariableInt::Decompress(vSrc.data(), vSrc.size(), vDecompressed.data(), DstNum * sizeof(int));
+		ASSERT_EQ(IntSize, ExpectedIntSize) << "Iteration=" << Iteration;
+		if(IntSize >= 0)
+		{
+			// the buffer beyond the decompressed ints is undefined
+			vDecompressed.resize(IntSize / sizeof(int));
+			vExpectedInts.resize(IntSize / sizeof(int));
+			EXPECT_EQ(vDecompressed, vExpectedInts) << "Iteration=" << Iteration;
+			if(Iteration % 3 == 0)
+			{
+				EXPECT_EQ(vDecompressed, vInts) << "Iteration=" << Iteration;
+			}
+		}
+	}
+}
+
+TEST(CVariableInt, Benchmark)
+{
+	static const int NUM_CHARACTERS = 64;
+	static const int NUM_TICKS = 50;
+	static const int NUM_ITERATIONS = 20;
+
+	// snapshot deltas of characters moving around
+	std::mt19937 Random(42);
+	std::vector<CNetObj_Character> vCharacters(NUM_CHARACTERS);
+	for(CNetObj_Character &Character : vCharacters)
+	{
+		mem_zero(&Character, sizeof(Character));
+		Character.m_X = Random() % 10000;
+		Character.m_Y = Random() % 10000;
+		Character.m_Health = 10;
+		Character.m_Weapon = 1;
+	}
+	std::unique_ptr<CSnapshotDelta> pDelta = std::make_unique<CSnapshotDelta>();
+	std::unique_ptr<CSnapshotBuilder> pBuilder = std::make_unique<CSnapshotBuilder>();
+	std::unique_ptr<CSnapshotBuffer> pFrom = std::make_unique<CSnapshotBuffer>();
+	std::unique_ptr<CSnapshotBuffer> pTo = std::make_unique<CSnapshotBuffer>();
+	std::vector<std::vector<int>> vvDeltas;
+	for(int Tick = 0; Tick <= NUM_TICKS; Tick++)
+	{
+		pBuilder->Init();
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			CNetObj_Character &Character = vCharacters[i];
+			Character.m_Tick = Tick;
+			Character.m_VelX += (int)(Random() % 65) - 32;
+			Character.m_VelY += (int)(Random() % 65) - 32;
+			Character.m_X += Character.m_VelX / 256;
+			Character.m_Y += Character.m_VelY / 256;
+			Character.m_Angle = Random() % 2 ? Character.m_Angle : (int)(Random() % 1608);
+			Character.m_Direction = (int)(Random() % 3) - 1;
+			void *pItem = pBuilder->NewItem(CNetObj_Character::ms_MsgId, i, sizeof(Character));
+			ASSERT_TRUE(pItem);
+			mem_copy(pItem, &Character, sizeof(Character));
+		}
+		pBuilder->Finish(pTo.get());
+		if(Tick > 0)
+		{
+			std::vector<int> vDelta(CSnapshot::MAX_SIZE / sizeof(int));
+			const int DeltaSize = pDelta->CreateDelta(pFrom->AsSnapshot(), pTo->AsSnapshot(), vDelta.data());
+			ASSERT_GT(DeltaSize, 0);
+			vDelta.resize(DeltaSize / sizeof(int));
+			vvDeltas.push_back(vDelta);
+		}
+		std::swap(pFrom, pTo);
+	}
+
+	std::vector<unsigned char> vCompressed(CSnapshot::MAX_SIZE * 2);
+	std::vector<unsigned char> vExpectedCompressed(vCompressed.size());
+	std::vector<int> vDecompressed(CSnapshot::MAX_SIZE / sizeof(int));
+	std::chrono::nanoseconds Duration(0);
+	std::chrono::nanoseconds DecompressDuration(0);
+	std::chrono::nanoseconds ReferenceDuration(0);
+	std::chrono::nanoseconds ReferenceDecompressDuration(0);
+	double NumBytes = 0;
+	for(int Iteration = 0; Iteration < NUM_ITERATIONS; Iteration++)
+	{
+		for(const std::vector<int> &vDelta : vvDeltas)
+		{
+			std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+			const long ExpectedSize = ReferenceCompress(vDelta.data(), vDelta.size(), vExpectedCompressed.data(), vExpectedCompressed.size());
+			ReferenceDuration += time_get_nanoseconds() - StartTime;
+			StartTime = time_get_nanoseconds();
+			const long Size = CVariableInt::Compress(vDelta.data(), vDelta.size() * sizeof(int), vCompressed.data(), vCompressed.size());
+			Duration += time_get_nanoseconds() - StartTime;
+			ASSERT_EQ(Size, ExpectedSize);
+
+			StartTime = time_get_nanoseconds();
+			const long ExpectedIntSize = ReferenceDecompress(vCompressed.data(), Size, vDecompressed.data(), vDecompressed.size());
+			ReferenceDecompressDuration += time_get_nanoseconds() - StartTime;
+			StartTime = time_get_nanoseconds();
+			const long IntSize = CVariableInt::Decompress(vCompressed.data(), Size, vDecompressed.data(), vDecompressed.size() * sizeof(int));
+			DecompressDuration += time_get_nanoseconds() - StartTime;
+			ASSERT_EQ(IntSize, ExpectedIntSize);
+			ASSERT_EQ(IntSize, (long)(vDelta.size() * sizeof(int)));
+			ASSERT_EQ(mem_comp(vDecompressed.data(), vDelta.data(), IntSize), 0);
+			NumBytes += IntSize;
+		}
+	}
+
+	const auto &&Rate = [&](std::chrono::duration<double> Time) { return NumBytes / 1000000.0 / Time.count(); };
+	log_info("compression_test", "snapshot deltas: compress %.0f MB/s (reference %.0f MB/s), decompress %.0f MB/s (reference %.0f MB/s)",
+		Rate(Duration), Rate(ReferenceDuration), Rate(DecompressDuration), Rate(ReferenceDecompressDuration));
+}
@@ -66,4 +66,6 @@ TEST(Csv, LetTheQuotingBegin)
 	Expect(2, apCols3, "\",,\",\",\"\"\"\"\"\"\"");
 	const char *apCols4[] = {"\",", " "};
 	Expect(2, apCols4, "\"\"\",\", ");
+	const char *apCols5[] = {"a\nb", "c\r\nd"};
+	Expect(2, apCols5, "\"a\nb\",\"c\r\nd\"");
 }
@@ -1,5 +1,9 @@
 #include "test.h"
 
+#include <base/log.h>
+#include <base/mem.h>
+#include <base/time.h>
+
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
@@ -7,7 +11,12 @@
 
 #include <gtest/gtest.h>
 
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <vector>
 
 TEST(Datafile, ExtendedType)
 {
@@ -112,3 +121,224 @@ TEST(Datafile, StringData)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, ParallelCompression)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+	char aSequentialFilename[IO_MAX_PATH_LENGTH];
+	Info.Filename(aSequentialFilename, sizeof(aSequentialFilename), "-sequential.tmp");
+	char aParallelFilename[IO_MAX_PATH_LENGTH];
+	Info.Filename(aParallelFilename, sizeof(aParallelFilename), "-parallel.tmp");
+
+	// Data resembling a large map with many tile layers of different sizes
+	std::vector<std::vector<unsigned char>> vvData;
+	unsigned Seed = 1;
+	for(int Layer = 0; Layer < 8; Layer++)
+	{
+		std::vector<unsigned char> &vData = vvData.emplace_back((Layer % 4 + 1) * 64 * 1024);
+		for(size_t i = 0; i < vData.size(); i++)
+		{
+			Seed = Seed * 1103515245 + 12345;
+			vData[i] = (Seed >> 16) % 8 == 0 ? (Seed >> 8) & 0xFF : 0;
+		}
+	}
+
+	const auto &&WriteFile = [&](const char *pFilename, int MaxThreads) {
+		CDataFileWriter Writer;
+		ASSERT_TRUE(Writer.Open(pStorage.get(), pFilename));
+		Writer.SetMaxCompressionThreads(MaxThreads);
+		for(size_t Index = 0; Index < vvData.size(); Index++)
+		{
+			const int Data = Writer.AddData(vvData[Index].size(), vvData[Index].data(), Index % 4 == 0 ? CDataFileWriter::COMPRESSION_BEST : CDataFileWriter::COMPRESSION_DEFAULT);
+			Writer.AddItem(MAPITEMTYPE_TEST, Index, sizeof(Data), &Data);
+		}
+		Writer.Finish();
+	};
+	WriteFile(aSequentialFilename, 1);
+	WriteFile(aParallelFilename, 4);
+
+	{
+		CDataFileReader SequentialReader;
+		ASSERT_TRUE(SequentialReader.Open(pStorage.get(), aSequentialFilename, IStorage::TYPE_ALL));
+		CDataFileReader ParallelReader;
+		ASSERT_TRUE(ParallelReader.Open(pStorage.get(), aParallelFilename, IStorage::TYPE_ALL));
+
+		EXPECT_EQ(SequentialReader.Size(), ParallelReader.Size());
+		EXPECT_EQ(SequentialReader.Crc(), ParallelReader.Crc());
+		EXPECT_EQ(SequentialReader.Sha256(), ParallelReader.Sha256());
+
+		ASSERT_EQ(ParallelReader.NumData(), (int)vvData.size());
+		for(int Index = 0; Index < ParallelReader.NumData(); Index++)
+		{
+			ASSERT_EQ(ParallelReader.GetDataSize(Index), (int)vvData[Index].size());
+			EXPECT_TRUE(mem_comp(ParallelReader.GetData(Index), vvData[Index].data(), vvData[Index].size()) == 0);
+		}
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(aSequentialFilename, IStorage::TYPE_SAVE);
+		pStorage->RemoveFile(aParallelFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Datafile, Benchmark)
+{
+	// the largest map that is shipped with the client
+	static const char *const MAP = "maps/Tutorial.map";
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage.get(), MAP, IStorage::TYPE_ALL));
+	size_t DataSize = 0;
+	for(int Index = 0; Index < Reader.NumData(); Index++)
+		DataSize += Reader.GetDataSize(Index);
+
+	const auto &&WriteMap = [&](const char *pFilename, int MaxThreads) {
+		CDataFileWriter Writer;
+		EXPECT_TRUE(Writer.Open(pStorage.get(), pFilename));
+		Writer.SetMaxCompressionThreads(MaxThreads);
+		for(int Index = 0; Index < Reader.NumItems(); Index++)
+		{
+			int Type, Id;
+			CUuid Uuid;
+			const void *pItem = Reader.GetItem(Index, &Type, &Id, &Uuid);
+			if(Type != ITEMTYPE_EX)
+				Writer.AddItem(Type, Id, Reader.GetItemSize(Index), pItem, &Uuid);
+		}
+		for(int Index = 0; Index < Reader.NumData(); Index++)
+			Writer.AddData(Reader.GetDataSize(Index), Reader.GetData(Index));
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		Writer.Finish();
+		return time_get_nanoseconds() - StartTime;
+	};
+
+	const std::chrono::nanoseconds SerialDuration = WriteMap("serial.map", 1);
+	const std::chrono::nanoseconds ParallelDuration = WriteMap("parallel.map", 4);
+	Reader.Close();
+
+	CDataFileReader SerialReader;
+	ASSERT_TRUE(SerialReader.Open(pStorage.get(), "serial.map", IStorage::TYPE_SAVE));
+	CDataFileReader ParallelReader;
+	ASSERT_TRUE(ParallelReader.Open(pStorage.get(), "parallel.map", IStorage::TYPE_SAVE));
+	EXPECT_EQ(SerialReader.Sha256(), ParallelReader.Sha256());
+	SerialReader.Close();
+	ParallelReader.Close();
+
+	const auto &&Milliseconds = [](std::chrono::nanoseconds Time) { return std::chrono::duration<double, std::milli>(Time).count(); };
+	log_info("datafile_test", "%s (%.1f MB of data): Finish took %.2fms serially, %.2fms with 4 threads",
+		MAP, DataSize / 1000000.0, Milliseconds(SerialDuration), Milliseconds(ParallelDuration));
+}
+
+TEST(Datafile, MaxLoadedDataSize)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	constexpr int NUM_DATA = 8;
+	constexpr int DATA_SIZE = 16 * 1024;
+	{
+		CDataFileWriter Writer;
+		ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename));
+		std::vector<unsigned char> vData(DATA_SIZE);
+		for(int Index = 0; Index < NUM_DATA; Index++)
+		{
+			std::fill(vData.begin(), vData.end(), Index);
+			EXPECT_EQ(Writer.AddData(vData.size(), vData.data()), Index);
+		}
+		Writer.Finish();
+	}
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		Reader.SetMaxLoadedDataSize(3 * DATA_SIZE);
+
+		for(int Index = 0; Index < NUM_DATA; Index++)
+		{
+			const unsigned char *pData = static_cast<const unsigned char *>(Reader.GetData(Index));
+			ASSERT_NE(pData, nullptr);
+			EXPECT_EQ(pData[0], Index);
+			EXPECT_EQ(pData[DATA_SIZE - 1], Index);
+			EXPECT_LE(Reader.LoadedDataSize(), 3 * DATA_SIZE);
+		}
+		EXPECT_EQ(Reader.LoadedDataSize(), 3 * DATA_SIZE);
+
+		// Data 5 is used again, so data 6 is the least recently used one
+		EXPECT_NE(Reader.GetData(5), nullptr);
+		EXPECT_NE(Reader.GetData(0), nullptr);
+		EXPECT_EQ(Reader.LoadedDataSize(), 3 * DATA_SIZE);
+		EXPECT_EQ(static_cast<const unsigned char *>(Reader.GetData(5))[0], 5);
+		EXPECT_EQ(static_cast<const unsigned char *>(Reader.GetData(7))[0], 7);
+
+		// Unloaded data can be loaded again
+		Reader.UnloadData(7);
+		EXPECT_EQ(Reader.LoadedDataSize(), 2 * DATA_SIZE);
+		EXPECT_EQ(static_cast<const unsigned char *>(Reader.GetData(6))[0], 6);
+		EXPECT_EQ(Reader.GetDataSize(6), DATA_SIZE);
+
+		// Replaced data is never unloaded
+		char *pReplaced = static_cast<char *>(malloc(DATA_SIZE));
+		mem_zero(pReplaced, DATA_SIZE);
+		Reader.ReplaceData(1, pReplaced, DATA_SIZE);
+		for(int Index = 2; Index < NUM_DATA; Index++)
+		{
+			EXPECT_NE(Reader.GetData(Index), nullptr);
+		}
+		EXPECT_EQ(Reader.GetData(1), pReplaced);
+
+		Reader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(Datafile, Hashes)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	{
+		CDataFileWriter Writer;
+		ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename));
+		const int Data = Writer.AddDataString("DDNet");
+		Writer.AddItem(MAPITEMTYPE_TEST, 0, sizeof(Data), &Data);
+		Writer.Finish();
+	}
+
+	void *pFileData;
+	unsigned FileSize;
+	ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pFileData, &FileSize));
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		// Loading data before the hashes are calculated must not affect them
+		EXPECT_STREQ(Reader.GetDataString(0), "DDNet");
+		EXPECT_EQ(Reader.Size(), (int)FileSize);
+		EXPECT_EQ(Reader.Sha256(), sha256(pFileData, FileSize));
+		EXPECT_EQ(Reader.Crc(), crc32(0, static_cast<const Bytef *>(pFileData), FileSize));
+		EXPECT_STREQ(Reader.GetDataString(0), "DDNet");
+		Reader.Close();
+	}
+	free(pFileData);
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
@@ -0,0 +1,133 @@
+#include "test.h"
+
+#include <base/bytes.h>
+#include <base/mem.h>
+#include <base/str.h>
+
+#include <engine/client/demo_info_cache.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+static CDemoInfo TestDemoInfo(bool WithSha256)
+{
+	CDemoInfo Info;
+	mem_zero(&Info.m_Header, sizeof(Info.m_Header));
+	mem_zero(&Info.m_TimelineMarkers, sizeof(Info.m_TimelineMarkers));
+	Info.m_Valid = true;
+	Info.m_Header.m_Version = 6;
+	str_copy(Info.m_Header.m_aMapName, "Tutorial");
+	str_copy(Info.m_Header.m_aType, "client");
+	uint_to_bytes_be(Info.m_Header.m_aMapCrc, 0x12345678);
+	uint_to_bytes_be(Info.m_Header.m_aMapSize, 1234);
+	uint_to_bytes_be(Info.m_Header.m_aLength, 567);
+	uint_to_bytes_be(Info.m_TimelineMarkers.m_aNumTimelineMarkers, 2);
+	uint_to_bytes_be(Info.m_TimelineMarkers.m_aTimelineMarkers[1], 42);
+	str_copy(Info.m_MapInfo.m_aName, "Tutorial");
+	if(WithSha256)
+	{
+		SHA256_DIGEST Sha256 = {};
+		Sha256.data[0] = 0xab;
+		Sha256.data[31] = 0xcd;
+		Info.m_MapInfo.m_Sha256 = Sha256;
+	}
+	else
+	{
+		Info.m_MapInfo.m_Sha256 = std::nullopt;
+	}
+	Info.m_MapInfo.m_Crc = 0x12345678;
+	Info.m_MapInfo.m_Size = 1234;
+	return Info;
+}
+
+static void ExpectEqualInfo(const CDemoInfo &Expected, const CDemoInfo &Actual)
+{
+	EXPECT_EQ(Expected.m_Valid, Actual.m_Valid);
+	EXPECT_EQ(mem_comp(&Expected.m_Header, &Actual.m_Header, sizeof(Expected.m_Header)), 0);
+	EXPECT_EQ(mem_comp(&Expected.m_TimelineMarkers, &Actual.m_TimelineMarkers, sizeof(Expected.m_TimelineMarkers)), 0);
+	EXPECT_STREQ(Expected.m_MapInfo.m_aName, Actual.m_MapInfo.m_aName);
+	EXPECT_EQ(Expected.m_MapInfo.m_Sha256, Actual.m_MapInfo.m_Sha256);
+	EXPECT_EQ(Expected.m_MapInfo.m_Crc, Actual.m_MapInfo.m_Crc);
+	EXPECT_EQ(Expected.m_MapInfo.m_Size, Actual.m_MapInfo.m_Size);
+}
+
+TEST(DemoInfoCache, LookupAndStore)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+
+	const CDemoInfo DemoInfo = TestDemoInfo(true);
+	const CDemoInfo OtherDemoInfo = TestDemoInfo(false);
+	{
+		auto pCache = std::unique_ptr<IDemoInfoCache>(CreateDemoInfoCache(pConsole.get(), pStorage.get()));
+		CDemoInfo Result;
+		EXPECT_FALSE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+
+		pCache->Store("/demos/a.demo", 100, 1000, DemoInfo);
+		pCache->Store("/demos/b.demo", 200, 2000, OtherDemoInfo);
+
+		ASSERT_TRUE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+		ExpectEqualInfo(DemoInfo, Result);
+		ASSERT_TRUE(pCache->Lookup("/demos/b.demo", 200, 2000, &Result));
+		ExpectEqualInfo(OtherDemoInfo, Result);
+
+		// changed files are not found
+		EXPECT_FALSE(pCache->Lookup("/demos/a.demo", 101, 1000, &Result));
+		EXPECT_FALSE(pCache->Lookup("/demos/a.demo", 100, 1001, &Result));
+		EXPECT_FALSE(pCache->Lookup("/demos/c.demo", 100, 1000, &Result));
+	}
+
+	// the cache persists and newer entries replace older ones
+	{
+		auto pCache = std::unique_ptr<IDemoInfoCache>(CreateDemoInfoCache(pConsole.get(), pStorage.get()));
+		CDemoInfo Result;
+		ASSERT_TRUE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+		ExpectEqualInfo(DemoInfo, Result);
+
+		CDemoInfo InvalidInfo = OtherDemoInfo;
+		InvalidInfo.m_Valid = false;
+		pCache->Store("/demos/a.demo", 150, 1500, InvalidInfo);
+		EXPECT_FALSE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+		ASSERT_TRUE(pCache->Lookup("/demos/a.demo", 150, 1500, &Result));
+		ExpectEqualInfo(InvalidInfo, Result);
+	}
+}
+
+TEST(DemoInfoCache, Prune)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+
+	const CDemoInfo DemoInfo = TestDemoInfo(true);
+	auto pCache = std::unique_ptr<IDemoInfoCache>(CreateDemoInfoCache(pConsole.get(), pStorage.get()));
+	pCache->Store("/demos/a.demo", 100, 1000, DemoInfo);
+	pCache->Store("/demos/b.demo", 100, 1000, DemoInfo);
+	pCache->Store("/demos/sub/c.demo", 100, 1000, DemoInfo);
+	pCache->Store("/demos2/d.demo", 100, 1000, DemoInfo);
+	pCache->Store("/demos.demo", 100, 1000, DemoInfo);
+
+	// only demos directly in the folder that are not listed anymore are removed
+	pCache->Prune("/demos", {"/demos/a.demo"});
+	CDemoInfo Result;
+	EXPECT_TRUE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+	EXPECT_FALSE(pCache->Lookup("/demos/b.demo", 100, 1000, &Result));
+	EXPECT_TRUE(pCache->Lookup("/demos/sub/c.demo", 100, 1000, &Result));
+	EXPECT_TRUE(pCache->Lookup("/demos2/d.demo", 100, 1000, &Result));
+	EXPECT_TRUE(pCache->Lookup("/demos.demo", 100, 1000, &Result));
+
+	pCache->Prune("/demos/sub", {});
+	EXPECT_FALSE(pCache->Lookup("/demos/sub/c.demo", 100, 1000, &Result));
+	EXPECT_TRUE(pCache->Lookup("/demos/a.demo", 100, 1000, &Result));
+}
@@ -0,0 +1,100 @@
+#include "test.h"
+
+#include <base/hash.h>
+#include <base/mem.h>
+#include <base/time.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <generated/protocol.h>
+
+#include <game/version.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+static void RecordDemo(IStorage *pStorage, IConsole *pConsole, const char *pFilename, int FirstTick, int NumTicks)
+{
+	CSnapshotDelta SnapshotDelta;
+	CDemoRecorder Recorder(&SnapshotDelta, true);
+	const SHA256_DIGEST Sha256 = {};
+	unsigned char aMapData[1] = {0};
+	ASSERT_EQ(Recorder.Start(pStorage, pConsole, pFilename, GAME_NETVERSION, "test", Sha256, 0, "client", sizeof(aMapData), aMapData, nullptr, nullptr, nullptr), 0);
+	for(int Tick = FirstTick; Tick < FirstTick + NumTicks; Tick++)
+	{
+		CSnapshotBuilder Builder;
+		Builder.Init();
+		CNetObj_Flag Flag;
+		Flag.m_X = Tick;
+		Flag.m_Y = 0;
+		Flag.m_Team = 0;
+		void *pItem = Builder.NewItem(CNetObj_Flag::ms_MsgId, 0, sizeof(Flag));
+		ASSERT_NE(pItem, nullptr);
+		mem_copy(pItem, &Flag, sizeof(Flag));
+		CSnapshotBuffer Buffer;
+		const int Size = Builder.Finish(&Buffer);
+		Recorder.RecordSnapshot(Tick, Buffer.AsSnapshot(), Size);
+	}
+	ASSERT_EQ(Recorder.Stop(IDemoRecorder::EStopMode::KEEP_FILE), 0);
+}
+
+class CCountingListener : public CDemoPlayer::IListener
+{
+public:
+	int m_NumSnapshots = 0;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override { m_NumSnapshots++; }
+	void OnDemoPlayerMessage(void *pData, int Size) override {}
+};
+
+static int CountUpdates(IStorage *pStorage, IConsole *pConsole, const char *pFilename, int FramesPerSecond)
+{
+	CSnapshotDelta SnapshotDelta;
+	CSnapshotDelta SnapshotDeltaSixup;
+	CDemoPlayer Player(&SnapshotDelta, &SnapshotDeltaSixup, false);
+	CCountingListener Listener;
+	Player.SetListener(&Listener);
+	EXPECT_EQ(Player.Load(pStorage, pConsole, pFilename, IStorage::TYPE_SAVE), 0);
+	Player.Play();
+	Player.SetFixedFrameTime(time_freq() / FramesPerSecond);
+	int Updates = 0;
+	while(Player.IsPlaying() && !Player.BaseInfo()->m_Paused)
+	{
+		Player.Update();
+		Updates++;
+		EXPECT_LE(Updates, 10000);
+		if(Updates > 10000)
+			break;
+	}
+	EXPECT_STREQ(Player.ErrorMessage(), "");
+	EXPECT_EQ(Listener.m_NumSnapshots, 3 * SERVER_TICK_SPEED);
+	Player.Stop();
+	return Updates;
+}
+
+TEST(Demo, FixedFrameTime)
+{
+	CNetBase::Init();
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+
+	RecordDemo(pStorage.get(), pConsole.get(), "fixed.demo", 100, 3 * SERVER_TICK_SPEED);
+
+	// playback only depends on the frames, not on how fast they are rendered
+	const int Updates = CountUpdates(pStorage.get(), pConsole.get(), "fixed.demo", SERVER_TICK_SPEED);
+	EXPECT_GE(Updates, 3 * SERVER_TICK_SPEED - 2);
+	EXPECT_LE(Updates, 3 * SERVER_TICK_SPEED);
+	EXPECT_EQ(CountUpdates(pStorage.get(), pConsole.get(), "fixed.demo", SERVER_TICK_SPEED), Updates);
+	EXPECT_NEAR(CountUpdates(pStorage.get(), pConsole.get(), "fixed.demo", 2 * SERVER_TICK_SPEED), 2 * Updates, 2);
+}
@@ -1,7 +1,27 @@
+#include "test.h"
+
+#include <base/io.h>
+#include <base/log.h>
+#include <base/mem.h>
 #include <base/str.h>
+#include <base/time.h>
+
+#include <engine/engine.h>
+#include <engine/shared/linereader.h>
+#include <engine/storage.h>
+
+#include <game/editor/auto_map_rules.h>
+#include <game/version.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 bool is_letter(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
 
 bool IsValidEditorTooltip(const char *pTooltip, char *pErrorMsg, int ErrorMsgSize)
@@ -95,3 +115,322 @@ TEST(Editor, QuickActionNames)
 #include <game/editor/quick_actions.h>
 #undef REGISTER_QUICK_ACTION
 }
+
+class CBundledAutoMapRules
+{
+public:
+	std::string m_Name;
+	CAutoMapRules m_Rules;
+};
+
+static int ListAutoMapRulesCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	if(!IsDir && str_endswith(pName, ".rules"))
+		static_cast<std::vector<std::string> *>(pUser)->emplace_back(pName);
+	return 0;
+}
+
+static std::vector<CBundledAutoMapRules> LoadBundledAutoMapRules(IStorage *pStorage)
+{
+	std::vector<std::string> vNames;
+	pStorage->ListDirectory(IStorage::TYPE_ALL, "editor/automap", ListAutoMapRulesCallback, &vNames);
+	std::sort(vNames.begin(), vNames.end());
+
+	std::vector<CBundledAutoMapRules> vBundled;
+	for(const std::string &Name : vNames)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "editor/automap/%s", Name.c_str());
+		CLineReader LineReader;
+		EXPECT_TRUE(LineReader.OpenFile(pStorage->OpenFile(aPath, IOFLAG_READ, IStorage::TYPE_ALL))) << aPath;
+		CBundledAutoMapRules &Bundled = vBundled.emplace_back();
+		Bundled.m_Name = Name;
+		Bundled.m_Rules.Load(LineReader);
+	}
+	return vBundled;
+}
+
+// blobs of solid tiles with some other indices and flags sprinkled in
+static std::vector<CTile> AutoMapTestTiles(int Width, int Height, unsigned Seed)
+{
+	std::mt19937 Random(Seed);
+	std::vector<CTile> vTiles(Width * Height);
+	for(CTile &Tile : vTiles)
+		mem_zero(&Tile, sizeof(Tile));
+	for(int Blob = 0; Blob < Width * Height / 64; Blob++)
+	{
+		const int BlobX = Random() % Width;
+		const int BlobY = Random() % Height;
+		const int BlobWidth = 1 + Random() % 12;
+		const int BlobHeight = 1 + Random() % 12;
+		for(int y = BlobY; y < std::min(Height, BlobY + BlobHeight); y++)
+			for(int x = BlobX; x < std::min(Width, BlobX + BlobWidth); x++)
+				vTiles[y * Width + x].m_Index = 1;
+	}
+	for(CTile &Tile : vTiles)
+	{
+		if(Random() % 16 == 0)
+		{
+			Tile.m_Index = Random() % 256;
+			Tile.m_Flags = Random() % 8;
+		}
+	}
+	return vTiles;
+}
+
+// The automapper as it was before the rules were compiled: every rule is
+// checked for every tile, with the hash that seeds the random rules.
+static const int REFERENCE_HASH_MAX = 65536;
+
+static uint32_t ReferenceHashUInt32(uint32_t Num)
+{
+	Num++;
+	Num ^= Num >> 17;
+	Num *= 0xed5ad4bbu;
+	Num ^= Num >> 11;
+	Num *= 0xac4c1b51u;
+	Num ^= Num >> 15;
+	Num *= 0x31848babu;
+	Num ^= Num >> 14;
+	return Num;
+}
+
+static int ReferenceHashLocation(uint32_t Seed, uint32_t Run, uint32_t Rule, uint32_t X, uint32_t Y)
+{
+	const uint32_t Prime = 31;
+	uint32_t Hash = 1;
+	Hash = Hash * Prime + ReferenceHashUInt32(Seed);
+	Hash = Hash * Prime + ReferenceHashUInt32(Run);
+	Hash = Hash * Prime + ReferenceHashUInt32(Rule);
+	Hash = Hash * Prime + ReferenceHashUInt32(X);
+	Hash = Hash * Prime + ReferenceHashUInt32(Y);
+	Hash = ReferenceHashUInt32(Hash * Prime);
+	return Hash % REFERENCE_HASH_MAX;
+}
+
+static void ReferenceProceedRun(const CAutoMapRules::CRun &Run, const CAutoMapRules::CRunParams &Params, std::vector<CAutoMapRules::CTileChange> &vChanges)
+{
+	const int Width = Params.m_Width;
+	const int Height = Params.m_Height;
+	for(int y = 0; y < Height; y++)
+	{
+		for(int x = 0; x < Width; x++)
+		{
+			CTile *pTile = &Params.m_pTiles[y * Width + x];
+			const CTile *pReadTile = &Params.m_pReadTiles[y * Width + x];
+			const CTile Previous = *pTile;
+			bool Changed = false;
+
+			for(size_t i = 0; i < Run.m_vIndexRules.size(); ++i)
+			{
+				const CAutoMapRules::CIndexRule *pIndexRule = &Run.m_vIndexRules[i];
+				if(pReadTile->m_Index == 0)
+				{
+					if(pTile->m_Index != 0 && Params.m_IsFilterable) // TODO: This is a lazy workaround
+					{
+						pTile->m_Index = 0;
+						pTile->m_Flags = pIndexRule->m_Flag;
+						Changed = true;
+						continue;
+					}
+
+					if(pIndexRule->m_SkipEmpty) // skip empty tiles
+						continue;
+				}
+				if(pIndexRule->m_SkipFull && pReadTile->m_Index != 0) // skip full tiles
+					continue;
+
+				bool RespectRules = true;
+				for(size_t j = 0; j < pIndexRule->m_vRules.size() && RespectRules; ++j)
+				{
+					const CAutoMapRules::CPosRule *pRule = &pIndexRule->m_vRules[j];
+
+					int CheckIndex, CheckFlags;
+					int CheckX = x + pRule->m_X;
+					int CheckY = y + pRule->m_Y;
+					if(CheckX >= 0 && CheckX < Width && CheckY >= 0 && CheckY < Height)
+					{
+						int CheckTile = CheckY * Width + CheckX;
+						CheckIndex = Params.m_pReadTiles[CheckTile].m_Index;
+						CheckFlags = Params.m_pReadTiles[CheckTile].m_Flags & (TILEFLAG_ROTATE | TILEFLAG_XFLIP | TILEFLAG_YFLIP);
+					}
+					else
+					{
+						CheckIndex = -1;
+						CheckFlags = 0;
+					}
+
+					if(pRule->m_Value == CAutoMapRules::CPosRule::INDEX)
+					{
+						RespectRules = false;
+						for(const auto &Index : pRule->m_vIndexList)
+						{
+							if(CheckIndex == Index.m_Id && (!Index.m_TestFlag || CheckFlags == Index.m_Flag))
+							{
+								RespectRules = true;
+								break;
+							}
+						}
+					}
+					else if(pRule->m_Value == CAutoMapRules::CPosRule::NOTINDEX)
+					{
+						for(const auto &Index : pRule->m_vIndexList)
+						{
+							if(CheckIndex == Index.m_Id && (!Index.m_TestFlag || CheckFlags == Index.m_Flag))
+							{
+								RespectRules = false;
+								break;
+							}
+						}
+					}
+				}
+
+				bool PassesModuloCheck;
+				if(pIndexRule->m_vModuloRules.empty())
+					PassesModuloCheck = true;
+				else
+					PassesModuloCheck = std::any_of(pIndexRule->m_vModuloRules.cbegin(), pIndexRule->m_vModuloRules.cend(), [&](const CAutoMapRules::CModuloRule &ModuloRule) {
+						return (x + Params.m_SeedOffsetX + ModuloRule.m_OffsetX) % ModuloRule.m_ModX == 0 && (y + Params.m_SeedOffsetY + ModuloRule.m_OffsetY) % ModuloRule.m_ModY == 0;
+					});
+
+				if(RespectRules && PassesModuloCheck &&
+					(pIndexRule->m_RandomProbability >= 1.0f || ReferenceHashLocation(Params.m_Seed, Params.m_RunIndex, i, x + Params.m_SeedOffsetX, y + Params.m_SeedOffsetY) < REFERENCE_HASH_MAX * pIndexRule->m_RandomProbability))
+				{
+					pTile->m_Index = pIndexRule->m_Id;
+					pTile->m_Flags = pIndexRule->m_Flag;
+					Changed = true;
+				}
+			}
+
+			if(Changed)
+				vChanges.push_back({x, y, Previous});
+		}
+	}
+}
+
+// Applies all runs of the configuration like CAutoMapper::Proceed. With
+// IsFilterable, the first run reads a copy of the tiles as reference layer.
+static void AutoMapTiles(const CAutoMapRules::CConfiguration &Config, std::vector<CTile> &vTiles, int Width, int Height, bool IsFilterable, bool Reference, IEngine *pEngine, std::vector<CAutoMapRules::CTileChange> &vChanges)
+{
+	for(size_t RunIndex = 0; RunIndex < Config.m_vRuns.size(); RunIndex++)
+	{
+		const CAutoMapRules::CRun &Run = Config.m_vRuns[RunIndex];
+		const std::vector<CTile> vCopy = Run.m_AutomapCopy ? vTiles : std::vector<CTile>();
+		CAutoMapRules::CRunParams Params;
+		Params.m_pReadTiles = Run.m_AutomapCopy ? vCopy.data() : vTiles.data();
+		Params.m_pTiles = vTiles.data();
+		Params.m_Width = Width;
+		Params.m_Height = Height;
+		Params.m_Seed = 1234;
+		Params.m_RunIndex = RunIndex;
+		Params.m_SeedOffsetX = 5;
+		Params.m_SeedOffsetY = 7;
+		Params.m_IsFilterable = IsFilterable && RunIndex == 0;
+		if(Reference)
+			ReferenceProceedRun(Run, Params, vChanges);
+		else
+			CAutoMapRules::ProceedRun(Run, Params, pEngine, vChanges);
+	}
+}
+
+TEST(AutoMapper, CompiledRulesMatchReference)
+{
+	// just large enough to be split into row bands
+	static const int WIDTH = 128;
+	static const int HEIGHT = 66;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+	std::unique_ptr<IEngine> pEngine(CreateTestEngine(GAME_NAME));
+	const std::vector<CBundledAutoMapRules> vBundled = LoadBundledAutoMapRules(pStorage.get());
+	ASSERT_FALSE(vBundled.empty());
+
+	const std::vector<CTile> vInput = AutoMapTestTiles(WIDTH, HEIGHT, 42);
+	for(const CBundledAutoMapRules &Bundled : vBundled)
+	{
+		ASSERT_FALSE(Bundled.m_Rules.m_vConfigs.empty()) << Bundled.m_Name;
+		for(const CAutoMapRules::CConfiguration &Config : Bundled.m_Rules.m_vConfigs)
+		{
+			for(bool IsFilterable : {false, true})
+			{
+				std::vector<CTile> vExpected = vInput;
+				std::vector<CAutoMapRules::CTileChange> vExpectedChanges;
+				AutoMapTiles(Config, vExpected, WIDTH, HEIGHT, IsFilterable, true, nullptr, vExpectedChanges);
+
+				for(IEngine *pRunEngine : {(IEngine *)nullptr, pEngine.get()})
+				{
+					std::vector<CTile> vTiles = vInput;
+					std::vector<CAutoMapRules::CTileChange> vChanges;
+					AutoMapTiles(Config, vTiles, WIDTH, HEIGHT, IsFilterable, false, pRunEngine, vChanges);
+
+					SCOPED_TRACE(std::string(Bundled.m_Name) + " [" + Config.m_aName + "]" + (IsFilterable ? " filterable" : "") + (pRunEngine ? " in jobs" : ""));
+					EXPECT_EQ(mem_comp(vTiles.data(), vExpected.data(), vTiles.size() * sizeof(CTile)), 0);
+					ASSERT_EQ(vChanges.size(), vExpectedChanges.size());
+					for(size_t i = 0; i < vChanges.size(); i++)
+					{
+						ASSERT_EQ(vChanges[i].m_X, vExpectedChanges[i].m_X);
+						ASSERT_EQ(vChanges[i].m_Y, vExpectedChanges[i].m_Y);
+						ASSERT_EQ(mem_comp(&vChanges[i].m_Previous, &vExpectedChanges[i].m_Previous, sizeof(CTile)), 0);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(AutoMapper, Benchmark)
+{
+	static const int WIDTH = 96;
+	static const int HEIGHT = 96;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+	std::unique_ptr<IEngine> pEngine(CreateTestEngine(GAME_NAME));
+	const std::vector<CBundledAutoMapRules> vBundled = LoadBundledAutoMapRules(pStorage.get());
+
+	const std::vector<CTile> vInput = AutoMapTestTiles(WIDTH, HEIGHT, 42);
+	std::chrono::nanoseconds TotalDuration(0);
+	std::chrono::nanoseconds TotalJobsDuration(0);
+	std::chrono::nanoseconds TotalReferenceDuration(0);
+	for(const CBundledAutoMapRules &Bundled : vBundled)
+	{
+		std::chrono::nanoseconds Duration(0);
+		std::chrono::nanoseconds JobsDuration(0);
+		std::chrono::nanoseconds ReferenceDuration(0);
+		for(const CAutoMapRules::CConfiguration &Config : Bundled.m_Rules.m_vConfigs)
+		{
+			std::vector<CAutoMapRules::CTileChange> vChanges;
+			std::vector<CTile> vTiles = vInput;
+			std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+			AutoMapTiles(Config, vTiles, WIDTH, HEIGHT, false, true, nullptr, vChanges);
+			ReferenceDuration += time_get_nanoseconds() - StartTime;
+
+			vChanges.clear();
+			vTiles = vInput;
+			StartTime = time_get_nanoseconds();
+			AutoMapTiles(Config, vTiles, WIDTH, HEIGHT, false, false, nullptr, vChanges);
+			Duration += time_get_nanoseconds() - StartTime;
+
+			vChanges.clear();
+			vTiles = vInput;
+			StartTime = time_get_nanoseconds();
+			AutoMapTiles(Config, vTiles, WIDTH, HEIGHT, false, false, pEngine.get(), vChanges);
+			JobsDuration += time_get_nanoseconds() - StartTime;
+		}
+
+		const auto &&Milliseconds = [](std::chrono::nanoseconds Time) { return std::chrono::duration<double, std::milli>(Time).count(); };
+		log_info("editor_test", "%s: %d configs on %dx%d, compiled %.1fms, in jobs %.1fms (reference %.1fms)",
+			Bundled.m_Name.c_str(), (int)Bundled.m_Rules.m_vConfigs.size(), WIDTH, HEIGHT, Milliseconds(Duration), Milliseconds(JobsDuration), Milliseconds(ReferenceDuration));
+		TotalDuration += Duration;
+		TotalJobsDuration += JobsDuration;
+		TotalReferenceDuration += ReferenceDuration;
+	}
+
+	const auto &&Seconds = [](std::chrono::nanoseconds Time) { return std::chrono::duration<double>(Time).count(); };
+	log_info("editor_test", "all bundled rules: compiled %.2fs, in jobs %.2fs (reference %.2fs)",
+		Seconds(TotalDuration), Seconds(TotalJobsDuration), Seconds(TotalReferenceDuration));
+}
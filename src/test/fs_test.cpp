@@ -6,6 +6,9 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
+#include <string>
+
 TEST(Filesystem, Filename)
 {
 	EXPECT_STREQ(fs_filename(""), "");
@@ -138,6 +141,48 @@ TEST(Filesystem, CreateDeleteDirectory)
 	EXPECT_FALSE(fs_is_dir(Info.m_aFilename));
 }
 
+TEST(Filesystem, ListdirFileinfo)
+{
+	CTestInfo Info;
+	char aFilename[IO_MAX_PATH_LENGTH];
+	str_format(aFilename, sizeof(aFilename), "%s/test.txt", Info.m_aFilename);
+	char aFolder[IO_MAX_PATH_LENGTH];
+	str_format(aFolder, sizeof(aFolder), "%s/folder", Info.m_aFilename);
+
+	EXPECT_FALSE(fs_makedir(Info.m_aFilename));
+	EXPECT_FALSE(fs_makedir(aFolder));
+	IOHANDLE File = io_open(aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_write(File, "hello", 5), 5u);
+	EXPECT_FALSE(io_close(File));
+
+	struct SEntry
+	{
+		int m_IsDir;
+		int64_t m_Size;
+		time_t m_TimeModified;
+	};
+	std::map<std::string, SEntry> Entries;
+	fs_listdir_fileinfo(
+		Info.m_aFilename, [](const CFsFileInfo *pInfo, int IsDir, int Type, void *pUser) {
+			auto &ListedEntries = *static_cast<std::map<std::string, SEntry> *>(pUser);
+			ListedEntries[pInfo->m_pName] = SEntry{IsDir, pInfo->m_Size, pInfo->m_TimeModified};
+			return 0;
+		},
+		0, &Entries);
+
+	ASSERT_EQ(Entries.count("test.txt"), 1u);
+	EXPECT_EQ(Entries["test.txt"].m_IsDir, 0);
+	EXPECT_EQ(Entries["test.txt"].m_Size, 5);
+	EXPECT_GT(Entries["test.txt"].m_TimeModified, 0);
+	ASSERT_EQ(Entries.count("folder"), 1u);
+	EXPECT_EQ(Entries["folder"].m_IsDir, 1);
+
+	EXPECT_FALSE(fs_remove(aFilename));
+	EXPECT_FALSE(fs_removedir(aFolder));
+	EXPECT_FALSE(fs_removedir(Info.m_aFilename));
+}
+
 TEST(Filesystem, CantDeleteDirectoryWithRemove)
 {
 	CTestInfo Info;
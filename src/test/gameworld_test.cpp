@@ -1,6 +1,9 @@
 #include "test.h"
 
+#include <base/log.h>
 #include <base/logger.h>
+#include <base/secure.h>
+#include <base/time.h>
 #include <base/types.h>
 
 #include <engine/engine.h>
@@ -12,8 +15,11 @@
 #include <engine/server/server_logger.h>
 #include <engine/shared/assertion_logger.h>
 #include <engine/shared/config.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
 
 #include <generated/protocol.h>
+#include <generated/protocol7.h>
 
 #include <game/server/entities/character.h>
 #include <game/server/gamecontext.h>
@@ -24,6 +30,7 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <memory>
 #include <thread>
 
@@ -124,6 +131,30 @@ public:
 		pServer->InitMaplist();
 	}
 
+	// the same steps as a tick in CServer::Run
+	void RunTick()
+	{
+		m_pServer->UpdateDebugDummies(false);
+		m_pServer->m_CurrentGameTick++;
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(m_pServer->m_aClients[c].m_State != CServer::CClient::STATE_INGAME)
+				continue;
+			const int *pInput = nullptr;
+			for(auto &Input : m_pServer->m_aClients[c].m_aInputs)
+			{
+				if(Input.m_GameTick == m_pServer->Tick())
+				{
+					pInput = Input.m_aData;
+					break;
+				}
+			}
+			GameServer()->OnClientPredictedInput(c, pInput);
+		}
+		GameServer()->OnTick();
+		m_pServer->DoSnapshot();
+	}
+
 	~CTestGameWorld() override
 	{
 		m_pServer->m_Econ.Shutdown();
@@ -304,3 +335,63 @@ TEST_F(CTestGameWorld, CharacterEmote)
 	pChr->Freeze(10);
 	ASSERT_EQ(pChr->DetermineEyeEmote(), EMOTE_ANGRY);
 }
+
+TEST_F(CTestGameWorld, DebugDummiesAtMaxSlots)
+{
+	static const int NUM_TICKS = 150;
+
+	CNetBase::Init();
+	NETADDR BindAddr;
+	ASSERT_EQ(net_addr_from_str(&BindAddr, "127.0.0.1"), 0);
+	do
+	{
+		BindAddr.port = secure_rand_below(65535 - 1024) + 1024;
+	} while(!m_pServer->m_NetServer.Open(BindAddr, nullptr, SERVER_MAX_CLIENTS, SERVER_MAX_CLIENTS));
+	ASSERT_EQ(m_pServer->MaxClients(), SERVER_MAX_CLIENTS);
+
+	g_Config.m_DbgDummies = SERVER_MAX_CLIENTS;
+	std::chrono::nanoseconds TickTime = std::chrono::nanoseconds::zero();
+	for(int Tick = 0; Tick < NUM_TICKS; Tick++)
+	{
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		RunTick();
+		TickTime += time_get_nanoseconds() - StartTime;
+	}
+	log_info("gameworld_test", "%d debug dummies: %.3fms per tick", SERVER_MAX_CLIENTS,
+		std::chrono::duration<double, std::milli>(TickTime).count() / NUM_TICKS);
+
+	for(int ClientId = 0; ClientId < SERVER_MAX_CLIENTS; ClientId++)
+	{
+		EXPECT_EQ(m_pServer->m_aClients[ClientId].m_State, CServer::CClient::STATE_INGAME) << ClientId;
+		ASSERT_NE(GameServer()->m_apPlayers[ClientId], nullptr) << ClientId;
+		EXPECT_NE(GameServer()->m_apPlayers[ClientId]->GetCharacter(), nullptr) << ClientId;
+	}
+
+	// a 0.7 client only sees the clients it can address
+	const int SixupClient = 0;
+	m_pServer->m_aClients[SixupClient].m_Sixup = true;
+	for(int ClientId = 0; ClientId < MAX_CLIENTS; ClientId++)
+	{
+		int Target = ClientId;
+		EXPECT_EQ(m_pServer->Translate(Target, SixupClient), ClientId < SIXUP_MAX_CLIENTS) << ClientId;
+	}
+	m_pServer->m_SnapshotBuilder.Init(true);
+	GameServer()->OnSnap(SixupClient, true, false);
+	CSnapshotBuffer Data;
+	m_pServer->m_SnapshotBuilder.Finish(&Data);
+	m_pServer->m_aClients[SixupClient].m_Sixup = false;
+	const CSnapshot *pSnapshot = Data.AsSnapshot();
+	int NumPlayerInfos = 0;
+	for(int Index = 0; Index < pSnapshot->NumItems(); Index++)
+	{
+		if(pSnapshot->GetItemType(Index) != protocol7::NETOBJTYPE_PLAYERINFO)
+			continue;
+		EXPECT_LT(pSnapshot->GetItem(Index)->Id(), SIXUP_MAX_CLIENTS);
+		NumPlayerInfos++;
+	}
+	EXPECT_EQ(NumPlayerInfos, minimum((int)SERVER_MAX_CLIENTS, (int)SIXUP_MAX_CLIENTS));
+
+	g_Config.m_DbgDummies = 0;
+	RunTick();
+	m_pServer->m_NetServer.Close();
+}
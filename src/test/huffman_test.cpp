@@ -1,9 +1,17 @@
+#include <base/log.h>
 #include <base/mem.h>
+#include <base/time.h>
 
+#include <engine/shared/compression.h>
 #include <engine/shared/huffman.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
 TEST(Huffman, CompressionShouldNotChangeData)
 {
 	CHuffman Huffman;
@@ -47,3 +55,318 @@ TEST(Huffman, CompressionCompatible)
 	EXPECT_EQ(match, 0) << "The compression is not compatible with older/other implementations anymore";
 	EXPECT_EQ(Size, 15);
 }
+
+// The original decoder and encoder, the optimized implementation must behave exactly the same.
+class CReferenceHuffman
+{
+	enum
+	{
+		EOF_SYMBOL = 256,
+		MAX_SYMBOLS = EOF_SYMBOL + 1,
+		MAX_NODES = MAX_SYMBOLS * 2 - 1,
+		LUTBITS = 10,
+		LUTSIZE = 1 << LUTBITS,
+		LUTMASK = LUTSIZE - 1,
+	};
+
+	struct CNode
+	{
+		unsigned m_Bits;
+		unsigned m_NumBits;
+		unsigned short m_aLeaves[2];
+		unsigned char m_Symbol;
+	};
+
+	CNode m_aNodes[MAX_NODES];
+	CNode *m_apDecodeLut[LUTSIZE];
+	CNode *m_pStartNode;
+	int m_NumNodes;
+
+	void Setbits_r(CNode *pNode, int Bits, unsigned Depth)
+	{
+		if(pNode->m_aLeaves[1] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeaves[1]], Bits | (1 << Depth), Depth + 1);
+		if(pNode->m_aLeaves[0] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeaves[0]], Bits, Depth + 1);
+		if(pNode->m_NumBits)
+		{
+			pNode->m_Bits = Bits;
+			pNode->m_NumBits = Depth;
+		}
+	}
+
+public:
+	void Init(const unsigned *pFrequencies)
+	{
+		struct CConstructNode
+		{
+			unsigned short m_NodeId;
+			int m_Frequency;
+		};
+		CConstructNode aNodesLeftStorage[MAX_SYMBOLS];
+		CConstructNode *apNodesLeft[MAX_SYMBOLS];
+		int NumNodesLeft = MAX_SYMBOLS;
+
+		mem_zero(m_aNodes, sizeof(m_aNodes));
+		mem_zero(m_apDecodeLut, sizeof(m_apDecodeLut));
+		for(int i = 0; i < MAX_SYMBOLS; i++)
+		{
+			m_aNodes[i].m_NumBits = 0xFFFFFFFF;
+			m_aNodes[i].m_Symbol = i;
+			m_aNodes[i].m_aLeaves[0] = 0xffff;
+			m_aNodes[i].m_aLeaves[1] = 0xffff;
+			aNodesLeftStorage[i].m_Frequency = i == EOF_SYMBOL ? 1 : pFrequencies[i];
+			aNodesLeftStorage[i].m_NodeId = i;
+			apNodesLeft[i] = &aNodesLeftStorage[i];
+		}
+		m_NumNodes = MAX_SYMBOLS;
+		while(NumNodesLeft > 1)
+		{
+			std::stable_sort(apNodesLeft, apNodesLeft + NumNodesLeft, [](const CConstructNode *pNode1, const CConstructNode *pNode2) {
+				return pNode2->m_Frequency < pNode1->m_Frequency;
+			});
+			m_aNodes[m_NumNodes].m_NumBits = 0;
+			m_aNodes[m_NumNodes].m_aLeaves[0] = apNodesLeft[NumNodesLeft - 1]->m_NodeId;
+			m_aNodes[m_NumNodes].m_aLeaves[1] = apNodesLeft[NumNodesLeft - 2]->m_NodeId;
+			apNodesLeft[NumNodesLeft - 2]->m_NodeId = m_NumNodes;
+			apNodesLeft[NumNodesLeft - 2]->m_Frequency = apNodesLeft[NumNodesLeft - 1]->m_Frequency + apNodesLeft[NumNodesLeft - 2]->m_Frequency;
+			m_NumNodes++;
+			NumNodesLeft--;
+		}
+		m_pStartNode = &m_aNodes[m_NumNodes - 1];
+		Setbits_r(m_pStartNode, 0, 0);
+
+		for(int i = 0; i < LUTSIZE; i++)
+		{
+			unsigned Bits = i;
+			int k;
+			CNode *pNode = m_pStartNode;
+			for(k = 0; k < LUTBITS; k++)
+			{
+				pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
+				Bits >>= 1;
+				if(pNode->m_NumBits)
+				{
+					m_apDecodeLut[i] = pNode;
+					break;
+				}
+			}
+			if(k == LUTBITS)
+				m_apDecodeLut[i] = pNode;
+		}
+	}
+
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
+	{
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned char *pDst = (unsigned char *)pOutput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		const auto &&Load = [&](int Symbol) {
+			Bits |= m_aNodes[Symbol].m_Bits << Bitcount;
+			Bitcount += m_aNodes[Symbol].m_NumBits;
+		};
+		const auto &&Write = [&]() {
+			while(Bitcount >= 8)
+			{
+				*pDst++ = (unsigned char)(Bits & 0xff);
+				if(pDst == pDstEnd)
+					return false;
+				Bits >>= 8;
+				Bitcount -= 8;
+			}
+			return true;
+		};
+		for(; pSrc != pSrcEnd; pSrc++)
+		{
+			Load(*pSrc);
+			if(!Write())
+				return -1;
+		}
+		Load(EOF_SYMBOL);
+		if(!Write())
+			return -1;
+		*pDst++ = Bits;
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
+	{
+		unsigned char *pDst = (unsigned char *)pOutput;
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		const CNode *pEof = &m_aNodes[EOF_SYMBOL];
+		while(true)
+		{
+			const CNode *pNode = nullptr;
+			if(Bitcount >= LUTBITS)
+				pNode = m_apDecodeLut[Bits & LUTMASK];
+			while(Bitcount < 24 && pSrc != pSrcEnd)
+			{
+				Bits |= (*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+			if(!pNode)
+				pNode = m_apDecodeLut[Bits & LUTMASK];
+			if(!pNode)
+				return -1;
+			if(pNode->m_NumBits)
+			{
+				Bits >>= pNode->m_NumBits;
+				Bitcount -= pNode->m_NumBits;
+			}
+			else
+			{
+				Bits >>= LUTBITS;
+				Bitcount -= LUTBITS;
+				while(true)
+				{
+					pNode = &m_aNodes[pNode->m_aLeaves[Bits & 1]];
+					Bitcount--;
+					Bits >>= 1;
+					if(pNode->m_NumBits)
+						break;
+					if(Bitcount == 0)
+						return -1;
+				}
+			}
+			if(pNode == pEof)
+				break;
+			if(pDst == pDstEnd)
+				return -1;
+			*pDst++ = pNode->m_Symbol;
+		}
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+};
+
+// Packed integers like in snapshot deltas, mostly zeros and small values.
+static std::vector<unsigned char> SnapshotPayload(std::mt19937 &Random, int Size)
+{
+	std::geometric_distribution<int> SmallDistribution(0.3);
+	std::uniform_int_distribution<int> LargeDistribution(-100000, 100000);
+	std::uniform_int_distribution<int> KindDistribution(0, 99);
+	std::vector<unsigned char> vPayload;
+	while((int)vPayload.size() < Size)
+	{
+		const int Kind = KindDistribution(Random);
+		int Value = Kind < 60 ? 0 : Kind < 95 ? SmallDistribution(Random) * (Kind % 2 ? 1 : -1) : LargeDistribution(Random);
+		unsigned char aPacked[CVariableInt::MAX_BYTES_PACKED];
+		unsigned char *pEnd = CVariableInt::Pack(aPacked, Value, sizeof(aPacked));
+		vPayload.insert(vPayload.end(), aPacked, pEnd);
+	}
+	vPayload.resize(Size);
+	return vPayload;
+}
+
+static std::vector<unsigned char> RandomPayload(std::mt19937 &Random, int Size)
+{
+	std::uniform_int_distribution<int> Distribution(0, 255);
+	std::vector<unsigned char> vPayload(Size);
+	for(unsigned char &Byte : vPayload)
+		Byte = Distribution(Random);
+	return vPayload;
+}
+
+TEST(Huffman, FuzzEquivalence)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	CReferenceHuffman Reference;
+	Reference.Init(CHuffman::ms_aFreqTable);
+
+	std::mt19937 Random(42);
+	std::uniform_int_distribution<int> SizeDistribution(0, 1500);
+	std::uniform_int_distribution<int> MarginDistribution(-4, 16);
+	for(int i = 0; i < 3000; i++)
+	{
+		const int Size = SizeDistribution(Random);
+		const std::vector<unsigned char> vInput = i % 2 ? SnapshotPayload(Random, Size) : RandomPayload(Random, Size);
+
+		// compress, also into buffers that are too small
+		std::vector<unsigned char> vCompressed(4096);
+		std::vector<unsigned char> vExpectedCompressed(4096);
+		const int ExpectedSize = Reference.Compress(vInput.data(), vInput.size(), vExpectedCompressed.data(), vExpectedCompressed.size());
+		ASSERT_GT(ExpectedSize, 0);
+		for(int OutputSize : {(int)vCompressed.size(), ExpectedSize, ExpectedSize + 1, ExpectedSize + MarginDistribution(Random)})
+		{
+			OutputSize = std::clamp(OutputSize, 1, (int)vCompressed.size());
+			const int CompressedSize = Huffman.Compress(vInput.data(), vInput.size(), vCompressed.data(), OutputSize);
+			ASSERT_EQ(CompressedSize, Reference.Compress(vInput.data(), vInput.size(), vExpectedCompressed.data(), OutputSize)) << "i=" << i << " OutputSize=" << OutputSize;
+			if(CompressedSize > 0)
+			{
+				ASSERT_EQ(mem_comp(vCompressed.data(), vExpectedCompressed.data(), CompressedSize), 0) << "i=" << i;
+			}
+		}
+		Huffman.Compress(vInput.data(), vInput.size(), vCompressed.data(), vCompressed.size());
+
+		// decompress valid, truncated and corrupted data
+		std::vector<unsigned char> vDecompressInput(vCompressed.begin(), vCompressed.begin() + ExpectedSize);
+		if(i % 3 == 1)
+			vDecompressInput.resize(std::uniform_int_distribution<int>(0, ExpectedSize)(Random));
+		else if(i % 3 == 2)
+			vDecompressInput = RandomPayload(Random, ExpectedSize);
+		std::vector<unsigned char> vDecompressed(2048);
+		std::vector<unsigned char> vExpectedDecompressed(2048);
+		for(int OutputSize : {(int)vDecompressed.size(), Size, Size + MarginDistribution(Random)})
+		{
+			OutputSize = std::clamp(OutputSize, 0, (int)vDecompressed.size());
+			const int DecompressedSize = Huffman.Decompress(vDecompressInput.data(), vDecompressInput.size(), vDecompressed.data(), OutputSize);
+			ASSERT_EQ(DecompressedSize, Reference.Decompress(vDecompressInput.data(), vDecompressInput.size(), vExpectedDecompressed.data(), OutputSize)) << "i=" << i << " OutputSize=" << OutputSize;
+			if(DecompressedSize > 0)
+			{
+				ASSERT_EQ(mem_comp(vDecompressed.data(), vExpectedDecompressed.data(), DecompressedSize), 0) << "i=" << i;
+			}
+			if(i % 3 == 0 && OutputSize >= Size)
+			{
+				ASSERT_EQ(DecompressedSize, Size);
+				ASSERT_EQ(mem_comp(vDecompressed.data(), vInput.data(), Size), 0);
+			}
+		}
+	}
+}
+
+TEST(Huffman, Benchmark)
+{
+	static const int PAYLOAD_SIZE = 1200;
+	static const int NUM_PAYLOADS = 256;
+	static const int NUM_ITERATIONS = 20;
+
+	CHuffman Huffman;
+	Huffman.Init();
+	CReferenceHuffman Reference;
+	Reference.Init(CHuffman::ms_aFreqTable);
+
+	std::mt19937 Random(42);
+	std::vector<std::vector<unsigned char>> vvPayloads;
+	std::vector<std::vector<unsigned char>> vvCompressed;
+	for(int i = 0; i < NUM_PAYLOADS; i++)
+	{
+		vvPayloads.push_back(SnapshotPayload(Random, PAYLOAD_SIZE));
+		std::vector<unsigned char> vCompressed(PAYLOAD_SIZE * 2);
+		vCompressed.resize(Huffman.Compress(vvPayloads.back().data(), PAYLOAD_SIZE, vCompressed.data(), vCompressed.size()));
+		vvCompressed.push_back(vCompressed);
+	}
+
+	unsigned char aBuffer[PAYLOAD_SIZE * 2];
+	const auto &&Measure = [&](auto &&Function) {
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		for(int Iteration = 0; Iteration < NUM_ITERATIONS; Iteration++)
+			for(int i = 0; i < NUM_PAYLOADS; i++)
+				Function(i);
+		const std::chrono::duration<double> Duration = time_get_nanoseconds() - StartTime;
+		return (double)PAYLOAD_SIZE * NUM_PAYLOADS * NUM_ITERATIONS / Duration.count() / 1e6;
+	};
+	const double Compress = Measure([&](int i) { Huffman.Compress(vvPayloads[i].data(), PAYLOAD_SIZE, aBuffer, sizeof(aBuffer)); });
+	const double ReferenceCompress = Measure([&](int i) { Reference.Compress(vvPayloads[i].data(), PAYLOAD_SIZE, aBuffer, sizeof(aBuffer)); });
+	const double Decompress = Measure([&](int i) { EXPECT_EQ(Huffman.Decompress(vvCompressed[i].data(), vvCompressed[i].size(), aBuffer, sizeof(aBuffer)), PAYLOAD_SIZE); });
+	const double ReferenceDecompress = Measure([&](int i) { Reference.Decompress(vvCompressed[i].data(), vvCompressed[i].size(), aBuffer, sizeof(aBuffer)); });
+
+	log_info("huffman_test", "compress %.1f MB/s (reference %.1f MB/s), decompress %.1f MB/s (reference %.1f MB/s)",
+		Compress, ReferenceCompress, Decompress, ReferenceDecompress);
+}
@@ -1,14 +1,20 @@
 #include "test.h"
 
+#include <base/log.h>
 #include <base/sphore.h>
 #include <base/thread.h>
+#include <base/time.h>
 
 #include <engine/shared/host_lookup.h>
 #include <engine/shared/jobs.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
 #include <functional>
+#include <thread>
 
 static const int TEST_NUM_THREADS = 4;
 
@@ -36,11 +42,14 @@ protected:
 class CJob : public IJob
 {
 	std::function<void()> m_JobFunction;
+	const char *m_pName;
 	void Run() override { m_JobFunction(); }
 
 public:
-	CJob(std::function<void()> &&JobFunction) :
-		m_JobFunction(JobFunction) {}
+	CJob(std::function<void()> &&JobFunction, const char *pName = nullptr) :
+		m_JobFunction(JobFunction), m_pName(pName) {}
+
+	const char *Name() const override { return m_pName; }
 
 	void Abortable(bool Abortable)
 	{
@@ -48,6 +57,13 @@ public:
 	}
 };
 
+static std::shared_ptr<CJob> MakeJob(IJob::EPriority Priority, std::function<void()> &&JobFunction, const char *pName = nullptr)
+{
+	std::shared_ptr<CJob> pJob = std::make_shared<CJob>(std::move(JobFunction), pName);
+	pJob->SetPriority(Priority);
+	return pJob;
+}
+
 TEST_F(Jobs, Constructor)
 {
 }
@@ -165,3 +181,198 @@ TEST_F(Jobs, Many)
 	}
 	SetUp();
 }
+
+TEST_F(Jobs, InteractiveNotBlockedByBackground)
+{
+	CSemaphore BackgroundStarted;
+	CSemaphore ReleaseBackground;
+	std::atomic<int> NumBackgroundStarted(0);
+	std::vector<std::shared_ptr<CJob>> vpBackgroundJobs;
+	// one more background job than may run at the same time
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		vpBackgroundJobs.push_back(MakeJob(IJob::PRIORITY_BACKGROUND, [&] {
+			NumBackgroundStarted++;
+			BackgroundStarted.Signal();
+			ReleaseBackground.Wait();
+		}));
+		Add(vpBackgroundJobs.back());
+	}
+	for(int i = 0; i < TEST_NUM_THREADS - 1; i++)
+	{
+		BackgroundStarted.Wait();
+	}
+
+	// all but one worker are busy with background jobs, the interactive job must still run
+	CSemaphore InteractiveDone;
+	Add(MakeJob(IJob::PRIORITY_INTERACTIVE, [&] { InteractiveDone.Signal(); }));
+	InteractiveDone.Wait();
+	EXPECT_EQ(NumBackgroundStarted.load(), TEST_NUM_THREADS - 1);
+
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		ReleaseBackground.Signal();
+	}
+	TearDown();
+	for(auto &pJob : vpBackgroundJobs)
+	{
+		EXPECT_EQ(pJob->State(), IJob::STATE_DONE);
+	}
+	SetUp();
+}
+
+TEST_F(Jobs, Affinity)
+{
+	static const int NUM_JOBS = 64;
+	std::thread::id aThreadIds[NUM_JOBS];
+	std::vector<std::shared_ptr<CJob>> vpJobs;
+	for(int i = 0; i < NUM_JOBS; i++)
+	{
+		vpJobs.push_back(MakeJob(IJob::PRIORITY_INTERACTIVE, [&aThreadIds, i] { aThreadIds[i] = std::this_thread::get_id(); }));
+		vpJobs.back()->SetAffinity(TEST_NUM_THREADS + 1);
+		EXPECT_EQ(vpJobs.back()->Affinity(), TEST_NUM_THREADS + 1);
+		Add(vpJobs.back());
+	}
+	TearDown();
+	for(int i = 0; i < NUM_JOBS; i++)
+	{
+		EXPECT_EQ(vpJobs[i]->State(), IJob::STATE_DONE);
+		EXPECT_EQ(aThreadIds[i], aThreadIds[0]);
+	}
+	SetUp();
+}
+
+TEST_F(Jobs, Group)
+{
+	static const int NUM_TASKS = 256;
+	std::atomic<int> aNumRuns[NUM_TASKS] = {};
+	CJobGroup Group;
+	for(int i = 0; i < NUM_TASKS; i++)
+		Add(Group.Add("group", [&aNumRuns, i] { aNumRuns[i]++; }));
+	Group.Wait();
+	for(int i = 0; i < NUM_TASKS; i++)
+		EXPECT_EQ(aNumRuns[i].load(), 1);
+}
+
+TEST_F(Jobs, GroupNotBlockedByBusyPool)
+{
+	// occupy all workers, the tasks of the group must still complete
+	CSemaphore Started;
+	CSemaphore Release;
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		Add(MakeJob(IJob::PRIORITY_INTERACTIVE, [&] {
+			Started.Signal();
+			Release.Wait();
+		}));
+	}
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+		Started.Wait();
+
+	static const int NUM_TASKS = 16;
+	std::thread::id aThreadIds[NUM_TASKS];
+	{
+		CJobGroup Group;
+		for(int i = 0; i < NUM_TASKS; i++)
+			Add(Group.Add("group", [&aThreadIds, i] { aThreadIds[i] = std::this_thread::get_id(); }));
+		Group.Wait();
+	}
+	for(int i = 0; i < NUM_TASKS; i++)
+		EXPECT_EQ(aThreadIds[i], std::this_thread::get_id());
+
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+		Release.Signal();
+	TearDown();
+	SetUp();
+}
+
+TEST_F(Jobs, Statistics)
+{
+	static const int NUM_JOBS = 16;
+	for(int i = 0; i < NUM_JOBS; i++)
+	{
+		Add(std::make_shared<CJob>([] {}));
+		Add(std::make_shared<CJob>([] {}, i % 2 == 0 ? "even" : "odd"));
+	}
+	TearDown();
+	std::vector<CJobPool::CJobStatistics> vStatistics = m_Pool.Statistics();
+	ASSERT_EQ(vStatistics.size(), 3u);
+	std::sort(vStatistics.begin(), vStatistics.end(), [](const CJobPool::CJobStatistics &Left, const CJobPool::CJobStatistics &Right) {
+		return Left.m_Name < Right.m_Name;
+	});
+	// jobs without a name are grouped by their demangled type name
+	EXPECT_EQ(vStatistics[0].m_Name, "CJob");
+	EXPECT_EQ(vStatistics[0].m_NumJobs, NUM_JOBS);
+	EXPECT_EQ(vStatistics[1].m_Name, "even");
+	EXPECT_EQ(vStatistics[1].m_NumJobs, NUM_JOBS / 2);
+	EXPECT_EQ(vStatistics[2].m_Name, "odd");
+	EXPECT_EQ(vStatistics[2].m_NumJobs, NUM_JOBS / 2);
+	for(const CJobPool::CJobStatistics &Statistics : vStatistics)
+	{
+		EXPECT_GE(Statistics.m_TotalRunTime, Statistics.m_MaxRunTime);
+		EXPECT_GE(Statistics.m_TotalQueueTime, Statistics.m_MaxQueueTime);
+	}
+	SetUp();
+}
+
+TEST_F(Jobs, Stress)
+{
+	static const int NUM_PRODUCERS = 4;
+	static const int NUM_JOBS_PER_PRODUCER = 5000;
+	// every second job adds a child job from the worker thread, which can be stolen by other workers
+	static const int NUM_JOBS_TOTAL = NUM_PRODUCERS * NUM_JOBS_PER_PRODUCER * 3 / 2;
+
+	std::atomic<int> NumDone(0);
+	CSemaphore AllDone;
+	const auto &&Done = [&] {
+		if(++NumDone == NUM_JOBS_TOTAL)
+		{
+			AllDone.Signal();
+		}
+	};
+	const auto &&Produce = [&] {
+		for(int i = 0; i < NUM_JOBS_PER_PRODUCER; i++)
+		{
+			const IJob::EPriority Priority = i % 3 == 0 ? IJob::PRIORITY_BACKGROUND : IJob::PRIORITY_INTERACTIVE;
+			if(i % 2 == 0)
+			{
+				Add(MakeJob(
+					Priority, [&, Priority] {
+						Add(MakeJob(Priority, [&] { Done(); }, "child"));
+						Done();
+					},
+					"parent"));
+			}
+			else
+			{
+				Add(MakeJob(Priority, [&] { Done(); }, "single"));
+			}
+		}
+	};
+
+	const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+	std::vector<std::thread> vProducers;
+	for(int i = 0; i < NUM_PRODUCERS; i++)
+	{
+		vProducers.emplace_back(Produce);
+	}
+	for(std::thread &Producer : vProducers)
+	{
+		Producer.join();
+	}
+	AllDone.Wait();
+	const std::chrono::nanoseconds Duration = time_get_nanoseconds() - StartTime;
+	EXPECT_EQ(NumDone.load(), NUM_JOBS_TOTAL);
+
+	TearDown();
+	for(const CJobPool::CJobStatistics &Statistics : m_Pool.Statistics())
+	{
+		log_info("jobs_test", "%s: jobs=%" PRId64 " avg_queue=%.3fus max_queue=%.3fus avg_run=%.3fus max_run=%.3fus",
+			Statistics.m_Name.c_str(), Statistics.m_NumJobs,
+			Statistics.m_TotalQueueTime.count() / 1000.0 / Statistics.m_NumJobs, Statistics.m_MaxQueueTime.count() / 1000.0,
+			Statistics.m_TotalRunTime.count() / 1000.0 / Statistics.m_NumJobs, Statistics.m_MaxRunTime.count() / 1000.0);
+	}
+	log_info("jobs_test", "ran %d jobs from %d producers on %d threads in %.2fms (%.0f jobs/s)",
+		NUM_JOBS_TOTAL, NUM_PRODUCERS, TEST_NUM_THREADS, Duration.count() / 1000000.0, NUM_JOBS_TOTAL / (Duration.count() / 1000000000.0));
+	SetUp();
+}
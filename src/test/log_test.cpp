@@ -0,0 +1,106 @@
+#include "test.h"
+
+#include <base/fs.h>
+#include <base/io.h>
+#include <base/log.h>
+#include <base/logger.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+TEST(Log, MaxLevel)
+{
+	CMemoryLogger Logger;
+	Logger.SetFilter(CLogFilter{LEVEL_TRACE});
+	CLogScope LogScope(&Logger);
+
+	int NumEvaluated = 0;
+	log_set_max_level(LEVEL_INFO);
+	EXPECT_TRUE(log_level_enabled(LEVEL_ERROR));
+	EXPECT_TRUE(log_level_enabled(LEVEL_INFO));
+	EXPECT_FALSE(log_level_enabled(LEVEL_DEBUG));
+	log_info("test", "info %d", ++NumEvaluated);
+	log_debug("test", "debug %d", ++NumEvaluated);
+	log_trace("test", "trace %d", ++NumEvaluated);
+	log_warn_color(LOG_COLOR{255, 0, 0}, "test", "warn %d", ++NumEvaluated);
+	log_log(LEVEL_DEBUG, "test", "debug %d", 0);
+
+	log_set_max_level(-1);
+	log_error("test", "error %d", ++NumEvaluated);
+
+	log_set_max_level(LEVEL_TRACE);
+	log_trace("test", "trace %d", ++NumEvaluated);
+
+	EXPECT_EQ(NumEvaluated, 3);
+	const std::vector<CLogMessage> vLines = Logger.Lines();
+	ASSERT_EQ(vLines.size(), 3u);
+	EXPECT_STREQ(vLines[0].Message(), "info 1");
+	EXPECT_STREQ(vLines[1].Message(), "warn 2");
+	EXPECT_STREQ(vLines[2].Message(), "trace 3");
+}
+
+TEST(Log, AsyncFileThreads)
+{
+	static const int NUM_LINES_PER_THREAD = 20000;
+	static const char *const s_apThreadNames[] = {"game", "sql", "http"};
+	static const int NUM_THREADS = std::size(s_apThreadNames);
+
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	std::unique_ptr<ILogger> pLogger = log_logger_file(File);
+
+	const auto &&Run = [&](LEVEL Level) {
+		std::vector<std::thread> vThreads;
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		for(const char *pThreadName : s_apThreadNames)
+		{
+			vThreads.emplace_back([&, pThreadName] {
+				CLogScope LogScope(pLogger.get());
+				for(int i = 0; i < NUM_LINES_PER_THREAD; i++)
+				{
+					if(Level == LEVEL_TRACE)
+						log_trace(pThreadName, "message %d from %s with some more text %f", i, pThreadName, i / 3.0);
+					else
+						log_info(pThreadName, "message %d from %s with some more text %f", i, pThreadName, i / 3.0);
+				}
+			});
+		}
+		for(std::thread &Thread : vThreads)
+			Thread.join();
+		return time_get_nanoseconds() - StartTime;
+	};
+
+	const std::chrono::duration<double> WriteDuration = Run(LEVEL_INFO);
+	log_set_max_level(LEVEL_INFO);
+	const std::chrono::duration<double> DropDuration = Run(LEVEL_TRACE);
+	log_set_max_level(LEVEL_TRACE);
+	pLogger = nullptr;
+
+	char *pContent = io_read_all_str(io_open(Info.m_aFilename, IOFLAG_READ));
+	ASSERT_TRUE(pContent);
+	int NumLines = 0;
+	for(const char *pLine = pContent; *pLine;)
+	{
+		const char *pEnd = str_find(pLine, "\n");
+		ASSERT_TRUE(pEnd);
+		// lines of different threads must not be interleaved
+		const char *pText = str_find(pLine, "with some more text");
+		EXPECT_TRUE(pText && pText < pEnd);
+		pLine = pEnd + 1;
+		NumLines++;
+	}
+	free(pContent);
+	EXPECT_EQ(NumLines, NUM_THREADS * NUM_LINES_PER_THREAD);
+	EXPECT_FALSE(fs_remove(Info.m_aFilename));
+
+	const double NumLinesTotal = NUM_THREADS * NUM_LINES_PER_THREAD;
+	log_info("log_test", "%d threads: %.0f written lines/s, %.0f dropped lines/s",
+		NUM_THREADS, NumLinesTotal / WriteDuration.count(), NumLinesTotal / DropDuration.count());
+}
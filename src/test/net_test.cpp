@@ -2,9 +2,14 @@
 #include <base/net.h>
 #include <base/secure.h>
 
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -54,3 +59,192 @@ TEST(Net, Ipv4AndIpv6Work)
 	net_udp_close(Socket1);
 	net_udp_close(Socket2);
 }
+
+TEST(Net, ConnlessInPlace)
+{
+	NETADDR Bindaddr = {};
+	Bindaddr.type = NETTYPE_IPV4;
+	NETSOCKET Sender = net_udp_create(Bindaddr);
+	ASSERT_TRUE(Sender);
+	NETSOCKET Receiver;
+	do
+	{
+		Bindaddr.port = secure_rand_below(65535 - 1024) + 1024;
+	} while(!(Receiver = net_udp_create(Bindaddr)));
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	const auto &&Receive = [&]() {
+		NETADDR Addr;
+		unsigned char *pData;
+		EXPECT_EQ(net_socket_read_wait(Receiver, 10s), 1);
+		const int Size = net_udp_recv(Receiver, &Addr, &pData);
+		EXPECT_GT(Size, 0);
+		return std::vector<unsigned char>(pData, pData + std::max(Size, 0));
+	};
+
+	// the in-place variants must send the same packets
+	unsigned char aBuffer[NET_CONNLESS_HEADER_SIZE_7 + 5];
+	unsigned char *pData = aBuffer + sizeof(aBuffer) - 5;
+	mem_copy(pData, "hello", 5);
+	unsigned char aExtra[NET_CONNLESS_EXTRA_SIZE] = {0};
+
+	CNetBase::SendPacketConnless(Sender, &Target, "hello", 5, false, aExtra);
+	const std::vector<unsigned char> vExpected = Receive();
+	CNetBase::SendPacketConnlessInPlace(Sender, &Target, pData, 5);
+	EXPECT_EQ(Receive(), vExpected);
+
+	CNetBase::SendPacketConnlessWithToken7(Sender, &Target, "hello", 5, 0x12345678, 0x7654321);
+	const std::vector<unsigned char> vExpected7 = Receive();
+	CNetBase::SendPacketConnlessWithToken7InPlace(Sender, &Target, pData, 5, 0x12345678, 0x7654321);
+	EXPECT_EQ(Receive(), vExpected7);
+
+	net_udp_close(Sender);
+	net_udp_close(Receiver);
+}
+
+class CSlotTestServer
+{
+public:
+	CNetServer m_Server;
+	NETADDR m_Address;
+	std::vector<int> m_vNewClients;
+	std::vector<int> m_vDelClients;
+	// client id of each received chunk
+	std::vector<int> m_vChunkClientIds;
+
+	static int NewClientCallback(int ClientId, void *pUser, bool Sixup)
+	{
+		static_cast<CSlotTestServer *>(pUser)->m_vNewClients.push_back(ClientId);
+		return 0;
+	}
+
+	static int DelClientCallback(int ClientId, const char *pReason, void *pUser)
+	{
+		static_cast<CSlotTestServer *>(pUser)->m_vDelClients.push_back(ClientId);
+		return 0;
+	}
+
+	bool Open(int MaxClients)
+	{
+		NETADDR BindAddr;
+		if(net_addr_from_str(&BindAddr, "127.0.0.1"))
+			return false;
+		do
+		{
+			BindAddr.port = secure_rand_below(65535 - 1024) + 1024;
+		} while(!m_Server.Open(BindAddr, nullptr, MaxClients, MaxClients));
+		m_Server.SetCallbacks(NewClientCallback, DelClientCallback, this);
+		m_Address = BindAddr;
+		return true;
+	}
+
+	void Update()
+	{
+		m_Server.Update();
+		CNetChunk Chunk;
+		SECURITY_TOKEN ResponseToken;
+		while(m_Server.Recv(&Chunk, &ResponseToken))
+		{
+			m_vChunkClientIds.push_back(Chunk.m_ClientId);
+		}
+	}
+};
+
+static void UpdateClient(CNetClient &Client)
+{
+	Client.Update();
+	CNetChunk Chunk;
+	SECURITY_TOKEN ResponseToken;
+	while(Client.Recv(&Chunk, &ResponseToken, false))
+	{
+	}
+}
+
+template<typename F>
+static bool PumpUntil(CSlotTestServer &Server, std::vector<CNetClient *> vpClients, F &&Done)
+{
+	for(int i = 0; i < 5000; i++)
+	{
+		for(CNetClient *pClient : vpClients)
+			UpdateClient(*pClient);
+		Server.Update();
+		if(Done())
+			return true;
+		net_socket_read_wait(Server.m_Server.Socket(), 1ms);
+	}
+	return false;
+}
+
+static bool OpenClient(CNetClient &Client)
+{
+	NETADDR BindAddr = {};
+	BindAddr.type = NETTYPE_IPV4;
+	return Client.Open(BindAddr);
+}
+
+static void SendChunk(CNetClient &Client)
+{
+	const unsigned char aData[] = {1, 2, 3};
+	CNetChunk Chunk = {};
+	Chunk.m_ClientId = 0;
+	Chunk.m_Flags = NETSENDFLAG_VITAL | NETSENDFLAG_FLUSH;
+	Chunk.m_DataSize = sizeof(aData);
+	Chunk.m_pData = aData;
+	Client.Send(&Chunk);
+}
+
+// Returns the slot of the client, as seen by the server for a chunk sent by the client.
+static int SlotOfClient(CSlotTestServer &Server, CNetClient &Client, std::vector<CNetClient *> vpClients)
+{
+	Server.m_vChunkClientIds.clear();
+	SendChunk(Client);
+	if(!PumpUntil(Server, vpClients, [&] { return !Server.m_vChunkClientIds.empty(); }))
+		return -2;
+	return Server.m_vChunkClientIds.back();
+}
+
+TEST(Net, ServerSlotByAddress)
+{
+	CNetBase::Init();
+	g_Config.m_ConnTimeout = 100;
+	CSlotTestServer Server;
+	ASSERT_TRUE(Server.Open(2));
+
+	CNetClient ClientA, ClientB, ClientC;
+	ASSERT_TRUE(OpenClient(ClientA));
+	ASSERT_TRUE(OpenClient(ClientB));
+	ASSERT_TRUE(OpenClient(ClientC));
+	const std::vector<CNetClient *> vpClients = {&ClientA, &ClientB, &ClientC};
+
+	ClientA.Connect(&Server.m_Address, 1);
+	ASSERT_TRUE(PumpUntil(Server, vpClients, [&] { return ClientA.State() == NETSTATE_ONLINE && Server.m_vNewClients.size() == 1; }));
+	ClientB.Connect(&Server.m_Address, 1);
+	ASSERT_TRUE(PumpUntil(Server, vpClients, [&] { return ClientB.State() == NETSTATE_ONLINE && Server.m_vNewClients.size() == 2; }));
+	const int SlotA = Server.m_vNewClients[0];
+	const int SlotB = Server.m_vNewClients[1];
+	EXPECT_NE(SlotA, SlotB);
+	EXPECT_EQ(SlotOfClient(Server, ClientA, vpClients), SlotA);
+	EXPECT_EQ(SlotOfClient(Server, ClientB, vpClients), SlotB);
+
+	// the slot of a dropped client is reused by the next client
+	Server.m_Server.Drop(SlotA, "test");
+	ASSERT_EQ(Server.m_vDelClients, std::vector<int>{SlotA});
+	ASSERT_TRUE(PumpUntil(Server, vpClients, [&] { return ClientA.State() != NETSTATE_ONLINE; }));
+	ClientC.Connect(&Server.m_Address, 1);
+	ASSERT_TRUE(PumpUntil(Server, vpClients, [&] { return ClientC.State() == NETSTATE_ONLINE && Server.m_vNewClients.size() == 3; }));
+	EXPECT_EQ(Server.m_vNewClients[2], SlotA);
+	EXPECT_EQ(SlotOfClient(Server, ClientC, vpClients), SlotA);
+	EXPECT_EQ(SlotOfClient(Server, ClientB, vpClients), SlotB);
+
+	// a resumed connection is found in its new slot
+	Server.m_Server.ResumeOldConnection(SlotA, SlotB);
+	EXPECT_EQ(SlotOfClient(Server, ClientB, vpClients), SlotA);
+
+	ClientA.Close();
+	ClientB.Close();
+	ClientC.Close();
+	Server.m_Server.Close();
+}
@@ -0,0 +1,91 @@
+#include "test.h"
+
+#include <base/fs.h>
+#include <base/io.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/shared/profiler.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(Profiler, NestedScopes)
+{
+	{
+		const CProfileScope ProfileScope("before_start");
+	}
+
+	CProfiler::Start();
+	for(int i = 0; i < 3; i++)
+	{
+		const CProfileScope OuterScope("outer");
+		{
+			const CProfileScope InnerScope("inner");
+		}
+		{
+			const CProfileScope InnerScope("other");
+		}
+	}
+	std::thread([]() {
+		const CProfileScope ProfileScope("thread");
+	}).join();
+	CProfiler::Stop();
+
+	{
+		const CProfileScope ProfileScope("after_stop");
+	}
+
+	const std::vector<CProfiler::CThreadEvents> vThreads = CProfiler::Events();
+	const std::vector<CProfiler::CPathStats> vStats = CProfiler::Summarize(vThreads);
+	ASSERT_EQ(vStats.size(), 4u);
+	EXPECT_EQ(vStats[0].m_Path, "outer");
+	EXPECT_EQ(vStats[1].m_Path, "outer;inner");
+	EXPECT_EQ(vStats[2].m_Path, "outer;other");
+	EXPECT_EQ(vStats[3].m_Path, "thread");
+	for(const CProfiler::CPathStats &Stats : vStats)
+	{
+		EXPECT_EQ(Stats.m_Count, Stats.m_Path == "thread" ? 1 : 3);
+		EXPECT_LE(Stats.m_Median, Stats.m_P99);
+		EXPECT_LE(Stats.m_P99, Stats.m_Max);
+		EXPECT_LE(Stats.m_Max, Stats.m_Total);
+	}
+	// the time of the nested scopes only counts for themselves
+	EXPECT_EQ(vStats[0].m_Total, vStats[0].m_Self + vStats[1].m_Total + vStats[2].m_Total);
+
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	CProfiler::WriteChromeTrace(File, vThreads);
+	io_close(File);
+	char *pTrace = io_read_all_str(io_open(Info.m_aFilename, IOFLAG_READ));
+	ASSERT_TRUE(pTrace);
+	EXPECT_TRUE(str_startswith(pTrace, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	EXPECT_TRUE(str_find(pTrace, "{\"name\":\"inner\",\"ph\":\"X\""));
+	free(pTrace);
+	fs_remove(Info.m_aFilename);
+
+	// restarting discards the recorded scopes
+	CProfiler::Start();
+	CProfiler::Stop();
+	EXPECT_TRUE(CProfiler::Summarize(CProfiler::Events()).empty());
+}
+
+TEST(Profiler, EventsSince)
+{
+	CProfiler::Start();
+	{
+		const CProfileScope ProfileScope("first");
+	}
+	const int64_t Since = time_get_nanoseconds().count();
+	{
+		const CProfileScope ProfileScope("second");
+	}
+	CProfiler::Stop();
+
+	const std::vector<CProfiler::CPathStats> vStats = CProfiler::Summarize(CProfiler::Events(Since));
+	ASSERT_EQ(vStats.size(), 1u);
+	EXPECT_EQ(vStats[0].m_Path, "second");
+	EXPECT_EQ(CProfiler::Summarize(CProfiler::Events()).size(), 2u);
+}
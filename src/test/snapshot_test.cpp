@@ -77,3 +77,56 @@ TEST(Snapshot, CrcOverflow)
 	Builder.Finish(&Buffer);
 	ASSERT_EQ(Buffer.AsSnapshot()->Crc(), 1);
 }
+
+static int BuildFlagSnapshot(CSnapshotBuffer *pBuffer, int X)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	CNetObj_Flag *pFlag = static_cast<CNetObj_Flag *>(Builder.NewItem(CNetObj_Flag::ms_MsgId, 0, sizeof(CNetObj_Flag)));
+	pFlag->m_X = X;
+	pFlag->m_Y = 0;
+	pFlag->m_Team = 0;
+	return Builder.Finish(pBuffer);
+}
+
+TEST(Snapshot, StoragePool)
+{
+	CSnapshotBuffer Buffer1;
+	CSnapshotBuffer Buffer2;
+	const int Size1 = BuildFlagSnapshot(&Buffer1, 1);
+	const int Size2 = BuildFlagSnapshot(&Buffer2, 2);
+
+	CSnapshotPool Pool;
+	{
+		CSnapshotStorage Storage1;
+		CSnapshotStorage Storage2;
+		Storage1.SetPool(&Pool);
+		Storage2.SetPool(&Pool);
+
+		// identical snapshots are only stored once
+		Storage1.Add(1, 0, Size1, Buffer1.AsSnapshot(), 0, nullptr);
+		Storage1.Add(2, 0, Size1, Buffer1.AsSnapshot(), 0, nullptr);
+		Storage2.Add(1, 0, Size1, Buffer1.AsSnapshot(), 0, nullptr);
+		Storage2.Add(2, 0, Size2, Buffer2.AsSnapshot(), 0, nullptr);
+		EXPECT_EQ(Pool.NumSnapshots(), 2);
+		EXPECT_EQ(Pool.MemoryUsage(), (size_t)(Size1 + Size2));
+
+		const CSnapshot *pSnap1;
+		const CSnapshot *pSnap2;
+		ASSERT_EQ(Storage1.Get(2, nullptr, &pSnap1, nullptr), Size1);
+		ASSERT_EQ(Storage2.Get(1, nullptr, &pSnap2, nullptr), Size1);
+		EXPECT_EQ(pSnap1, pSnap2);
+		EXPECT_EQ(mem_comp(pSnap1, Buffer1.AsSnapshot(), Size1), 0);
+		ASSERT_EQ(Storage2.Get(2, nullptr, &pSnap2, nullptr), Size2);
+		EXPECT_EQ(mem_comp(pSnap2, Buffer2.AsSnapshot(), Size2), 0);
+
+		// snapshots are freed when they are no longer stored anywhere
+		Storage2.PurgeUntil(3);
+		EXPECT_EQ(Pool.NumSnapshots(), 1);
+		EXPECT_EQ(Pool.MemoryUsage(), (size_t)Size1);
+		Storage1.PurgeUntil(2);
+		EXPECT_EQ(Pool.NumSnapshots(), 1);
+	}
+	EXPECT_EQ(Pool.NumSnapshots(), 0);
+	EXPECT_EQ(Pool.MemoryUsage(), 0u);
+}
@@ -0,0 +1,222 @@
+#include <base/log.h>
+#include <base/time.h>
+
+#include <engine/shared/mpsc_queue.h>
+#include <engine/shared/sound_mix.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+static void ReferenceAccumulate(int *pOut, const short *pIn, unsigned Frames, int Channels, int VolumeL, int VolumeR)
+{
+	const short *pInL = pIn;
+	const short *pInR = Channels == 1 ? pIn : pIn + 1;
+	for(unsigned s = 0; s < Frames; s++)
+	{
+		*pOut++ += (*pInL) * VolumeL;
+		*pOut++ += (*pInR) * VolumeR;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
+static void ReferenceClamp(short *pOut, const int *pIn, unsigned Samples, int MasterVolume)
+{
+	for(unsigned i = 0; i < Samples; i++)
+		pOut[i] = std::clamp<int>(((pIn[i] * MasterVolume) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+}
+
+static std::vector<short> RandomSamples(std::mt19937 &Random, size_t Size)
+{
+	std::uniform_int_distribution<int> Distribution(std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	std::vector<short> vSamples(Size);
+	for(short &Sample : vSamples)
+		Sample = Distribution(Random);
+	return vSamples;
+}
+
+TEST(SoundMix, Accumulate)
+{
+	std::mt19937 Random(42);
+	std::uniform_int_distribution<int> VolumeDistribution(0, 255);
+	std::uniform_int_distribution<int> MixDistribution(-1000000, 1000000);
+	for(int Channels = 1; Channels <= 2; Channels++)
+	{
+		// cover the remainder loops as well
+		for(unsigned Frames = 0; Frames < 40; Frames++)
+		{
+			// unaligned input and output
+			const std::vector<short> vIn = RandomSamples(Random, Frames * Channels + 1);
+			std::vector<int> vOut(Frames * 2 + 1);
+			for(int &Value : vOut)
+				Value = MixDistribution(Random);
+			std::vector<int> vExpected = vOut;
+
+			const int VolumeL = VolumeDistribution(Random);
+			const int VolumeR = Frames % 4 == 0 ? 255 : VolumeDistribution(Random);
+			ReferenceAccumulate(vExpected.data() + 1, vIn.data() + 1, Frames, Channels, VolumeL, VolumeR);
+			if(Channels == 1)
+				CSoundMix::AccumulateMono(vOut.data() + 1, vIn.data() + 1, Frames, VolumeL, VolumeR);
+			else
+				CSoundMix::AccumulateStereo(vOut.data() + 1, vIn.data() + 1, Frames, VolumeL, VolumeR);
+			EXPECT_EQ(vOut, vExpected) << "Channels=" << Channels << " Frames=" << Frames;
+		}
+	}
+}
+
+TEST(SoundMix, Clamp)
+{
+	std::mt19937 Random(42);
+	// values up to the largest that the reference computes without overflow
+	std::uniform_int_distribution<int> Distribution(-std::numeric_limits<int>::max() / 100, std::numeric_limits<int>::max() / 100);
+	std::vector<int> vIn(1000 + 3);
+	for(int &Value : vIn)
+		Value = Distribution(Random);
+	vIn[0] = 0;
+	vIn[1] = -std::numeric_limits<int>::max() / 100;
+	vIn[2] = std::numeric_limits<int>::max() / 100;
+	for(int i = 3; i < 50; i++)
+		vIn[i] = i * 101 * 256 / 100 * (i % 2 ? -1 : 1); // exact multiples and their neighbours
+	for(int i = 50; i < 100; i++)
+		vIn[i] = vIn[i - 47] + (i % 2 ? 1 : -1);
+
+	for(int MasterVolume : {0, 1, 50, 99, 100})
+	{
+		for(unsigned Offset = 0; Offset < 3; Offset++)
+		{
+			const unsigned Samples = vIn.size() - Offset;
+			std::vector<short> vExpected(Samples);
+			std::vector<short> vOut(Samples);
+			ReferenceClamp(vExpected.data(), vIn.data() + Offset, Samples, MasterVolume);
+			CSoundMix::Clamp(vOut.data(), vIn.data() + Offset, Samples, MasterVolume);
+			EXPECT_EQ(vOut, vExpected) << "MasterVolume=" << MasterVolume << " Offset=" << Offset;
+		}
+	}
+}
+
+TEST(SoundMix, Benchmark)
+{
+	static const int NUM_VOICES = 64;
+	static const unsigned NUM_FRAMES = 1024;
+	static const int NUM_ITERATIONS = 200;
+
+	std::mt19937 Random(42);
+	const std::vector<short> vIn = RandomSamples(Random, NUM_FRAMES * 2);
+	std::vector<int> vMix(NUM_FRAMES * 2);
+	std::vector<int> vExpectedMix(NUM_FRAMES * 2);
+	std::vector<short> vOut(NUM_FRAMES * 2);
+	std::vector<short> vExpectedOut(NUM_FRAMES * 2);
+
+	const auto &&Run = [&](bool Reference) {
+		int *pMix = Reference ? vExpectedMix.data() : vMix.data();
+		short *pOut = Reference ? vExpectedOut.data() : vOut.data();
+		const std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		for(int Iteration = 0; Iteration < NUM_ITERATIONS; Iteration++)
+		{
+			std::fill(pMix, pMix + NUM_FRAMES * 2, 0);
+			for(int Voice = 0; Voice < NUM_VOICES; Voice++)
+			{
+				// keep the sum in range, like real voices with falloff
+				const int Channels = Voice % 2 + 1;
+				const int Volume = Voice % 4;
+				if(Reference)
+					ReferenceAccumulate(pMix, vIn.data(), NUM_FRAMES, Channels, Volume, 3 - Volume);
+				else if(Channels == 1)
+					CSoundMix::AccumulateMono(pMix, vIn.data(), NUM_FRAMES, Volume, 3 - Volume);
+				else
+					CSoundMix::AccumulateStereo(pMix, vIn.data(), NUM_FRAMES, Volume, 3 - Volume);
+			}
+			if(Reference)
+				ReferenceClamp(pOut, pMix, NUM_FRAMES * 2, 100);
+			else
+				CSoundMix::Clamp(pOut, pMix, NUM_FRAMES * 2, 100);
+		}
+		return time_get_nanoseconds() - StartTime;
+	};
+
+	const std::chrono::duration<double> ReferenceDuration = Run(true);
+	const std::chrono::duration<double> Duration = Run(false);
+	EXPECT_EQ(vMix, vExpectedMix);
+	EXPECT_EQ(vOut, vExpectedOut);
+
+	const double MixedFrames = (double)NUM_ITERATIONS * NUM_FRAMES;
+	log_info("sound_mix_test", "mixed %d voices: %.0f frames/s (reference %.0f frames/s)",
+		NUM_VOICES, MixedFrames / Duration.count(), MixedFrames / ReferenceDuration.count());
+}
+
+TEST(MpscQueue, PushPop)
+{
+	CMpscQueue<int, 4> Queue;
+	int Item;
+	EXPECT_FALSE(Queue.TryPop(&Item));
+	for(int Lap = 0; Lap < 3; Lap++)
+	{
+		for(int i = 0; i < 4; i++)
+			EXPECT_TRUE(Queue.TryPush(Lap * 10 + i));
+		EXPECT_FALSE(Queue.TryPush(-1));
+		for(int i = 0; i < 4; i++)
+		{
+			ASSERT_TRUE(Queue.TryPop(&Item));
+			EXPECT_EQ(Item, Lap * 10 + i);
+		}
+		EXPECT_FALSE(Queue.TryPop(&Item));
+	}
+}
+
+TEST(MpscQueue, MultipleProducers)
+{
+	static const int NUM_PRODUCERS = 4;
+	static const int NUM_ITEMS_PER_PRODUCER = 100000;
+
+	class CItem
+	{
+	public:
+		int m_Producer;
+		int m_Index;
+	};
+	CMpscQueue<CItem, 64> Queue;
+
+	std::vector<std::thread> vProducers;
+	for(int Producer = 0; Producer < NUM_PRODUCERS; Producer++)
+	{
+		vProducers.emplace_back([&Queue, Producer] {
+			for(int i = 0; i < NUM_ITEMS_PER_PRODUCER; i++)
+			{
+				while(!Queue.TryPush({Producer, i}))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	// the items of every producer must arrive in order
+	int aNextIndex[NUM_PRODUCERS] = {0};
+	int NumItems = 0;
+	while(NumItems < NUM_PRODUCERS * NUM_ITEMS_PER_PRODUCER)
+	{
+		CItem Item;
+		if(!Queue.TryPop(&Item))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		NumItems++;
+		if(Item.m_Producer < 0 || Item.m_Producer >= NUM_PRODUCERS)
+		{
+			ADD_FAILURE() << "Invalid producer " << Item.m_Producer;
+			continue;
+		}
+		EXPECT_EQ(Item.m_Index, aNextIndex[Item.m_Producer]);
+		aNextIndex[Item.m_Producer] = Item.m_Index + 1;
+	}
+
+	for(std::thread &Producer : vProducers)
+		Producer.join();
+	CItem Item;
+	EXPECT_FALSE(Queue.TryPop(&Item));
+}
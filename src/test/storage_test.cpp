@@ -0,0 +1,162 @@
+#include "test.h"
+
+#include <base/detect.h>
+#include <base/fs.h>
+#include <base/io.h>
+#include <base/log.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/storage.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+
+static void WriteFile(IStorage *pStorage, const char *pFilename)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_close(File);
+}
+
+static int CollectCallback(const char *pName, int IsDir, int Type, void *pUser)
+{
+	if(str_comp(pName, ".") != 0 && str_comp(pName, "..") != 0)
+		static_cast<std::set<std::string> *>(pUser)->emplace(pName);
+	return 0;
+}
+
+static std::set<std::string> ListDirectory(IStorage *pStorage, const char *pPath)
+{
+	std::set<std::string> Entries;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, pPath, CollectCallback, &Entries);
+	return Entries;
+}
+
+static std::set<std::string> FindFiles(IStorage *pStorage, const char *pFilename, const char *pPath)
+{
+	std::set<std::string> Entries;
+	pStorage->FindFiles(pFilename, pPath, IStorage::TYPE_SAVE, &Entries);
+	return Entries;
+}
+
+TEST(Storage, FindAndListChanges)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+
+	char aFound[IO_MAX_PATH_LENGTH];
+	EXPECT_FALSE(pStorage->FindFile("a.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	EXPECT_EQ(ListDirectory(pStorage.get(), "maps"), std::set<std::string>());
+
+	ASSERT_TRUE(pStorage->CreateFolder("maps", IStorage::TYPE_SAVE));
+	ASSERT_TRUE(pStorage->CreateFolder("maps/sub", IStorage::TYPE_SAVE));
+	WriteFile(pStorage.get(), "maps/sub/a.map");
+	ASSERT_TRUE(pStorage->FindFile("a.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	EXPECT_STREQ(aFound, "maps/sub/a.map");
+
+	// files in a folder are found before the ones in its subfolders
+	WriteFile(pStorage.get(), "maps/a.map");
+	ASSERT_TRUE(pStorage->FindFile("a.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	EXPECT_STREQ(aFound, "maps/a.map");
+	EXPECT_EQ(FindFiles(pStorage.get(), "a.map", "maps"), (std::set<std::string>{"maps/a.map", "maps/sub/a.map"}));
+	EXPECT_EQ(ListDirectory(pStorage.get(), "maps"), (std::set<std::string>{"a.map", "sub"}));
+
+	ASSERT_TRUE(pStorage->RenameFile("maps/sub/a.map", "maps/sub/b.map", IStorage::TYPE_SAVE));
+	EXPECT_EQ(FindFiles(pStorage.get(), "a.map", "maps"), (std::set<std::string>{"maps/a.map"}));
+	EXPECT_EQ(ListDirectory(pStorage.get(), "maps/sub"), (std::set<std::string>{"b.map"}));
+
+	ASSERT_TRUE(pStorage->RemoveFile("maps/a.map", IStorage::TYPE_SAVE));
+	EXPECT_FALSE(pStorage->FindFile("a.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	EXPECT_EQ(ListDirectory(pStorage.get(), "maps"), (std::set<std::string>{"sub"}));
+
+#if defined(CONF_PLATFORM_LINUX)
+	// changes made outside of the storage are reported by inotify
+	char aPath[IO_MAX_PATH_LENGTH];
+	pStorage->GetCompletePath(IStorage::TYPE_SAVE, "maps/sub/c.map", aPath, sizeof(aPath));
+	IOHANDLE File = io_open(aPath, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_close(File);
+	ASSERT_TRUE(pStorage->FindFile("c.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	EXPECT_STREQ(aFound, "maps/sub/c.map");
+	ASSERT_FALSE(fs_remove(aPath));
+	EXPECT_FALSE(pStorage->FindFile("c.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+#endif
+}
+
+TEST(Storage, Benchmark)
+{
+	static const int NUM_FOLDERS = 20;
+	static const int NUM_FILES = 1000;
+	static const int NUM_CACHED_LOOKUPS = 100;
+
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	{
+		std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+		ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+		ASSERT_TRUE(pStorage->CreateFolder("maps", IStorage::TYPE_SAVE));
+		for(int Folder = 0; Folder < NUM_FOLDERS; Folder++)
+		{
+			char aFolder[IO_MAX_PATH_LENGTH];
+			str_format(aFolder, sizeof(aFolder), "maps/folder%d", Folder);
+			ASSERT_TRUE(pStorage->CreateFolder(aFolder, IStorage::TYPE_SAVE));
+			for(int File = 0; File < NUM_FILES; File++)
+			{
+				char aFilename[IO_MAX_PATH_LENGTH];
+				str_format(aFilename, sizeof(aFilename), "%s/map%d.map", aFolder, File);
+				WriteFile(pStorage.get(), aFilename);
+			}
+		}
+	}
+
+	// A new storage has not listed any folder yet, so its first lookup reads
+	// the tree from disk like a search without the cache.
+	const auto &&Measure = [&](const char *pName, const auto &&Lookup) {
+		std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+		ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+		std::chrono::nanoseconds StartTime = time_get_nanoseconds();
+		Lookup(pStorage.get());
+		const std::chrono::nanoseconds UncachedDuration = time_get_nanoseconds() - StartTime;
+		StartTime = time_get_nanoseconds();
+		for(int i = 0; i < NUM_CACHED_LOOKUPS; i++)
+			Lookup(pStorage.get());
+		const std::chrono::nanoseconds CachedDuration = (time_get_nanoseconds() - StartTime) / NUM_CACHED_LOOKUPS;
+		log_info("storage_test", "%s in %d folders with %d files: %.3fms uncached, %.3fms cached", pName, NUM_FOLDERS, NUM_FILES,
+			std::chrono::duration<double, std::milli>(UncachedDuration).count(), std::chrono::duration<double, std::milli>(CachedDuration).count());
+	};
+
+	Measure("FindFile of an existing file", [](IStorage *pStorage) {
+		char aFound[IO_MAX_PATH_LENGTH];
+		ASSERT_TRUE(pStorage->FindFile("map500.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	});
+	Measure("FindFile of a missing file", [](IStorage *pStorage) {
+		char aFound[IO_MAX_PATH_LENGTH];
+		ASSERT_FALSE(pStorage->FindFile("missing.map", "maps", IStorage::TYPE_SAVE, aFound, sizeof(aFound)));
+	});
+	Measure("FindFiles", [](IStorage *pStorage) {
+		EXPECT_EQ(FindFiles(pStorage, "map500.map", "maps").size(), (size_t)NUM_FOLDERS);
+	});
+
+	// the test storage is only deleted automatically if it contains a few files
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating test storage";
+	for(int Folder = 0; Folder < NUM_FOLDERS; Folder++)
+	{
+		char aFolder[IO_MAX_PATH_LENGTH];
+		str_format(aFolder, sizeof(aFolder), "maps/folder%d", Folder);
+		for(int File = 0; File < NUM_FILES; File++)
+		{
+			char aFilename[IO_MAX_PATH_LENGTH];
+			str_format(aFilename, sizeof(aFilename), "%s/map%d.map", aFolder, File);
+			ASSERT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+		}
+		ASSERT_TRUE(pStorage->RemoveFolder(aFolder, IStorage::TYPE_SAVE));
+	}
+}
@@ -931,3 +931,78 @@ TEST_F(TeeHistorian, PrevGameUuid)
 	EXPECT_STREQ(JsonPrevGameUuid, "fe19c218-f555-4002-a273-126c59ccc17a");
 	json_value_free(pJson);
 }
+
+TEST_F(TeeHistorian, Reader)
+{
+	CNetObj_PlayerInput Input = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	const unsigned char aMessage[] = {0x01, 0x02, 0x03};
+
+	m_TH.RecordPlayerJoin(3, CTeeHistorian::PROTOCOL_7);
+	Tick(1);
+	Player(3, 10, 20);
+	Player(5, 1, 2);
+	Inputs();
+	m_TH.RecordPlayerInput(3, 1, &Input);
+	m_TH.RecordPlayerMessage(3, aMessage, sizeof(aMessage));
+	Tick(2);
+	Player(3, 12, 18);
+	DeadPlayer(5);
+	Inputs();
+	Input.m_Direction = -1;
+	m_TH.RecordPlayerInput(3, 1, &Input);
+	Tick(5);
+	Player(3, 0, 0);
+	Inputs();
+	m_TH.RecordPlayerDrop(3, "too many pancakes");
+	Finish();
+
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(m_vBuffer.data(), m_vBuffer.size()));
+	json_value *pJson = json_parse(Reader.Header(), -1);
+	ASSERT_TRUE(pJson);
+	EXPECT_STREQ((*pJson)["map_name"], "Kobra 3 Solo");
+	json_value_free(pJson);
+
+	CTeeHistorianReader::CChunk Chunk;
+	auto ExpectChunk = [&](CTeeHistorianReader::EChunk Type, int Tick, int ClientId) {
+		ASSERT_TRUE(Reader.Read(&Chunk));
+		EXPECT_EQ(Chunk.m_Type, Type);
+		EXPECT_EQ(Chunk.m_Tick, Tick);
+		EXPECT_EQ(Chunk.m_ClientId, ClientId);
+	};
+
+	ExpectChunk(CTeeHistorianReader::CHUNK_EX, 0, -1);
+	EXPECT_EQ(m_UuidManager.LookupUuid(Chunk.m_Uuid), TEEHISTORIAN_JOINVER7);
+	ExpectChunk(CTeeHistorianReader::CHUNK_JOIN, 0, 3);
+
+	ExpectChunk(CTeeHistorianReader::CHUNK_PLAYER, 1, 3);
+	EXPECT_EQ(Chunk.m_X, 10);
+	EXPECT_EQ(Chunk.m_Y, 20);
+	ExpectChunk(CTeeHistorianReader::CHUNK_PLAYER, 1, 5);
+	EXPECT_EQ(Chunk.m_X, 1);
+	EXPECT_EQ(Chunk.m_Y, 2);
+	ExpectChunk(CTeeHistorianReader::CHUNK_INPUT, 1, 3);
+	EXPECT_EQ(Chunk.m_Input.m_Direction, 1);
+	EXPECT_EQ(Chunk.m_Input.m_PrevWeapon, 10);
+	ExpectChunk(CTeeHistorianReader::CHUNK_MESSAGE, 1, 3);
+	ASSERT_EQ(Chunk.m_DataSize, (int)sizeof(aMessage));
+	EXPECT_EQ(mem_comp(Chunk.m_pData, aMessage, sizeof(aMessage)), 0);
+
+	ExpectChunk(CTeeHistorianReader::CHUNK_PLAYER, 2, 3);
+	EXPECT_EQ(Chunk.m_X, 12);
+	EXPECT_EQ(Chunk.m_Y, 18);
+	ExpectChunk(CTeeHistorianReader::CHUNK_PLAYER_OLD, 2, 5);
+	ExpectChunk(CTeeHistorianReader::CHUNK_INPUT, 2, 3);
+	EXPECT_EQ(mem_comp(&Chunk.m_Input, &Input, sizeof(Input)), 0);
+
+	ExpectChunk(CTeeHistorianReader::CHUNK_PLAYER, 5, 3);
+	EXPECT_EQ(Chunk.m_X, 0);
+	EXPECT_EQ(Chunk.m_Y, 0);
+	ExpectChunk(CTeeHistorianReader::CHUNK_DROP, 5, 3);
+	EXPECT_STREQ(Chunk.m_pString, "too many pancakes");
+	ExpectChunk(CTeeHistorianReader::CHUNK_FINISH, 5, -1);
+
+	EXPECT_FALSE(Reader.Read(&Chunk));
+	EXPECT_TRUE(Reader.Finished());
+	EXPECT_FALSE(Reader.Error());
+}
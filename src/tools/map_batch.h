@@ -0,0 +1,373 @@
+#ifndef TOOLS_MAP_BATCH_H
+#define TOOLS_MAP_BATCH_H
+
+#include <base/dbg.h>
+#include <base/fs.h>
+#include <base/io.h>
+#include <base/lock.h>
+#include <base/log.h>
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/sphore.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/shared/jobs.h>
+#include <engine/shared/linereader.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs a pass of a map tool over many maps in parallel on a job pool.
+ *
+ * Maps can be given as single files, as directories which are searched
+ * recursively for `.map` files, or as list files prefixed with `@` which
+ * contain one map path per line. Each map also has a name, which is its path
+ * relative to the given directory, or its file name otherwise. The memory used by maps being processed
+ * at the same time is bounded by an estimate based on the file sizes. The log output of a pass is
+ * buffered and printed in one block once its map is done, so the output of different maps does not
+ * interleave.
+ */
+class CMapBatch
+{
+public:
+	/**
+	 * A pass processes a single map and must be thread-safe.
+	 *
+	 * @param pMap Path of the map to process.
+	 * @param pName Name of the map, to be used for output files.
+	 * @param pStorage The storage to use, maps are opened with `IStorage::TYPE_ABSOLUTE`.
+	 *
+	 * @return `true` on success, `false` otherwise.
+	 */
+	typedef std::function<bool(const char *pMap, const char *pName, IStorage *pStorage)> FPass;
+
+	// Processing a map needs more memory than the size of the file, mostly because the data is decompressed.
+	static constexpr int64_t MEMORY_PER_FILE_BYTE = 8;
+
+private:
+	class CMapResult
+	{
+	public:
+		std::string m_Path;
+		std::string m_Name;
+		int64_t m_FileSize = 0;
+		int64_t m_Duration = 0;
+		bool m_Success = false;
+		bool m_Duplicate = false;
+	};
+
+	// Collects the log messages of a pass, they are printed once the pass is done.
+	class CBufferedLogger : public ILogger
+	{
+	public:
+		class CLine
+		{
+		public:
+			LEVEL m_Level;
+			std::string m_System;
+			std::string m_Message;
+		};
+		std::vector<CLine> m_vLines;
+
+		void Log(const CLogMessage *pMessage) override
+		{
+			m_vLines.push_back({pMessage->m_Level, pMessage->m_aSystem, pMessage->Message()});
+		}
+	};
+
+	class CMapJob : public IJob
+	{
+		CMapBatch *m_pBatch;
+		CMapResult *m_pResult;
+
+		void Run() override
+		{
+			CBufferedLogger Logger;
+			const int64_t StartTime = time_get();
+			{
+				const CLogScope LogScope(&Logger);
+				m_pResult->m_Success = m_pBatch->m_Pass(m_pResult->m_Path.c_str(), m_pResult->m_Name.c_str(), m_pBatch->m_pStorage);
+			}
+			m_pResult->m_Duration = time_get() - StartTime;
+			m_pBatch->Release(m_pResult->m_FileSize * MEMORY_PER_FILE_BYTE);
+			m_pBatch->PrintOutput(Logger);
+		}
+
+	public:
+		CMapJob(CMapBatch *pBatch, CMapResult *pResult) :
+			m_pBatch(pBatch),
+			m_pResult(pResult)
+		{
+		}
+	};
+
+	const char *m_pToolName;
+	int m_NumThreads;
+	int64_t m_MaxMemory;
+	bool m_UniqueNames = false;
+	std::vector<CMapResult> m_vResults;
+	IStorage *m_pStorage = nullptr;
+	FPass m_Pass;
+
+	CLock m_MemoryLock;
+	int64_t m_UsedMemory GUARDED_BY(m_MemoryLock) = 0;
+	CSemaphore m_MemoryReleased;
+
+	CLock m_OutputLock;
+
+	class CListDirectoryContext
+	{
+	public:
+		CMapBatch *m_pBatch;
+		const char *m_pDirectory;
+		int m_RootLength;
+	};
+
+	static int ListDirectoryCallback(const char *pName, int IsDir, int DirType, void *pUser)
+	{
+		if(pName[0] == '.')
+		{
+			return 0;
+		}
+		const CListDirectoryContext *pContext = static_cast<const CListDirectoryContext *>(pUser);
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "%s/%s", pContext->m_pDirectory, pName);
+		if(IsDir)
+		{
+			pContext->m_pBatch->AddDirectory(aPath, pContext->m_RootLength);
+		}
+		else if(str_endswith(pName, ".map"))
+		{
+			pContext->m_pBatch->AddMap(aPath, aPath + pContext->m_RootLength);
+		}
+		return 0;
+	}
+
+	void AddDirectory(const char *pDirectory, int RootLength)
+	{
+		const CListDirectoryContext Context = {this, pDirectory, RootLength};
+		fs_listdir(pDirectory, ListDirectoryCallback, IStorage::TYPE_ABSOLUTE, (void *)&Context);
+	}
+
+	bool AddListFile(const char *pListFile)
+	{
+		CLineReader LineReader;
+		if(!LineReader.OpenFile(io_open(pListFile, IOFLAG_READ)))
+		{
+			log_error(m_pToolName, "Failed to open map list '%s'", pListFile);
+			return false;
+		}
+		while(const char *pLine = LineReader.Get())
+		{
+			if(pLine[0] != '\0' && pLine[0] != '#')
+			{
+				AddMap(pLine, fs_filename(pLine));
+			}
+		}
+		return true;
+	}
+
+	void AddMap(const char *pMap, const char *pName)
+	{
+		CMapResult &Result = m_vResults.emplace_back();
+		Result.m_Path = pMap;
+		Result.m_Name = pName;
+	}
+
+	void Acquire(int64_t Size) REQUIRES(!m_MemoryLock)
+	{
+		while(true)
+		{
+			{
+				const CLockScope LockScope(m_MemoryLock);
+				// always allow a single map to be processed, even if it's larger than the limit
+				if(m_UsedMemory == 0 || m_UsedMemory + Size <= m_MaxMemory)
+				{
+					m_UsedMemory += Size;
+					return;
+				}
+			}
+			m_MemoryReleased.Wait();
+		}
+	}
+
+	void Release(int64_t Size) REQUIRES(!m_MemoryLock)
+	{
+		{
+			const CLockScope LockScope(m_MemoryLock);
+			m_UsedMemory -= Size;
+		}
+		m_MemoryReleased.Signal();
+	}
+
+	void PrintOutput(const CBufferedLogger &Logger) REQUIRES(!m_OutputLock)
+	{
+		const CLockScope LockScope(m_OutputLock);
+		for(const CBufferedLogger::CLine &Line : Logger.m_vLines)
+		{
+			log_log(Line.m_Level, Line.m_System.c_str(), "%s", Line.m_Message.c_str());
+		}
+	}
+
+	// Marks all but the first of the maps with the same name as failed.
+	void CheckUniqueNames()
+	{
+		std::vector<CMapResult *> vpSorted;
+		vpSorted.reserve(m_vResults.size());
+		for(CMapResult &Result : m_vResults)
+		{
+			vpSorted.push_back(&Result);
+		}
+		// names are compared case-insensitively, because some file systems are case-insensitive
+		std::stable_sort(vpSorted.begin(), vpSorted.end(), [](const CMapResult *pLeft, const CMapResult *pRight) {
+			return str_comp_nocase(pLeft->m_Name.c_str(), pRight->m_Name.c_str()) < 0;
+		});
+		size_t First = 0;
+		for(size_t i = 1; i < vpSorted.size(); i++)
+		{
+			if(str_comp_nocase(vpSorted[First]->m_Name.c_str(), vpSorted[i]->m_Name.c_str()) == 0)
+			{
+				log_error(m_pToolName, "Map '%s' has the same name '%s' as map '%s' and is skipped", vpSorted[i]->m_Path.c_str(), vpSorted[i]->m_Name.c_str(), vpSorted[First]->m_Path.c_str());
+				vpSorted[i]->m_Duplicate = true;
+			}
+			else
+			{
+				First = i;
+			}
+		}
+	}
+
+public:
+	/**
+	 * @param pToolName Name of the tool used for logging.
+	 * @param NumThreads Number of maps processed in parallel, 0 uses the number of hardware threads.
+	 * @param MaxMemory Estimated memory limit for all maps processed in parallel, in bytes.
+	 */
+	CMapBatch(const char *pToolName, int NumThreads = 0, int64_t MaxMemory = (int64_t)2 * 1024 * 1024 * 1024) :
+		m_pToolName(pToolName),
+		m_NumThreads(NumThreads > 0 ? NumThreads : std::max(1, (int)std::thread::hardware_concurrency())),
+		m_MaxMemory(MaxMemory)
+	{
+	}
+
+	/**
+	 * Adds the maps given by a command line argument.
+	 *
+	 * @param pArgument A map file, a directory or a list file prefixed with `@`.
+	 *
+	 * @return `true` on success, `false` if the argument could not be used.
+	 */
+	bool AddArgument(const char *pArgument)
+	{
+		if(pArgument[0] == '@')
+		{
+			return AddListFile(pArgument + 1);
+		}
+		else if(fs_is_dir(pArgument))
+		{
+			char aDirectory[IO_MAX_PATH_LENGTH];
+			str_copy(aDirectory, pArgument);
+			fs_normalize_path(aDirectory);
+			AddDirectory(aDirectory, str_length(aDirectory) + 1);
+			return true;
+		}
+		else if(fs_is_file(pArgument))
+		{
+			AddMap(pArgument, fs_filename(pArgument));
+			return true;
+		}
+		log_error(m_pToolName, "Map, directory or map list '%s' not found", pArgument);
+		return false;
+	}
+
+	/**
+	 * Skips maps whose name is already used by another map, for passes which
+	 * write output files based on the name and would overwrite each other.
+	 */
+	void RequireUniqueNames()
+	{
+		m_UniqueNames = true;
+	}
+
+	int NumMaps() const
+	{
+		return m_vResults.size();
+	}
+
+	/**
+	 * Runs the pass over all added maps and waits until all of them are done.
+	 *
+	 * @return The number of maps that failed.
+	 */
+	int Run(IStorage *pStorage, FPass Pass)
+	{
+		m_pStorage = pStorage;
+		m_Pass = std::move(Pass);
+
+		if(m_UniqueNames)
+		{
+			CheckUniqueNames();
+		}
+
+		for(CMapResult &Result : m_vResults)
+		{
+			IOHANDLE File = io_open(Result.m_Path.c_str(), IOFLAG_READ);
+			if(File)
+			{
+				Result.m_FileSize = maximum<int64_t>(io_length(File), 0);
+				io_close(File);
+			}
+		}
+
+		// Start with the largest maps so a single large map does not delay the end of the batch.
+		std::vector<CMapResult *> vpQueue;
+		vpQueue.reserve(m_vResults.size());
+		for(CMapResult &Result : m_vResults)
+		{
+			if(!Result.m_Duplicate)
+			{
+				vpQueue.push_back(&Result);
+			}
+		}
+		std::stable_sort(vpQueue.begin(), vpQueue.end(), [](const CMapResult *pLeft, const CMapResult *pRight) {
+			return pLeft->m_FileSize > pRight->m_FileSize;
+		});
+
+		const int64_t StartTime = time_get();
+		{
+			CJobPool JobPool;
+			JobPool.Init(m_NumThreads);
+			for(CMapResult *pResult : vpQueue)
+			{
+				Acquire(pResult->m_FileSize * MEMORY_PER_FILE_BYTE);
+				JobPool.Add(std::make_shared<CMapJob>(this, pResult));
+			}
+			JobPool.Shutdown();
+		}
+		const int64_t TotalDuration = time_get() - StartTime;
+
+		int NumFailed = 0;
+		int64_t SumDuration = 0;
+		for(const CMapResult &Result : m_vResults)
+		{
+			log_info(m_pToolName, "%s '%s' in %.2fms (%" PRId64 " bytes)", Result.m_Success ? "Processed" : (Result.m_Duplicate ? "Skipped" : "Failed"), Result.m_Path.c_str(), Result.m_Duration * 1000.0 / time_freq(), Result.m_FileSize);
+			if(!Result.m_Success)
+			{
+				NumFailed++;
+			}
+			SumDuration += Result.m_Duration;
+		}
+		log_info(m_pToolName, "Processed %d maps (%d failed) in %.2fs with %d threads, %.2fs total processing time",
+			NumMaps(), NumFailed, TotalDuration / (double)time_freq(), m_NumThreads, SumDuration / (double)time_freq());
+		return NumFailed;
+	}
+};
+
+#endif
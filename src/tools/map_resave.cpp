@@ -1,15 +1,22 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include "map_batch.h"
+
+#include <base/fs.h>
 #include <base/logger.h>
 #include <base/os.h>
+#include <base/str.h>
 
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
 static const char *TOOL_NAME = "map_resave";
 
-static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStorage *pStorage)
+// The writer copies all data it is given, so the reader only needs to keep the data that is currently being copied.
+static constexpr int64_t MAX_LOADED_DATA_SIZE = 16 * 1024 * 1024;
+
+static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStorage *pStorage, int MaxCompressionThreads = 0)
 {
 	CDataFileReader Reader;
 	if(!Reader.Open(pStorage, pSourceMap, IStorage::TYPE_ABSOLUTE))
@@ -17,6 +24,7 @@ static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStora
 		log_error(TOOL_NAME, "Failed to open source map '%s' for reading", pSourceMap);
 		return -1;
 	}
+	Reader.SetMaxLoadedDataSize(MAX_LOADED_DATA_SIZE);
 
 	CDataFileWriter Writer;
 	if(!Writer.Open(pStorage, pDestinationMap))
@@ -25,6 +33,7 @@ static int ResaveMap(const char *pSourceMap, const char *pDestinationMap, IStora
 		Reader.Close();
 		return -1;
 	}
+	Writer.SetMaxCompressionThreads(MaxCompressionThreads);
 
 	// add all items
 	for(int Index = 0; Index < Reader.NumItems(); Index++)
@@ -62,9 +71,11 @@ int main(int argc, const char **argv)
 	CCmdlineFix CmdlineFix(&argc, &argv);
 	log_set_global_logger_default();
 
-	if(argc != 3)
+	const bool Batch = argc >= 4 && str_comp(argv[1], "--batch") == 0;
+	if(argc != 3 && !Batch)
 	{
 		log_error(TOOL_NAME, "Usage: %s <source map> <destination map>", TOOL_NAME);
+		log_error(TOOL_NAME, "Usage: %s --batch <destination folder> <source maps, folders or @map lists>...", TOOL_NAME);
 		return -1;
 	}
 
@@ -75,5 +86,33 @@ int main(int argc, const char **argv)
 		return -1;
 	}
 
-	return ResaveMap(argv[1], argv[2], pStorage.get());
+	if(!Batch)
+	{
+		return ResaveMap(argv[1], argv[2], pStorage.get());
+	}
+
+	const char *pDestinationFolder = argv[2];
+	CMapBatch MapBatch(TOOL_NAME);
+	MapBatch.RequireUniqueNames();
+	for(int i = 3; i < argc; i++)
+	{
+		if(!MapBatch.AddArgument(argv[i]))
+		{
+			return -1;
+		}
+	}
+	// Maps are already resaved in parallel, so each map is compressed on a single thread.
+	const int NumFailed = MapBatch.Run(pStorage.get(), [pDestinationFolder](const char *pMap, const char *pName, IStorage *pMapStorage) {
+		char aDestinationMap[IO_MAX_PATH_LENGTH];
+		str_format(aDestinationMap, sizeof(aDestinationMap), "%s/%s", pDestinationFolder, pName);
+		char aCompletePath[IO_MAX_PATH_LENGTH];
+		pMapStorage->GetCompletePath(IStorage::TYPE_SAVE, aDestinationMap, aCompletePath, sizeof(aCompletePath));
+		if(fs_makedir_rec_for(aCompletePath) != 0)
+		{
+			log_error(TOOL_NAME, "Failed to create folder for destination map '%s'", aDestinationMap);
+			return false;
+		}
+		return ResaveMap(pMap, aDestinationMap, pMapStorage, 1) == 0;
+	});
+	return NumFailed == 0 ? 0 : -1;
 }
@@ -1,3 +1,5 @@
+#include "map_batch.h"
+
 #include <base/hash.h>
 #include <base/logger.h>
 #include <base/os.h>
@@ -84,21 +86,11 @@ int main(int argc, const char **argv)
 	const CCmdlineFix CmdlineFix(&argc, &argv);
 	log_set_global_logger_default();
 
-	const char *pMap;
-	bool CalcHashes;
-	if(argc == 2)
-	{
-		pMap = argv[1];
-		CalcHashes = false;
-	}
-	else if(argc == 3 && str_comp(argv[1], "--calc-hashes") == 0)
+	const bool CalcHashes = argc >= 2 && str_comp(argv[1], "--calc-hashes") == 0;
+	const int FirstMapArgument = CalcHashes ? 2 : 1;
+	if(argc <= FirstMapArgument)
 	{
-		pMap = argv[2];
-		CalcHashes = true;
-	}
-	else
-	{
-		log_error(TOOL_NAME, "Usage: %s [--calc-hashes] <map>", TOOL_NAME);
+		log_error(TOOL_NAME, "Usage: %s [--calc-hashes] <maps, folders or @map lists>...", TOOL_NAME);
 		return -1;
 	}
 
@@ -109,5 +101,21 @@ int main(int argc, const char **argv)
 		return -1;
 	}
 
-	return TestMap(pMap, CalcHashes, pStorage.get());
+	if(argc == FirstMapArgument + 1 && fs_is_file(argv[FirstMapArgument]))
+	{
+		return TestMap(argv[FirstMapArgument], CalcHashes, pStorage.get());
+	}
+
+	CMapBatch MapBatch(TOOL_NAME);
+	for(int i = FirstMapArgument; i < argc; i++)
+	{
+		if(!MapBatch.AddArgument(argv[i]))
+		{
+			return -1;
+		}
+	}
+	const int NumFailed = MapBatch.Run(pStorage.get(), [CalcHashes](const char *pMap, const char *pName, IStorage *pMapStorage) {
+		return TestMap(pMap, CalcHashes, pMapStorage) == 0;
+	});
+	return NumFailed == 0 ? 0 : -1;
 }
@@ -0,0 +1,822 @@
+#include <base/fs.h>
+#include <base/io.h>
+#include <base/log.h>
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/os.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+#include <engine/shared/csv.h>
+#include <engine/shared/linereader.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char *TOOL_NAME = "score_transfer";
+
+bool IsInterrupted()
+{
+	return false;
+}
+
+static void Usage()
+{
+	log_error(TOOL_NAME, "Usage: %s [options] <source> <destination>", TOOL_NAME);
+	log_error(TOOL_NAME, "Copies the race, teamrace and saves tables between score databases.");
+	log_error(TOOL_NAME, "Databases:");
+	log_error(TOOL_NAME, "  sqlite <file>");
+	log_error(TOOL_NAME, "  mysql <database> <prefix> <user> <password> <ip> <port>");
+	log_error(TOOL_NAME, "  csv <folder> (only as destination, writes <folder>/<table>.csv)");
+	log_error(TOOL_NAME, "Options:");
+	log_error(TOOL_NAME, "  --tables <race,teamrace,saves>  tables to copy, all by default");
+	log_error(TOOL_NAME, "  --batch-size <rows>             rows per transaction, 10000 by default");
+	log_error(TOOL_NAME, "  --jobs <count>                  parallel MySQL destination connections, 4 by default");
+	log_error(TOOL_NAME, "  --checkpoint <file>             record progress in the file and resume from it");
+	log_error(TOOL_NAME, "The source must not change between resumed runs. Rows that already exist");
+	log_error(TOOL_NAME, "in a destination database are skipped, a csv destination can contain rows");
+	log_error(TOOL_NAME, "twice if a run was interrupted after writing them but before saving the checkpoint.");
+}
+
+enum EColumnType
+{
+	COLUMN_STRING,
+	COLUMN_FLOAT,
+	COLUMN_INT,
+	COLUMN_BLOB,
+	// copied as unix timestamp, so both databases agree on the time zone
+	COLUMN_TIMESTAMP,
+};
+
+class CColumn
+{
+public:
+	std::string m_Name;
+	EColumnType m_Type;
+};
+
+class CTable
+{
+public:
+	const char *m_pName;
+	// the rows are read in this order, so resumed runs skip the same rows
+	const char *m_pPrimaryKey;
+	std::vector<CColumn> m_vColumns;
+};
+
+static std::vector<CTable> AllTables()
+{
+	CTable Race = {"race", "Map, Name, Time, Timestamp, Server", {{"Map", COLUMN_STRING}, {"Name", COLUMN_STRING}, {"Timestamp", COLUMN_TIMESTAMP}, {"Time", COLUMN_FLOAT}, {"Server", COLUMN_STRING}}};
+	for(int i = 1; i <= 25; i++)
+		Race.m_vColumns.push_back({"cp" + std::to_string(i), COLUMN_FLOAT});
+	Race.m_vColumns.push_back({"GameId", COLUMN_STRING});
+	Race.m_vColumns.push_back({"DDNet7", COLUMN_INT});
+
+	CTable Teamrace = {"teamrace", "Id, Name", {{"Map", COLUMN_STRING}, {"Name", COLUMN_STRING}, {"Timestamp", COLUMN_TIMESTAMP}, {"Time", COLUMN_FLOAT}, {"ID", COLUMN_BLOB}, {"GameId", COLUMN_STRING}, {"DDNet7", COLUMN_INT}}};
+	CTable Saves = {"saves", "Map, Code", {{"Savegame", COLUMN_STRING}, {"Map", COLUMN_STRING}, {"Code", COLUMN_STRING}, {"Timestamp", COLUMN_TIMESTAMP}, {"Server", COLUMN_STRING}, {"DDNet7", COLUMN_INT}, {"SaveId", COLUMN_STRING}}};
+	return {Race, Teamrace, Saves};
+}
+
+class CValue
+{
+public:
+	bool m_Null;
+	int64_t m_Int;
+	float m_Float;
+	std::string m_Data;
+};
+
+// consecutive rows of the source table, values stored row by row
+class CBatch
+{
+public:
+	int64_t m_Index;
+	int64_t m_FirstRow;
+	int m_NumRows = 0;
+	std::vector<CValue> m_vValues;
+};
+
+static bool Execute(IDbConnection *pConnection, const char *pQuery, char *pError, int ErrorSize)
+{
+	int NumUpdated;
+	return pConnection->PrepareStatement(pQuery, pError, ErrorSize) &&
+	       pConnection->ExecuteUpdate(&NumUpdated, pError, ErrorSize);
+}
+
+class CDatabase
+{
+public:
+	enum EType
+	{
+		TYPE_SQLITE,
+		TYPE_MYSQL,
+		TYPE_CSV,
+	};
+	EType m_Type;
+	char m_aPath[IO_MAX_PATH_LENGTH];
+	CMysqlConfig m_MysqlConfig;
+
+	// Parses a database description from the arguments, returns the number of arguments used or 0 on error.
+	int Parse(int NumArgs, const char **ppArgs)
+	{
+		if(NumArgs >= 2 && str_comp(ppArgs[0], "sqlite") == 0)
+		{
+			m_Type = TYPE_SQLITE;
+			str_copy(m_aPath, ppArgs[1]);
+			return 2;
+		}
+		if(NumArgs >= 2 && str_comp(ppArgs[0], "csv") == 0)
+		{
+			m_Type = TYPE_CSV;
+			str_copy(m_aPath, ppArgs[1]);
+			return 2;
+		}
+		if(NumArgs >= 7 && str_comp(ppArgs[0], "mysql") == 0)
+		{
+			m_Type = TYPE_MYSQL;
+			str_copy(m_MysqlConfig.m_aDatabase, ppArgs[1]);
+			str_copy(m_MysqlConfig.m_aPrefix, ppArgs[2]);
+			str_copy(m_MysqlConfig.m_aUser, ppArgs[3]);
+			str_copy(m_MysqlConfig.m_aPass, ppArgs[4]);
+			str_copy(m_MysqlConfig.m_aIp, ppArgs[5]);
+			m_MysqlConfig.m_aBindaddr[0] = '\0';
+			m_MysqlConfig.m_Port = str_toint(ppArgs[6]);
+			return 7;
+		}
+		return 0;
+	}
+
+	// Tables are created in destinations. Returns nullptr for CSV.
+	std::unique_ptr<IDbConnection> Connect(bool Destination, char *pError, int ErrorSize) const
+	{
+		std::unique_ptr<IDbConnection> pConnection;
+		if(m_Type == TYPE_SQLITE)
+		{
+			pConnection = CreateSqliteConnection(m_aPath, Destination);
+		}
+		else if(m_Type == TYPE_MYSQL)
+		{
+			CMysqlConfig Config = m_MysqlConfig;
+			Config.m_Setup = Destination;
+			pConnection = CreateMysqlConnection(Config);
+		}
+		if(!pConnection)
+		{
+			str_copy(pError, "unsupported database", ErrorSize);
+			return nullptr;
+		}
+		if(!pConnection->Connect(pError, ErrorSize))
+			return nullptr;
+		if(m_Type == TYPE_MYSQL)
+		{
+			// START TRANSACTION can't be prepared, so commit manually instead.
+			// Timestamps are converted in the session time zone, UTC has no
+			// ambiguous times during daylight saving time changes.
+			if(!Execute(pConnection.get(), "SET time_zone = '+00:00'", pError, ErrorSize) ||
+				(Destination && !Execute(pConnection.get(), "SET autocommit = 0", pError, ErrorSize)))
+			{
+				pConnection->Disconnect();
+				return nullptr;
+			}
+		}
+		return pConnection;
+	}
+
+	const char *FromUnixTimestamp() const
+	{
+		return m_Type == TYPE_SQLITE ? "DATETIME(?, 'unixepoch')" : "FROM_UNIXTIME(?)";
+	}
+};
+
+class IBatchWriter
+{
+public:
+	virtual ~IBatchWriter() = default;
+	virtual bool Write(const CBatch &Batch, char *pError, int ErrorSize) = 0;
+};
+
+class CDatabaseWriter : public IBatchWriter
+{
+	// SQLite supports at least 999 variables per statement
+	static constexpr int MAX_VARIABLES = 999;
+
+	const CDatabase &m_Database;
+	const CTable &m_Table;
+	std::unique_ptr<IDbConnection> m_pConnection;
+	int m_RowsPerStatement;
+	std::string m_InsertFull;
+
+	std::string FormatInsert(int NumRows) const
+	{
+		std::string Row = "(";
+		for(size_t i = 0; i < m_Table.m_vColumns.size(); i++)
+		{
+			if(i > 0)
+				Row += ", ";
+			Row += m_Table.m_vColumns[i].m_Type == COLUMN_TIMESTAMP ? m_Database.FromUnixTimestamp() : "?";
+		}
+		Row += ")";
+
+		std::string Insert = std::string(m_pConnection->InsertIgnore()) + " INTO " + m_pConnection->GetPrefix() + "_" + m_Table.m_pName + " (";
+		for(size_t i = 0; i < m_Table.m_vColumns.size(); i++)
+		{
+			if(i > 0)
+				Insert += ", ";
+			Insert += m_Table.m_vColumns[i].m_Name;
+		}
+		Insert += ") VALUES ";
+		for(int i = 0; i < NumRows; i++)
+		{
+			if(i > 0)
+				Insert += ", ";
+			Insert += Row;
+		}
+		return Insert;
+	}
+
+	bool InsertRows(const CBatch &Batch, int FirstRow, int NumRows, char *pError, int ErrorSize)
+	{
+		const std::string Partial = NumRows == m_RowsPerStatement ? "" : FormatInsert(NumRows);
+		if(!m_pConnection->PrepareStatement(NumRows == m_RowsPerStatement ? m_InsertFull.c_str() : Partial.c_str(), pError, ErrorSize))
+			return false;
+
+		const int NumColumns = m_Table.m_vColumns.size();
+		int Variable = 1;
+		for(int Row = FirstRow; Row < FirstRow + NumRows; Row++)
+		{
+			for(int Column = 0; Column < NumColumns; Column++, Variable++)
+			{
+				const CValue &Value = Batch.m_vValues[Row * NumColumns + Column];
+				if(Value.m_Null)
+				{
+					m_pConnection->BindNull(Variable);
+					continue;
+				}
+				switch(m_Table.m_vColumns[Column].m_Type)
+				{
+				case COLUMN_STRING: m_pConnection->BindString(Variable, Value.m_Data.c_str()); break;
+				case COLUMN_FLOAT: m_pConnection->BindFloat(Variable, Value.m_Float); break;
+				case COLUMN_INT: m_pConnection->BindInt(Variable, Value.m_Int); break;
+				case COLUMN_BLOB: m_pConnection->BindBlob(Variable, (unsigned char *)Value.m_Data.data(), Value.m_Data.size()); break;
+				case COLUMN_TIMESTAMP: m_pConnection->BindInt64(Variable, Value.m_Int); break;
+				}
+			}
+		}
+		int NumInserted;
+		return m_pConnection->ExecuteUpdate(&NumInserted, pError, ErrorSize);
+	}
+
+public:
+	CDatabaseWriter(const CDatabase &Database, const CTable &Table, std::unique_ptr<IDbConnection> pConnection) :
+		m_Database(Database), m_Table(Table), m_pConnection(std::move(pConnection))
+	{
+		m_RowsPerStatement = MAX_VARIABLES / m_Table.m_vColumns.size();
+		m_InsertFull = FormatInsert(m_RowsPerStatement);
+	}
+
+	~CDatabaseWriter() override
+	{
+		m_pConnection->Disconnect();
+	}
+
+	bool Write(const CBatch &Batch, char *pError, int ErrorSize) override
+	{
+		// MySQL connections run without autocommit, see CDatabase::Connect
+		if(m_Database.m_Type == CDatabase::TYPE_SQLITE && !Execute(m_pConnection.get(), "BEGIN IMMEDIATE", pError, ErrorSize))
+			return false;
+		for(int Row = 0; Row < Batch.m_NumRows; Row += m_RowsPerStatement)
+		{
+			if(!InsertRows(Batch, Row, minimum(m_RowsPerStatement, Batch.m_NumRows - Row), pError, ErrorSize))
+			{
+				char aRollbackError[256];
+				Execute(m_pConnection.get(), "ROLLBACK", aRollbackError, sizeof(aRollbackError));
+				return false;
+			}
+		}
+		return Execute(m_pConnection.get(), "COMMIT", pError, ErrorSize);
+	}
+};
+
+class CCsvWriter : public IBatchWriter
+{
+	const CTable &m_Table;
+	IOHANDLE m_File;
+
+public:
+	CCsvWriter(const CTable &Table, IOHANDLE File) :
+		m_Table(Table), m_File(File)
+	{
+	}
+
+	~CCsvWriter() override
+	{
+		io_close(m_File);
+	}
+
+	bool Write(const CBatch &Batch, char *pError, int ErrorSize) override
+	{
+		const int NumColumns = m_Table.m_vColumns.size();
+		std::vector<std::string> vFields(NumColumns);
+		std::vector<const char *> vpFields(NumColumns);
+		for(int Row = 0; Row < Batch.m_NumRows; Row++)
+		{
+			for(int Column = 0; Column < NumColumns; Column++)
+			{
+				const CValue &Value = Batch.m_vValues[Row * NumColumns + Column];
+				std::string &Field = vFields[Column];
+				char aBuf[32];
+				if(Value.m_Null)
+				{
+					Field.clear();
+				}
+				else if(m_Table.m_vColumns[Column].m_Type == COLUMN_FLOAT)
+				{
+					str_format(aBuf, sizeof(aBuf), "%.9g", Value.m_Float);
+					Field = aBuf;
+				}
+				else if(m_Table.m_vColumns[Column].m_Type == COLUMN_INT || m_Table.m_vColumns[Column].m_Type == COLUMN_TIMESTAMP)
+				{
+					Field = std::to_string(Value.m_Int);
+				}
+				else if(m_Table.m_vColumns[Column].m_Type == COLUMN_BLOB)
+				{
+					Field.clear();
+					for(unsigned char Byte : Value.m_Data)
+					{
+						str_format(aBuf, sizeof(aBuf), "%02x", Byte);
+						Field += aBuf;
+					}
+				}
+				else
+				{
+					Field = Value.m_Data;
+				}
+				vpFields[Column] = Field.c_str();
+			}
+			CsvWrite(m_File, NumColumns, vpFields.data());
+		}
+		// the checkpoint must not get ahead of the file. The rows are written
+		// again if the run is interrupted before the checkpoint is saved.
+		if(io_flush(m_File) != 0 || io_error(m_File) != 0)
+		{
+			str_copy(pError, "error writing csv file", ErrorSize);
+			return false;
+		}
+		return true;
+	}
+};
+
+// Progress of all tables, saved as lines of `<table> <rows>` after the
+// rows up to that count have been committed. The last line of a table wins.
+class CCheckpoint
+{
+	std::map<std::string, int64_t> m_Rows;
+	IOHANDLE m_File = nullptr;
+
+public:
+	~CCheckpoint()
+	{
+		if(m_File)
+			io_close(m_File);
+	}
+
+	bool Open(const char *pFilename)
+	{
+		IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+		CLineReader LineReader;
+		if(File && LineReader.OpenFile(File))
+		{
+			while(const char *pLine = LineReader.Get())
+			{
+				const char *pRows = str_find(pLine, " ");
+				if(pRows)
+					m_Rows[std::string(pLine, pRows - pLine)] = str_toint64_base(pRows + 1);
+			}
+		}
+		m_File = io_open(pFilename, IOFLAG_APPEND);
+		return m_File != nullptr;
+	}
+
+	int64_t Rows(const char *pTable) const
+	{
+		auto It = m_Rows.find(pTable);
+		return It == m_Rows.end() ? 0 : It->second;
+	}
+
+	void Save(const char *pTable, int64_t Rows)
+	{
+		m_Rows[pTable] = Rows;
+		if(!m_File)
+			return;
+		char aLine[128];
+		str_format(aLine, sizeof(aLine), "%s %lld", pTable, (long long)Rows);
+		io_write(m_File, aLine, str_length(aLine));
+		io_write_newline(m_File);
+		io_flush(m_File);
+	}
+};
+
+class CTransfer
+{
+public:
+	const CDatabase &m_Source;
+	const CDatabase &m_Destination;
+	int m_BatchSize;
+	int m_NumJobs;
+	CCheckpoint &m_Checkpoint;
+
+	CTransfer(const CDatabase &Source, const CDatabase &Destination, int BatchSize, int NumJobs, CCheckpoint &Checkpoint) :
+		m_Source(Source), m_Destination(Destination), m_BatchSize(BatchSize), m_NumJobs(NumJobs), m_Checkpoint(Checkpoint)
+	{
+	}
+
+	bool Run(const CTable &Table);
+
+private:
+	// the reader waits if this many batches are queued, so memory use stays bounded
+	int MaxQueued() const { return 2 * m_NumJobs; }
+
+	std::unique_ptr<IBatchWriter> CreateWriter(const CTable &Table, bool Append, char *pError, int ErrorSize);
+	void WriterThread(const CTable &Table, IBatchWriter *pWriter);
+	bool ReadRow(IDbConnection *pConnection, const CTable &Table, CBatch &Batch);
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Cv;
+	std::deque<CBatch> m_Queue;
+	bool m_ReadingDone;
+	bool m_Failed;
+	// batches that are committed, but not all batches before them
+	std::map<int64_t, int64_t> m_CommittedEnds;
+	int64_t m_NextCommit;
+	int64_t m_CommittedRows;
+	char m_aError[256];
+	std::vector<char> m_vStringBuffer;
+};
+
+std::unique_ptr<IBatchWriter> CTransfer::CreateWriter(const CTable &Table, bool Append, char *pError, int ErrorSize)
+{
+	if(m_Destination.m_Type == CDatabase::TYPE_CSV)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "%s/%s.csv", m_Destination.m_aPath, Table.m_pName);
+		if(fs_makedir_rec_for(aPath) != 0)
+		{
+			str_format(pError, ErrorSize, "failed to create folder for '%s'", aPath);
+			return nullptr;
+		}
+		IOHANDLE File = io_open(aPath, Append ? IOFLAG_APPEND : IOFLAG_WRITE);
+		if(!File)
+		{
+			str_format(pError, ErrorSize, "failed to open '%s'", aPath);
+			return nullptr;
+		}
+		if(!Append)
+		{
+			std::vector<const char *> vpHeader;
+			for(const CColumn &Column : Table.m_vColumns)
+				vpHeader.push_back(Column.m_Name.c_str());
+			CsvWrite(File, vpHeader.size(), vpHeader.data());
+		}
+		return std::make_unique<CCsvWriter>(Table, File);
+	}
+	std::unique_ptr<IDbConnection> pConnection = m_Destination.Connect(true, pError, ErrorSize);
+	if(!pConnection)
+		return nullptr;
+	return std::make_unique<CDatabaseWriter>(m_Destination, Table, std::move(pConnection));
+}
+
+void CTransfer::WriterThread(const CTable &Table, IBatchWriter *pWriter)
+{
+	while(true)
+	{
+		CBatch Batch;
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_Cv.wait(Lock, [&]() { return !m_Queue.empty() || m_ReadingDone || m_Failed; });
+			if(m_Failed || m_Queue.empty())
+				return;
+			Batch = std::move(m_Queue.front());
+			m_Queue.pop_front();
+		}
+		m_Cv.notify_all();
+
+		char aError[256];
+		const bool Success = pWriter->Write(Batch, aError, sizeof(aError));
+
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		if(!Success)
+		{
+			if(!m_Failed)
+				str_format(m_aError, sizeof(m_aError), "failed to write rows %lld to %lld: %s", (long long)Batch.m_FirstRow, (long long)(Batch.m_FirstRow + Batch.m_NumRows), aError);
+			m_Failed = true;
+			m_Cv.notify_all();
+			return;
+		}
+		// batches can finish out of order, only save progress without gaps
+		m_CommittedEnds[Batch.m_Index] = Batch.m_FirstRow + Batch.m_NumRows;
+		bool Advanced = false;
+		for(auto It = m_CommittedEnds.find(m_NextCommit); It != m_CommittedEnds.end(); It = m_CommittedEnds.find(m_NextCommit))
+		{
+			m_CommittedRows = It->second;
+			m_CommittedEnds.erase(It);
+			m_NextCommit++;
+			Advanced = true;
+		}
+		if(Advanced)
+			m_Checkpoint.Save(Table.m_pName, m_CommittedRows);
+	}
+}
+
+bool CTransfer::ReadRow(IDbConnection *pConnection, const CTable &Table, CBatch &Batch)
+{
+	for(size_t i = 0; i < Table.m_vColumns.size(); i++)
+	{
+		const int Column = i + 1;
+		CValue &Value = Batch.m_vValues.emplace_back();
+		Value.m_Null = pConnection->IsNull(Column);
+		if(Value.m_Null)
+			continue;
+		switch(Table.m_vColumns[i].m_Type)
+		{
+		case COLUMN_STRING:
+			pConnection->GetString(Column, m_vStringBuffer.data(), m_vStringBuffer.size());
+			Value.m_Data = m_vStringBuffer.data();
+			break;
+		case COLUMN_FLOAT:
+			Value.m_Float = pConnection->GetFloat(Column);
+			break;
+		case COLUMN_INT:
+		case COLUMN_TIMESTAMP:
+			Value.m_Int = pConnection->GetInt64(Column);
+			break;
+		case COLUMN_BLOB:
+		{
+			const int Size = pConnection->GetBlob(Column, (unsigned char *)m_vStringBuffer.data(), m_vStringBuffer.size());
+			Value.m_Data.assign(m_vStringBuffer.data(), Size);
+			break;
+		}
+		}
+	}
+	Batch.m_NumRows++;
+	return true;
+}
+
+bool CTransfer::Run(const CTable &Table)
+{
+	const int64_t StartRow = m_Checkpoint.Rows(Table.m_pName);
+	m_Queue.clear();
+	m_ReadingDone = false;
+	m_Failed = false;
+	m_CommittedEnds.clear();
+	m_NextCommit = 0;
+	m_CommittedRows = StartRow;
+	m_aError[0] = '\0';
+	// large enough for the longest TEXT in MySQL
+	m_vStringBuffer.resize(65536);
+
+	char aError[256];
+	std::unique_ptr<IDbConnection> pSource = m_Source.Connect(false, aError, sizeof(aError));
+	if(!pSource)
+	{
+		log_error(TOOL_NAME, "failed to connect to source: %s", aError);
+		return false;
+	}
+
+	std::string Select = "SELECT ";
+	for(size_t i = 0; i < Table.m_vColumns.size(); i++)
+	{
+		if(i > 0)
+			Select += ", ";
+		if(Table.m_vColumns[i].m_Type == COLUMN_TIMESTAMP)
+		{
+			char aBuf[128];
+			pSource->ToUnixTimestamp(Table.m_vColumns[i].m_Name.c_str(), aBuf, sizeof(aBuf));
+			Select += aBuf;
+		}
+		else
+		{
+			Select += Table.m_vColumns[i].m_Name;
+		}
+	}
+	Select += std::string(" FROM ") + pSource->GetPrefix() + "_" + Table.m_pName;
+	Select += std::string(" ORDER BY ") + Table.m_pPrimaryKey;
+	if(!pSource->PrepareStatement(Select.c_str(), aError, sizeof(aError)))
+	{
+		log_error(TOOL_NAME, "failed to read %s: %s", Table.m_pName, aError);
+		pSource->Disconnect();
+		return false;
+	}
+
+	std::vector<std::unique_ptr<IBatchWriter>> vpWriters;
+	for(int i = 0; i < m_NumJobs; i++)
+	{
+		std::unique_ptr<IBatchWriter> pWriter = CreateWriter(Table, StartRow > 0, aError, sizeof(aError));
+		if(!pWriter)
+		{
+			log_error(TOOL_NAME, "failed to open destination: %s", aError);
+			pSource->Disconnect();
+			return false;
+		}
+		vpWriters.push_back(std::move(pWriter));
+	}
+	std::vector<std::thread> vThreads;
+	for(auto &pWriter : vpWriters)
+		vThreads.emplace_back([this, &Table, pWriter = pWriter.get()]() { WriterThread(Table, pWriter); });
+
+	if(StartRow > 0)
+		log_info(TOOL_NAME, "%s: resuming after %lld rows", Table.m_pName, (long long)StartRow);
+
+	const auto StartTime = time_get_nanoseconds();
+	auto LastReport = StartTime;
+	int64_t Row = 0;
+	int64_t NumBatches = 0;
+	CBatch Batch;
+	bool ReadError = false;
+	while(true)
+	{
+		bool End;
+		if(!pSource->Step(&End, aError, sizeof(aError)))
+		{
+			log_error(TOOL_NAME, "failed to read %s: %s", Table.m_pName, aError);
+			ReadError = true;
+			break;
+		}
+		if(End)
+			break;
+		// the rows before the checkpoint are already copied
+		if(Row++ < StartRow)
+			continue;
+
+		if(Batch.m_NumRows == 0)
+		{
+			Batch.m_Index = NumBatches;
+			Batch.m_FirstRow = Row - 1;
+			Batch.m_vValues.reserve((size_t)m_BatchSize * Table.m_vColumns.size());
+		}
+		ReadRow(pSource.get(), Table, Batch);
+		if(Batch.m_NumRows == m_BatchSize)
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_Cv.wait(Lock, [&]() { return (int)m_Queue.size() < MaxQueued() || m_Failed; });
+			if(m_Failed)
+				break;
+			m_Queue.push_back(std::move(Batch));
+			Batch = CBatch();
+			NumBatches++;
+			m_Cv.notify_all();
+		}
+
+		const auto Now = time_get_nanoseconds();
+		if(Now - LastReport >= std::chrono::seconds(5))
+		{
+			LastReport = Now;
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			log_info(TOOL_NAME, "%s: %lld rows read, %lld committed", Table.m_pName, (long long)Row, (long long)m_CommittedRows);
+		}
+	}
+	pSource->Disconnect();
+
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		if(ReadError)
+			m_Failed = true;
+		else if(Batch.m_NumRows > 0 && !m_Failed)
+			m_Queue.push_back(std::move(Batch));
+		m_ReadingDone = true;
+	}
+	m_Cv.notify_all();
+	for(std::thread &Thread : vThreads)
+		Thread.join();
+	vpWriters.clear();
+
+	if(m_Failed)
+	{
+		if(m_aError[0])
+			log_error(TOOL_NAME, "%s: %s", Table.m_pName, m_aError);
+		return false;
+	}
+	// also mark tables without new rows as done
+	m_Checkpoint.Save(Table.m_pName, Row);
+
+	const double Seconds = (time_get_nanoseconds() - StartTime).count() / 1e9;
+	const int64_t Copied = Row - StartRow;
+	log_info(TOOL_NAME, "%s: copied %lld rows in %.2f s (%.0f rows/s)", Table.m_pName, (long long)Copied, Seconds, Seconds > 0 ? Copied / Seconds : 0.0);
+	return true;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	CDatabase Source;
+	CDatabase Destination;
+	int NumDatabases = 0;
+	const char *pTables = "race,teamrace,saves";
+	int BatchSize = 10000;
+	int NumJobs = 4;
+	const char *pCheckpoint = nullptr;
+	for(int i = 1; i < argc;)
+	{
+		if(str_comp(argv[i], "--tables") == 0 && i + 1 < argc)
+		{
+			pTables = argv[i + 1];
+			i += 2;
+		}
+		else if(str_comp(argv[i], "--batch-size") == 0 && i + 1 < argc)
+		{
+			BatchSize = str_toint(argv[i + 1]);
+			i += 2;
+		}
+		else if(str_comp(argv[i], "--jobs") == 0 && i + 1 < argc)
+		{
+			NumJobs = str_toint(argv[i + 1]);
+			i += 2;
+		}
+		else if(str_comp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+		{
+			pCheckpoint = argv[i + 1];
+			i += 2;
+		}
+		else
+		{
+			const int Used = NumDatabases < 2 ? (NumDatabases == 0 ? Source : Destination).Parse(argc - i, argv + i) : 0;
+			if(Used == 0)
+			{
+				Usage();
+				return -1;
+			}
+			NumDatabases++;
+			i += Used;
+		}
+	}
+	if(NumDatabases != 2 || BatchSize <= 0 || NumJobs <= 0 || Source.m_Type == CDatabase::TYPE_CSV)
+	{
+		Usage();
+		return -1;
+	}
+	if(Destination.m_Type != CDatabase::TYPE_MYSQL && NumJobs > 1)
+	{
+		// SQLite only allows one writer at a time and csv rows are appended
+		// in order, so resuming doesn't write rows twice
+		log_info(TOOL_NAME, "using a single job for %s destinations", Destination.m_Type == CDatabase::TYPE_CSV ? "csv" : "sqlite");
+		NumJobs = 1;
+	}
+
+	std::vector<CTable> vTables;
+	for(const CTable &Table : AllTables())
+	{
+		const char *pFound = str_find(pTables, Table.m_pName);
+		const int Length = str_length(Table.m_pName);
+		// match whole names only, "race" is part of "teamrace"
+		while(pFound && ((pFound != pTables && pFound[-1] != ',') || (pFound[Length] != '\0' && pFound[Length] != ',')))
+			pFound = str_find(pFound + 1, Table.m_pName);
+		if(pFound)
+			vTables.push_back(Table);
+	}
+	if(vTables.empty())
+	{
+		log_error(TOOL_NAME, "no known tables in '%s'", pTables);
+		return -1;
+	}
+
+	if((Source.m_Type == CDatabase::TYPE_MYSQL || Destination.m_Type == CDatabase::TYPE_MYSQL) && !MysqlAvailable())
+	{
+		log_error(TOOL_NAME, "compiled without MySQL support");
+		return -1;
+	}
+	if(MysqlInit() != 0)
+	{
+		log_error("mysql", "failed to initialize MySQL library");
+		return -1;
+	}
+
+	CCheckpoint Checkpoint;
+	if(pCheckpoint && !Checkpoint.Open(pCheckpoint))
+	{
+		log_error(TOOL_NAME, "failed to open checkpoint file '%s'", pCheckpoint);
+		MysqlUninit();
+		return -1;
+	}
+
+	CTransfer Transfer(Source, Destination, BatchSize, NumJobs, Checkpoint);
+	bool Success = true;
+	for(const CTable &Table : vTables)
+	{
+		if(!Transfer.Run(Table))
+		{
+			Success = false;
+			break;
+		}
+	}
+	MysqlUninit();
+	return Success ? 0 : -1;
+}
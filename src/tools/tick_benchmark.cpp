@@ -0,0 +1,547 @@
+#include <base/hash.h>
+#include <base/io.h>
+#include <base/logger.h>
+#include <base/os.h>
+#include <base/str.h>
+#include <base/time.h>
+
+#include <engine/console.h>
+#include <engine/engine.h>
+#include <engine/server/antibot.h>
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+#include <engine/server/server.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/json.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <game/server/entities/character.h>
+#include <game/server/gamecontext.h>
+#include <game/server/teehistorian.h>
+#include <game/version.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+static const char *TOOL_NAME = "tick_benchmark";
+
+bool IsInterrupted()
+{
+	return false;
+}
+
+/**
+ * Replays the clients of a teehistorian file on a server without networking
+ * and measures the time spent in each tick.
+ *
+ * Joins, drops, game messages and inputs are fed to the server in the tick
+ * they were recorded in, the recorded positions are compared with the
+ * replayed ones to check that the replay behaves like the recorded game.
+ * Snapshots and deltas are created like `CServer::DoSnapshot` does, assuming
+ * that all clients acknowledge every snapshot immediately.
+ */
+class CTickBenchmark
+{
+public:
+	enum
+	{
+		PHASE_INPUT,
+		PHASE_WORLD,
+		PHASE_SNAP,
+		PHASE_DELTA,
+		NUM_PHASES,
+	};
+
+	static constexpr const char *PHASE_NAMES[NUM_PHASES] = {"input", "world tick", "snap", "delta"};
+
+private:
+	CServer *m_pServer;
+	CGameContext *m_pGameServer;
+
+	CNetObj_PlayerInput m_aInputs[MAX_CLIENTS];
+	bool m_aHasInput[MAX_CLIENTS] = {};
+	bool m_aJoinSixup[MAX_CLIENTS] = {};
+
+	int64_t m_aPhaseTimes[NUM_PHASES] = {};
+	// time spent on events between the ticks, counted towards the next tick
+	int64_t m_PendingEventTime = 0;
+	std::vector<int64_t> m_vTickTimes;
+
+	int m_NumPositions = 0;
+	int m_NumPositionMismatches = 0;
+	int m_FirstMismatchTick = -1;
+	int m_NumSkippedCommands = 0;
+
+	bool Ingame(int ClientId) const
+	{
+		return m_pServer->m_aClients[ClientId].m_State == CServer::CClient::STATE_INGAME;
+	}
+
+	const int *Input(int ClientId) const
+	{
+		return m_aHasInput[ClientId] ? (const int *)&m_aInputs[ClientId] : nullptr;
+	}
+
+	void Snap()
+	{
+		const bool IsGlobalSnap = m_pServer->Config()->m_SvHighBandwidth || (m_pServer->Tick() % 2) == 0;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CServer::CClient &Client = m_pServer->m_aClients[i];
+			if(Client.m_State != CServer::CClient::STATE_INGAME)
+				continue;
+			if(!IsGlobalSnap && !(Client.m_ForceHighBandwidthOnSpectate && m_pGameServer->IsClientHighBandwidth(i)))
+				continue;
+
+			int64_t Start = time_get();
+			m_pServer->m_SnapshotBuilder.Init(Client.m_Sixup);
+			m_pGameServer->OnSnap(i, IsGlobalSnap, false);
+			CSnapshotBuffer Data;
+			const int SnapshotSize = m_pServer->m_SnapshotBuilder.Finish(&Data);
+			int64_t End = time_get();
+			m_aPhaseTimes[PHASE_SNAP] += End - Start;
+			Start = End;
+
+			Data.AsSnapshot()->Crc();
+			Client.m_Snapshots.PurgeUntil(m_pServer->Tick() - m_pServer->TickSpeed() * 3);
+			Client.m_Snapshots.Add(m_pServer->Tick(), Start, SnapshotSize, Data.AsSnapshot(), 0, nullptr);
+			const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+			Client.m_Snapshots.Get(Client.m_LastAckedSnapshot, nullptr, &pDeltashot, nullptr);
+
+			CSnapshotDelta *const pSnapshotDelta = Client.m_Sixup ? &m_pServer->m_SnapshotDeltaSixup : &m_pServer->m_SnapshotDelta;
+			char aDeltaData[CSnapshot::MAX_SIZE];
+			const int DeltaSize = pSnapshotDelta->CreateDelta(pDeltashot, Data.AsSnapshot(), aDeltaData);
+			if(DeltaSize)
+			{
+				char aCompData[CSnapshot::MAX_SIZE];
+				CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
+			}
+			Client.m_LastAckedSnapshot = m_pServer->Tick();
+			Client.m_SnapRate = CServer::CClient::SNAPRATE_FULL;
+			m_aPhaseTimes[PHASE_DELTA] += time_get() - Start;
+		}
+		if(IsGlobalSnap)
+		{
+			const int64_t Start = time_get();
+			m_pGameServer->OnPostGlobalSnap();
+			m_aPhaseTimes[PHASE_SNAP] += time_get() - Start;
+		}
+	}
+
+	// mirrors the tick loop of `CServer::Run`
+	void RunTick()
+	{
+		const int64_t TickStart = time_get();
+
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(Ingame(c))
+				m_pGameServer->OnClientPredictedEarlyInput(c, Input(c));
+		}
+		m_pServer->m_CurrentGameTick++;
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(Ingame(c))
+				m_pGameServer->OnClientPredictedInput(c, Input(c));
+		}
+		const int64_t WorldStart = time_get();
+		m_aPhaseTimes[PHASE_INPUT] += WorldStart - TickStart + m_PendingEventTime;
+
+		m_pGameServer->OnTick();
+		m_aPhaseTimes[PHASE_WORLD] += time_get() - WorldStart;
+
+		Snap();
+
+		m_vTickTimes.push_back(time_get() - TickStart + m_PendingEventTime);
+		m_PendingEventTime = 0;
+	}
+
+	void CheckPosition(const CTeeHistorianReader::CChunk &Chunk)
+	{
+		CCharacter *pChr = m_pGameServer->GetPlayerChar(Chunk.m_ClientId);
+		bool Match;
+		if(Chunk.m_Type == CTeeHistorianReader::CHUNK_PLAYER)
+		{
+			CNetObj_CharacterCore Core;
+			if(pChr)
+				pChr->GetCore().Write(&Core);
+			Match = pChr && Core.m_X == Chunk.m_X && Core.m_Y == Chunk.m_Y;
+		}
+		else
+		{
+			Match = !pChr;
+		}
+		m_NumPositions++;
+		if(!Match)
+		{
+			m_NumPositionMismatches++;
+			if(m_FirstMismatchTick < 0)
+				m_FirstMismatchTick = Chunk.m_Tick;
+		}
+	}
+
+	void OnEx(const CTeeHistorianReader::CChunk &Chunk)
+	{
+		const int Id = g_UuidManager.LookupUuid(Chunk.m_Uuid);
+		if(Id != TEEHISTORIAN_JOINVER6 && Id != TEEHISTORIAN_JOINVER7 && Id != TEEHISTORIAN_PLAYER_READY)
+			return;
+
+		CUnpacker Unpacker;
+		Unpacker.Reset(Chunk.m_pData, Chunk.m_DataSize);
+		const int ClientId = Unpacker.GetInt();
+		if(Unpacker.Error() || ClientId < 0 || ClientId >= MAX_CLIENTS)
+			return;
+
+		if(Id == TEEHISTORIAN_PLAYER_READY)
+		{
+			// like `CServer::OnNetMsgEnterGame`, without sending the server info
+			if(m_pServer->m_aClients[ClientId].m_State == CServer::CClient::STATE_READY)
+			{
+				m_pServer->m_aClients[ClientId].m_State = CServer::CClient::STATE_INGAME;
+				m_pGameServer->OnClientEnter(ClientId);
+			}
+		}
+		else
+		{
+			m_aJoinSixup[ClientId] = Id == TEEHISTORIAN_JOINVER7;
+		}
+	}
+
+	void OnChunk(const CTeeHistorianReader::CChunk &Chunk)
+	{
+		const int ClientId = Chunk.m_ClientId;
+		switch(Chunk.m_Type)
+		{
+		case CTeeHistorianReader::CHUNK_PLAYER:
+		case CTeeHistorianReader::CHUNK_PLAYER_OLD:
+			CheckPosition(Chunk);
+			break;
+		case CTeeHistorianReader::CHUNK_INPUT:
+			m_aInputs[ClientId] = Chunk.m_Input;
+			m_aHasInput[ClientId] = true;
+			break;
+		case CTeeHistorianReader::CHUNK_MESSAGE:
+			if(m_pServer->m_aClients[ClientId].m_State >= CServer::CClient::STATE_READY)
+			{
+				CNetChunk Packet;
+				Packet.m_ClientId = ClientId;
+				Packet.m_Address = *m_pServer->ClientAddr(ClientId);
+				Packet.m_Flags = NET_CHUNKFLAG_VITAL;
+				Packet.m_DataSize = Chunk.m_DataSize;
+				Packet.m_pData = Chunk.m_pData;
+				m_pServer->ProcessClientPacket(&Packet);
+			}
+			break;
+		case CTeeHistorianReader::CHUNK_JOIN:
+			if(m_pServer->m_aClients[ClientId].m_State == CServer::CClient::STATE_EMPTY)
+			{
+				// the map download is not recorded, the client is ready immediately
+				m_pServer->ConnectDebugDummy(ClientId, m_aJoinSixup[ClientId]);
+				m_pServer->m_aClients[ClientId].m_State = CServer::CClient::STATE_CONNECTING;
+				m_pServer->OnNetMsgReady(ClientId);
+			}
+			m_aHasInput[ClientId] = false;
+			break;
+		case CTeeHistorianReader::CHUNK_DROP:
+			if(m_pServer->m_aClients[ClientId].m_State != CServer::CClient::STATE_EMPTY)
+			{
+				CServer::DelClientCallback(ClientId, Chunk.m_pString, m_pServer);
+			}
+			m_aHasInput[ClientId] = false;
+			m_aJoinSixup[ClientId] = false;
+			break;
+		case CTeeHistorianReader::CHUNK_CONSOLE_COMMAND:
+			// chat commands are replayed through their messages, rcon
+			// commands are not recorded in a way that can be replayed
+			m_NumSkippedCommands++;
+			break;
+		case CTeeHistorianReader::CHUNK_EX:
+			OnEx(Chunk);
+			break;
+		case CTeeHistorianReader::CHUNK_FINISH:
+			break;
+		}
+	}
+
+	static double Milliseconds(int64_t Time)
+	{
+		return Time * 1000.0 / time_freq();
+	}
+
+public:
+	CTickBenchmark(CServer *pServer, CGameContext *pGameServer) :
+		m_pServer(pServer),
+		m_pGameServer(pGameServer)
+	{
+	}
+
+	bool Run(CTeeHistorianReader *pReader)
+	{
+		CTeeHistorianReader::CChunk Chunk;
+		while(pReader->Read(&Chunk))
+		{
+			while(m_pServer->Tick() < Chunk.m_Tick)
+			{
+				RunTick();
+			}
+			const int64_t Start = time_get();
+			OnChunk(Chunk);
+			m_PendingEventTime += time_get() - Start;
+		}
+		if(pReader->Error())
+		{
+			log_error(TOOL_NAME, "Failed to read teehistorian file after tick %d", m_pServer->Tick());
+			return false;
+		}
+		if(!pReader->Finished())
+		{
+			log_warn(TOOL_NAME, "Teehistorian file ends without finish marker, the server may have crashed");
+		}
+		return true;
+	}
+
+	void Report() const
+	{
+		if(m_vTickTimes.empty())
+		{
+			log_info(TOOL_NAME, "No ticks replayed");
+			return;
+		}
+
+		std::vector<int64_t> vSorted = m_vTickTimes;
+		std::sort(vSorted.begin(), vSorted.end());
+		int64_t Total = 0;
+		for(int64_t Time : vSorted)
+		{
+			Total += Time;
+		}
+		const int NumTicks = vSorted.size();
+		log_info(TOOL_NAME, "Replayed %d ticks in %.2fs, %.0f ticks/s (%.1fx real time)",
+			NumTicks, Total / (double)time_freq(), NumTicks * (double)time_freq() / Total, NumTicks * (double)time_freq() / Total / (double)SERVER_TICK_SPEED);
+		log_info(TOOL_NAME, "Tick time: mean %.3fms, p50 %.3fms, p99 %.3fms, max %.3fms",
+			Milliseconds(Total) / NumTicks, Milliseconds(vSorted[NumTicks / 2]), Milliseconds(vSorted[std::min(NumTicks - 1, NumTicks * 99 / 100)]), Milliseconds(vSorted.back()));
+		for(int Phase = 0; Phase < NUM_PHASES; Phase++)
+		{
+			log_info(TOOL_NAME, "  %-10s %.3fms per tick (%.1f%%)", PHASE_NAMES[Phase], Milliseconds(m_aPhaseTimes[Phase]) / NumTicks, m_aPhaseTimes[Phase] * 100.0 / Total);
+		}
+		if(m_NumPositionMismatches > 0)
+		{
+			log_warn(TOOL_NAME, "%d of %d recorded positions differ from the replay, starting in tick %d", m_NumPositionMismatches, m_NumPositions, m_FirstMismatchTick);
+		}
+		else
+		{
+			log_info(TOOL_NAME, "All %d recorded positions match the replay", m_NumPositions);
+		}
+		if(m_NumSkippedCommands > 0)
+		{
+			log_info(TOOL_NAME, "Skipped %d console commands", m_NumSkippedCommands);
+		}
+	}
+};
+
+// applies the configuration or tuning stored in the header of a teehistorian file
+static void ApplyHeader(IConsole *pConsole, const json_value *pHeader, bool Tuning)
+{
+	const json_value *pObject = json_object_get(pHeader, Tuning ? "tuning" : "config");
+	if(pObject->type != json_object)
+		return;
+	for(unsigned i = 0; i < pObject->u.object.length; i++)
+	{
+		const char *pName = pObject->u.object.values[i].name;
+		const char *pValue = json_string_get(pObject->u.object.values[i].value);
+		if(!pValue)
+			continue;
+		char aLine[1024];
+		if(Tuning)
+		{
+			// tuning values are stored in hundredths
+			str_format(aLine, sizeof(aLine), "tune %s %.2f", pName, str_toint(pValue) / 100.0f);
+		}
+		else
+		{
+			char aValue[512];
+			char *pDst = aValue;
+			str_escape(&pDst, pValue, aValue + sizeof(aValue));
+			str_format(aLine, sizeof(aLine), "%s \"%s\"", pName, aValue);
+		}
+		pConsole->ExecuteLine(aLine, IConsole::CLIENT_ID_UNSPECIFIED, false);
+	}
+}
+
+static void Usage()
+{
+	log_error(TOOL_NAME, "Usage: %s [--map <name>] [--verbose] <teehistorian file>", TOOL_NAME);
+	log_error(TOOL_NAME, "Replays the clients of a teehistorian file without networking and reports the tick times.");
+	log_error(TOOL_NAME, "The map is looked up in the maps folder, by default with the name stored in the file.");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	std::shared_ptr<ILogger> pStdoutLogger = log_logger_stdout();
+	log_set_global_logger(log_logger_collection({pStdoutLogger}).release());
+
+	const char *pMapName = nullptr;
+	const char *pFilename = nullptr;
+	bool Verbose = false;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "--map") == 0 && i + 1 < argc)
+		{
+			pMapName = argv[++i];
+		}
+		else if(str_comp(argv[i], "--verbose") == 0)
+		{
+			Verbose = true;
+		}
+		else if(!pFilename)
+		{
+			pFilename = argv[i];
+		}
+		else
+		{
+			Usage();
+			return -1;
+		}
+	}
+	if(!pFilename)
+	{
+		Usage();
+		return -1;
+	}
+	if(!Verbose)
+	{
+		// the server logs a lot while replaying, only show the results
+		CLogFilter Filter;
+		Filter.m_MaxLevel = LEVEL_WARN;
+		pStdoutLogger->SetFilter(Filter);
+	}
+
+	void *pData;
+	unsigned DataSize;
+	if(!io_read_all(io_open(pFilename, IOFLAG_READ), &pData, &DataSize))
+	{
+		log_error(TOOL_NAME, "Failed to read teehistorian file '%s'", pFilename);
+		return -1;
+	}
+	std::unique_ptr<void, decltype(&free)> pDataOwner(pData, free);
+
+	CTeeHistorianReader Reader;
+	json_value *pHeader = Reader.Open(pData, DataSize) ? json_parse(Reader.Header(), str_length(Reader.Header())) : nullptr;
+	if(!pHeader || pHeader->type != json_object)
+	{
+		log_error(TOOL_NAME, "'%s' is not a valid teehistorian file", pFilename);
+		json_value_free(pHeader);
+		return -1;
+	}
+	if(!pMapName)
+	{
+		pMapName = json_string_get(json_object_get(pHeader, "map_name"));
+		if(!pMapName)
+		{
+			log_error(TOOL_NAME, "Teehistorian file does not contain a map name");
+			json_value_free(pHeader);
+			return -1;
+		}
+	}
+
+	if(MysqlInit() != 0)
+	{
+		log_error("mysql", "failed to initialize MySQL library");
+		json_value_free(pHeader);
+		return -1;
+	}
+
+	CServer *pServer = CreateServer();
+	std::unique_ptr<IKernel> pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+	pKernel->RegisterInterface(pServer);
+
+	IEngine *pEngine = CreateEngine(GAME_NAME, std::make_shared<CFutureLogger>());
+	pKernel->RegisterInterface(pEngine);
+
+	IStorage *pStorage = CreateStorage(IStorage::EInitializationType::SERVER, argc, argv);
+	if(!pStorage)
+	{
+		log_error(TOOL_NAME, "Failed to initialize storage");
+		json_value_free(pHeader);
+		return -1;
+	}
+	pKernel->RegisterInterface(pStorage);
+
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER | CFGFLAG_ECON).release();
+	pKernel->RegisterInterface(pConsole);
+
+	IConfigManager *pConfigManager = CreateConfigManager();
+	pKernel->RegisterInterface(pConfigManager);
+
+	IEngineAntibot *pEngineAntibot = CreateEngineAntibot();
+	pKernel->RegisterInterface(pEngineAntibot);
+	pKernel->RegisterInterface(static_cast<IAntibot *>(pEngineAntibot), false);
+
+	CGameContext *pGameServer = (CGameContext *)CreateGameServer();
+	pKernel->RegisterInterface(static_cast<IGameServer *>(pGameServer));
+
+	pEngine->Init();
+	pConsole->Init();
+	pConfigManager->Init();
+	pServer->RegisterCommands();
+
+	// replay with the configuration of the recorded server, but do not record again,
+	// do not touch the recorded server's databases and do not open any inputs
+	ApplyHeader(pConsole, pHeader, false);
+	char aSqliteFile[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aSqliteFile, sizeof(aSqliteFile), "tick_benchmark.sqlite");
+	pConsole->ExecuteLine("sv_tee_historian 0", IConsole::CLIENT_ID_UNSPECIFIED);
+	pConsole->ExecuteLine("sv_use_sql 0", IConsole::CLIENT_ID_UNSPECIFIED);
+	pConsole->ExecuteLine("ec_port 0", IConsole::CLIENT_ID_UNSPECIFIED);
+	pConsole->ExecuteLine("sv_input_fifo \"\"", IConsole::CLIENT_ID_UNSPECIFIED);
+	str_copy(pServer->Config()->m_SvSqliteFile, aSqliteFile);
+	str_copy(pServer->Config()->m_SvMap, pMapName);
+
+	pServer->m_RunServer = CServer::RUNNING;
+	pServer->m_AuthManager.Init();
+	if(!pServer->InitMapAndDatabases())
+	{
+		json_value_free(pHeader);
+		return -1;
+	}
+
+	const char *pMapSha256 = json_string_get(json_object_get(pHeader, "map_sha256"));
+	char aMapSha256[SHA256_MAXSTRSIZE];
+	sha256_str(pServer->m_aCurrentMapSha256[CServer::MAP_TYPE_SIX], aMapSha256, sizeof(aMapSha256));
+	if(pMapSha256 && str_comp(pMapSha256, aMapSha256) != 0)
+	{
+		log_warn(TOOL_NAME, "Map '%s' differs from the recorded map, the replay will diverge", pMapName);
+	}
+
+	if(!pServer->m_Http.Init(std::chrono::seconds{2}))
+	{
+		log_error(TOOL_NAME, "Failed to initialize the HTTP client");
+	}
+	pServer->InitGameServer();
+
+	ApplyHeader(pConsole, pHeader, true);
+	json_value_free(pHeader);
+
+	pServer->m_GameStartTime = time_get();
+	CTickBenchmark Benchmark(pServer, pGameServer);
+	const bool Success = Benchmark.Run(&Reader);
+
+	CLogFilter Filter;
+	pStdoutLogger->SetFilter(Filter);
+	Benchmark.Report();
+
+	pServer->m_Econ.Shutdown();
+	pServer->m_Fifo.Shutdown();
+	pGameServer->OnShutdown(nullptr);
+	pServer->DbPool()->OnShutdown();
+	pStorage->RemoveFile(aSqliteFile, IStorage::TYPE_SAVE);
+	pKernel.reset();
+	MysqlUninit();
+
+	return Success ? 0 : -1;
+}